@@ -22,13 +22,24 @@ Q := @
 ECHO = @echo
 endif
 
+################################################################################
+# Target platform ("stm32" for Core Module or "host" for POSIX simulation)     #
+################################################################################
+
+TARGET ?= stm32
+
 ################################################################################
 # Directories                                                                  #
 ################################################################################
 
 APP_DIR ?= app
+ifeq ($(TARGET),host)
+OBJ_DIR ?= obj/host
+OUT_DIR ?= out/host
+else
 OBJ_DIR ?= obj
 OUT_DIR ?= out
+endif
 SDK_DIR ?= sdk
 
 ################################################################################
@@ -45,6 +56,7 @@ TYPE ?= debug
 ELF ?= $(OUT_DIR)/$(TYPE)/$(OUT).elf
 MAP ?= $(OUT_DIR)/$(TYPE)/$(OUT).map
 BIN ?= $(OUT_DIR)/$(TYPE)/$(OUT).bin
+DICT ?= $(OUT_DIR)/$(TYPE)/$(OUT).dict
 
 ################################################################################
 # Linker script                                                                #
@@ -57,6 +69,10 @@ LINKER_SCRIPT ?= $(SDK_DIR)/sys/lkr/stm32l083cz.ld
 ################################################################################
 
 INC_DIR += $(APP_DIR)
+ifeq ($(TARGET),host)
+INC_DIR += $(SDK_DIR)/twr/host/inc
+INC_DIR += $(SDK_DIR)/twr/inc
+else
 INC_DIR += $(SDK_DIR)/twr/inc
 INC_DIR += $(SDK_DIR)/twr/stm/inc
 INC_DIR += $(SDK_DIR)/bcl/inc
@@ -64,6 +80,7 @@ INC_DIR += $(SDK_DIR)/stm/hal/inc
 INC_DIR += $(SDK_DIR)/stm/spirit1/inc
 INC_DIR += $(SDK_DIR)/stm/usb/inc
 INC_DIR += $(SDK_DIR)/sys/inc
+endif
 INC_DIR += $(SDK_DIR)/lib/jsmn
 INC_DIR += $(SDK_DIR)/lib/minmea
 
@@ -72,20 +89,64 @@ INC_DIR += $(SDK_DIR)/lib/minmea
 ################################################################################
 
 SRC_DIR += $(APP_DIR)
+ifeq ($(TARGET),host)
+SRC_DIR += $(SDK_DIR)/twr/host/src
+else
 SRC_DIR += $(SDK_DIR)/twr/src
 SRC_DIR += $(SDK_DIR)/twr/stm/src
 SRC_DIR += $(SDK_DIR)/stm/hal/src
 SRC_DIR += $(SDK_DIR)/stm/spirit1/src
 SRC_DIR += $(SDK_DIR)/stm/usb/src
 SRC_DIR += $(SDK_DIR)/sys/src
+endif
 SRC_DIR += $(SDK_DIR)/lib/jsmn
 SRC_DIR += $(SDK_DIR)/lib/minmea
 
+################################################################################
+# Hardware independent modules built for host (peripherals are in twr/host)    #
+################################################################################
+
+SRC_HOST += twr_aes_ccm.c
+SRC_HOST += twr_atci.c
+SRC_HOST += twr_base64.c
+SRC_HOST += twr_button.c
+SRC_HOST += twr_config.c
+SRC_HOST += twr_crc.c
+SRC_HOST += twr_data_stream.c
+SRC_HOST += twr_defer.c
+SRC_HOST += twr_dice.c
+SRC_HOST += twr_error.c
+SRC_HOST += twr_event_flags.c
+SRC_HOST += twr_fifo.c
+SRC_HOST += twr_font_ubuntu_11.c
+SRC_HOST += twr_font_ubuntu_13.c
+SRC_HOST += twr_font_ubuntu_15.c
+SRC_HOST += twr_font_ubuntu_24.c
+SRC_HOST += twr_font_ubuntu_28.c
+SRC_HOST += twr_font_ubuntu_33.c
+SRC_HOST += twr_gfx.c
+SRC_HOST += twr_info.c
+SRC_HOST += twr_irq.c
+SRC_HOST += twr_led.c
+SRC_HOST += twr_log.c
+SRC_HOST += twr_queue.c
+SRC_HOST += twr_radio.c
+SRC_HOST += twr_radio_node.c
+SRC_HOST += twr_radio_pub.c
+SRC_HOST += twr_ramp.c
+SRC_HOST += twr_scheduler.c
+SRC_HOST += twr_sha256.c
+SRC_HOST += twr_sleep.c
+
 ################################################################################
 # Toolchain                                                                    #
 ################################################################################
 
+ifeq ($(TARGET),host)
+TOOLCHAIN ?=
+else
 TOOLCHAIN ?= arm-none-eabi-
+endif
 CC = $(TOOLCHAIN)gcc
 GDB = $(TOOLCHAIN)gdb
 OBJCOPY = $(TOOLCHAIN)objcopy
@@ -99,9 +160,14 @@ VSCODE ?= code
 # Compiler flags for "c" files                                                 #
 ################################################################################
 
+ifeq ($(TARGET),host)
+CFLAGS += -D'_GNU_SOURCE'
+CFLAGS += -D'TWR_HOST'
+else
 CFLAGS += -mcpu=cortex-m0plus
 CFLAGS += -mthumb
 CFLAGS += -mlittle-endian
+endif
 CFLAGS += -Wall
 CFLAGS += -pedantic
 CFLAGS += -Wextra
@@ -110,9 +176,11 @@ CFLAGS += -Wswitch-default
 CFLAGS += -Wswitch-enum
 CFLAGS += -D'__weak=__attribute__((weak))'
 CFLAGS += -D'__packed=__attribute__((__packed__))'
+ifneq ($(TARGET),host)
 CFLAGS += -D'USE_HAL_DRIVER'
 CFLAGS += -D'STM32L083xx'
 CFLAGS += -D'HAL_IWDG_MODULE_ENABLED'
+endif
 CFLAGS += -ffunction-sections
 CFLAGS += -fdata-sections
 CFLAGS += -std=c11
@@ -125,11 +193,87 @@ CFLAGS_RELEASE += -D'RELEASE'
 BAND ?= 868
 CFLAGS += -D'BAND=$(BAND)'
 
+TICK_LPTIM ?=
+ifneq ($(TICK_LPTIM),)
+  CFLAGS += -D'TWR_TICK_LPTIM=$(TICK_LPTIM)'
+endif
+
+SCHEDULER_MAX_TASKS ?=
+ifneq ($(SCHEDULER_MAX_TASKS),)
+  CFLAGS += -D'TWR_SCHEDULER_MAX_TASKS=$(SCHEDULER_MAX_TASKS)'
+endif
+
 SCHEDULER_INTERVAL ?=
 ifneq ($(SCHEDULER_INTERVAL),)
   CFLAGS += -D'TWR_SCHEDULER_INTERVAL_MS=$(SCHEDULER_INTERVAL)'
 endif
 
+SCHEDULER_TICKLESS ?=
+ifneq ($(SCHEDULER_TICKLESS),)
+  CFLAGS += -D'TWR_SCHEDULER_TICKLESS=$(SCHEDULER_TICKLESS)'
+endif
+
+# Deadline heap pays off only with large task pools (SCHEDULER_MAX_TASKS of about a hundred and more)
+SCHEDULER_HEAP ?=
+ifneq ($(SCHEDULER_HEAP),)
+  CFLAGS += -D'TWR_SCHEDULER_HEAP=$(SCHEDULER_HEAP)'
+endif
+
+SCHEDULER_STATS ?=
+ifneq ($(SCHEDULER_STATS),)
+  CFLAGS += -D'TWR_SCHEDULER_STATS=$(SCHEDULER_STATS)'
+endif
+
+RADIO_PUB_BATCH ?=
+ifneq ($(RADIO_PUB_BATCH),)
+  CFLAGS += -D'TWR_RADIO_PUB_BATCH=$(RADIO_PUB_BATCH)'
+endif
+
+RADIO_PUB_BATCH_LATENCY ?=
+ifneq ($(RADIO_PUB_BATCH_LATENCY),)
+  CFLAGS += -D'TWR_RADIO_PUB_BATCH_LATENCY_MS=$(RADIO_PUB_BATCH_LATENCY)'
+endif
+
+RADIO_PUB_TOPIC ?=
+ifneq ($(RADIO_PUB_TOPIC),)
+  CFLAGS += -D'TWR_RADIO_PUB_TOPIC_LENGTH=$(RADIO_PUB_TOPIC)'
+endif
+
+RADIO_PUB_TOPIC_GATEWAY ?=
+ifneq ($(RADIO_PUB_TOPIC_GATEWAY),)
+  CFLAGS += -D'TWR_RADIO_PUB_TOPIC_GATEWAY_LENGTH=$(RADIO_PUB_TOPIC_GATEWAY)'
+endif
+
+RADIO_LINK_STATS ?=
+ifneq ($(RADIO_LINK_STATS),)
+  CFLAGS += -D'TWR_RADIO_LINK_STATS=$(RADIO_LINK_STATS)'
+endif
+
+RADIO_LINK_PUB_INTERVAL ?=
+ifneq ($(RADIO_LINK_PUB_INTERVAL),)
+  CFLAGS += -D'TWR_RADIO_LINK_PUB_INTERVAL_MS=$(RADIO_LINK_PUB_INTERVAL)'
+endif
+
+RADIO_MAX_DEVICES ?=
+ifneq ($(RADIO_MAX_DEVICES),)
+  CFLAGS += -D'TWR_RADIO_MAX_DEVICES=$(RADIO_MAX_DEVICES)'
+endif
+
+RADIO_CCA ?=
+ifneq ($(RADIO_CCA),)
+  CFLAGS += -D'TWR_RADIO_CCA=$(RADIO_CCA)'
+endif
+
+RADIO_SECURITY ?=
+ifneq ($(RADIO_SECURITY),)
+  CFLAGS += -D'TWR_RADIO_SECURITY=$(RADIO_SECURITY)'
+endif
+
+LOG_TOKEN ?=
+ifneq ($(LOG_TOKEN),)
+  CFLAGS += -D'TWR_LOG_TOKEN=$(LOG_TOKEN)'
+endif
+
 ################################################################################
 # Compiler flags for "s" files                                                 #
 ################################################################################
@@ -145,6 +289,11 @@ ASFLAGS_RELEASE += -Os
 # Linker flags                                                                 #
 ################################################################################
 
+ifeq ($(TARGET),host)
+LDFLAGS += -Wl,-Map=$(MAP)
+LDFLAGS += -Wl,--gc-sections
+LDLIBS += -lm
+else
 LDFLAGS += -mcpu=cortex-m0plus
 LDFLAGS += -mthumb
 LDFLAGS += -mlittle-endian
@@ -157,12 +306,16 @@ LDFLAGS += -Wl,--gc-sections
 LDFLAGS += -Wl,--print-memory-usage
 LDFLAGS += -Wl,-u,__errno
 LDFLAGS += --specs=nosys.specs
+endif
 
 ################################################################################
 # Create list of files for compilation                                         #
 ################################################################################
 
 SRC_C = $(foreach dir,$(SRC_DIR),$(wildcard $(dir)/*.c))
+ifeq ($(TARGET),host)
+SRC_C += $(addprefix $(SDK_DIR)/twr/src/,$(SRC_HOST))
+endif
 SRC_S = $(foreach dir,$(SRC_DIR),$(wildcard $(dir)/*.s))
 
 ################################################################################
@@ -199,7 +352,9 @@ debug: $(ALLDEP)
 	$(Q)$(MAKE) .obj-debug
 	$(Q)$(MAKE) elf
 	$(Q)$(MAKE) size
+ifneq ($(TARGET),host)
 	$(Q)$(MAKE) bin
+endif
 
 ################################################################################
 # Release target                                                               #
@@ -211,7 +366,9 @@ release: $(ALLDEP)
 	$(Q)$(MAKE) .obj-release TYPE=release
 	$(Q)$(MAKE) elf TYPE=release
 	$(Q)$(MAKE) size TYPE=release
+ifneq ($(TARGET),host)
 	$(Q)$(MAKE) bin TYPE=release
+endif
 	$(Q)$(MAKE) .clean-obj TYPE=release
 
 ################################################################################
@@ -329,7 +486,12 @@ elf: $(ELF) $(ALLDEP)
 $(ELF): $(OBJ) $(ALLDEP)
 	$(Q)$(ECHO) "Linking object files..."
 	$(Q)mkdir -p $(OUT_DIR)/$(TYPE)
-	$(Q)$(CC) $(LDFLAGS) $(OBJ) -o $(ELF)
+	$(Q)$(CC) $(LDFLAGS) $(OBJ) $(LDLIBS) -o $(ELF)
+ifeq ($(LOG_TOKEN),1)
+	$(Q)$(ECHO) "Creating $(DICT) from $(ELF)..."
+	$(Q)$(OBJCOPY) --dump-section twr_log_fmt=$(DICT) $(ELF) $(DICT).elf
+	$(Q)rm -f $(DICT).elf
+endif
 
 ################################################################################
 # Print information about size of sections                                     #
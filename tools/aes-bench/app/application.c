@@ -0,0 +1,180 @@
+#include <application.h>
+
+// Benchmark of AES-CCM as radio uses it with TWR_RADIO_SECURITY. Known answer of RFC 3610 is checked first,
+// then frames of several sizes are sealed and opened over and over, time per frame and its energy are logged
+// along with time and energy the tag adds on air.
+
+#define BENCH_COUNT 1000
+
+// Head of radio frame and header byte are authenticated, the rest is encrypted and followed by tag
+#define BENCH_AAD_LENGTH 9
+#define BENCH_MIC_LENGTH 4
+#define BENCH_MAX_LENGTH 51
+
+// Supply voltage, run current of MCU and current of SPIRIT1 transmitting at +11 dBm, used for energy estimate
+#define BENCH_SUPPLY_MV 3000
+#define BENCH_RUN_CURRENT_UA 7000
+#define BENCH_TX_CURRENT_UA 21000
+
+// Radio sends 19200 bits per second
+#define BENCH_AIR_US_PER_BYTE 417
+
+static const size_t _bench_length[] = { 4, 23, BENCH_MAX_LENGTH };
+
+static bool _bench_vector(void);
+static void _bench_frame(size_t length);
+static uint32_t _bench_energy(uint32_t time_us, uint32_t current_ua);
+
+void application_init(void)
+{
+    twr_log_init(TWR_LOG_LEVEL_DUMP, TWR_LOG_TIMESTAMP_OFF);
+
+    twr_aes_init();
+}
+
+void application_task(void *param)
+{
+    (void) param;
+
+    if (!_bench_vector())
+    {
+        twr_log_error("APP: RFC 3610 vector failed");
+
+        return;
+    }
+
+    twr_log_info("APP: RFC 3610 vector passed");
+
+    for (size_t i = 0; i < sizeof(_bench_length) / sizeof(_bench_length[0]); i++)
+    {
+        _bench_frame(_bench_length[i]);
+
+        // Whole report does not fit in log FIFO, each line is written out before the next run
+        twr_log_flush();
+    }
+
+#ifdef TWR_HOST
+    exit(EXIT_SUCCESS);
+#endif
+}
+
+static bool _bench_vector(void)
+{
+    // Packet vector #1 of RFC 3610
+    static const uint8_t key_buffer[16] =
+    {
+        0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf
+    };
+    static const uint8_t nonce[TWR_AES_CCM_NONCE_SIZE] =
+    {
+        0x00, 0x00, 0x00, 0x03, 0x02, 0x01, 0x00, 0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5
+    };
+    static const uint8_t aad[8] =
+    {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07
+    };
+    static const uint8_t ciphertext[23] =
+    {
+        0x58, 0x8c, 0x97, 0x9a, 0x61, 0xc6, 0x63, 0xd2, 0xf0, 0x66, 0xd0, 0xc2, 0xc0, 0xf9, 0x89, 0x80,
+        0x6d, 0x5f, 0x6b, 0x61, 0xda, 0xc3, 0x84
+    };
+    static const uint8_t tag[8] =
+    {
+        0x17, 0xe8, 0xd1, 0x2c, 0xfd, 0xf9, 0x26, 0xe0
+    };
+
+    twr_aes_key_t key;
+    uint8_t plaintext[sizeof(ciphertext)];
+    uint8_t buffer[sizeof(ciphertext)];
+    uint8_t mic[sizeof(tag)];
+
+    twr_aes_key_from_uint8(key, key_buffer);
+
+    for (size_t i = 0; i < sizeof(plaintext); i++)
+    {
+        plaintext[i] = 0x08 + i;
+    }
+
+    if (!twr_aes_ccm_encrypt(buffer, mic, plaintext, sizeof(plaintext), aad, sizeof(aad), key, nonce, sizeof(mic)))
+    {
+        return false;
+    }
+
+    if ((memcmp(buffer, ciphertext, sizeof(ciphertext)) != 0) || (memcmp(mic, tag, sizeof(tag)) != 0))
+    {
+        return false;
+    }
+
+    if (!twr_aes_ccm_decrypt(buffer, ciphertext, sizeof(ciphertext), aad, sizeof(aad), key, nonce, tag, sizeof(tag)))
+    {
+        return false;
+    }
+
+    if (memcmp(buffer, plaintext, sizeof(plaintext)) != 0)
+    {
+        return false;
+    }
+
+    // Tampered tag has to be refused
+    mic[0] ^= 0x01;
+
+    return !twr_aes_ccm_decrypt(buffer, ciphertext, sizeof(ciphertext), aad, sizeof(aad), key, nonce, mic, sizeof(mic));
+}
+
+static void _bench_frame(size_t length)
+{
+    uint8_t frame[BENCH_AAD_LENGTH + BENCH_MAX_LENGTH + BENCH_MIC_LENGTH];
+    uint8_t buffer[BENCH_MAX_LENGTH];
+    uint8_t nonce[TWR_AES_CCM_NONCE_SIZE];
+    twr_aes_key_t key;
+    bool ok = true;
+
+    for (size_t i = 0; i < sizeof(frame); i++)
+    {
+        frame[i] = i;
+    }
+
+    memset(nonce, 0x5a, sizeof(nonce));
+
+    twr_aes_key_from_uint8(key, frame);
+
+    twr_tick_t tick_start = twr_tick_get();
+
+    for (int i = 0; i < BENCH_COUNT; i++)
+    {
+        ok &= twr_aes_ccm_encrypt(frame + BENCH_AAD_LENGTH, frame + BENCH_AAD_LENGTH + length, frame + BENCH_AAD_LENGTH, length,
+                                  frame, BENCH_AAD_LENGTH, key, nonce, BENCH_MIC_LENGTH);
+    }
+
+    twr_tick_t tick_seal = twr_tick_get() - tick_start;
+
+    tick_start = twr_tick_get();
+
+    for (int i = 0; i < BENCH_COUNT; i++)
+    {
+        ok &= twr_aes_ccm_decrypt(buffer, frame + BENCH_AAD_LENGTH, length, frame, BENCH_AAD_LENGTH, key, nonce,
+                                  frame + BENCH_AAD_LENGTH + length, BENCH_MIC_LENGTH);
+    }
+
+    twr_tick_t tick_open = twr_tick_get() - tick_start;
+
+    if (!ok)
+    {
+        twr_log_error("APP: Frame with %u bytes of payload failed", (unsigned) length);
+
+        return;
+    }
+
+    uint32_t seal_us = tick_seal * 1000 / BENCH_COUNT;
+    uint32_t open_us = tick_open * 1000 / BENCH_COUNT;
+    uint32_t air_us = BENCH_MIC_LENGTH * BENCH_AIR_US_PER_BYTE;
+
+    twr_log_info("APP: Payload %u B, seal %" PRIu32 " us %" PRIu32 " nJ, open %" PRIu32 " us %" PRIu32 " nJ, tag on air %" PRIu32 " us %" PRIu32 " nJ",
+                 (unsigned) length, seal_us, _bench_energy(seal_us, BENCH_RUN_CURRENT_UA), open_us, _bench_energy(open_us, BENCH_RUN_CURRENT_UA),
+                 air_us, _bench_energy(air_us, BENCH_TX_CURRENT_UA));
+}
+
+static uint32_t _bench_energy(uint32_t time_us, uint32_t current_ua)
+{
+    return (uint64_t) time_us * current_ua * BENCH_SUPPLY_MV / 1000000;
+}
@@ -0,0 +1,7 @@
+#ifndef _APPLICATION_H
+#define _APPLICATION_H
+
+#include <twr.h>
+#include <twr_aes.h>
+
+#endif // _APPLICATION_H
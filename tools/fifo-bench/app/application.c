@@ -0,0 +1,169 @@
+#include <application.h>
+
+// Benchmark of twr_fifo: data pass through FIFO in chunks of several sizes, once with the current lock-free
+// implementation and once with the former one, which masked interrupts for the whole call and copied byte by byte.
+// Throughput and time of one call are logged, for the former implementation it is also time with interrupts masked.
+
+#define BENCH_FIFO_SIZE 256
+#define BENCH_TOTAL 262144
+
+typedef struct
+{
+    const char *name;
+    size_t (*write)(twr_fifo_t *fifo, const void *buffer, size_t length);
+    size_t (*read)(twr_fifo_t *fifo, void *buffer, size_t length);
+    bool masked;
+
+} bench_implementation_t;
+
+static size_t _bench_legacy_write(twr_fifo_t *fifo, const void *buffer, size_t length);
+static size_t _bench_legacy_read(twr_fifo_t *fifo, void *buffer, size_t length);
+static void _bench_run(const bench_implementation_t *implementation, size_t chunk);
+
+static const bench_implementation_t _bench_implementation[] =
+{
+    { "former", _bench_legacy_write, _bench_legacy_read, true },
+    { "lock-free", twr_fifo_write, twr_fifo_read, false },
+};
+
+static const size_t _bench_chunk[] = { 1, 16, 64, 200 };
+
+void application_init(void)
+{
+    twr_log_init(TWR_LOG_LEVEL_DUMP, TWR_LOG_TIMESTAMP_OFF);
+}
+
+void application_task(void *param)
+{
+    (void) param;
+
+    for (size_t i = 0; i < sizeof(_bench_chunk) / sizeof(_bench_chunk[0]); i++)
+    {
+        for (size_t j = 0; j < sizeof(_bench_implementation) / sizeof(_bench_implementation[0]); j++)
+        {
+            _bench_run(&_bench_implementation[j], _bench_chunk[i]);
+
+            // Whole report does not fit in log FIFO, each line is written out before the next run
+            twr_log_flush();
+        }
+    }
+
+#ifdef TWR_HOST
+    exit(EXIT_SUCCESS);
+#endif
+}
+
+static void _bench_run(const bench_implementation_t *implementation, size_t chunk)
+{
+    static uint8_t fifo_buffer[BENCH_FIFO_SIZE];
+    uint8_t buffer[BENCH_FIFO_SIZE];
+    twr_fifo_t fifo;
+    uint8_t expected = 0;
+    uint8_t pattern = 0;
+    bool ok = true;
+
+    twr_fifo_init(&fifo, fifo_buffer, sizeof(fifo_buffer));
+
+    // Positions wrap around at odd offsets, so that copies are split in two segments now and then
+    twr_tick_t tick_start = twr_tick_get();
+
+    for (size_t total = 0; total < BENCH_TOTAL; total += chunk)
+    {
+        for (size_t i = 0; i < chunk; i++)
+        {
+            buffer[i] = pattern++;
+        }
+
+        ok &= implementation->write(&fifo, buffer, chunk) == chunk;
+
+        ok &= implementation->read(&fifo, buffer, chunk) == chunk;
+
+        for (size_t i = 0; i < chunk; i++)
+        {
+            ok &= buffer[i] == expected++;
+        }
+    }
+
+    twr_tick_t duration = twr_tick_get() - tick_start;
+
+    if (!ok)
+    {
+        twr_log_error("APP: %s FIFO corrupted data in chunks of %u B", implementation->name, (unsigned) chunk);
+
+        return;
+    }
+
+    if (duration == 0)
+    {
+        duration = 1;
+    }
+
+    uint32_t calls = 2 * (BENCH_TOTAL / chunk);
+    uint32_t throughput = (uint64_t) BENCH_TOTAL * 1000 / 1024 / duration;
+    uint32_t call_ns = (uint64_t) duration * 1000000 / calls;
+
+    twr_log_info("APP: %s, chunk %u B, %" PRIu32 " kB/s, %" PRIu32 " ns per call, %" PRIu32 " ns masked",
+                 implementation->name, (unsigned) chunk, throughput, call_ns, implementation->masked ? call_ns : 0);
+}
+
+// Former implementation, kept here for comparison only
+
+static size_t _bench_legacy_write(twr_fifo_t *fifo, const void *buffer, size_t length)
+{
+    twr_irq_disable();
+
+    for (size_t i = 0; i < length; i++)
+    {
+        if (((fifo->head + 1) == fifo->tail) || (((fifo->head + 1) == fifo->size) && (fifo->tail == 0)))
+        {
+            twr_irq_enable();
+
+            return i;
+        }
+
+        *((uint8_t *) fifo->buffer + fifo->head) = *(uint8_t *) buffer;
+
+        buffer = (uint8_t *) buffer + 1;
+
+        fifo->head++;
+
+        if (fifo->head == fifo->size)
+        {
+            fifo->head = 0;
+        }
+    }
+
+    twr_irq_enable();
+
+    return length;
+}
+
+static size_t _bench_legacy_read(twr_fifo_t *fifo, void *buffer, size_t length)
+{
+    twr_irq_disable();
+
+    for (size_t i = 0; i < length; i++)
+    {
+        if (fifo->tail == fifo->head)
+        {
+            twr_irq_enable();
+
+            return i;
+        }
+
+        *(uint8_t *) buffer = *((uint8_t *) fifo->buffer + fifo->tail);
+
+        buffer = (uint8_t *) buffer + 1;
+
+        fifo->tail++;
+
+        if (fifo->tail == fifo->size)
+        {
+            fifo->tail = 0;
+        }
+    }
+
+    twr_irq_enable();
+
+    return length;
+}
@@ -0,0 +1,6 @@
+#ifndef _APPLICATION_H
+#define _APPLICATION_H
+
+#include <twr.h>
+
+#endif // _APPLICATION_H
@@ -0,0 +1,513 @@
+// Decoder of tokenized log (firmware built with LOG_TOKEN=1). Dictionary is created next to ELF by the build,
+// frames are read from file, serial port (set to 115200 8N1 raw) or standard input and printed as text which
+// looks like output of firmware with plain log.
+//
+// Usage: log-decoder <firmware.dict> [<input>]
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define DUMP_WIDTH 8
+#define FRAME_SIZE 1024
+
+#define TYPE_INT32 0
+#define TYPE_INT64 1
+#define TYPE_FLOAT 2
+#define TYPE_STRING 3
+
+#define HEADER_LEVEL_MASK 0x07
+#define HEADER_TIMESTAMP_SHIFT 3
+#define HEADER_TIMESTAMP_MASK 0x03
+#define HEADER_OVERFLOW 0x80
+
+typedef struct
+{
+    const uint8_t *data;
+    size_t length;
+    size_t offset;
+    bool error;
+
+} reader_t;
+
+static uint8_t *_dictionary;
+static size_t _dictionary_length;
+
+static const char _level_id[] = { 'X', 'D', 'I', 'W', 'E' };
+
+static bool _load_dictionary(const char *path);
+static int _open_input(const char *path);
+static size_t _cobs_decode(uint8_t *buffer, size_t length);
+static void _decode_frame(const uint8_t *frame, size_t length);
+static void _print_message(const char *format, uint32_t types, reader_t *reader);
+static void _print_dump(const char *prefix, const uint8_t *data, size_t length);
+static uint64_t _read_varint(reader_t *reader);
+static int64_t _read_zigzag(reader_t *reader);
+static const uint8_t *_read_bytes(reader_t *reader, size_t *length);
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "Usage: %s <firmware.dict> [<input>]\n", argv[0]);
+
+        return EXIT_FAILURE;
+    }
+
+    if (!_load_dictionary(argv[1]))
+    {
+        return EXIT_FAILURE;
+    }
+
+    int fd = argc == 3 ? _open_input(argv[2]) : STDIN_FILENO;
+
+    if (fd < 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    static uint8_t frame[FRAME_SIZE];
+    size_t length = 0;
+    bool overrun = false;
+    uint8_t buffer[256];
+    ssize_t ret;
+
+    while ((ret = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (ssize_t i = 0; i < ret; i++)
+        {
+            if (buffer[i] != 0)
+            {
+                if (length < sizeof(frame))
+                {
+                    frame[length++] = buffer[i];
+                }
+                else
+                {
+                    overrun = true;
+                }
+
+                continue;
+            }
+
+            // Delimiter ends frame, garbage before the first one and frames too long are dropped
+            if (length != 0 && !overrun)
+            {
+                _decode_frame(frame, _cobs_decode(frame, length));
+            }
+
+            length = 0;
+            overrun = false;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static bool _load_dictionary(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL)
+    {
+        fprintf(stderr, "log-decoder: Cannot open %s: %s\n", path, strerror(errno));
+
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+
+    long size = ftell(file);
+
+    fseek(file, 0, SEEK_SET);
+
+    _dictionary = malloc(size + 1);
+
+    if (_dictionary == NULL || fread(_dictionary, 1, size, file) != (size_t) size)
+    {
+        fprintf(stderr, "log-decoder: Cannot read %s\n", path);
+
+        fclose(file);
+
+        return false;
+    }
+
+    // Last format is terminated even if dictionary is cut
+    _dictionary[size] = 0;
+    _dictionary_length = size;
+
+    fclose(file);
+
+    return true;
+}
+
+static int _open_input(const char *path)
+{
+    int fd = open(path, O_RDONLY | O_NOCTTY);
+
+    if (fd < 0)
+    {
+        fprintf(stderr, "log-decoder: Cannot open %s: %s\n", path, strerror(errno));
+
+        return -1;
+    }
+
+    struct termios tio;
+
+    // Serial port gets the format of log UART, other files are read as they are
+    if (tcgetattr(fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, B115200);
+        cfsetospeed(&tio, B115200);
+
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    return fd;
+}
+
+static size_t _cobs_decode(uint8_t *buffer, size_t length)
+{
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < length)
+    {
+        uint8_t code = buffer[in++];
+
+        for (uint8_t i = 1; i < code && in < length; i++)
+        {
+            buffer[out++] = buffer[in++];
+        }
+
+        // Block shorter than 254 bytes stands for zero, unless it is the last one
+        if (code != 0xff && in < length)
+        {
+            buffer[out++] = 0;
+        }
+    }
+
+    return out;
+}
+
+static void _decode_frame(const uint8_t *frame, size_t length)
+{
+    reader_t reader = { .data = frame, .length = length };
+
+    if (length == 0)
+    {
+        return;
+    }
+
+    uint8_t header = frame[reader.offset++];
+    uint8_t level = header & HEADER_LEVEL_MASK;
+    char id = level < sizeof(_level_id) ? _level_id[level] : '?';
+
+    if ((header & HEADER_OVERFLOW) != 0)
+    {
+        uint64_t count = _read_varint(&reader);
+
+        printf("# <%c> %llu messages dropped\n", id, (unsigned long long) count);
+
+        return;
+    }
+
+    uint64_t token = _read_varint(&reader);
+
+    char prefix[48];
+    uint8_t timestamp = (header >> HEADER_TIMESTAMP_SHIFT) & HEADER_TIMESTAMP_MASK;
+
+    if (timestamp == 0)
+    {
+        snprintf(prefix, sizeof(prefix), "# <%c> ", id);
+    }
+    else
+    {
+        uint64_t tick = _read_varint(&reader) / 10;
+
+        snprintf(prefix, sizeof(prefix), "# %s%llu.%02llu <%c> ", timestamp == 2 ? "+" : "",
+                 (unsigned long long) (tick / 100), (unsigned long long) (tick % 100), id);
+    }
+
+    if (reader.error || token + 4 >= _dictionary_length)
+    {
+        printf("%sUnknown token %llu\n", prefix, (unsigned long long) token);
+
+        return;
+    }
+
+    // Entry is types of arguments in 32-bit little endian word followed by format
+    const uint8_t *entry = _dictionary + token;
+    uint32_t types = entry[0] | (entry[1] << 8) | (entry[2] << 16) | ((uint32_t) entry[3] << 24);
+
+    fputs(prefix, stdout);
+
+    _print_message((const char *) entry + 4, types, &reader);
+
+    putchar('\n');
+
+    if (level == 0)
+    {
+        size_t dump_length;
+        const uint8_t *dump = _read_bytes(&reader, &dump_length);
+
+        if (dump != NULL)
+        {
+            _print_dump(prefix, dump, dump_length);
+        }
+    }
+
+    fflush(stdout);
+}
+
+static void _print_message(const char *format, uint32_t types, reader_t *reader)
+{
+    uint32_t count = types & 0x0f;
+    uint32_t index = 0;
+
+    while (*format != 0)
+    {
+        if (*format != '%')
+        {
+            putchar(*format++);
+
+            continue;
+        }
+
+        if (format[1] == '%')
+        {
+            putchar('%');
+
+            format += 2;
+
+            continue;
+        }
+
+        // Conversion is rebuilt without length modifier, which is given by type of argument instead
+        char spec[32];
+        size_t length = 0;
+
+        spec[length++] = *format++;
+
+        while (*format != 0 && strchr("-+ #0123456789.", *format) != NULL && length < sizeof(spec) - 4)
+        {
+            spec[length++] = *format++;
+        }
+
+        while (*format != 0 && strchr("hlLqjzt", *format) != NULL)
+        {
+            format++;
+        }
+
+        char conversion = *format;
+
+        if (conversion == 0)
+        {
+            break;
+        }
+
+        format++;
+
+        if (index >= count)
+        {
+            fputs("<?>", stdout);
+
+            continue;
+        }
+
+        uint32_t type = (types >> (4 + 2 * index++)) & 0x03;
+
+        if (type == TYPE_STRING)
+        {
+            size_t string_length;
+            const uint8_t *string = _read_bytes(reader, &string_length);
+
+            if (string == NULL)
+            {
+                fputs("<?>", stdout);
+
+                continue;
+            }
+
+            // Precision of format, if any, is replaced by length of string, firmware sent no more than that
+            char *dot = memchr(spec, '.', length);
+
+            if (dot != NULL)
+            {
+                length = dot - spec;
+            }
+
+            spec[length++] = '.';
+            spec[length++] = '*';
+            spec[length++] = 's';
+            spec[length] = 0;
+
+            printf(spec, (int) string_length, (const char *) string);
+
+            continue;
+        }
+
+        if (type == TYPE_FLOAT)
+        {
+            float value;
+
+            if (reader->offset + sizeof(value) > reader->length)
+            {
+                reader->error = true;
+
+                fputs("<?>", stdout);
+
+                continue;
+            }
+
+            memcpy(&value, reader->data + reader->offset, sizeof(value));
+
+            reader->offset += sizeof(value);
+
+            spec[length++] = strchr("fFeEgGaA", conversion) != NULL ? conversion : 'f';
+            spec[length] = 0;
+
+            printf(spec, (double) value);
+
+            continue;
+        }
+
+        int64_t value = _read_zigzag(reader);
+
+        if (reader->error)
+        {
+            fputs("<?>", stdout);
+
+            continue;
+        }
+
+        if (conversion == 'p')
+        {
+            printf("0x%llx", (unsigned long long) (type == TYPE_INT32 ? (uint32_t) value : (uint64_t) value));
+
+            continue;
+        }
+
+        if (conversion == 'c')
+        {
+            spec[length++] = 'c';
+            spec[length] = 0;
+
+            printf(spec, (int) value);
+
+            continue;
+        }
+
+        spec[length++] = 'l';
+        spec[length++] = 'l';
+        spec[length++] = strchr("diouxX", conversion) != NULL ? conversion : 'd';
+        spec[length] = 0;
+
+        if (conversion == 'd' || conversion == 'i')
+        {
+            printf(spec, (long long) value);
+        }
+        else
+        {
+            // Unsigned value of 32-bit argument is taken from its 32 bits only
+            printf(spec, (unsigned long long) (type == TYPE_INT32 ? (uint32_t) value : (uint64_t) value));
+        }
+    }
+}
+
+static void _print_dump(const char *prefix, const uint8_t *data, size_t length)
+{
+    for (size_t position = 0; position < length; position += DUMP_WIDTH)
+    {
+        printf("%s%3d: ", prefix, (int) position);
+
+        for (size_t i = 0; i < DUMP_WIDTH; i++)
+        {
+            if (i == DUMP_WIDTH / 2)
+            {
+                fputs("| ", stdout);
+            }
+
+            if (position + i < length)
+            {
+                printf("%02X ", data[position + i]);
+            }
+            else
+            {
+                fputs("   ", stdout);
+            }
+        }
+
+        putchar(' ');
+
+        for (size_t i = 0; i < DUMP_WIDTH; i++)
+        {
+            uint8_t value = position + i < length ? data[position + i] : ' ';
+
+            putchar(isprint(value) ? value : '.');
+        }
+
+        putchar('\n');
+    }
+}
+
+static uint64_t _read_varint(reader_t *reader)
+{
+    uint64_t value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (reader->offset >= reader->length)
+        {
+            reader->error = true;
+
+            return 0;
+        }
+
+        uint8_t byte = reader->data[reader->offset++];
+
+        value |= (uint64_t) (byte & 0x7f) << shift;
+
+        if ((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+
+    reader->error = true;
+
+    return 0;
+}
+
+static int64_t _read_zigzag(reader_t *reader)
+{
+    uint64_t value = _read_varint(reader);
+
+    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+static const uint8_t *_read_bytes(reader_t *reader, size_t *length)
+{
+    *length = _read_varint(reader);
+
+    if (reader->error || reader->offset + *length > reader->length)
+    {
+        reader->error = true;
+
+        return NULL;
+    }
+
+    const uint8_t *data = reader->data + reader->offset;
+
+    reader->offset += *length;
+
+    return data;
+}
@@ -0,0 +1,183 @@
+#include <application.h>
+
+// One process of radio ACK latency test, gateway if SIM_GATEWAY=1 is set and node otherwise.
+// Gateway runs display task of normal priority which blocks for SIM_LOAD milliseconds every SIM_PERIOD milliseconds,
+// as update of display over SPI would.
+// Node publishes every SIM_INTERVAL milliseconds and measures time from publish to acknowledged transmission.
+// Results are printed at the end of simulation and collected by radio-latency.sh.
+
+static struct
+{
+    bool gateway;
+    twr_tick_t warmup;
+    twr_tick_t interval;
+    twr_tick_t duration;
+    twr_tick_t load;
+    twr_tick_t period;
+    bool paired;
+    bool pending;
+    uint64_t clock_sent;
+    uint32_t sent;
+    uint32_t acked;
+    uint64_t latency_total;
+    uint64_t latency_max;
+
+} _sim;
+
+static twr_tick_t _sim_get_env(const char *name, twr_tick_t fallback);
+static void _sim_display_task(void *param);
+static void _sim_radio_event_handler(twr_radio_event_t event, void *event_param);
+static void _sim_node_task(void);
+
+void application_init(void)
+{
+    _sim.gateway = _sim_get_env("SIM_GATEWAY", 0) != 0;
+    _sim.warmup = _sim_get_env("SIM_WARMUP", 3000);
+    _sim.interval = _sim_get_env("SIM_INTERVAL", 200);
+    _sim.duration = _sim_get_env("SIM_DURATION", 10000);
+    _sim.load = _sim_get_env("SIM_LOAD", 0);
+    _sim.period = _sim_get_env("SIM_PERIOD", 50);
+
+    if (_sim.gateway)
+    {
+        twr_radio_init(TWR_RADIO_MODE_GATEWAY);
+
+        twr_radio_pairing_mode_start();
+
+        // Load starts after pairing, so that it only affects measured frames
+        if (_sim.load != 0)
+        {
+            twr_scheduler_register(_sim_display_task, NULL, _sim.warmup);
+        }
+    }
+    else
+    {
+        twr_radio_init(TWR_RADIO_MODE_NODE_SLEEPING);
+
+        twr_radio_set_event_handler(_sim_radio_event_handler, NULL);
+    }
+}
+
+void application_task(void *param)
+{
+    (void) param;
+
+    if (!_sim.gateway)
+    {
+        _sim_node_task();
+
+        return;
+    }
+
+    // Gateway outlives node by one second, so that the last frame is acknowledged
+    if (twr_tick_get() >= _sim.warmup + _sim.duration + 1000)
+    {
+        exit(EXIT_SUCCESS);
+    }
+
+    twr_scheduler_plan_current_absolute(_sim.warmup + _sim.duration + 1000);
+}
+
+void twr_radio_pub_on_uint32(uint64_t *id, char *subtopic, uint32_t *value)
+{
+    (void) id;
+    (void) subtopic;
+    (void) value;
+}
+
+static void _sim_display_task(void *param)
+{
+    (void) param;
+
+    uint64_t clock_end = twr_host_get_clock_us() + _sim.load * 1000;
+
+    while (twr_host_get_clock_us() < clock_end)
+    {
+        continue;
+    }
+
+    twr_scheduler_plan_current_relative(_sim.period);
+}
+
+static void _sim_node_task(void)
+{
+    twr_tick_t now = twr_tick_get();
+
+    if (now < _sim.warmup)
+    {
+        if (!_sim.paired)
+        {
+            twr_radio_pairing_request("radio-latency", "1.0");
+        }
+
+        twr_scheduler_plan_current_absolute(_sim.warmup);
+
+        return;
+    }
+
+    if (now >= _sim.warmup + _sim.duration)
+    {
+        twr_radio_peer_t *peer = twr_radio_get_peer_device(0xffffffffffff);
+
+        printf("sim node sent %" PRIu32 " acked %" PRIu32 " total %" PRIu64 " max %" PRIu64 " retry %u\n",
+            _sim.sent, _sim.acked, _sim.latency_total, _sim.latency_max, peer != NULL ? peer->tx_retry : 0);
+
+        exit(EXIT_SUCCESS);
+    }
+
+    // Next frame is only sent when the previous one is done, so that each round trip is measured alone
+    if (!_sim.pending && twr_radio_pub_uint32("sim/seq", &_sim.sent))
+    {
+        _sim.clock_sent = twr_host_get_clock_us();
+
+        _sim.pending = true;
+
+        _sim.sent++;
+    }
+
+    twr_scheduler_plan_current_relative(_sim.interval);
+}
+
+static void _sim_radio_event_handler(twr_radio_event_t event, void *event_param)
+{
+    (void) event_param;
+
+    if (event == TWR_RADIO_EVENT_PAIRED)
+    {
+        _sim.paired = true;
+    }
+    else if (event == TWR_RADIO_EVENT_TX_DONE)
+    {
+        if (_sim.pending)
+        {
+            uint64_t latency = twr_host_get_clock_us() - _sim.clock_sent;
+
+            _sim.latency_total += latency;
+
+            if (_sim.latency_max < latency)
+            {
+                _sim.latency_max = latency;
+            }
+
+            _sim.acked++;
+
+            _sim.pending = false;
+        }
+    }
+    else if (event == TWR_RADIO_EVENT_TX_ERROR)
+    {
+        _sim.pending = false;
+
+        if (!_sim.paired && twr_tick_get() < _sim.warmup)
+        {
+            twr_radio_pairing_request("radio-latency", "1.0");
+        }
+    }
+}
+
+static twr_tick_t _sim_get_env(const char *name, twr_tick_t fallback)
+{
+    const char *value = getenv(name);
+
+    return value != NULL ? strtoull(value, NULL, 10) : fallback;
+}
@@ -0,0 +1,52 @@
+#!/bin/bash
+# Radio ACK latency test: node publishes to gateway whose display task blocks for LOADS milliseconds every PERIOD
+# milliseconds, round trip from publish to acknowledged transmission is measured on node for every load.
+# Test fails if any round trip exceeds BOUND milliseconds, or a frame is retried or not acknowledged, which means
+# that ACK of gateway came too late for node. Arguments are passed to make.
+set -eu
+
+: ${LOADS:="0 10 20 30"}
+: ${PERIOD:=50}
+: ${BOUND:=80}
+: ${WARMUP:=3000}
+: ${INTERVAL:=200}
+: ${DURATION:=10000}
+: ${PORT:=5500}
+
+cd "$(dirname "$0")"
+
+make clean > /dev/null
+make -j4 "$@" > /dev/null
+
+ELF=out/host/debug/firmware.elf
+
+export SIM_WARMUP=$WARMUP SIM_INTERVAL=$INTERVAL SIM_DURATION=$DURATION SIM_PERIOD=$PERIOD
+export TWR_HOST_REALTIME=1
+
+printf '%6s %8s %8s %10s %10s %10s\n' load sent acked avg_ms max_ms retry
+
+failed=0
+
+for load in $LOADS
+do
+    dir=$(mktemp -d)
+
+    export TWR_HOST_RADIO_PORT=$PORT
+    PORT=$(( PORT + 1 ))
+
+    SIM_GATEWAY=1 SIM_LOAD=$load TWR_HOST_ID=ffffffffffff TWR_HOST_EEPROM=$dir/gateway.bin $ELF > /dev/null 2>&1 &
+    TWR_HOST_ID=1 TWR_HOST_EEPROM=$dir/node.bin $ELF > $dir/node.txt 2> /dev/null
+
+    wait
+
+    awk -v load=$load -v bound=$BOUND '
+        $2 == "node" {
+            printf "%6d %8d %8d %10.1f %10.1f %10d\n", load, $4, $6, $6 ? $8 / $6 / 1000 : 0, $10 / 1000, $12
+            exit ($4 == 0 || $6 != $4 || $12 != 0 || $10 > bound * 1000)
+        }
+        END { if (NR == 0) exit 1 }' $dir/node.txt || failed=1
+
+    rm -rf $dir
+done
+
+exit $failed
@@ -0,0 +1,190 @@
+#include <application.h>
+#include <unistd.h>
+
+// One process of radio collision simulator, gateway if SIM_GATEWAY=1 is set and node otherwise.
+// Nodes pair with gateway during warm-up and then all publish on the same interval, so they contend for channel
+// at the same moments. Results are printed at the end of simulation and collected by radio-sim.sh.
+
+static struct
+{
+    bool gateway;
+    twr_tick_t warmup;
+    twr_tick_t interval;
+    twr_tick_t duration;
+    twr_tick_t drain;
+    twr_tick_t pairing;
+    bool paired;
+    bool measure;
+    uint32_t sent;
+    uint32_t done;
+    uint32_t error;
+    uint32_t received;
+
+} _sim;
+
+static twr_tick_t _sim_get_env(const char *name, twr_tick_t fallback);
+static void _sim_radio_event_handler(twr_radio_event_t event, void *event_param);
+static void _sim_node_task(void);
+static void _sim_print_node(void);
+
+void application_init(void)
+{
+    _sim.gateway = _sim_get_env("SIM_GATEWAY", 0) != 0;
+    _sim.warmup = _sim_get_env("SIM_WARMUP", 5000);
+    _sim.interval = _sim_get_env("SIM_INTERVAL", 5000);
+    _sim.duration = _sim_get_env("SIM_DURATION", 30000);
+    _sim.drain = _sim_get_env("SIM_DRAIN", 5000);
+
+    srand(getpid());
+
+    if (_sim.gateway)
+    {
+        twr_radio_init(TWR_RADIO_MODE_GATEWAY);
+
+        twr_radio_pairing_mode_start();
+    }
+    else
+    {
+        twr_radio_init(TWR_RADIO_MODE_NODE_SLEEPING);
+
+        twr_radio_set_event_handler(_sim_radio_event_handler, NULL);
+    }
+}
+
+void application_task(void *param)
+{
+    (void) param;
+
+    if (!_sim.gateway)
+    {
+        _sim_node_task();
+
+        return;
+    }
+
+    if (twr_tick_get() >= _sim.warmup + _sim.duration + _sim.drain)
+    {
+        printf("sim gateway received %" PRIu32 "\n", _sim.received);
+
+        exit(EXIT_SUCCESS);
+    }
+
+    twr_scheduler_plan_current_absolute(_sim.warmup + _sim.duration + _sim.drain);
+}
+
+void twr_radio_pub_on_uint32(uint64_t *id, char *subtopic, uint32_t *value)
+{
+    (void) id;
+    (void) subtopic;
+    (void) value;
+
+    // Duplicates are dropped by radio, so every call is one delivered message
+    if (twr_tick_get() >= _sim.warmup)
+    {
+        _sim.received++;
+    }
+}
+
+static void _sim_node_task(void)
+{
+    twr_tick_t now = twr_tick_get();
+
+    if (now < _sim.warmup)
+    {
+        // Pairing requests are spread over first half of warm-up
+        if (_sim.pairing == 0)
+        {
+            _sim.pairing = 1 + rand() % (_sim.warmup / 2 + 1);
+
+            twr_scheduler_plan_current_absolute(_sim.pairing);
+
+            return;
+        }
+
+        if (!_sim.paired)
+        {
+            twr_radio_pairing_request("radio-sim", "1.0");
+        }
+
+        twr_scheduler_plan_current_absolute(_sim.warmup);
+
+        return;
+    }
+
+    if (now >= _sim.warmup + _sim.duration + _sim.drain)
+    {
+        _sim_print_node();
+
+        exit(EXIT_SUCCESS);
+    }
+
+    if (now >= _sim.warmup + _sim.duration)
+    {
+        twr_scheduler_plan_current_absolute(_sim.warmup + _sim.duration + _sim.drain);
+
+        return;
+    }
+
+    _sim.measure = true;
+
+    if (twr_radio_pub_uint32("sim/seq", &_sim.sent))
+    {
+        _sim.sent++;
+    }
+
+    twr_scheduler_plan_current_relative(_sim.interval);
+}
+
+static void _sim_radio_event_handler(twr_radio_event_t event, void *event_param)
+{
+    (void) event_param;
+
+    if (event == TWR_RADIO_EVENT_PAIRED)
+    {
+        _sim.paired = true;
+    }
+    else if (event == TWR_RADIO_EVENT_TX_DONE)
+    {
+        if (_sim.measure)
+        {
+            _sim.done++;
+        }
+    }
+    else if (event == TWR_RADIO_EVENT_TX_ERROR)
+    {
+        if (_sim.measure)
+        {
+            _sim.error++;
+        }
+        else if (!_sim.paired && twr_tick_get() < _sim.warmup)
+        {
+            twr_radio_pairing_request("radio-sim", "1.0");
+        }
+    }
+}
+
+static void _sim_print_node(void)
+{
+    uint64_t id;
+
+    twr_radio_get_peer_id(&id, 1);
+
+    twr_radio_peer_t *peer = twr_radio_get_peer_device(id);
+
+    twr_radio_peer_t none = { .id = 0 };
+
+    if (peer == NULL)
+    {
+        peer = &none;
+    }
+
+    printf("sim node %012" PRIx64 " paired %d sent %" PRIu32 " done %" PRIu32 " error %" PRIu32 " frames %u retry %u busy %u\n",
+        twr_radio_get_my_id(), _sim.paired, _sim.sent, _sim.done, _sim.error, peer->tx_count, peer->tx_retry, peer->tx_busy);
+}
+
+static twr_tick_t _sim_get_env(const char *name, twr_tick_t fallback)
+{
+    const char *value = getenv(name);
+
+    return value != NULL ? strtoull(value, NULL, 10) : fallback;
+}
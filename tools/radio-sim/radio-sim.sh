@@ -0,0 +1,53 @@
+#!/bin/bash
+# Radio collision simulator: gateway and growing number of nodes run the radio stack as host processes
+# on emulated radio in wall clock time, all nodes publish on the same interval and goodput is reported.
+# Arguments are passed to make, e.g. "./radio-sim.sh RADIO_CCA=0" compares against plain ALOHA.
+set -eu
+
+: ${NODES:="1 2 5 10 20"}
+: ${WARMUP:=5000}
+: ${INTERVAL:=5000}
+: ${DURATION:=30000}
+: ${DRAIN:=5000}
+: ${PORT:=5400}
+
+cd "$(dirname "$0")"
+
+make clean > /dev/null
+make -j4 "$@" > /dev/null
+
+ELF=out/host/debug/firmware.elf
+
+export SIM_WARMUP=$WARMUP SIM_INTERVAL=$INTERVAL SIM_DURATION=$DURATION SIM_DRAIN=$DRAIN
+export TWR_HOST_REALTIME=1
+
+printf '%6s %8s %10s %8s %10s %8s %8s %8s\n' nodes offered delivered ratio goodput frames retry busy
+
+for n in $NODES
+do
+    dir=$(mktemp -d)
+
+    # Every run has its own channel, so that stray packets of previous run do not interfere
+    export TWR_HOST_RADIO_PORT=$PORT
+    PORT=$(( PORT + 1 ))
+
+    SIM_GATEWAY=1 TWR_HOST_ID=ffffffffffff TWR_HOST_EEPROM=$dir/gateway.bin $ELF > $dir/gateway.txt 2> /dev/null &
+
+    for i in $(seq 1 $n)
+    do
+        TWR_HOST_ID=$(printf '%x' $i) TWR_HOST_EEPROM=$dir/node$i.bin $ELF > $dir/node$i.txt 2> /dev/null &
+    done
+
+    wait
+
+    cat $dir/*.txt | awk -v nodes=$n -v duration=$DURATION '
+        $2 == "gateway" { delivered = $4 }
+        $2 == "node" { offered += $7; frames += $13; retry += $15; busy += $17 }
+        END {
+            printf "%6d %8d %10d %7.1f%% %8.2f/s %8.2f %8d %8d\n", nodes, offered, delivered,
+                offered ? 100 * delivered / offered : 0, delivered * 1000 / duration,
+                delivered ? frames / delivered : 0, retry, busy
+        }'
+
+    rm -rf $dir
+done
@@ -0,0 +1,95 @@
+#include <application.h>
+#include <time.h>
+
+// Benchmark of scheduler backends: all free slots of task pool are taken by tasks which plan themselves again
+// every 500 to 999 ticks. Idle hook counts spins and measures wall clock time between return from sleep and next
+// idle, which is time spent by scheduler and the trivial tasks, without host wait for the next deadline. Result is
+// printed at the end and collected by scheduler-bench.sh, built with SCHEDULER_HEAP=0 and 1 for every pool size.
+
+// Slot of application task
+#define BENCH_RESERVED 1
+#define BENCH_TASKS (TWR_SCHEDULER_MAX_TASKS - BENCH_RESERVED)
+
+static struct
+{
+    twr_tick_t duration;
+    twr_tick_t period[BENCH_TASKS];
+    bool running;
+    uint64_t spin_start;
+    uint64_t elapsed;
+    uint32_t spins;
+    uint32_t dispatched;
+
+} _bench;
+
+static uint64_t _bench_get_clock_ns(void);
+static void _bench_task(void *param);
+
+void application_init(void)
+{
+    const char *duration = getenv("SIM_DURATION");
+
+    _bench.duration = duration != NULL ? strtoull(duration, NULL, 10) : 600000;
+
+    // Fixed seed, both backends see the same schedule
+    srand(1);
+
+    for (size_t i = 0; i < BENCH_TASKS; i++)
+    {
+        _bench.period[i] = 500 + rand() % 500;
+
+        twr_scheduler_register(_bench_task, &_bench.period[i], 1 + rand() % _bench.period[i]);
+    }
+}
+
+void application_task(void *param)
+{
+    (void) param;
+
+    if (!_bench.running)
+    {
+        _bench.running = true;
+
+        _bench.spin_start = _bench_get_clock_ns();
+
+        twr_scheduler_plan_current_absolute(_bench.duration);
+
+        return;
+    }
+
+    printf("sim bench %d %" PRIu32 " %" PRIu32 " %" PRIu64 "\n", TWR_SCHEDULER_MAX_TASKS, _bench.spins, _bench.dispatched, _bench.elapsed);
+
+    exit(EXIT_SUCCESS);
+}
+
+void application_idle(void)
+{
+    if (_bench.running)
+    {
+        _bench.elapsed += _bench_get_clock_ns() - _bench.spin_start;
+
+        _bench.spins++;
+    }
+
+    twr_sleep();
+
+    _bench.spin_start = _bench_get_clock_ns();
+}
+
+static uint64_t _bench_get_clock_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void _bench_task(void *param)
+{
+    twr_tick_t *period = param;
+
+    _bench.dispatched++;
+
+    twr_scheduler_plan_current_relative(*period);
+}
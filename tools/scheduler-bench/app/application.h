@@ -0,0 +1,7 @@
+#ifndef _APPLICATION_H
+#define _APPLICATION_H
+
+#include <twr.h>
+#include <twr_sleep.h>
+
+#endif // _APPLICATION_H
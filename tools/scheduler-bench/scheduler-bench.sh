@@ -0,0 +1,30 @@
+#!/bin/bash
+# Benchmark of scheduler backends: task pool of every size is filled with periodic tasks and cost of one spin
+# is measured with linear scan of the pool and with deadline heap. Time is simulated, so spins follow each other
+# without waiting and wall clock time is spent by scheduler only. Arguments are passed to make.
+set -eu
+
+: ${TASKS:="32 128 512"}
+: ${DURATION:=600000}
+
+cd "$(dirname "$0")"
+
+ELF=out/host/debug/firmware.elf
+
+export SIM_DURATION=$DURATION
+
+printf '%6s %8s %8s %12s %10s %10s\n' tasks backend spins dispatched ns/spin ns/task
+
+for n in $TASKS
+do
+    for heap in 0 1
+    do
+        make clean > /dev/null
+        make -j4 SCHEDULER_MAX_TASKS=$n SCHEDULER_HEAP=$heap "$@" > /dev/null
+
+        $ELF | awk -v heap=$heap '
+            $2 == "bench" {
+                printf "%6d %8s %8d %12d %10.1f %10.1f\n", $3, heap == 1 ? "heap" : "linear", $4, $5, $6 / $4, $6 / $5
+            }'
+    done
+done
@@ -0,0 +1,163 @@
+#include <application.h>
+#include <time.h>
+
+// Benchmark of interrupt masking by tick readers. Periodic tasks which plan themselves from now and check
+// a timeout run in simulated time, calls of twr_tick_get and twr_irq_disable are counted by linker wrappers.
+// The former twr_tick_get masked interrupts on every call, so it would add one masked section per call.
+// Then cost of one read is measured for lock-free read with sequence counter and for read in masked section,
+// on host masking only calls the emulated PRIMASK functions, so the difference is smaller than on Cortex-M0+.
+
+#define BENCH_TASKS 8
+#define BENCH_READS 10000000
+
+static struct
+{
+    twr_tick_t duration;
+    bool running;
+    uint32_t spins;
+    uint32_t tick_count;
+    uint32_t irq_count;
+    twr_tick_t timeout[BENCH_TASKS];
+    volatile twr_tick_t counter;
+    volatile uint32_t sequence;
+
+} _bench;
+
+twr_tick_t __real_twr_tick_get(void);
+void __real_twr_irq_disable(void);
+
+static void _bench_task(void *param);
+static void _bench_read(const char *name, twr_tick_t (*read)(void));
+static twr_tick_t _bench_read_lock_free(void);
+static twr_tick_t _bench_read_masked(void);
+static uint64_t _bench_get_clock_ns(void);
+
+void application_init(void)
+{
+    const char *duration = getenv("SIM_DURATION");
+
+    _bench.duration = duration != NULL ? strtoull(duration, NULL, 10) : 600000;
+
+    for (size_t i = 0; i < BENCH_TASKS; i++)
+    {
+        twr_scheduler_register(_bench_task, (void *) i, 0);
+    }
+}
+
+void application_task(void *param)
+{
+    (void) param;
+
+    if (!_bench.running)
+    {
+        _bench.running = true;
+
+        twr_scheduler_plan_current_absolute(_bench.duration);
+
+        return;
+    }
+
+    _bench.running = false;
+
+    printf("bench spin %" PRIu32 " %" PRIu32 " %" PRIu32 "\n", _bench.spins, _bench.tick_count, _bench.irq_count);
+
+    _bench_read("lock-free", _bench_read_lock_free);
+    _bench_read("masked", _bench_read_masked);
+
+    exit(EXIT_SUCCESS);
+}
+
+void application_idle(void)
+{
+    if (_bench.running)
+    {
+        _bench.spins++;
+    }
+
+    twr_sleep();
+}
+
+twr_tick_t __wrap_twr_tick_get(void)
+{
+    if (_bench.running)
+    {
+        _bench.tick_count++;
+    }
+
+    return __real_twr_tick_get();
+}
+
+void __wrap_twr_irq_disable(void)
+{
+    if (_bench.running)
+    {
+        _bench.irq_count++;
+    }
+
+    __real_twr_irq_disable();
+}
+
+static void _bench_task(void *param)
+{
+    size_t i = (size_t) param;
+
+    // Timeout is checked as drivers do while waiting for peripheral
+    if (twr_tick_get() >= _bench.timeout[i])
+    {
+        _bench.timeout[i] = twr_tick_get() + 1000;
+    }
+
+    twr_scheduler_plan_current_from_now(10 + i * 50);
+}
+
+static void _bench_read(const char *name, twr_tick_t (*read)(void))
+{
+    twr_tick_t sum = 0;
+
+    uint64_t clock_start = _bench_get_clock_ns();
+
+    for (uint32_t i = 0; i < BENCH_READS; i++)
+    {
+        sum += read();
+    }
+
+    uint64_t elapsed = _bench_get_clock_ns() - clock_start;
+
+    printf("bench read %s %.1f %" PRIu64 "\n", name, (double) elapsed / BENCH_READS, sum);
+}
+
+static twr_tick_t _bench_read_lock_free(void)
+{
+    twr_tick_t tick;
+    uint32_t sequence;
+
+    do
+    {
+        sequence = _bench.sequence;
+
+        tick = _bench.counter;
+
+    } while (sequence != _bench.sequence);
+
+    return tick;
+}
+
+static twr_tick_t _bench_read_masked(void)
+{
+    twr_irq_disable();
+
+    twr_tick_t tick = _bench.counter;
+
+    twr_irq_enable();
+
+    return tick;
+}
+
+static uint64_t _bench_get_clock_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
@@ -0,0 +1,19 @@
+#!/bin/bash
+# Benchmark of interrupt masking by tick readers: scheduler runs periodic tasks in simulated time while calls
+# of twr_tick_get and twr_irq_disable are counted, then cost of one read is measured for lock-free read and for
+# the former read which masked interrupts. Arguments are passed to make.
+set -eu
+
+: ${DURATION:=600000}
+
+cd "$(dirname "$0")"
+
+make clean > /dev/null
+make -j4 "$@" > /dev/null
+
+SIM_DURATION=$DURATION out/host/debug/firmware.elf | awk '
+    $2 == "spin" {
+        printf "spins %d, twr_tick_get %.2f per spin\n", $3, $4 / $3
+        printf "twr_irq_disable per spin: %.2f lock-free, %.2f former\n", $5 / $3, ($5 + $4) / $3
+    }
+    $2 == "read" { printf "%-10s %8.1f ns per read\n", $3, $4 }'
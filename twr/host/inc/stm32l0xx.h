@@ -0,0 +1,59 @@
+#ifndef _STM32L0XX_H
+#define _STM32L0XX_H
+
+// Stand-in for CMSIS device header when building for host (TARGET=host)
+// Provides only the registers and intrinsics which are touched by portable part of SDK
+
+#include <stdint.h>
+
+typedef struct
+{
+    volatile uint32_t SCR;
+
+} SCB_Type;
+
+typedef struct
+{
+    volatile uint32_t LOAD;
+    volatile uint32_t VAL;
+
+} SysTick_Type;
+
+typedef struct
+{
+    volatile uint32_t WPR;
+    volatile uint32_t ISR;
+
+} RTC_TypeDef;
+
+#define SCB_SCR_SLEEPDEEP_Msk (1UL << 2)
+
+#define RTC_ISR_RSF (1UL << 5)
+
+extern SCB_Type twr_host_scb;
+
+extern RTC_TypeDef twr_host_rtc;
+
+SysTick_Type *twr_host_systick(void);
+
+#define SCB (&twr_host_scb)
+
+#define RTC (&twr_host_rtc)
+
+// Counter value is derived from host monotonic clock on every access
+#define SysTick (twr_host_systick())
+
+uint32_t HAL_GetTick(void);
+
+// There are no asynchronous interrupts on host, event handlers run only from inside of __WFI
+uint32_t __get_PRIMASK(void);
+
+void __disable_irq(void);
+
+void __enable_irq(void);
+
+void __WFI(void);
+
+#define __DMB() __sync_synchronize()
+
+#endif // _STM32L0XX_H
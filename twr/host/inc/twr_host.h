@@ -0,0 +1,63 @@
+#ifndef _TWR_HOST_H
+#define _TWR_HOST_H
+
+#include <twr_common.h>
+#include <twr_tick.h>
+
+//! @addtogroup twr_host twr_host
+//! @brief POSIX host port of SDK core for simulation, fuzzing and benchmarking (TARGET=host)
+//! @details Time is simulated by default: it stands still while tasks run and jumps to the next planned task when idle,
+//! so runs are deterministic and as fast as the host allows. Set environment variable TWR_HOST_REALTIME=1 to follow
+//! wall clock instead. Peripherals are emulated by host resources: UART by pseudo-terminal, EEPROM by file and radio
+//! by UDP multicast on loopback interface. File descriptors of these resources are polled instead of waiting for interrupt.
+//! @{
+
+//! @cond
+
+#ifndef TWR_HOST_MAX_FD
+#define TWR_HOST_MAX_FD 8
+#endif
+
+//! @endcond
+
+//! @brief Check whether time follows wall clock
+//! @return true If environment variable TWR_HOST_REALTIME is set to 1
+//! @return false If time is simulated
+
+bool twr_host_is_realtime(void);
+
+//! @brief Get wall clock time elapsed since start of process
+//! @return Time in microseconds
+
+uint64_t twr_host_get_clock_us(void);
+
+//! @brief Get value of environment variable
+//! @param[in] name Name of variable without TWR_HOST_ prefix
+//! @param[in] fallback Value returned if variable is not set
+//! @return Value of variable
+
+const char *twr_host_get_env(const char *name, const char *fallback);
+
+//! @brief Register file descriptor to be watched while idle
+//! @param[in] fd File descriptor
+//! @param[in] handler Function called (as if from interrupt) whenever descriptor becomes readable
+//! @param[in] param Optional parameter passed to handler
+//! @return true On success
+//! @return false If there is no free slot (see TWR_HOST_MAX_FD)
+
+bool twr_host_register_fd(int fd, void (*handler)(int, void *), void *param);
+
+//! @brief Unregister file descriptor
+//! @param[in] fd File descriptor
+
+void twr_host_unregister_fd(int fd);
+
+//! @brief Wait for event (host equivalent of WFI)
+//! @details Polls registered file descriptors and advances simulated time to the next planned task if none is ready.
+//! Process exits when nothing is planned and there is no file descriptor to wait for.
+
+void twr_host_wait(void);
+
+//! @}
+
+#endif // _TWR_HOST_H
@@ -0,0 +1,57 @@
+#include <twr_scheduler.h>
+#include <twr_system.h>
+#include <twr_error.h>
+#include <twr_log.h>
+#include <twr_sleep.h>
+
+void application_init(void);
+
+void application_task(void *param);
+
+void application_error(twr_error_t code);
+
+static void _twr_host_exit(void);
+
+int main(void)
+{
+    // Tools and simulations end by exit(), log queued until then is written out
+    atexit(_twr_host_exit);
+
+    twr_system_init();
+
+    twr_scheduler_init();
+
+    twr_scheduler_register(application_task, NULL, 0);
+
+    application_init();
+
+    twr_scheduler_run();
+}
+
+__attribute__((weak)) void application_init(void)
+{
+}
+
+__attribute__((weak)) void application_task(void *param)
+{
+    (void) param;
+}
+
+__attribute__((weak)) void application_idle()
+{
+    twr_sleep();
+}
+
+__attribute__((weak)) void application_error(twr_error_t code)
+{
+    twr_log_flush();
+
+    fprintf(stderr, "twr_host: Application error %d at tick %" PRIu64 "\n", (int) code, twr_tick_get());
+
+    abort();
+}
+
+static void _twr_host_exit(void)
+{
+    twr_log_flush();
+}
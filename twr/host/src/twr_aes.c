@@ -0,0 +1,359 @@
+#include <twr_aes.h>
+
+// Software AES-128 with the same key and block layout as hardware driver, so that ciphertext of host matches device.
+// Keys and initialization vectors are stored with reversed byte order as made by twr_aes_key_from_uint8.
+
+static const uint8_t _twr_aes_sbox[256] =
+{
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+static void _twr_aes_expand(uint8_t *round_key, const twr_aes_key_t key);
+static void _twr_aes_encrypt_block(uint8_t *block, const uint8_t *round_key);
+static void _twr_aes_decrypt_block(uint8_t *block, const uint8_t *round_key);
+static uint8_t _twr_aes_xtime(uint8_t value);
+static uint8_t _twr_aes_multiply(uint8_t value, uint8_t factor);
+static uint8_t _twr_aes_inverse_sbox(uint8_t value);
+
+void twr_aes_init(void)
+{
+}
+
+bool twr_aes_key_derivation(twr_aes_key_t decryption_key, const twr_aes_key_t key)
+{
+    // Inverse cipher expands decryption key on its own
+    memcpy(decryption_key, key, sizeof(twr_aes_key_t));
+
+    return true;
+}
+
+bool twr_aes_ecb_encrypt(void *buffer_out, const void *buffer_in, const size_t length, const twr_aes_key_t key)
+{
+    uint8_t round_key[176];
+
+    if ((length % 16) != 0)
+    {
+        return false;
+    }
+
+    _twr_aes_expand(round_key, key);
+
+    memmove(buffer_out, buffer_in, length);
+
+    for (size_t i = 0; i < length; i += 16)
+    {
+        _twr_aes_encrypt_block((uint8_t *) buffer_out + i, round_key);
+    }
+
+    return true;
+}
+
+bool twr_aes_ecb_decrypt(void *buffer_out, const void *buffer_in, size_t length, twr_aes_key_t key)
+{
+    uint8_t round_key[176];
+
+    if ((length % 16) != 0)
+    {
+        return false;
+    }
+
+    _twr_aes_expand(round_key, key);
+
+    memmove(buffer_out, buffer_in, length);
+
+    for (size_t i = 0; i < length; i += 16)
+    {
+        _twr_aes_decrypt_block((uint8_t *) buffer_out + i, round_key);
+    }
+
+    return true;
+}
+
+bool twr_aes_ctwr_encrypt(void *buffer_out, const void *buffer_in, size_t length, const twr_aes_key_t key, const twr_aes_iv_t iv)
+{
+    uint8_t round_key[176];
+    uint8_t chain[16];
+
+    if ((length % 16) != 0)
+    {
+        return false;
+    }
+
+    _twr_aes_expand(round_key, key);
+
+    for (int i = 0; i < 16; i++)
+    {
+        chain[i] = ((const uint8_t *) iv)[15 - i];
+    }
+
+    for (size_t i = 0; i < length; i += 16)
+    {
+        for (int j = 0; j < 16; j++)
+        {
+            chain[j] ^= ((const uint8_t *) buffer_in)[i + j];
+        }
+
+        _twr_aes_encrypt_block(chain, round_key);
+
+        memcpy((uint8_t *) buffer_out + i, chain, 16);
+    }
+
+    return true;
+}
+
+bool twr_aes_ctwr_decrypt(void *buffer_out, const void *buffer_in, size_t length, const twr_aes_key_t key, const twr_aes_iv_t iv)
+{
+    uint8_t round_key[176];
+    uint8_t chain[16];
+    uint8_t block[16];
+
+    if ((length % 16) != 0)
+    {
+        return false;
+    }
+
+    _twr_aes_expand(round_key, key);
+
+    for (int i = 0; i < 16; i++)
+    {
+        chain[i] = ((const uint8_t *) iv)[15 - i];
+    }
+
+    for (size_t i = 0; i < length; i += 16)
+    {
+        memcpy(block, (const uint8_t *) buffer_in + i, 16);
+
+        _twr_aes_decrypt_block(block, round_key);
+
+        for (int j = 0; j < 16; j++)
+        {
+            block[j] ^= chain[j];
+        }
+
+        memcpy(chain, (const uint8_t *) buffer_in + i, 16);
+
+        memcpy((uint8_t *) buffer_out + i, block, 16);
+    }
+
+    return true;
+}
+
+bool twr_aes_ctr_encrypt(void *buffer_out, const void *buffer_in, size_t length, const twr_aes_key_t key, const twr_aes_iv_t iv)
+{
+    uint8_t round_key[176];
+    uint8_t counter[16];
+    uint8_t block[16];
+
+    if ((length % 16) != 0)
+    {
+        return false;
+    }
+
+    _twr_aes_expand(round_key, key);
+
+    for (int i = 0; i < 16; i++)
+    {
+        counter[i] = ((const uint8_t *) iv)[15 - i];
+    }
+
+    for (size_t i = 0; i < length; i += 16)
+    {
+        memcpy(block, counter, 16);
+
+        _twr_aes_encrypt_block(block, round_key);
+
+        for (int j = 0; j < 16; j++)
+        {
+            ((uint8_t *) buffer_out)[i + j] = ((const uint8_t *) buffer_in)[i + j] ^ block[j];
+        }
+
+        // Hardware increments only the last 32 bits of counter block
+        for (int j = 15; j >= 12; j--)
+        {
+            if (++counter[j] != 0)
+            {
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+void twr_aes_key_from_uint8(twr_aes_key_t key, const uint8_t *buffer)
+{
+    uint8_t *tmp = (uint8_t *) key;
+
+    for (int i = 0; i < 16; i++)
+    {
+        tmp[15 - i] = buffer[i];
+    }
+}
+
+void twr_aes_iv_from_uint8(twr_aes_iv_t iv, const uint8_t *buffer)
+{
+    uint8_t *tmp = (uint8_t *) iv;
+
+    for (int i = 0; i < 16; i++)
+    {
+        tmp[15 - i] = buffer[i];
+    }
+}
+
+static void _twr_aes_expand(uint8_t *round_key, const twr_aes_key_t key)
+{
+    uint8_t rcon = 0x01;
+
+    for (int i = 0; i < 16; i++)
+    {
+        round_key[i] = ((const uint8_t *) key)[15 - i];
+    }
+
+    for (int i = 16; i < 176; i += 4)
+    {
+        uint8_t word[4];
+
+        memcpy(word, round_key + i - 4, 4);
+
+        if ((i % 16) == 0)
+        {
+            uint8_t first = word[0];
+
+            word[0] = _twr_aes_sbox[word[1]] ^ rcon;
+            word[1] = _twr_aes_sbox[word[2]];
+            word[2] = _twr_aes_sbox[word[3]];
+            word[3] = _twr_aes_sbox[first];
+
+            rcon = _twr_aes_xtime(rcon);
+        }
+
+        for (int j = 0; j < 4; j++)
+        {
+            round_key[i + j] = round_key[i + j - 16] ^ word[j];
+        }
+    }
+}
+
+static void _twr_aes_encrypt_block(uint8_t *block, const uint8_t *round_key)
+{
+    uint8_t tmp[16];
+
+    for (int i = 0; i < 16; i++)
+    {
+        block[i] ^= round_key[i];
+    }
+
+    for (int round = 1; round <= 10; round++)
+    {
+        // SubBytes and ShiftRows, state is stored column by column
+        for (int i = 0; i < 16; i++)
+        {
+            tmp[i] = _twr_aes_sbox[block[(i + 4 * (i % 4)) % 16]];
+        }
+
+        for (int c = 0; c < 4 && round != 10; c++)
+        {
+            uint8_t *column = tmp + 4 * c;
+            uint8_t all = column[0] ^ column[1] ^ column[2] ^ column[3];
+            uint8_t first = column[0];
+
+            column[0] ^= all ^ _twr_aes_xtime(column[0] ^ column[1]);
+            column[1] ^= all ^ _twr_aes_xtime(column[1] ^ column[2]);
+            column[2] ^= all ^ _twr_aes_xtime(column[2] ^ column[3]);
+            column[3] ^= all ^ _twr_aes_xtime(column[3] ^ first);
+        }
+
+        for (int i = 0; i < 16; i++)
+        {
+            block[i] = tmp[i] ^ round_key[16 * round + i];
+        }
+    }
+}
+
+static void _twr_aes_decrypt_block(uint8_t *block, const uint8_t *round_key)
+{
+    uint8_t tmp[16];
+
+    for (int round = 10; round >= 1; round--)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            tmp[i] = block[i] ^ round_key[16 * round + i];
+        }
+
+        for (int c = 0; c < 4 && round != 10; c++)
+        {
+            uint8_t *column = tmp + 4 * c;
+            uint8_t a0 = column[0], a1 = column[1], a2 = column[2], a3 = column[3];
+
+            column[0] = _twr_aes_multiply(a0, 14) ^ _twr_aes_multiply(a1, 11) ^ _twr_aes_multiply(a2, 13) ^ _twr_aes_multiply(a3, 9);
+            column[1] = _twr_aes_multiply(a0, 9) ^ _twr_aes_multiply(a1, 14) ^ _twr_aes_multiply(a2, 11) ^ _twr_aes_multiply(a3, 13);
+            column[2] = _twr_aes_multiply(a0, 13) ^ _twr_aes_multiply(a1, 9) ^ _twr_aes_multiply(a2, 14) ^ _twr_aes_multiply(a3, 11);
+            column[3] = _twr_aes_multiply(a0, 11) ^ _twr_aes_multiply(a1, 13) ^ _twr_aes_multiply(a2, 9) ^ _twr_aes_multiply(a3, 14);
+        }
+
+        // Inverse ShiftRows and SubBytes
+        for (int i = 0; i < 16; i++)
+        {
+            block[(i + 4 * (i % 4)) % 16] = _twr_aes_inverse_sbox(tmp[i]);
+        }
+    }
+
+    for (int i = 0; i < 16; i++)
+    {
+        block[i] ^= round_key[i];
+    }
+}
+
+static uint8_t _twr_aes_xtime(uint8_t value)
+{
+    return (value << 1) ^ ((value & 0x80) ? 0x1b : 0);
+}
+
+static uint8_t _twr_aes_multiply(uint8_t value, uint8_t factor)
+{
+    uint8_t result = 0;
+
+    while (factor != 0)
+    {
+        if (factor & 1)
+        {
+            result ^= value;
+        }
+
+        value = _twr_aes_xtime(value);
+
+        factor >>= 1;
+    }
+
+    return result;
+}
+
+static uint8_t _twr_aes_inverse_sbox(uint8_t value)
+{
+    // Table is searched, decryption is only used by tools on host
+    for (int i = 0; i < 256; i++)
+    {
+        if (_twr_aes_sbox[i] == value)
+        {
+            return i;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include <twr_atsha204.h>
+#include <twr_host.h>
+#include <unistd.h>
+
+// Serial number is taken from TWR_HOST_ID (hexadecimal) or derived from process ID,
+// so that simulated nodes running side by side get distinct radio IDs
+
+#define _TWR_ATSHA204_SERIAL_NUMBER_SIZE 6
+
+static void _twr_atsha204_task(void *param);
+
+void twr_atsha204_init(twr_atsha204_t *self, twr_i2c_channel_t i2c_channel, uint8_t i2c_address)
+{
+    memset(self, 0, sizeof(*self));
+
+    self->_i2c_channel = i2c_channel;
+    self->_i2c_address = i2c_address;
+
+    self->_task_id = twr_scheduler_register(_twr_atsha204_task, self, TWR_TICK_INFINITY);
+
+    self->_ready = true;
+}
+
+void twr_atsha204_set_event_handler(twr_atsha204_t *self, void (*event_handler)(twr_atsha204_t *, twr_atsha204_event_t, void *), void *event_param)
+{
+    self->_event_handler = event_handler;
+    self->_event_param = event_param;
+}
+
+bool twr_atsha204_is_ready(twr_atsha204_t *self)
+{
+    return self->_ready;
+}
+
+bool twr_atsha204_read_serial_number(twr_atsha204_t *self)
+{
+    if (!twr_atsha204_is_ready(self))
+    {
+        return false;
+    }
+
+    self->_ready = false;
+    self->_state = TWR_ATSHA204_STATE_READ_SERIAL_NUMBER;
+
+    twr_scheduler_plan_relative(self->_task_id, 4);
+
+    return true;
+}
+
+bool twr_atsha204_get_serial_number(twr_atsha204_t *self, void *destination, size_t size)
+{
+    if (!twr_atsha204_is_ready(self) || self->_state != TWR_ATSHA204_STATE_SERIAL_NUMBER)
+    {
+        return false;
+    }
+
+    uint8_t *number = (uint8_t *) destination;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        *number++ = i < _TWR_ATSHA204_SERIAL_NUMBER_SIZE ? self->_rx_buffer[i] : 0;
+    }
+
+    return true;
+}
+
+static void _twr_atsha204_task(void *param)
+{
+    twr_atsha204_t *self = (twr_atsha204_t *) param;
+
+    const char *id = twr_host_get_env("ID", NULL);
+
+    uint64_t serial_number = id != NULL ? strtoull(id, NULL, 16) : (uint64_t) getpid();
+
+    for (size_t i = 0; i < _TWR_ATSHA204_SERIAL_NUMBER_SIZE; i++)
+    {
+        self->_rx_buffer[i] = serial_number >> (8 * i);
+    }
+
+    self->_state = TWR_ATSHA204_STATE_SERIAL_NUMBER;
+    self->_ready = true;
+
+    if (self->_event_handler != NULL)
+    {
+        self->_event_handler(self, TWR_ATSHA204_EVENT_SERIAL_NUMBER, self->_event_param);
+    }
+}
@@ -0,0 +1,156 @@
+#include <twr_eeprom.h>
+#include <twr_scheduler.h>
+#include <twr_host.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// EEPROM is backed by file mapped to memory (TWR_HOST_EEPROM, default "eeprom.bin") so it persists across runs,
+// new file reads as zeros which is also the erased state of STM32L0 data EEPROM
+
+#define _TWR_EEPROM_SIZE 6144
+
+static struct
+{
+    uint8_t *memory;
+    bool running;
+    uint32_t address;
+    uint8_t *buffer;
+    size_t length;
+    void (*event_handler)(twr_eepromc_event_t, void *);
+    void *event_param;
+    twr_scheduler_task_id_t task_id;
+
+} _twr_eeprom;
+
+static bool _twr_eeprom_map(void);
+static void _twr_eeprom_async_write_task(void *param);
+
+bool twr_eeprom_write(uint32_t address, const void *buffer, size_t length)
+{
+    // If user attempts to write outside EEPROM area...
+    if (address + length > _TWR_EEPROM_SIZE || !_twr_eeprom_map())
+    {
+        // Indicate failure
+        return false;
+    }
+
+    memcpy(_twr_eeprom.memory + address, buffer, length);
+
+    return true;
+}
+
+bool twr_eeprom_async_write(uint32_t address, const void *buffer, size_t length, void (*event_handler)(twr_eepromc_event_t, void *), void *event_param)
+{
+    if (_twr_eeprom.running)
+    {
+        return false;
+    }
+
+    // If user attempts to write outside EEPROM area...
+    if (address + length > _TWR_EEPROM_SIZE)
+    {
+        // Indicate failure
+        return false;
+    }
+
+    _twr_eeprom.address = address;
+
+    _twr_eeprom.buffer = (uint8_t *) buffer;
+
+    _twr_eeprom.length = length;
+
+    _twr_eeprom.event_handler = event_handler;
+
+    _twr_eeprom.event_param = event_param;
+
+    _twr_eeprom.task_id = twr_scheduler_register(_twr_eeprom_async_write_task, NULL, 0);
+
+    _twr_eeprom.running = true;
+
+    return true;
+}
+
+void twr_eeprom_async_cancel(void)
+{
+    if (_twr_eeprom.running)
+    {
+        twr_scheduler_unregister(_twr_eeprom.task_id);
+
+        _twr_eeprom.running = false;
+    }
+}
+
+bool twr_eeprom_read(uint32_t address, void *buffer, size_t length)
+{
+    // If user attempts to read outside of EEPROM boundary...
+    if (address + length > _TWR_EEPROM_SIZE || !_twr_eeprom_map())
+    {
+        // Indicate failure
+        return false;
+    }
+
+    memcpy(buffer, _twr_eeprom.memory + address, length);
+
+    return true;
+}
+
+size_t twr_eeprom_get_size(void)
+{
+    return _TWR_EEPROM_SIZE;
+}
+
+static bool _twr_eeprom_map(void)
+{
+    if (_twr_eeprom.memory != NULL)
+    {
+        return true;
+    }
+
+    const char *path = twr_host_get_env("EEPROM", "eeprom.bin");
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0 || ftruncate(fd, _TWR_EEPROM_SIZE) != 0)
+    {
+        perror("twr_eeprom: open");
+
+        return false;
+    }
+
+    void *memory = mmap(NULL, _TWR_EEPROM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if (memory == MAP_FAILED)
+    {
+        perror("twr_eeprom: mmap");
+
+        return false;
+    }
+
+    _twr_eeprom.memory = memory;
+
+    return true;
+}
+
+static void _twr_eeprom_async_write_task(void *param)
+{
+    (void) param;
+
+    twr_eepromc_event_t event = TWR_EEPROM_EVENT_ASYNC_WRITE_DONE;
+
+    if (!twr_eeprom_write(_twr_eeprom.address, _twr_eeprom.buffer, _twr_eeprom.length))
+    {
+        event = TWR_EEPROM_EVENT_ASYNC_WRITE_ERROR;
+    }
+
+    twr_scheduler_unregister(_twr_eeprom.task_id);
+
+    _twr_eeprom.running = false;
+
+    if (_twr_eeprom.event_handler != NULL)
+    {
+        _twr_eeprom.event_handler(event, _twr_eeprom.event_param);
+    }
+}
@@ -0,0 +1,61 @@
+#include <twr_gpio.h>
+
+// Pins are emulated in memory, input of pin in output mode reads back its output and others read their pull
+
+static struct
+{
+    twr_gpio_mode_t mode;
+    twr_gpio_pull_t pull;
+    int output;
+
+} _twr_gpio[TWR_GPIO_SDA0 + 1];
+
+void twr_gpio_init(twr_gpio_channel_t channel)
+{
+    (void) channel;
+}
+
+void twr_gpio_set_pull(twr_gpio_channel_t channel, twr_gpio_pull_t pull)
+{
+    _twr_gpio[channel].pull = pull;
+}
+
+twr_gpio_pull_t twr_gpio_get_pull(twr_gpio_channel_t channel)
+{
+    return _twr_gpio[channel].pull;
+}
+
+void twr_gpio_set_mode(twr_gpio_channel_t channel, twr_gpio_mode_t mode)
+{
+    _twr_gpio[channel].mode = mode;
+}
+
+twr_gpio_mode_t twr_gpio_get_mode(twr_gpio_channel_t channel)
+{
+    return _twr_gpio[channel].mode;
+}
+
+int twr_gpio_get_input(twr_gpio_channel_t channel)
+{
+    if (_twr_gpio[channel].mode == TWR_GPIO_MODE_OUTPUT || _twr_gpio[channel].mode == TWR_GPIO_MODE_OUTPUT_OD)
+    {
+        return _twr_gpio[channel].output;
+    }
+
+    return _twr_gpio[channel].pull == TWR_GPIO_PULL_UP ? 1 : 0;
+}
+
+void twr_gpio_set_output(twr_gpio_channel_t channel, int state)
+{
+    _twr_gpio[channel].output = state != 0 ? 1 : 0;
+}
+
+int twr_gpio_get_output(twr_gpio_channel_t channel)
+{
+    return _twr_gpio[channel].output;
+}
+
+void twr_gpio_toggle_output(twr_gpio_channel_t channel)
+{
+    _twr_gpio[channel].output ^= 1;
+}
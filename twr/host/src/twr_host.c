@@ -0,0 +1,240 @@
+#include <twr_host.h>
+#include <twr_scheduler.h>
+#include <stm32l0xx.h>
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
+
+SCB_Type twr_host_scb;
+
+RTC_TypeDef twr_host_rtc;
+
+static struct
+{
+    bool initialized;
+    bool realtime;
+    struct timespec start;
+    SysTick_Type systick;
+    uint32_t primask;
+
+    struct
+    {
+        int fd;
+        void (*handler)(int, void *);
+        void *param;
+
+    } watch[TWR_HOST_MAX_FD];
+
+    size_t watch_count;
+
+} _twr_host;
+
+static void _twr_host_init(void);
+
+static bool _twr_host_poll(int timeout);
+
+bool twr_host_is_realtime(void)
+{
+    _twr_host_init();
+
+    return _twr_host.realtime;
+}
+
+uint64_t twr_host_get_clock_us(void)
+{
+    _twr_host_init();
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    int64_t sec = (int64_t) now.tv_sec - (int64_t) _twr_host.start.tv_sec;
+    int64_t nsec = (int64_t) now.tv_nsec - (int64_t) _twr_host.start.tv_nsec;
+
+    return (uint64_t) (sec * 1000000 + nsec / 1000);
+}
+
+const char *twr_host_get_env(const char *name, const char *fallback)
+{
+    char key[64];
+
+    snprintf(key, sizeof(key), "TWR_HOST_%s", name);
+
+    const char *value = getenv(key);
+
+    return value != NULL ? value : fallback;
+}
+
+bool twr_host_register_fd(int fd, void (*handler)(int, void *), void *param)
+{
+    if (_twr_host.watch_count >= TWR_HOST_MAX_FD)
+    {
+        return false;
+    }
+
+    _twr_host.watch[_twr_host.watch_count].fd = fd;
+    _twr_host.watch[_twr_host.watch_count].handler = handler;
+    _twr_host.watch[_twr_host.watch_count].param = param;
+
+    _twr_host.watch_count++;
+
+    return true;
+}
+
+void twr_host_unregister_fd(int fd)
+{
+    for (size_t i = 0; i < _twr_host.watch_count; i++)
+    {
+        if (_twr_host.watch[i].fd == fd)
+        {
+            _twr_host.watch[i] = _twr_host.watch[--_twr_host.watch_count];
+
+            return;
+        }
+    }
+}
+
+void twr_host_wait(void)
+{
+    twr_tick_t tick_now = twr_tick_get();
+    twr_tick_t tick_next = twr_scheduler_get_next_tick();
+
+    if (tick_next == TWR_TICK_INFINITY && _twr_host.watch_count == 0)
+    {
+        fprintf(stderr, "twr_host: Nothing is planned, exiting at tick %" PRIu64 "\n", tick_now);
+
+        exit(EXIT_SUCCESS);
+    }
+
+    if (twr_host_is_realtime())
+    {
+        int timeout = -1;
+
+        if (tick_next != TWR_TICK_INFINITY)
+        {
+            timeout = tick_next > tick_now ? (int) (tick_next - tick_now < INT32_MAX ? tick_next - tick_now : INT32_MAX) : 0;
+        }
+
+        _twr_host_poll(timeout);
+
+        return;
+    }
+
+    // Pending input is handled first, simulated time does not pass while there is something to do
+    if (_twr_host_poll(0))
+    {
+        return;
+    }
+
+    if (tick_next == TWR_TICK_INFINITY)
+    {
+        _twr_host_poll(-1);
+
+        return;
+    }
+
+    twr_tick_t delta = tick_next > tick_now ? tick_next - tick_now : 1;
+
+#if !TWR_SCHEDULER_TICKLESS
+
+    // Periodic wake-up advances time only in whole scheduler intervals
+    delta = (delta + TWR_SCHEDULER_INTERVAL_MS - 1) / TWR_SCHEDULER_INTERVAL_MS * TWR_SCHEDULER_INTERVAL_MS;
+
+#endif
+
+    twr_tick_increment_irq(delta);
+}
+
+SysTick_Type *twr_host_systick(void)
+{
+    _twr_host.systick.LOAD = 999;
+    _twr_host.systick.VAL = 999 - twr_host_get_clock_us() % 1000;
+
+    return &_twr_host.systick;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return (uint32_t) (twr_host_get_clock_us() / 1000);
+}
+
+uint32_t __get_PRIMASK(void)
+{
+    return _twr_host.primask;
+}
+
+void __disable_irq(void)
+{
+    _twr_host.primask = 1;
+}
+
+void __enable_irq(void)
+{
+    _twr_host.primask = 0;
+}
+
+void __WFI(void)
+{
+    twr_host_wait();
+}
+
+static void _twr_host_init(void)
+{
+    if (_twr_host.initialized)
+    {
+        return;
+    }
+
+    _twr_host.initialized = true;
+
+    clock_gettime(CLOCK_MONOTONIC, &_twr_host.start);
+
+    _twr_host.realtime = strcmp(twr_host_get_env("REALTIME", "0"), "1") == 0;
+}
+
+static bool _twr_host_poll(int timeout)
+{
+    struct pollfd fds[TWR_HOST_MAX_FD];
+
+    size_t count = _twr_host.watch_count;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        fds[i].fd = _twr_host.watch[i].fd;
+        fds[i].events = POLLIN;
+        fds[i].revents = 0;
+    }
+
+    int ret = poll(fds, count, timeout);
+
+    if (ret <= 0)
+    {
+        if (ret < 0 && errno != EINTR)
+        {
+            perror("twr_host: poll");
+        }
+
+        return false;
+    }
+
+    // Handlers may unregister descriptors, so look them up again by value
+    for (size_t i = 0; i < count; i++)
+    {
+        if (fds[i].revents == 0)
+        {
+            continue;
+        }
+
+        for (size_t j = 0; j < _twr_host.watch_count; j++)
+        {
+            if (_twr_host.watch[j].fd == fds[i].fd)
+            {
+                _twr_host.watch[j].handler(fds[i].fd, _twr_host.watch[j].param);
+
+                break;
+            }
+        }
+    }
+
+    return true;
+}
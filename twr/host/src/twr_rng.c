@@ -0,0 +1,7 @@
+#include <twr_rng.h>
+#include <sys/random.h>
+
+bool twr_rng_read(uint32_t *random)
+{
+    return getrandom(random, sizeof(*random), 0) == sizeof(*random);
+}
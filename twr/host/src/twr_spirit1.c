@@ -0,0 +1,573 @@
+#include <twr_spirit1.h>
+#include <twr_scheduler.h>
+#include <twr_host.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Radio medium is UDP multicast group on loopback interface shared by all simulated nodes on the host,
+// port can be changed by TWR_HOST_RADIO_PORT to separate networks and reported RSSI by TWR_HOST_RADIO_RSSI.
+// Every transmission is announced by carrier datagram when it starts and its data datagram is sent when it ends,
+// receiver loses packets which overlap on air and clear channel assessment sees the channel busy in between.
+// Packet is only received if receiver was in RX state before its carrier started, as it would miss the preamble.
+// Timing is only comparable between nodes if they follow wall clock (TWR_HOST_REALTIME=1).
+
+#define _TWR_SPIRIT1_GROUP "239.255.0.1"
+
+// Preamble, sync word, length and CRC are sent with every packet at 19200 bps
+#define _TWR_SPIRIT1_OVERHEAD 11
+#define _TWR_SPIRIT1_DATARATE 19200
+
+// Clear channel assessment listens for 64 bit periods
+#define _TWR_SPIRIT1_CCA_TIME 4
+
+#define _TWR_SPIRIT1_KIND_CARRIER 0
+#define _TWR_SPIRIT1_KIND_DATA 1
+
+typedef enum
+{
+    TWR_SPIRIT1_STATE_INIT = 0,
+    TWR_SPIRIT1_STATE_SLEEP = 1,
+    TWR_SPIRIT1_STATE_TX = 2,
+    TWR_SPIRIT1_STATE_RX = 3
+
+} twr_spirit1_state_t;
+
+typedef struct
+{
+    int initialized_semaphore;
+    void (*event_handler)(twr_spirit1_event_t, void *);
+    void *event_param;
+    twr_scheduler_task_id_t task_id;
+    twr_spirit1_state_t desired_state;
+    twr_spirit1_state_t current_state;
+    uint8_t tx_buffer[TWR_SPIRIT1_MAX_PACKET_SIZE];
+    size_t tx_length;
+    bool tx_cca;
+    uint8_t rx_buffer[TWR_SPIRIT1_MAX_PACKET_SIZE];
+    size_t rx_length;
+    int rx_rssi;
+    twr_tick_t rx_timeout;
+    twr_tick_t rx_tick_timeout;
+    twr_tick_t rx_sniff;
+    twr_tick_t rx_tick_sniff;
+    twr_tick_t rx_tick_start;
+    twr_tick_t tx_tick_cca;
+    twr_tick_t tx_tick_done;
+    twr_tick_t air_tick_start;
+    twr_tick_t air_tick_end;
+    uint32_t air_sender;
+    bool air_collided;
+    bool rx_ready;
+    int fd;
+    struct sockaddr_in group;
+    uint32_t sender;
+
+} twr_spirit1_t;
+
+static twr_spirit1_t _twr_spirit1;
+
+static void _twr_spirit1_task(void *param);
+static void _twr_spirit1_enter_state_tx(void);
+static void _twr_spirit1_check_state_tx(void);
+static void _twr_spirit1_enter_state_rx(void);
+static void _twr_spirit1_check_state_rx(void);
+static void _twr_spirit1_enter_state_sleep(void);
+static void _twr_spirit1_fd_handler(int fd, void *param);
+static void _twr_spirit1_send(uint8_t kind, const void *buffer, size_t length);
+static twr_tick_t _twr_spirit1_get_air_time(size_t length);
+
+bool twr_spirit1_init(void)
+{
+    if (_twr_spirit1.initialized_semaphore > 0)
+    {
+        _twr_spirit1.initialized_semaphore++;
+
+        return true;
+    }
+
+    memset(&_twr_spirit1, 0, sizeof(_twr_spirit1));
+
+    _twr_spirit1.desired_state = TWR_SPIRIT1_STATE_SLEEP;
+
+    _twr_spirit1.rx_timeout = TWR_TICK_INFINITY;
+
+    _twr_spirit1.rx_tick_timeout = TWR_TICK_INFINITY;
+
+    _twr_spirit1.fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (_twr_spirit1.fd < 0)
+    {
+        perror("twr_spirit1: socket");
+
+        return false;
+    }
+
+    int on = 1;
+    unsigned char loop = 1;
+    struct in_addr local = { .s_addr = htonl(INADDR_LOOPBACK) };
+    struct ip_mreq mreq = { .imr_multiaddr.s_addr = inet_addr(_TWR_SPIRIT1_GROUP), .imr_interface = local };
+
+    _twr_spirit1.group.sin_family = AF_INET;
+    _twr_spirit1.group.sin_addr.s_addr = inet_addr(_TWR_SPIRIT1_GROUP);
+    _twr_spirit1.group.sin_port = htons(atoi(twr_host_get_env("RADIO_PORT", "5311")));
+
+    struct sockaddr_in bind_address = _twr_spirit1.group;
+
+    bind_address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (setsockopt(_twr_spirit1.fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0 ||
+        bind(_twr_spirit1.fd, (struct sockaddr *) &bind_address, sizeof(bind_address)) != 0 ||
+        setsockopt(_twr_spirit1.fd, IPPROTO_IP, IP_MULTICAST_IF, &local, sizeof(local)) != 0 ||
+        setsockopt(_twr_spirit1.fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) != 0 ||
+        setsockopt(_twr_spirit1.fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0)
+    {
+        perror("twr_spirit1: setsockopt");
+
+        close(_twr_spirit1.fd);
+
+        return false;
+    }
+
+    // Every node hears its own transmissions on loopback, they are told apart by sender tag
+    _twr_spirit1.sender = (uint32_t) getpid();
+
+    _twr_spirit1.rx_rssi = atoi(twr_host_get_env("RADIO_RSSI", "-60"));
+
+    twr_host_register_fd(_twr_spirit1.fd, _twr_spirit1_fd_handler, NULL);
+
+    _twr_spirit1.task_id = twr_scheduler_register_ex(_twr_spirit1_task, NULL, TWR_TICK_INFINITY, TWR_SCHEDULER_PRIORITY_HIGH);
+
+    _twr_spirit1.initialized_semaphore++;
+
+    return true;
+}
+
+bool twr_spirit1_deinit(void)
+{
+    if (--_twr_spirit1.initialized_semaphore != 0)
+    {
+        return false;
+    }
+
+    twr_host_unregister_fd(_twr_spirit1.fd);
+
+    close(_twr_spirit1.fd);
+
+    twr_scheduler_unregister(_twr_spirit1.task_id);
+
+    return true;
+}
+
+void twr_spirit1_set_event_handler(void (*event_handler)(twr_spirit1_event_t, void *), void *event_param)
+{
+    _twr_spirit1.event_handler = event_handler;
+    _twr_spirit1.event_param = event_param;
+}
+
+void *twr_spirit1_get_tx_buffer(void)
+{
+    return _twr_spirit1.tx_buffer;
+}
+
+void twr_spirit1_set_tx_length(size_t length)
+{
+    _twr_spirit1.tx_length = length;
+}
+
+size_t twr_spirit1_get_tx_length(void)
+{
+    return _twr_spirit1.tx_length;
+}
+
+void *twr_spirit1_get_rx_buffer(void)
+{
+    return _twr_spirit1.rx_buffer;
+}
+
+size_t twr_spirit1_get_rx_length(void)
+{
+    return _twr_spirit1.rx_length;
+}
+
+int twr_spirit1_get_rx_rssi(void)
+{
+    return _twr_spirit1.rx_rssi;
+}
+
+void twr_spirit1_set_rx_timeout(twr_tick_t timeout)
+{
+    _twr_spirit1.rx_timeout = timeout;
+
+    if (_twr_spirit1.current_state == TWR_SPIRIT1_STATE_RX)
+    {
+        if (_twr_spirit1.rx_timeout == TWR_TICK_INFINITY)
+        {
+            _twr_spirit1.rx_tick_timeout = TWR_TICK_INFINITY;
+        }
+        else
+        {
+            _twr_spirit1.rx_tick_timeout = twr_tick_get() + _twr_spirit1.rx_timeout;
+        }
+
+        if (_twr_spirit1.initialized_semaphore > 0)
+        {
+            twr_scheduler_plan_absolute(_twr_spirit1.task_id, _twr_spirit1.rx_tick_timeout);
+        }
+    }
+}
+
+void twr_spirit1_tx(void)
+{
+    _twr_spirit1.desired_state = TWR_SPIRIT1_STATE_TX;
+
+    _twr_spirit1.tx_cca = false;
+
+    if (_twr_spirit1.initialized_semaphore > 0)
+    {
+        twr_scheduler_plan_now(_twr_spirit1.task_id);
+    }
+}
+
+void twr_spirit1_tx_cca(void)
+{
+    _twr_spirit1.desired_state = TWR_SPIRIT1_STATE_TX;
+
+    _twr_spirit1.tx_cca = true;
+
+    if (_twr_spirit1.initialized_semaphore > 0)
+    {
+        twr_scheduler_plan_now(_twr_spirit1.task_id);
+    }
+}
+
+void twr_spirit1_rx(void)
+{
+    _twr_spirit1.desired_state = TWR_SPIRIT1_STATE_RX;
+
+    _twr_spirit1.rx_sniff = 0;
+
+    if (_twr_spirit1.initialized_semaphore > 0)
+    {
+        twr_scheduler_plan_now(_twr_spirit1.task_id);
+    }
+}
+
+void twr_spirit1_rx_sniff(twr_tick_t timeout)
+{
+    _twr_spirit1.desired_state = TWR_SPIRIT1_STATE_RX;
+
+    _twr_spirit1.rx_sniff = timeout;
+
+    if (_twr_spirit1.initialized_semaphore > 0)
+    {
+        twr_scheduler_plan_now(_twr_spirit1.task_id);
+    }
+}
+
+void twr_spirit1_sleep(void)
+{
+    _twr_spirit1.desired_state = TWR_SPIRIT1_STATE_SLEEP;
+
+    if (_twr_spirit1.initialized_semaphore > 0)
+    {
+        twr_scheduler_plan_now(_twr_spirit1.task_id);
+    }
+}
+
+static void _twr_spirit1_task(void *param)
+{
+    (void) param;
+
+    if ((_twr_spirit1.current_state == TWR_SPIRIT1_STATE_RX) && (_twr_spirit1.rx_sniff != 0) && (twr_tick_get() >= _twr_spirit1.rx_tick_sniff))
+    {
+        _twr_spirit1.rx_sniff = 0;
+
+        // Carrier sensed at any moment of sniff keeps radio receiving
+        if (_twr_spirit1.air_tick_end > _twr_spirit1.rx_tick_start)
+        {
+            twr_scheduler_plan_current_absolute(_twr_spirit1.rx_tick_timeout);
+        }
+        else
+        {
+            _twr_spirit1.rx_tick_timeout = twr_tick_get();
+        }
+    }
+
+    if ((_twr_spirit1.current_state == TWR_SPIRIT1_STATE_RX) && (twr_tick_get() >= _twr_spirit1.rx_tick_timeout))
+    {
+        if (_twr_spirit1.event_handler != NULL)
+        {
+            _twr_spirit1.event_handler(TWR_SPIRIT1_EVENT_RX_TIMEOUT, _twr_spirit1.event_param);
+        }
+    }
+
+    if (_twr_spirit1.desired_state != _twr_spirit1.current_state)
+    {
+        if (_twr_spirit1.desired_state == TWR_SPIRIT1_STATE_TX)
+        {
+            _twr_spirit1_enter_state_tx();
+        }
+        else if (_twr_spirit1.desired_state == TWR_SPIRIT1_STATE_RX)
+        {
+            _twr_spirit1_enter_state_rx();
+        }
+        else if (_twr_spirit1.desired_state == TWR_SPIRIT1_STATE_SLEEP)
+        {
+            _twr_spirit1_enter_state_sleep();
+        }
+
+        return;
+    }
+
+    if (_twr_spirit1.current_state == TWR_SPIRIT1_STATE_TX)
+    {
+        _twr_spirit1_check_state_tx();
+    }
+    else if (_twr_spirit1.current_state == TWR_SPIRIT1_STATE_RX)
+    {
+        _twr_spirit1_check_state_rx();
+    }
+}
+
+static void _twr_spirit1_enter_state_tx(void)
+{
+    _twr_spirit1.current_state = TWR_SPIRIT1_STATE_TX;
+
+    if (_twr_spirit1.tx_cca)
+    {
+        _twr_spirit1.tx_tick_cca = twr_tick_get() + _TWR_SPIRIT1_CCA_TIME;
+
+        twr_scheduler_plan_current_absolute(_twr_spirit1.tx_tick_cca);
+
+        return;
+    }
+
+    _twr_spirit1.tx_tick_cca = 0;
+
+    // Packet is delivered and reported done after the time it would take on air
+    _twr_spirit1.tx_tick_done = twr_tick_get() + _twr_spirit1_get_air_time(_twr_spirit1.tx_length);
+
+    uint8_t length = _twr_spirit1.tx_length;
+
+    _twr_spirit1_send(_TWR_SPIRIT1_KIND_CARRIER, &length, sizeof(length));
+
+    // Radio does not hear packet which is on air while it transmits
+    if (twr_tick_get() < _twr_spirit1.air_tick_end)
+    {
+        _twr_spirit1.air_collided = true;
+    }
+
+    twr_scheduler_plan_current_absolute(_twr_spirit1.tx_tick_done);
+}
+
+static void _twr_spirit1_check_state_tx(void)
+{
+    twr_spirit1_event_t event = TWR_SPIRIT1_EVENT_TX_DONE;
+
+    if (_twr_spirit1.tx_tick_cca != 0)
+    {
+        if (twr_tick_get() < _twr_spirit1.tx_tick_cca)
+        {
+            twr_scheduler_plan_current_absolute(_twr_spirit1.tx_tick_cca);
+
+            return;
+        }
+
+        // Channel is busy if any packet was on air while listening
+        if (_twr_spirit1.air_tick_end > _twr_spirit1.tx_tick_cca - _TWR_SPIRIT1_CCA_TIME)
+        {
+            event = TWR_SPIRIT1_EVENT_TX_BUSY;
+        }
+        else
+        {
+            _twr_spirit1.tx_cca = false;
+
+            _twr_spirit1_enter_state_tx();
+
+            return;
+        }
+    }
+    else if (twr_tick_get() < _twr_spirit1.tx_tick_done)
+    {
+        twr_scheduler_plan_current_absolute(_twr_spirit1.tx_tick_done);
+
+        return;
+    }
+    else
+    {
+        _twr_spirit1_send(_TWR_SPIRIT1_KIND_DATA, _twr_spirit1.tx_buffer, _twr_spirit1.tx_length);
+    }
+
+    _twr_spirit1.desired_state = TWR_SPIRIT1_STATE_SLEEP;
+
+    if (_twr_spirit1.event_handler != NULL)
+    {
+        _twr_spirit1.event_handler(event, _twr_spirit1.event_param);
+    }
+
+    if (_twr_spirit1.desired_state == TWR_SPIRIT1_STATE_RX)
+    {
+        _twr_spirit1_enter_state_rx();
+    }
+    else if (_twr_spirit1.desired_state == TWR_SPIRIT1_STATE_SLEEP)
+    {
+        _twr_spirit1_enter_state_sleep();
+    }
+    else if (_twr_spirit1.desired_state == TWR_SPIRIT1_STATE_TX)
+    {
+        _twr_spirit1_enter_state_tx();
+    }
+}
+
+static void _twr_spirit1_enter_state_rx(void)
+{
+    _twr_spirit1.current_state = TWR_SPIRIT1_STATE_RX;
+
+    _twr_spirit1.rx_ready = false;
+
+    _twr_spirit1.rx_tick_start = twr_tick_get();
+
+    if (_twr_spirit1.rx_timeout == TWR_TICK_INFINITY)
+    {
+        _twr_spirit1.rx_tick_timeout = TWR_TICK_INFINITY;
+    }
+    else
+    {
+        _twr_spirit1.rx_tick_timeout = twr_tick_get() + _twr_spirit1.rx_timeout;
+    }
+
+    if (_twr_spirit1.rx_sniff != 0)
+    {
+        _twr_spirit1.rx_tick_sniff = twr_tick_get() + _twr_spirit1.rx_sniff;
+
+        twr_scheduler_plan_current_absolute(_twr_spirit1.rx_tick_sniff);
+
+        return;
+    }
+
+    twr_scheduler_plan_current_absolute(_twr_spirit1.rx_tick_timeout);
+}
+
+static void _twr_spirit1_check_state_rx(void)
+{
+    if (!_twr_spirit1.rx_ready)
+    {
+        return;
+    }
+
+    _twr_spirit1.rx_ready = false;
+
+    _twr_spirit1.rx_sniff = 0;
+
+    if (_twr_spirit1.rx_timeout == TWR_TICK_INFINITY)
+    {
+        _twr_spirit1.rx_tick_timeout = TWR_TICK_INFINITY;
+    }
+    else
+    {
+        _twr_spirit1.rx_tick_timeout = twr_tick_get() + _twr_spirit1.rx_timeout;
+    }
+
+    twr_scheduler_plan_current_absolute(_twr_spirit1.rx_tick_timeout);
+
+    if (_twr_spirit1.event_handler != NULL)
+    {
+        _twr_spirit1.event_handler(TWR_SPIRIT1_EVENT_RX_DONE, _twr_spirit1.event_param);
+    }
+}
+
+static void _twr_spirit1_enter_state_sleep(void)
+{
+    _twr_spirit1.current_state = TWR_SPIRIT1_STATE_SLEEP;
+}
+
+static void _twr_spirit1_fd_handler(int fd, void *param)
+{
+    (void) param;
+
+    uint8_t packet[sizeof(_twr_spirit1.sender) + 1 + TWR_SPIRIT1_MAX_PACKET_SIZE];
+
+    ssize_t length = recv(fd, packet, sizeof(packet), 0);
+
+    if (length <= (ssize_t) (sizeof(_twr_spirit1.sender) + 1))
+    {
+        return;
+    }
+
+    uint32_t sender;
+
+    memcpy(&sender, packet, sizeof(sender));
+
+    if (sender == _twr_spirit1.sender)
+    {
+        return;
+    }
+
+    uint8_t kind = packet[sizeof(sender)];
+
+    length -= sizeof(sender) + 1;
+
+    if (kind == _TWR_SPIRIT1_KIND_CARRIER)
+    {
+        twr_tick_t tick_now = twr_tick_get();
+        twr_tick_t tick_end = tick_now + _twr_spirit1_get_air_time(packet[sizeof(sender) + 1]);
+
+        // Packets which overlap on air are both lost, capture effect is not emulated
+        if ((tick_now < _twr_spirit1.air_tick_end) || (_twr_spirit1.current_state == TWR_SPIRIT1_STATE_TX && _twr_spirit1.tx_tick_cca == 0))
+        {
+            _twr_spirit1.air_collided = true;
+        }
+        else
+        {
+            _twr_spirit1.air_collided = false;
+            _twr_spirit1.air_sender = sender;
+            _twr_spirit1.air_tick_start = tick_now;
+        }
+
+        if (tick_end > _twr_spirit1.air_tick_end)
+        {
+            _twr_spirit1.air_tick_end = tick_end;
+        }
+
+        return;
+    }
+
+    // Packets are lost when radio does not listen or previous packet has not been taken yet, as they are on air
+    if (_twr_spirit1.current_state != TWR_SPIRIT1_STATE_RX || _twr_spirit1.rx_ready)
+    {
+        return;
+    }
+
+    if (_twr_spirit1.air_collided || sender != _twr_spirit1.air_sender || _twr_spirit1.air_tick_start < _twr_spirit1.rx_tick_start)
+    {
+        return;
+    }
+
+    _twr_spirit1.rx_length = length;
+
+    memcpy(_twr_spirit1.rx_buffer, packet + sizeof(sender) + 1, _twr_spirit1.rx_length);
+
+    _twr_spirit1.rx_ready = true;
+
+    twr_scheduler_plan_now(_twr_spirit1.task_id);
+}
+
+static void _twr_spirit1_send(uint8_t kind, const void *buffer, size_t length)
+{
+    uint8_t packet[sizeof(_twr_spirit1.sender) + 1 + TWR_SPIRIT1_MAX_PACKET_SIZE];
+
+    memcpy(packet, &_twr_spirit1.sender, sizeof(_twr_spirit1.sender));
+
+    packet[sizeof(_twr_spirit1.sender)] = kind;
+
+    memcpy(packet + sizeof(_twr_spirit1.sender) + 1, buffer, length);
+
+    sendto(_twr_spirit1.fd, packet, sizeof(_twr_spirit1.sender) + 1 + length, 0, (struct sockaddr *) &_twr_spirit1.group, sizeof(_twr_spirit1.group));
+}
+
+static twr_tick_t _twr_spirit1_get_air_time(size_t length)
+{
+    return ((_TWR_SPIRIT1_OVERHEAD + length) * 8 * 1000 + _TWR_SPIRIT1_DATARATE - 1) / _TWR_SPIRIT1_DATARATE;
+}
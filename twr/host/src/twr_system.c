@@ -0,0 +1,104 @@
+#include <twr_system.h>
+#include <twr_host.h>
+#include <twr_scheduler.h>
+
+// Clock sources are only counted on host, peripherals run at any clock and sleep is never blocked by them
+
+static int _twr_system_hsi16_enable_semaphore;
+
+static int _twr_system_pll_enable_semaphore;
+
+static int _twr_system_deep_sleep_disable_semaphore;
+
+void twr_system_init(void)
+{
+    setvbuf(stdout, NULL, _IOLBF, 0);
+}
+
+void twr_system_deep_sleep_enable(void)
+{
+    _twr_system_deep_sleep_disable_semaphore--;
+}
+
+void twr_system_deep_sleep_disable(void)
+{
+    _twr_system_deep_sleep_disable_semaphore++;
+}
+
+bool twr_system_get_deep_sleep(void)
+{
+    return _twr_system_deep_sleep_disable_semaphore == 0;
+}
+
+void twr_system_sleep_tickless(void)
+{
+    twr_system_sleep();
+}
+
+void twr_system_enter_standby_mode(void)
+{
+    fprintf(stderr, "twr_host: Entering standby mode, exiting at tick %" PRIu64 "\n", twr_tick_get());
+
+    exit(EXIT_SUCCESS);
+}
+
+twr_system_clock_t twr_system_clock_get(void)
+{
+    if (_twr_system_pll_enable_semaphore != 0)
+    {
+        return TWR_SYSTEM_CLOCK_PLL;
+    }
+    else if (_twr_system_hsi16_enable_semaphore != 0)
+    {
+        return TWR_SYSTEM_CLOCK_HSI;
+    }
+    else
+    {
+        return TWR_SYSTEM_CLOCK_MSI;
+    }
+}
+
+void twr_system_hsi16_enable(void)
+{
+    _twr_system_hsi16_enable_semaphore++;
+}
+
+void twr_system_hsi16_disable(void)
+{
+    _twr_system_hsi16_enable_semaphore--;
+}
+
+void twr_system_pll_enable(void)
+{
+    _twr_system_pll_enable_semaphore++;
+}
+
+void twr_system_pll_disable(void)
+{
+    _twr_system_pll_enable_semaphore--;
+}
+
+uint32_t twr_system_get_clock(void)
+{
+    static const uint32_t clock[] =
+    {
+        [TWR_SYSTEM_CLOCK_MSI] = 2097000,
+        [TWR_SYSTEM_CLOCK_HSI] = 16000000,
+        [TWR_SYSTEM_CLOCK_PLL] = 32000000
+    };
+
+    return clock[twr_system_clock_get()];
+}
+
+void twr_system_reset(void)
+{
+    fprintf(stderr, "twr_host: Reset requested, exiting at tick %" PRIu64 "\n", twr_tick_get());
+
+    exit(EXIT_FAILURE);
+}
+
+bool twr_system_get_vbus_sense(void)
+{
+    // Terminal of emulated UART is always at hand, as if USB was connected
+    return true;
+}
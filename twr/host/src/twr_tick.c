@@ -0,0 +1,56 @@
+#include <twr_tick.h>
+#include <twr_host.h>
+#include <time.h>
+
+// Simulated time, advanced only by twr_host_wait and twr_tick_wait
+static twr_tick_t _twr_tick_counter = 0;
+
+twr_tick_t twr_tick_get(void)
+{
+    if (twr_host_is_realtime())
+    {
+        return twr_host_get_clock_us() / 1000;
+    }
+
+    return _twr_tick_counter;
+}
+
+uint64_t twr_tick_get_us(void)
+{
+    if (twr_host_is_realtime())
+    {
+        return twr_host_get_clock_us();
+    }
+
+    return _twr_tick_counter * 1000;
+}
+
+void twr_tick_wait(twr_tick_t delay)
+{
+    if (twr_host_is_realtime())
+    {
+        struct timespec ts = { .tv_sec = delay / 1000, .tv_nsec = (delay % 1000) * 1000000 };
+
+        nanosleep(&ts, NULL);
+    }
+    else
+    {
+        _twr_tick_counter += delay;
+    }
+}
+
+void twr_tick_increment_irq(twr_tick_t delta)
+{
+    if (!twr_host_is_realtime())
+    {
+        _twr_tick_counter += delta;
+    }
+}
+
+void twr_tick_rtc_reset_irq(void)
+{
+}
+
+void twr_tick_rtc_sync_irq(void)
+{
+}
@@ -0,0 +1,411 @@
+#include <twr_uart.h>
+#include <twr_scheduler.h>
+#include <twr_host.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+// Every channel is connected to pseudo-terminal (path is printed on start) or to standard input and output
+// if environment variable TWR_HOST_UART<n> is set to "stdio"
+
+typedef struct
+{
+    bool initialized;
+    int fd_read;
+    int fd_write;
+    int fd_slave;
+    void (*event_handler)(twr_uart_channel_t, twr_uart_event_t, void *);
+    void *event_param;
+    twr_fifo_t *write_fifo;
+    twr_fifo_t *read_fifo;
+    twr_scheduler_task_id_t async_write_task_id;
+    twr_scheduler_task_id_t async_read_task_id;
+    bool async_write_in_progress;
+    bool async_read_in_progress;
+    twr_tick_t async_timeout;
+    twr_uart_segment_t writev_segment[TWR_UART_WRITEV_SEGMENTS];
+    size_t writev_count;
+    size_t writev_index;
+    void (*writev_done_handler)(twr_uart_channel_t, void *);
+    void *writev_done_param;
+
+} twr_uart_t;
+
+static twr_uart_t _twr_uart[3];
+
+static bool _twr_uart_open(twr_uart_channel_t channel);
+
+static void _twr_uart_write_all(twr_uart_channel_t channel, const void *buffer, size_t length);
+
+static void _twr_uart_async_write_pending(twr_uart_channel_t channel);
+
+static void _twr_uart_async_write_finish(twr_uart_channel_t channel);
+
+static void _twr_uart_async_write_task(void *param);
+
+static void _twr_uart_async_read_task(void *param);
+
+static void _twr_uart_fd_handler(int fd, void *param);
+
+void twr_uart_init(twr_uart_channel_t channel, twr_uart_baudrate_t baudrate, twr_uart_setting_t setting)
+{
+    (void) baudrate;
+    (void) setting;
+
+    _twr_uart_async_write_finish(channel);
+
+    memset(&_twr_uart[channel], 0, sizeof(_twr_uart[channel]));
+
+    _twr_uart[channel].fd_slave = -1;
+
+    _twr_uart[channel].initialized = _twr_uart_open(channel);
+}
+
+void twr_uart_deinit(twr_uart_channel_t channel)
+{
+    if (!_twr_uart[channel].initialized)
+    {
+        return;
+    }
+
+    _twr_uart_async_write_finish(channel);
+
+    twr_uart_async_read_cancel(channel);
+
+    if (_twr_uart[channel].fd_slave >= 0)
+    {
+        close(_twr_uart[channel].fd_slave);
+        close(_twr_uart[channel].fd_read);
+    }
+
+    _twr_uart[channel].initialized = false;
+}
+
+size_t twr_uart_write(twr_uart_channel_t channel, const void *buffer, size_t length)
+{
+    if (!_twr_uart[channel].initialized)
+    {
+        return 0;
+    }
+
+    twr_uart_flush(channel);
+
+    _twr_uart_write_all(channel, buffer, length);
+
+    return length;
+}
+
+size_t twr_uart_read(twr_uart_channel_t channel, void *buffer, size_t length, twr_tick_t timeout)
+{
+    if (!_twr_uart[channel].initialized)
+    {
+        return 0;
+    }
+
+    size_t bytes_read = 0;
+
+    // Time is not simulated while blocking on input, timeout follows wall clock
+    uint64_t timeout_us = timeout == TWR_TICK_INFINITY ? UINT64_MAX : twr_host_get_clock_us() + timeout * 1000;
+
+    while (bytes_read != length)
+    {
+        uint64_t now = twr_host_get_clock_us();
+
+        if (now >= timeout_us)
+        {
+            break;
+        }
+
+        struct pollfd pfd = { .fd = _twr_uart[channel].fd_read, .events = POLLIN };
+
+        int wait = timeout_us == UINT64_MAX ? -1 : (int) ((timeout_us - now + 999) / 1000);
+
+        if (poll(&pfd, 1, wait) <= 0)
+        {
+            continue;
+        }
+
+        ssize_t ret = read(_twr_uart[channel].fd_read, (uint8_t *) buffer + bytes_read, length - bytes_read);
+
+        if (ret <= 0)
+        {
+            break;
+        }
+
+        bytes_read += ret;
+    }
+
+    return bytes_read;
+}
+
+void twr_uart_set_event_handler(twr_uart_channel_t channel, void (*event_handler)(twr_uart_channel_t, twr_uart_event_t, void *), void *event_param)
+{
+    _twr_uart[channel].event_handler = event_handler;
+    _twr_uart[channel].event_param = event_param;
+}
+
+void twr_uart_set_async_fifo(twr_uart_channel_t channel, twr_fifo_t *write_fifo, twr_fifo_t *read_fifo)
+{
+    _twr_uart[channel].write_fifo = write_fifo;
+    _twr_uart[channel].read_fifo = read_fifo;
+}
+
+size_t twr_uart_async_write(twr_uart_channel_t channel, const void *buffer, size_t length)
+{
+    if (!_twr_uart[channel].initialized || _twr_uart[channel].write_fifo == NULL)
+    {
+        return 0;
+    }
+
+    size_t bytes_written = twr_fifo_write(_twr_uart[channel].write_fifo, buffer, length);
+
+    if (bytes_written != 0 && !_twr_uart[channel].async_write_in_progress)
+    {
+        // Transmission is done from task, so the event comes asynchronously as it does on target
+        _twr_uart[channel].async_write_task_id = twr_scheduler_register(_twr_uart_async_write_task, (void *) (intptr_t) channel, 0);
+
+        _twr_uart[channel].async_write_in_progress = true;
+    }
+
+    return bytes_written;
+}
+
+bool twr_uart_async_writev(twr_uart_channel_t channel, const twr_uart_segment_t *segment, size_t count, void (*done_handler)(twr_uart_channel_t, void *), void *done_param)
+{
+    twr_uart_t *uart = &_twr_uart[channel];
+
+    if (!uart->initialized || uart->async_write_in_progress || count > TWR_UART_WRITEV_SEGMENTS)
+    {
+        return false;
+    }
+
+    memcpy(uart->writev_segment, segment, count * sizeof(twr_uart_segment_t));
+
+    uart->writev_count = count;
+    uart->writev_index = 0;
+    uart->writev_done_handler = done_handler;
+    uart->writev_done_param = done_param;
+
+    uart->async_write_task_id = twr_scheduler_register(_twr_uart_async_write_task, (void *) (intptr_t) channel, 0);
+
+    uart->async_write_in_progress = true;
+
+    return true;
+}
+
+void twr_uart_flush(twr_uart_channel_t channel)
+{
+    if (!_twr_uart[channel].initialized || !_twr_uart[channel].async_write_in_progress)
+    {
+        return;
+    }
+
+    _twr_uart_async_write_pending(channel);
+}
+
+bool twr_uart_async_read_start(twr_uart_channel_t channel, twr_tick_t timeout)
+{
+    if (!_twr_uart[channel].initialized || _twr_uart[channel].read_fifo == NULL || _twr_uart[channel].async_read_in_progress)
+    {
+        return false;
+    }
+
+    if (!twr_host_register_fd(_twr_uart[channel].fd_read, _twr_uart_fd_handler, (void *) (intptr_t) channel))
+    {
+        return false;
+    }
+
+    _twr_uart[channel].async_timeout = timeout;
+
+    _twr_uart[channel].async_read_task_id = twr_scheduler_register(_twr_uart_async_read_task, (void *) (intptr_t) channel, _twr_uart[channel].async_timeout);
+
+    _twr_uart[channel].async_read_in_progress = true;
+
+    return true;
+}
+
+bool twr_uart_async_read_cancel(twr_uart_channel_t channel)
+{
+    if (!_twr_uart[channel].initialized || !_twr_uart[channel].async_read_in_progress)
+    {
+        return false;
+    }
+
+    _twr_uart[channel].async_read_in_progress = false;
+
+    twr_host_unregister_fd(_twr_uart[channel].fd_read);
+
+    twr_scheduler_unregister(_twr_uart[channel].async_read_task_id);
+
+    return false;
+}
+
+size_t twr_uart_async_read(twr_uart_channel_t channel, void *buffer, size_t length)
+{
+    if (!_twr_uart[channel].initialized || !_twr_uart[channel].async_read_in_progress)
+    {
+        return 0;
+    }
+
+    return twr_fifo_read(_twr_uart[channel].read_fifo, buffer, length);
+}
+
+static bool _twr_uart_open(twr_uart_channel_t channel)
+{
+    char name[8];
+
+    snprintf(name, sizeof(name), "UART%d", (int) channel);
+
+    if (strcmp(twr_host_get_env(name, "pty"), "stdio") == 0)
+    {
+        _twr_uart[channel].fd_read = STDIN_FILENO;
+        _twr_uart[channel].fd_write = STDOUT_FILENO;
+
+        return true;
+    }
+
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0)
+    {
+        perror("twr_uart: posix_openpt");
+
+        return false;
+    }
+
+    // Slave side is kept open, otherwise master would report hang-up until a terminal program attaches
+    _twr_uart[channel].fd_slave = open(ptsname(fd), O_RDWR | O_NOCTTY);
+
+    struct termios tio;
+
+    if (_twr_uart[channel].fd_slave >= 0 && tcgetattr(_twr_uart[channel].fd_slave, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+
+        tcsetattr(_twr_uart[channel].fd_slave, TCSANOW, &tio);
+    }
+
+    // Output is dropped rather than blocking when nobody reads the terminal, as it would be on a real line
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    _twr_uart[channel].fd_read = fd;
+    _twr_uart[channel].fd_write = fd;
+
+    fprintf(stderr, "twr_uart: %s is %s\n", name, ptsname(fd));
+
+    return true;
+}
+
+static void _twr_uart_write_all(twr_uart_channel_t channel, const void *buffer, size_t length)
+{
+    const uint8_t *p = buffer;
+
+    while (length != 0)
+    {
+        ssize_t ret = write(_twr_uart[channel].fd_write, p, length);
+
+        if (ret <= 0)
+        {
+            return;
+        }
+
+        p += ret;
+        length -= ret;
+    }
+}
+
+static void _twr_uart_async_write_pending(twr_uart_channel_t channel)
+{
+    twr_uart_t *uart = &_twr_uart[channel];
+
+    uint8_t buffer[64];
+    size_t length;
+
+    for (; uart->writev_index < uart->writev_count; uart->writev_index++)
+    {
+        _twr_uart_write_all(channel, uart->writev_segment[uart->writev_index].buffer, uart->writev_segment[uart->writev_index].length);
+    }
+
+    while (uart->write_fifo != NULL && (length = twr_fifo_read(uart->write_fifo, buffer, sizeof(buffer))) != 0)
+    {
+        _twr_uart_write_all(channel, buffer, length);
+    }
+}
+
+static void _twr_uart_async_write_finish(twr_uart_channel_t channel)
+{
+    // Write in progress is completed and reported, done handler may start another one
+    while (_twr_uart[channel].initialized && _twr_uart[channel].async_write_in_progress)
+    {
+        _twr_uart_async_write_task((void *) (intptr_t) channel);
+    }
+}
+
+static void _twr_uart_async_write_task(void *param)
+{
+    twr_uart_channel_t channel = (twr_uart_channel_t) (intptr_t) param;
+    twr_uart_t *uart = &_twr_uart[channel];
+
+    _twr_uart_async_write_pending(channel);
+
+    uart->async_write_in_progress = false;
+
+    twr_scheduler_unregister(uart->async_write_task_id);
+
+    if (uart->writev_count != 0)
+    {
+        uart->writev_count = 0;
+
+        if (uart->writev_done_handler != NULL)
+        {
+            uart->writev_done_handler(channel, uart->writev_done_param);
+        }
+    }
+
+    if (uart->event_handler != NULL)
+    {
+        uart->event_handler(channel, TWR_UART_EVENT_ASYNC_WRITE_DONE, uart->event_param);
+    }
+}
+
+static void _twr_uart_async_read_task(void *param)
+{
+    twr_uart_channel_t channel = (twr_uart_channel_t) (intptr_t) param;
+    twr_uart_t *uart = &_twr_uart[channel];
+
+    twr_scheduler_plan_current_relative(uart->async_timeout);
+
+    if (uart->event_handler != NULL)
+    {
+        if (twr_fifo_is_empty(uart->read_fifo))
+        {
+            uart->event_handler(channel, TWR_UART_EVENT_ASYNC_READ_TIMEOUT, uart->event_param);
+        }
+        else
+        {
+            uart->event_handler(channel, TWR_UART_EVENT_ASYNC_READ_DATA, uart->event_param);
+        }
+    }
+}
+
+static void _twr_uart_fd_handler(int fd, void *param)
+{
+    twr_uart_channel_t channel = (twr_uart_channel_t) (intptr_t) param;
+
+    uint8_t buffer[64];
+
+    ssize_t ret = read(fd, buffer, sizeof(buffer));
+
+    if (ret <= 0)
+    {
+        // End of input, stop watching descriptor so that idle loop does not spin on it
+        twr_host_unregister_fd(fd);
+
+        return;
+    }
+
+    twr_fifo_write(_twr_uart[channel].read_fifo, buffer, ret);
+
+    twr_scheduler_plan_now(_twr_uart[channel].async_read_task_id);
+}
@@ -3,6 +3,8 @@
 
 // Miscellaneous
 
+#include <twr_defer.h>
+#include <twr_event_flags.h>
 #include <twr_info.h>
 #include <twr_ir_rx.h>
 #include <twr_irq.h>
@@ -14,7 +16,9 @@
 
 // Peripheral drivers
 
+#ifndef TWR_HOST
 #include <twr_adc.h>
+#endif
 #include <twr_button.h>
 #include <twr_dac.h>
 #include <twr_eeprom.h>
@@ -70,7 +74,9 @@
 
 // Other
 
+#ifndef TWR_HOST
 #include <twr_analog_sensor.h>
+#endif
 #include <twr_atci.h>
 #include <twr_base64.h>
 #include <twr_chester_a.h>
@@ -95,9 +101,17 @@
 #include <twr_soil_sensor.h>
 #include <twr_switch.h>
 #include <twr_system.h>
+#ifndef TWR_HOST
 #include <twr_timer.h>
+#endif
 #include <twr_usb_cdc.h>
 
+// Host port (TARGET=host)
+
+#ifdef TWR_HOST
+#include <twr_host.h>
+#endif
+
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 
 //! @mainpage Overview
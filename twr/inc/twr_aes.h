@@ -10,6 +10,14 @@
 #define TWR_AES_KEYLEN 128
 #define TWR_AES_IVLEN 128
 
+//! @brief Size of CCM nonce, counter field takes the remaining 2 bytes of block
+
+#define TWR_AES_CCM_NONCE_SIZE 13
+
+//! @brief Maximum length of CCM payload and additional data together
+
+#define TWR_AES_CCM_MAX_LENGTH 64
+
 //! @brief AES 128-bit Key
 
 typedef uint32_t twr_aes_key_t[TWR_AES_KEYLEN/8/4];
@@ -59,7 +67,7 @@ bool twr_aes_ecb_decrypt(void *buffer_out, const void *buffer_in, size_t length,
 //! @return true On success
 //! @return false On failure
 
-bool twr_aes_ctwr_encrypt(void *buffer_out, const void *buffer_in, size_t length, twr_aes_key_t key, twr_aes_iv_t iv);
+bool twr_aes_ctwr_encrypt(void *buffer_out, const void *buffer_in, size_t length, const twr_aes_key_t key, const twr_aes_iv_t iv);
 
 //! @brief AES Cipher block chaining (CBC)
 //! @param[out] buffer_out Pointer to destination buffer
@@ -70,7 +78,48 @@ bool twr_aes_ctwr_encrypt(void *buffer_out, const void *buffer_in, size_t length
 //! @return true On success
 //! @return false On failure
 
-bool twr_aes_ctwr_decrypt(void *buffer_out, const void *buffer_in, size_t length, twr_aes_key_t key, twr_aes_iv_t iv);
+bool twr_aes_ctwr_decrypt(void *buffer_out, const void *buffer_in, size_t length, const twr_aes_key_t key, const twr_aes_iv_t iv);
+
+//! @brief AES Counter mode (CTR), decryption is the same operation
+//! @param[out] buffer_out Pointer to destination buffer
+//! @param[in] buffer_in Pointer to source buffer
+//! @param[in] length Number of bytes
+//! @param[in] key 128-bit encryption key
+//! @param[in] iv 128-bit Initial counter block, its last 32 bits are incremented for every block
+//! @return true On success
+//! @return false On failure
+
+bool twr_aes_ctr_encrypt(void *buffer_out, const void *buffer_in, size_t length, const twr_aes_key_t key, const twr_aes_iv_t iv);
+
+//! @brief AES authenticated encryption in Counter with CBC-MAC mode (CCM, RFC 3610)
+//! @param[out] buffer_out Pointer to destination buffer (can be the same as source buffer)
+//! @param[out] tag Pointer to destination of authentication tag
+//! @param[in] buffer_in Pointer to source buffer
+//! @param[in] length Number of bytes
+//! @param[in] aad Pointer to additional data, which is authenticated but not encrypted (can be NULL)
+//! @param[in] aad_length Number of bytes of additional data, together with length at most TWR_AES_CCM_MAX_LENGTH
+//! @param[in] key 128-bit encryption key
+//! @param[in] nonce Pointer to TWR_AES_CCM_NONCE_SIZE bytes, nonce must never repeat with the same key
+//! @param[in] tag_length Length of authentication tag (4, 6, 8, 10, 12, 14 or 16)
+//! @return true On success
+//! @return false On failure
+
+bool twr_aes_ccm_encrypt(void *buffer_out, void *tag, const void *buffer_in, size_t length, const void *aad, size_t aad_length, const twr_aes_key_t key, const uint8_t *nonce, size_t tag_length);
+
+//! @brief AES authenticated decryption in Counter with CBC-MAC mode (CCM, RFC 3610)
+//! @param[out] buffer_out Pointer to destination buffer (can be the same as source buffer), it is cleared on failure
+//! @param[in] buffer_in Pointer to source buffer
+//! @param[in] length Number of bytes
+//! @param[in] aad Pointer to additional data (can be NULL)
+//! @param[in] aad_length Number of bytes of additional data, together with length at most TWR_AES_CCM_MAX_LENGTH
+//! @param[in] key 128-bit encryption key
+//! @param[in] nonce Pointer to TWR_AES_CCM_NONCE_SIZE bytes
+//! @param[in] tag Pointer to authentication tag
+//! @param[in] tag_length Length of authentication tag (4, 6, 8, 10, 12, 14 or 16)
+//! @return true On success
+//! @return false On failure or if authentication tag does not match
+
+bool twr_aes_ccm_decrypt(void *buffer_out, const void *buffer_in, size_t length, const void *aad, size_t aad_length, const twr_aes_key_t key, const uint8_t *nonce, const void *tag, size_t tag_length);
 
 //! @brief Create key from uint8 array
 //! @param[out] key key 128-bit encryption key
@@ -2,6 +2,7 @@
 #define _TWR_ATCI_H
 
 #include <twr_uart.h>
+#include <twr_scheduler.h>
 
 //! @addtogroup twr_atci twr_atci
 //! @brief AT command interface
@@ -16,6 +17,12 @@
 #define TWR_ATCI_COMMAND_CLAC {"+CLAC", twr_atci_clac_action, NULL, NULL, NULL, "List all available AT commands"}
 #define TWR_ATCI_COMMAND_HELP {"$HELP", twr_atci_help_action, NULL, NULL, NULL, "This help"}
 
+#define TWR_ATCI_COMMAND_SLEEP {"$SLEEP", twr_atci_sleep_action, twr_atci_sleep_set, NULL, NULL, "Low power mode statistics, AT$SLEEP=0 clears them"}
+
+#if TWR_SCHEDULER_STATS
+#define TWR_ATCI_COMMAND_SCHED {"$SCHED", twr_atci_sched_action, twr_atci_sched_set, NULL, NULL, "Scheduler task statistics, AT$SCHED=0 clears them"}
+#endif
+
 typedef struct
 {
     char *txt;
@@ -96,6 +103,28 @@ bool twr_atci_clac_action(void);
 
 bool twr_atci_help_action(void);
 
+//! @brief Helper for low power mode statistics action, prints: sleep count, sleep time [ms], stop count, stop time [ms], run time [ms]
+
+bool twr_atci_sleep_action(void);
+
+//! @brief Helper for low power mode statistics set, clears statistics
+//! @param[in] param ATCI instance
+
+bool twr_atci_sleep_set(twr_atci_param_t *param);
+
+#if TWR_SCHEDULER_STATS
+
+//! @brief Helper for scheduler statistics action, prints one line per task: id, function address, run count, total time [ms], max time [us], max lateness [ms]
+
+bool twr_atci_sched_action(void);
+
+//! @brief Helper for scheduler statistics set, clears statistics
+//! @param[in] param ATCI instance
+
+bool twr_atci_sched_set(twr_atci_param_t *param);
+
+#endif
+
 //! @brief Parse string to uint and move parsing cursor forward
 //! @param[in] param ATCI instance
 //! @param[in] value pointer to number
@@ -0,0 +1,90 @@
+#ifndef _TWR_COROUTINE_H
+#define _TWR_COROUTINE_H
+
+#include <twr_scheduler.h>
+
+//! @addtogroup twr_coroutine twr_coroutine
+//! @brief Stackless coroutines (protothreads) for scheduler tasks
+//! @details Coroutine body is placed in scheduler task function between TWR_COROUTINE_BEGIN and TWR_COROUTINE_END.
+//! Awaiting returns from the task function and execution continues at the same place when the task is dispatched again.
+//! Local variables are not preserved across awaits, keep the state in the instance structure.
+//! At most one await may be placed on a single source line.
+//! @{
+
+//! @brief Coroutine state
+
+typedef struct
+{
+    //! @cond
+
+    uint16_t _resume;
+    twr_tick_t _tick;
+
+    //! @endcond
+
+} twr_coroutine_t;
+
+//! @cond
+
+#define _TWR_COROUTINE_YIELD(coroutine) (coroutine)->_resume = __LINE__; return; case __LINE__:
+
+//! @endcond
+
+//! @brief Initialize coroutine so that next dispatch starts at TWR_COROUTINE_BEGIN
+//! @param[in] coroutine Coroutine state
+
+#define TWR_COROUTINE_INIT(coroutine) do { (coroutine)->_resume = 0; } while (0)
+
+//! @brief Start coroutine body (resume from the last await)
+//! @param[in] coroutine Coroutine state
+
+#define TWR_COROUTINE_BEGIN(coroutine) switch ((coroutine)->_resume) { default: case 0:
+
+//! @brief Mark start of error handler which is entered by TWR_COROUTINE_THROW or failed TWR_COROUTINE_TRY_I2C
+//! @param[in] coroutine Coroutine state
+
+#define TWR_COROUTINE_CATCH(coroutine) (coroutine)->_resume = 0; return; _twr_coroutine_catch:
+
+//! @brief Jump to error handler
+//! @param[in] coroutine Coroutine state
+
+#define TWR_COROUTINE_THROW(coroutine) do { (void) (coroutine); goto _twr_coroutine_catch; } while (0)
+
+//! @brief End coroutine body, next dispatch starts at TWR_COROUTINE_BEGIN
+//! @param[in] coroutine Coroutine state
+
+#define TWR_COROUTINE_END(coroutine) } (coroutine)->_resume = 0
+
+//! @brief Suspend coroutine until task is dispatched again (task is planned for immediate execution)
+//! @param[in] coroutine Coroutine state
+
+#define TWR_COROUTINE_YIELD(coroutine) do { twr_scheduler_plan_current_now(); _TWR_COROUTINE_YIELD(coroutine); } while (0)
+
+//! @brief Suspend coroutine until absolute tick, earlier dispatch of the task is ignored
+//! @param[in] coroutine Coroutine state
+//! @param[in] tick Tick at which the coroutine continues
+
+#define TWR_AWAIT_TICK(coroutine, tick) do { (coroutine)->_tick = (tick); while (twr_tick_get() < (coroutine)->_tick) { twr_scheduler_plan_current_absolute((coroutine)->_tick); _TWR_COROUTINE_YIELD(coroutine); } } while (0)
+
+//! @brief Suspend coroutine for specified number of ticks, earlier dispatch of the task is ignored
+//! @param[in] coroutine Coroutine state
+//! @param[in] ms Number of ticks to wait
+
+#define TWR_AWAIT_MS(coroutine, ms) TWR_AWAIT_TICK(coroutine, twr_tick_get() + (ms))
+
+//! @brief Suspend coroutine until condition holds, producer of the event plans the task (e.g. twr_scheduler_plan_now)
+//! @param[in] coroutine Coroutine state
+//! @param[in] condition Expression evaluated on every dispatch of the task
+
+#define TWR_AWAIT_EVENT(coroutine, condition) do { while (!(condition)) { _TWR_COROUTINE_YIELD(coroutine); } } while (0)
+
+//! @brief Perform I2C transfer and jump to error handler if it fails
+//! @details Transfers of twr_i2c are synchronous, the task is blocked until transfer is done and coroutine does not yield
+//! @param[in] coroutine Coroutine state
+//! @param[in] transfer Expression of any twr_i2c transfer function
+
+#define TWR_COROUTINE_TRY_I2C(coroutine, transfer) do { if (!(transfer)) { TWR_COROUTINE_THROW(coroutine); } } while (0)
+
+//! @}
+
+#endif // _TWR_COROUTINE_H
@@ -0,0 +1,69 @@
+#ifndef _TWR_DEFER_H
+#define _TWR_DEFER_H
+
+#include <twr_common.h>
+
+//! @addtogroup twr_defer twr_defer
+//! @brief Deferred processing of interrupt events (bottom halves)
+//! @details Interrupt handler pushes small event records to lock-free ring of its source, the push itself takes no lock,
+//! but it plans the task, which masks interrupts for a while with heap scheduler backend.
+//! A single scheduler task of high priority then passes all pending records of all sources to their handlers in batch.
+//! Every source must have exactly one producer (one interrupt handler) and records are consumed only by the scheduler task.
+//! @{
+
+//! @brief Deferred event source instance
+
+typedef struct twr_defer_t twr_defer_t;
+
+//! @cond
+
+struct twr_defer_t
+{
+    uint8_t *_buffer;
+    size_t _item_size;
+    size_t _item_count;
+    volatile size_t _head;
+    volatile size_t _tail;
+    volatile uint32_t _overflow_count;
+    bool _processing;
+    void (*_handler)(const void *, void *);
+    void *_param;
+    twr_defer_t *_next;
+};
+
+//! @endcond
+
+//! @brief Initialize deferred event source
+//! @param[in] self Instance
+//! @param[in] buffer Buffer for event records (item_size * item_count bytes)
+//! @param[in] item_size Size of one event record
+//! @param[in] item_count Number of event records in buffer (ring holds one record less)
+//! @param[in] handler Function called for every event record from scheduler task
+//! @param[in] param Optional parameter which is passed to handler (can be NULL)
+
+void twr_defer_init(twr_defer_t *self, void *buffer, size_t item_size, size_t item_count, void (*handler)(const void *item, void *param), void *param);
+
+//! @brief Push event record from interrupt handler
+//! @param[in] self Instance
+//! @param[in] item Pointer to event record (item_size bytes)
+//! @return true On success
+//! @return false When ring is full (overflow is counted)
+
+bool twr_defer_irq_push(twr_defer_t *self, const void *item);
+
+//! @brief Pass pending event records of source to its handler right away
+//! @details Must not be called from interrupt, records are otherwise consumed by scheduler task.
+//! Call from handler of the same source returns right away.
+//! @param[in] self Instance
+
+void twr_defer_process(twr_defer_t *self);
+
+//! @brief Get number of event records lost due to full ring
+//! @param[in] self Instance
+//! @return Number of lost event records
+
+uint32_t twr_defer_get_overflow_count(twr_defer_t *self);
+
+//! @}
+
+#endif // _TWR_DEFER_H
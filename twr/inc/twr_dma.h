@@ -210,6 +210,24 @@ void twr_dma_channel_config(twr_dma_channel_t channel, twr_dma_channel_config_t
 
 void twr_dma_set_event_handler(twr_dma_channel_t channel, void (*event_handler)(twr_dma_channel_t, twr_dma_event_t, void *), void *event_param);
 
+//! @brief Borrow DMA channel which is not used by any other driver
+//! @details Driver which sets event handler of the channel later takes it over, release handler is called first to complete
+//! transfer in progress and stop the channel, events of borrower which are still pending are dropped. Driver which owns the channel
+//! has to set its event handler before it configures the channel.
+//! @param[in] channel DMA channel
+//! @param[in] event_handler Function address
+//! @param[in] release_handler Function called when channel is taken over
+//! @param[in] event_param Optional event parameter (can be NULL)
+//! @return true If channel has been borrowed
+//! @return false If channel is used by another driver
+
+bool twr_dma_channel_borrow(twr_dma_channel_t channel, void (*event_handler)(twr_dma_channel_t, twr_dma_event_t, void *), void (*release_handler)(twr_dma_channel_t, void *), void *event_param);
+
+//! @brief Return borrowed DMA channel
+//! @param[in] channel DMA channel
+
+void twr_dma_channel_return(twr_dma_channel_t channel);
+
 //! @brief Start DMA channel
 //! @param[in] channel DMA channel
 
@@ -0,0 +1,66 @@
+#ifndef _TWR_EVENT_FLAGS_H
+#define _TWR_EVENT_FLAGS_H
+
+#include <twr_scheduler.h>
+
+//! @addtogroup twr_event_flags twr_event_flags
+//! @brief Event flags which scheduler task can wait for
+//! @details Producers (typically interrupt handlers) set flags and the waiting task is planned only when one of the flags it waits for is set.
+//! Only one task can wait on the instance at a time. Task can be run also by timeout or by any other plan call, so it has to check the flags when run.
+//! @{
+
+//! @brief Event flags instance
+
+typedef struct twr_event_flags_t twr_event_flags_t;
+
+//! @cond
+
+struct twr_event_flags_t
+{
+    volatile uint32_t _flags;
+    uint32_t _wait_mask;
+    twr_scheduler_task_id_t _task_id;
+};
+
+//! @endcond
+
+//! @brief Initialize event flags (all flags cleared, no task waiting)
+//! @param[in] self Instance
+
+void twr_event_flags_init(twr_event_flags_t *self);
+
+//! @brief Set flags and plan waiting task if it waits for any of them (can be called from interrupt)
+//! @param[in] self Instance
+//! @param[in] flags Flags to be set
+
+void twr_event_flags_set(twr_event_flags_t *self, uint32_t flags);
+
+//! @brief Clear flags
+//! @param[in] self Instance
+//! @param[in] flags Flags to be cleared
+
+void twr_event_flags_clear(twr_event_flags_t *self, uint32_t flags);
+
+//! @brief Get flags
+//! @param[in] self Instance
+//! @return Current flags
+
+uint32_t twr_event_flags_get(twr_event_flags_t *self);
+
+//! @brief Get and clear flags atomically
+//! @param[in] self Instance
+//! @param[in] mask Flags to be taken
+//! @return Flags from mask which were set
+
+uint32_t twr_event_flags_take(twr_event_flags_t *self, uint32_t mask);
+
+//! @brief Plan current task to be run when any of flags from mask is set (flags are not cleared)
+//! @param[in] self Instance
+//! @param[in] mask Flags to wait for
+//! @param[in] timeout Maximum waiting time in ticks (TWR_TICK_INFINITY for no timeout)
+
+void twr_event_flags_wait(twr_event_flags_t *self, uint32_t mask, twr_tick_t timeout);
+
+//! @}
+
+#endif // _TWR_EVENT_FLAGS_H
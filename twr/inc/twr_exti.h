@@ -213,6 +213,16 @@ typedef enum
 
 void twr_exti_register(twr_exti_line_t line, twr_exti_edge_t edge, void (*callback)(twr_exti_line_t, void *), void *param);
 
+//! @brief Enable EXTI line interrupt and register callback function called from scheduler task
+//! @details Callback is run by twr_defer task of high priority instead of interrupt handler, edges which come before it runs are
+//! reported once. Use twr_exti_register for drivers which need exact timing of every edge.
+//! @param[in] line EXTI line
+//! @param[in] edge Desired interrupt edge sensitivity
+//! @param[in] callback Function address (called after interrupt occurs)
+//! @param[in] param Optional parameter being passed to callback function (can be NULL)
+
+void twr_exti_register_deferred(twr_exti_line_t line, twr_exti_edge_t edge, void (*callback)(twr_exti_line_t, void *), void *param);
+
 //! @brief Disable EXTI line interrupt
 //! @param[in] line EXTI line
 
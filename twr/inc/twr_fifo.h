@@ -5,6 +5,8 @@
 
 //! @addtogroup twr_fifo twr_fifo
 //! @brief FIFO buffer implementation
+//! @details FIFO is lock-free for one writer and one reader, each of them may run in interrupt or in task,
+//! so none of the functions masks interrupts. One byte of buffer is always left free.
 //! @{
 
 //! @brief Structure of FIFO instance
@@ -17,11 +19,11 @@ typedef struct
     //! @brief Size of buffer where FIFO holds data
     size_t size;
 
-    //! @brief Position of FIFO's head
-    size_t head;
+    //! @brief Position of FIFO's head, it is moved by writer only
+    volatile size_t head;
 
-    //! @brief Position of FIFO's tail
-    size_t tail;
+    //! @brief Position of FIFO's tail, it is moved by reader only
+    volatile size_t tail;
 
 } twr_fifo_t;
 
@@ -32,7 +34,7 @@ typedef struct
 
 void twr_fifo_init(twr_fifo_t *fifo, void *buffer, size_t size);
 
-//! @brief Purge FIFO buffer
+//! @brief Purge FIFO buffer, neither writer nor reader may run meanwhile
 //! @param[in] fifo FIFO instance
 
 void twr_fifo_purge(twr_fifo_t *fifo);
@@ -53,7 +55,7 @@ size_t twr_fifo_write(twr_fifo_t *fifo, const void *buffer, size_t length);
 
 size_t twr_fifo_read(twr_fifo_t *fifo, void *buffer, size_t length);
 
-//! @brief Write data to FIFO from interrupt
+//! @brief Write data to FIFO from interrupt, it is the same as twr_fifo_write
 //! @param[in] fifo FIFO instance
 //! @param[in] buffer Pointer to buffer from which data will be written
 //! @param[in] length Number of requested bytes to be written
@@ -61,7 +63,7 @@ size_t twr_fifo_read(twr_fifo_t *fifo, void *buffer, size_t length);
 
 size_t twr_fifo_irq_write(twr_fifo_t *fifo, const void *buffer, size_t length);
 
-//! @brief Read data from FIFO from interrupt
+//! @brief Read data from FIFO from interrupt, it is the same as twr_fifo_read
 //! @param[in] fifo FIFO instance
 //! @param[out] buffer Pointer to buffer where data will be read
 //! @param[in] length Number of requested bytes to be read
@@ -76,6 +78,38 @@ size_t twr_fifo_irq_read(twr_fifo_t *fifo, void *buffer, size_t length);
 
 bool twr_fifo_is_empty(twr_fifo_t *fifo);
 
+//! @brief Get free space, data of this length are written by one call without being cut
+//! @param[in] fifo FIFO instance
+//! @return Number of bytes which can be written
+
+size_t twr_fifo_get_free(twr_fifo_t *fifo);
+
+//! @brief Get contiguous free space, writer fills it in place (e.g. by DMA) and then commits it
+//! @param[in] fifo FIFO instance
+//! @param[out] buffer Pointer to start of free space
+//! @return Number of bytes which can be written from start of free space on, 0 if FIFO is full
+
+size_t twr_fifo_get_write_span(twr_fifo_t *fifo, void **buffer);
+
+//! @brief Commit data written in place to free space got by twr_fifo_get_write_span
+//! @param[in] fifo FIFO instance
+//! @param[in] length Number of bytes written, at most length of span
+
+void twr_fifo_commit_write(twr_fifo_t *fifo, size_t length);
+
+//! @brief Get contiguous data, reader consumes it in place (e.g. by DMA) and then commits it
+//! @param[in] fifo FIFO instance
+//! @param[out] buffer Pointer to start of data
+//! @return Number of bytes which can be read from start of data on, 0 if FIFO is empty
+
+size_t twr_fifo_get_read_span(twr_fifo_t *fifo, void **buffer);
+
+//! @brief Commit data consumed in place from data got by twr_fifo_get_read_span
+//! @param[in] fifo FIFO instance
+//! @param[in] length Number of bytes consumed, at most length of span
+
+void twr_fifo_commit_read(twr_fifo_t *fifo, size_t length);
+
 //! @}
 
 #endif // _TWR_FIFO_H
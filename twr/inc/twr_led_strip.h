@@ -26,6 +26,9 @@ typedef struct
     bool (*write)(void);
     bool (*is_ready)(void);
 
+    // Optional, plans current task to be run once driver is ready (task is planned immediately if NULL)
+    void (*wait_ready)(void);
+
 } twr_led_strip_driver_t;
 
 typedef enum
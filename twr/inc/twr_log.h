@@ -16,6 +16,14 @@
 #define TWR_LOG_BUFFER_SIZE 256
 #endif
 
+#ifndef TWR_LOG_FIFO_SIZE
+#define TWR_LOG_FIFO_SIZE 512
+#endif
+
+#ifndef TWR_LOG_TOKEN
+#define TWR_LOG_TOKEN 0
+#endif
+
 #define TWR_LOG_DUMP_WIDTH 8
 
 //! @brief Log level
@@ -65,6 +73,83 @@ typedef enum
 
 void twr_log_init(twr_log_level_t level, twr_log_timestamp_t timestamp);
 
+//! @brief Write out messages waiting in queue (blocking call)
+//! @details Messages are queued and transmitted from low priority task, so this is needed where scheduler does
+//!          not run anymore (e.g. in application_error)
+
+void twr_log_flush(void);
+
+#if TWR_LOG_TOKEN
+
+// Tokenized log: format string of every call is placed along with types of its arguments to section which is
+// not loaded to FLASH, frames carry offset of the entry as token and raw arguments, tools/log-decoder makes text
+// of them again with dictionary dumped from ELF. Format has to be string literal with at most 8 arguments.
+
+//! @cond
+
+#define twr_log_dump(buffer, length, ...) _TWR_LOG_TOKEN(TWR_LOG_LEVEL_DUMP, buffer, length, __VA_ARGS__)
+#define twr_log_debug(...) _TWR_LOG_TOKEN(TWR_LOG_LEVEL_DEBUG, NULL, 0, __VA_ARGS__)
+#define twr_log_info(...) _TWR_LOG_TOKEN(TWR_LOG_LEVEL_INFO, NULL, 0, __VA_ARGS__)
+#define twr_log_warning(...) _TWR_LOG_TOKEN(TWR_LOG_LEVEL_WARNING, NULL, 0, __VA_ARGS__)
+#define twr_log_error(...) _TWR_LOG_TOKEN(TWR_LOG_LEVEL_ERROR, NULL, 0, __VA_ARGS__)
+
+#define _TWR_LOG_TOKEN(level, buffer, length, ...) \
+    do \
+    { \
+        static const struct { uint32_t types; char format[sizeof(_TWR_LOG_TOKEN_FORMAT(__VA_ARGS__, 0))]; } _twr_log_entry \
+            __attribute__((section("twr_log_fmt"), used)) = \
+            { _TWR_LOG_TOKEN_EXPAND(_TWR_LOG_TOKEN_TYPES_, __VA_ARGS__), _TWR_LOG_TOKEN_FORMAT(__VA_ARGS__, 0) }; \
+        (void) sizeof(_twr_log_token_check(__VA_ARGS__)); \
+        _twr_log_token(level, &_twr_log_entry, buffer, length, \
+                       _TWR_LOG_TOKEN_EXPAND(_TWR_LOG_TOKEN_TYPES_, __VA_ARGS__) _TWR_LOG_TOKEN_EXPAND(_TWR_LOG_TOKEN_ARGS_, __VA_ARGS__)); \
+    } while (0)
+
+#define _TWR_LOG_TOKEN_FORMAT(format, ...) format
+#define _TWR_LOG_TOKEN_COUNT(...) _TWR_LOG_TOKEN_NTH(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0, 0)
+#define _TWR_LOG_TOKEN_NTH(f, a1, a2, a3, a4, a5, a6, a7, a8, n, ...) n
+#define _TWR_LOG_TOKEN_EXPAND(prefix, ...) _TWR_LOG_TOKEN_PASTE(prefix, _TWR_LOG_TOKEN_COUNT(__VA_ARGS__))(__VA_ARGS__)
+#define _TWR_LOG_TOKEN_PASTE(a, b) _TWR_LOG_TOKEN_PASTE_(a, b)
+#define _TWR_LOG_TOKEN_PASTE_(a, b) a##b
+
+// Argument is sent as 32-bit integer (0), 64-bit integer (1), float (2) or string (3)
+#define _TWR_LOG_TOKEN_TYPE(a) _Generic((a), char *: 3, const char *: 3, float: 2, double: 2, default: (sizeof(a) > 4 ? 1 : 0))
+#define _TWR_LOG_TOKEN_T(i, a) ((uint32_t) _TWR_LOG_TOKEN_TYPE(a) << (4 + 2 * (i)))
+
+// Types are packed with number of arguments in the lowest 4 bits
+#define _TWR_LOG_TOKEN_TYPES_0(f) 0
+#define _TWR_LOG_TOKEN_TYPES_1(f, a1) (1 | _TWR_LOG_TOKEN_T(0, a1))
+#define _TWR_LOG_TOKEN_TYPES_2(f, a1, a2) (2 | _TWR_LOG_TOKEN_T(0, a1) | _TWR_LOG_TOKEN_T(1, a2))
+#define _TWR_LOG_TOKEN_TYPES_3(f, a1, a2, a3) (3 | _TWR_LOG_TOKEN_T(0, a1) | _TWR_LOG_TOKEN_T(1, a2) | _TWR_LOG_TOKEN_T(2, a3))
+#define _TWR_LOG_TOKEN_TYPES_4(f, a1, a2, a3, a4) (4 | _TWR_LOG_TOKEN_T(0, a1) | _TWR_LOG_TOKEN_T(1, a2) | _TWR_LOG_TOKEN_T(2, a3) | _TWR_LOG_TOKEN_T(3, a4))
+#define _TWR_LOG_TOKEN_TYPES_5(f, a1, a2, a3, a4, a5) (5 | _TWR_LOG_TOKEN_T(0, a1) | _TWR_LOG_TOKEN_T(1, a2) | _TWR_LOG_TOKEN_T(2, a3) | _TWR_LOG_TOKEN_T(3, a4) | \
+                                                      _TWR_LOG_TOKEN_T(4, a5))
+#define _TWR_LOG_TOKEN_TYPES_6(f, a1, a2, a3, a4, a5, a6) (6 | _TWR_LOG_TOKEN_T(0, a1) | _TWR_LOG_TOKEN_T(1, a2) | _TWR_LOG_TOKEN_T(2, a3) | _TWR_LOG_TOKEN_T(3, a4) | \
+                                                          _TWR_LOG_TOKEN_T(4, a5) | _TWR_LOG_TOKEN_T(5, a6))
+#define _TWR_LOG_TOKEN_TYPES_7(f, a1, a2, a3, a4, a5, a6, a7) (7 | _TWR_LOG_TOKEN_T(0, a1) | _TWR_LOG_TOKEN_T(1, a2) | _TWR_LOG_TOKEN_T(2, a3) | _TWR_LOG_TOKEN_T(3, a4) | \
+                                                              _TWR_LOG_TOKEN_T(4, a5) | _TWR_LOG_TOKEN_T(5, a6) | _TWR_LOG_TOKEN_T(6, a7))
+#define _TWR_LOG_TOKEN_TYPES_8(f, a1, a2, a3, a4, a5, a6, a7, a8) (8 | _TWR_LOG_TOKEN_T(0, a1) | _TWR_LOG_TOKEN_T(1, a2) | _TWR_LOG_TOKEN_T(2, a3) | _TWR_LOG_TOKEN_T(3, a4) | \
+                                                                  _TWR_LOG_TOKEN_T(4, a5) | _TWR_LOG_TOKEN_T(5, a6) | _TWR_LOG_TOKEN_T(6, a7) | _TWR_LOG_TOKEN_T(7, a8))
+
+// Format string itself is left out of call, so that it does not end up in FLASH
+#define _TWR_LOG_TOKEN_ARGS_0(f)
+#define _TWR_LOG_TOKEN_ARGS_1(f, a1) , a1
+#define _TWR_LOG_TOKEN_ARGS_2(f, a1, a2) , a1, a2
+#define _TWR_LOG_TOKEN_ARGS_3(f, a1, a2, a3) , a1, a2, a3
+#define _TWR_LOG_TOKEN_ARGS_4(f, a1, a2, a3, a4) , a1, a2, a3, a4
+#define _TWR_LOG_TOKEN_ARGS_5(f, a1, a2, a3, a4, a5) , a1, a2, a3, a4, a5
+#define _TWR_LOG_TOKEN_ARGS_6(f, a1, a2, a3, a4, a5, a6) , a1, a2, a3, a4, a5, a6
+#define _TWR_LOG_TOKEN_ARGS_7(f, a1, a2, a3, a4, a5, a6, a7) , a1, a2, a3, a4, a5, a6, a7
+#define _TWR_LOG_TOKEN_ARGS_8(f, a1, a2, a3, a4, a5, a6, a7, a8) , a1, a2, a3, a4, a5, a6, a7, a8
+
+void _twr_log_token(twr_log_level_t level, const void *entry, const void *buffer, size_t length, uint32_t types, ...);
+
+// Never called, it lets compiler check arguments against format
+int _twr_log_token_check(const char *format, ...) __attribute__ ((format (printf, 1, 2)));
+
+//! @endcond
+
+#else
+
 //! @brief Log DUMP message (annotated in log as <X>)
 //! @param[in] buffer Pointer to source buffer
 //! @param[in] length Number of bytes to be printed
@@ -97,9 +182,12 @@ void twr_log_warning(const char *format, ...) __attribute__ ((format (printf, 1,
 
 void twr_log_error(const char *format, ...) __attribute__ ((format (printf, 1, 2)));
 
+#endif
+
 #else
 
 #define twr_log_init(...)
+#define twr_log_flush(...)
 #define twr_log_dump(...)
 #define twr_log_debug(...)
 #define twr_log_info(...)
@@ -3,6 +3,7 @@
 
 #include <twr_i2c.h>
 #include <twr_scheduler.h>
+#include <twr_coroutine.h>
 
 //! @addtogroup twr_opt3001 twr_opt3001
 //! @brief Driver for OPT3001 ambient light sensor
@@ -24,7 +25,8 @@ typedef enum
 
 typedef struct twr_opt3001_t twr_opt3001_t;
 
-//! @cond
+//! @brief Former states of measurement
+//! @deprecated Measurement is driven by coroutine, the enumeration is no longer used by the driver
 
 typedef enum
 {
@@ -34,7 +36,9 @@ typedef enum
     TWR_OPT3001_STATE_READ = 2,
     TWR_OPT3001_STATE_UPDATE = 3
 
-} twr_opt3001_state_t;
+} twr_opt3001_state_t __attribute__((deprecated));
+
+//! @cond
 
 struct twr_opt3001_t
 {
@@ -46,7 +50,7 @@ struct twr_opt3001_t
     void *_event_param;
     bool _measurement_active;
     twr_tick_t _update_interval;
-    twr_opt3001_state_t _state;
+    twr_coroutine_t _coroutine;
     twr_tick_t _tick_ready;
     bool _illuminance_valid;
     uint16_t _reg_result;
@@ -13,6 +13,8 @@ typedef struct
 {
     void *_buffer;
     size_t _size;
+    size_t _head;
+    size_t _tail;
     size_t _length;
 
 } twr_queue_t;
@@ -44,6 +46,29 @@ bool twr_queue_put(twr_queue_t *queue, const void *buffer, size_t length);
 
 bool twr_queue_get(twr_queue_t *queue, void *buffer, size_t *length);
 
+//! @brief Get first item of queue to buffer without removing it
+//! @param[in] queue Instance
+//! @param[in] buffer Buffer to be copied from the queue (can be NULL to get only length of item)
+//! @param[out] length Length of item
+//! @return true On success
+//! @return false If queue is empty
+
+bool twr_queue_peek(twr_queue_t *queue, void *buffer, size_t *length);
+
+//! @brief Get first item of queue in place without copying it
+//! @param[in] queue Instance
+//! @param[out] item Pointer to item data inside of queue buffer, valid until twr_queue_consume is called
+//! @param[out] length Length of item
+//! @return true On success
+//! @return false If queue is empty
+
+bool twr_queue_peek_in_place(twr_queue_t *queue, void **item, size_t *length);
+
+//! @brief Remove first item of queue
+//! @param[in] queue Instance
+
+void twr_queue_consume(twr_queue_t *queue);
+
 //! @brief Clear queue
 //! @param[in] queue Instance
 
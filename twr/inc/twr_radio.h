@@ -5,26 +5,114 @@
 #include <twr_button.h>
 #include <twr_led.h>
 #include <twr_spirit1.h>
+#include <twr_aes.h>
 
 //! @addtogroup twr_radio twr_radio
 //! @brief Radio implementation
 //! @{
 
+// Gateway can hold hundreds of peers, each takes about 32 bytes of RAM (48 bytes with TWR_RADIO_LINK_STATS)
 #ifndef TWR_RADIO_MAX_DEVICES
 #define TWR_RADIO_MAX_DEVICES 4
 #endif
 
+// Number of 8 byte records in EEPROM journal of peer list, the more spare records the less wear
+#ifndef TWR_RADIO_PEER_JOURNAL_LENGTH
+#define TWR_RADIO_PEER_JOURNAL_LENGTH (TWR_RADIO_MAX_DEVICES * 3 / 2 + 16)
+#endif
+
 #ifndef TWR_RADIO_PUB_QUEUE_BUFFER_SIZE
 #define TWR_RADIO_PUB_QUEUE_BUFFER_SIZE 512
 #endif
 
+// Several queued publish messages are packed into one frame, gateway has to run firmware which decodes them
+#ifndef TWR_RADIO_PUB_BATCH
+#define TWR_RADIO_PUB_BATCH 0
+#endif
+
+// Time the first queued publish message may wait for more messages to share its frame
+#ifndef TWR_RADIO_PUB_BATCH_LATENCY_MS
+#define TWR_RADIO_PUB_BATCH_LATENCY_MS 0
+#endif
+
+// Number of subtopics node registers with gateway, twr_radio_pub_bool/int/uint32/float/string then send 1 byte id
+// of subtopic instead of its name and compact value, gateway has to run firmware with TWR_RADIO_PUB_TOPIC_GATEWAY_LENGTH
+#ifndef TWR_RADIO_PUB_TOPIC_LENGTH
+#define TWR_RADIO_PUB_TOPIC_LENGTH 0
+#endif
+
+// Number of subtopics gateway remembers for all its nodes together, each takes about 64 bytes of RAM
+#ifndef TWR_RADIO_PUB_TOPIC_GATEWAY_LENGTH
+#define TWR_RADIO_PUB_TOPIC_GATEWAY_LENGTH 0
+#endif
+
+// Peers keep RSSI window and counters of received frames, without them link statistics carry the last RSSI only
+#ifndef TWR_RADIO_LINK_STATS
+#define TWR_RADIO_LINK_STATS 0
+#endif
+
+// Number of frames received from peer over which its RSSI minimum, maximum and average are taken
+#ifndef TWR_RADIO_LINK_WINDOW
+#define TWR_RADIO_LINK_WINDOW 16
+#endif
+
+// Node publishes statistics of its link to gateway at most this often, along with other publish messages, 0 disables it
+#ifndef TWR_RADIO_LINK_PUB_INTERVAL_MS
+#define TWR_RADIO_LINK_PUB_INTERVAL_MS 0
+#endif
+
 #ifndef TWR_RADIO_RX_QUEUE_BUFFER_SIZE
 #define TWR_RADIO_RX_QUEUE_BUFFER_SIZE 128
 #endif
 
+// Frames are sent only if clear channel assessment finds channel free (listen before talk), ACKs are sent right away
+#ifndef TWR_RADIO_CCA
+#define TWR_RADIO_CCA 1
+#endif
+
+// Number of attempts to send frame
+#ifndef TWR_RADIO_TX_MAX_COUNT
+#define TWR_RADIO_TX_MAX_COUNT 6
+#endif
+
+// Number of times channel can be found busy before frame is given up
+#ifndef TWR_RADIO_CCA_MAX_COUNT
+#define TWR_RADIO_CCA_MAX_COUNT 8
+#endif
+
+// Random back-off after failed attempt or busy channel is drawn from window which doubles every time up to maximum
+#ifndef TWR_RADIO_BACKOFF_MIN_MS
+#define TWR_RADIO_BACKOFF_MIN_MS 100
+#endif
+
+#ifndef TWR_RADIO_BACKOFF_MAX_MS
+#define TWR_RADIO_BACKOFF_MAX_MS 800
+#endif
+
+// Frames are encrypted and authenticated by AES-CCM with session key of peer, which is derived at pairing
+// from network key set by twr_radio_set_key, acknowledgements are authenticated too and frames which go without
+// session (pairing, attach, detach and rekey) by network key; gateway and all its nodes have to run the same setting
+//
+// Replay protection stays partial for frames under network key:
+// - rekey acknowledgement depends on 16-bit message id only, recorded one works again once the id wraps around
+// - attach is not bound to anything, replayed one makes node pair again
+// - detach is taken only as response to the last frame node has sent, so node keeps pairing when it misses
+//   detach of gateway and sends two more frames first
+// - repeated pairing request is answered the same way and the current session stays until node sends frame sealed
+//   by the new one, gateway cannot send to such node until then
+#ifndef TWR_RADIO_SECURITY
+#define TWR_RADIO_SECURITY 0
+#endif
+
+#if TWR_RADIO_SECURITY
+#define TWR_RADIO_MIC_SIZE 4
+#else
+#define TWR_RADIO_MIC_SIZE 0
+#endif
+
 #define TWR_RADIO_ID_SIZE           6
 #define TWR_RADIO_HEAD_SIZE         (TWR_RADIO_ID_SIZE + 2)
-#define TWR_RADIO_MAX_BUFFER_SIZE   (TWR_SPIRIT1_MAX_PACKET_SIZE - TWR_RADIO_HEAD_SIZE)
+#define TWR_RADIO_MAX_BUFFER_SIZE   (TWR_SPIRIT1_MAX_PACKET_SIZE - TWR_RADIO_HEAD_SIZE - TWR_RADIO_MIC_SIZE)
 #define TWR_RADIO_MAX_TOPIC_LEN     (TWR_RADIO_MAX_BUFFER_SIZE - 1 - 4 - 1)
 #define TWR_RADIO_NULL_BOOL         0xff
 #define TWR_RADIO_NULL_INT          INT32_MIN
@@ -100,6 +188,11 @@ typedef enum
     TWR_RADIO_HEADER_PUB_VALUE_INT   = 0x1e,
 
     TWR_RADIO_HEADER_SUB_REG         = 0x20,
+    TWR_RADIO_HEADER_PUB_BATCH       = 0x21,
+    TWR_RADIO_HEADER_PUB_TOPIC_REG   = 0x22,
+    TWR_RADIO_HEADER_PUB_TOPIC_ID    = 0x23,
+    TWR_RADIO_HEADER_PUB_LINK        = 0x24,
+    TWR_RADIO_HEADER_WAKE_INTERVAL   = 0x25,
 
     TWR_RADIO_HEADER_ACK             = 0xaa,
 
@@ -127,13 +220,74 @@ struct twr_radio_sub_t {
     void *param;
 };
 
+//! @brief Decoder of received messages with header which is not used by SDK, such messages are sent by twr_radio_pub_queue_put
+
+typedef struct
+{
+    //! @brief Header, the first byte of message
+    uint8_t header;
+
+    //! @brief Length of data behind header, 0 for any length
+    size_t length;
+
+    //! @brief Callback with sender id and data behind header
+    void (*callback)(uint64_t *id, uint8_t *buffer, size_t length, void *param);
+
+    //! @brief Parameter of callback
+    void *param;
+
+} twr_radio_decoder_t;
+
 typedef struct
 {
     uint64_t id;
     uint16_t message_id;
     bool message_id_synced;
-    twr_radio_mode_t mode;
-    int rssi;
+    uint8_t mode;
+    int8_t rssi;
+
+    // Period in which node samples channel for wake-up burst (ms), 0 if node does not listen while sleeping
+    uint16_t wake_interval;
+
+    // Statistics of frames sent to peer: frames on air, retransmissions among them, attempts which found channel busy,
+    // messages acknowledged and messages given up; counters are cleared when peer is added and wrap around
+    uint16_t tx_count;
+    uint16_t tx_retry;
+    uint16_t tx_busy;
+    uint16_t tx_success;
+    uint16_t tx_error;
+
+#if TWR_RADIO_LINK_STATS
+    // Statistics of frames received from peer: RSSI minimum, maximum and average over the last window
+    // of TWR_RADIO_LINK_WINDOW frames (zero until the first frame), messages received, messages lost as told
+    // by gaps in message id (counted by gateway only) and retransmissions dropped as duplicates
+    int8_t rssi_min;
+    int8_t rssi_max;
+    int8_t rssi_avg;
+    uint16_t rx_count;
+    uint16_t rx_lost;
+    uint16_t rx_duplicate;
+
+    // Window in progress
+    int8_t rssi_window_min;
+    int8_t rssi_window_max;
+    int16_t rssi_window_sum;
+    uint8_t rssi_window_count;
+#endif
+
+#if TWR_RADIO_SECURITY
+    // Session key established at pairing, it is kept in RAM only, extended message id of the last frame received
+    // from peer, frames with lower one are replays, and number of frames gateway sent to peer in the session
+    twr_aes_key_t key;
+    uint32_t rx_counter;
+    uint32_t tx_counter;
+    bool key_valid;
+
+    // Session of pairing gateway has answered, it replaces the current one once peer sends frame sealed by it
+    twr_aes_key_t pending_key;
+    uint32_t pending_rx_counter;
+    bool pending_valid;
+#endif
 
 } twr_radio_peer_t;
 
@@ -182,12 +336,46 @@ void twr_radio_pub_queue_clear();
 
 void twr_radio_set_subs(twr_radio_sub_t *subs, int length);
 
+//! @brief Set decoders of application messages, header decoded by SDK is never passed to them
+//! @param[in] decoders Array of decoders, it is not copied
+//! @param[in] length Number of decoders
+
+void twr_radio_set_decoders(const twr_radio_decoder_t *decoders, int length);
+
 bool twr_radio_send_sub_data(uint64_t *id, uint8_t order, void *payload, size_t size);
 
 void twr_radio_set_rx_timeout_for_sleeping_node(twr_tick_t timeout);
 
+//! @brief Set wake-on-radio interval of sleeping node
+//! @param[in] interval Period of channel sampling in milliseconds (at most 65535), 0 to disable
+//! @details Radio of sleeping node wakes up every interval and listens for carrier for about 25 ms, it stays in RX
+//! only if channel is busy. Interval is announced to gateway, which repeats every message for this node
+//! as a wake-up burst spanning the whole interval, so that downlink is delivered within one interval.
+//! Gateway does not transmit anything else during the burst, long intervals are meant for nodes with rare downlink.
+
+void twr_radio_set_wake_interval(twr_tick_t interval);
+
+#if TWR_RADIO_SECURITY
+
+//! @brief Set network key from which session keys are derived at pairing, call it after twr_radio_init
+//! @param[in] key Key of 16 bytes, the same for gateway and all its nodes
+
+void twr_radio_set_key(const uint8_t *key);
+
+#endif
+
 twr_radio_peer_t *twr_radio_get_peer_device(uint64_t id);
 
+//! @brief Get number of messages refused by twr_radio_pub_queue_put because publish queue was full
+//! @return Number of messages since initialization, wraps around
+
+uint16_t twr_radio_get_pub_queue_overflow(void);
+
+//! @brief Get number of received messages dropped because receive queue was full
+//! @return Number of messages since initialization, wraps around
+
+uint16_t twr_radio_get_rx_queue_overflow(void);
+
 uint8_t *twr_radio_id_to_buffer(uint64_t *id, uint8_t *buffer);
 uint8_t *twr_radio_bool_to_buffer(bool *value, uint8_t *buffer);
 uint8_t *twr_radio_int_to_buffer(int *value, uint8_t *buffer);
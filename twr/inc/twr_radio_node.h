@@ -113,8 +113,10 @@ bool twr_radio_node_led_strip_thermometer_set(uint64_t *id, float temperature, i
 //! @param[in] id Pointer on own id
 //! @param[in] buffer Pointer to RX buffer
 //! @param[in] length RX buffer length
+//! @return true If header belongs to this module
+//! @return false If header is decoded elsewhere
 
-void twr_radio_node_decode(uint64_t *id, uint8_t *buffer, size_t length);
+bool twr_radio_node_decode(uint64_t *id, uint8_t *buffer, size_t length);
 
 //! @}
 
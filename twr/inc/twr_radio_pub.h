@@ -74,6 +74,27 @@ enum
     TWR_RADIO_PUB_VALUE_HOLD_DURATION_BUTTON = 0
 };
 
+//! @brief Statistics of node link to gateway, as published by twr_radio_pub_link
+
+typedef struct
+{
+    //! @brief RSSI of acknowledgements from gateway, minimum, maximum and average over the last window
+    int8_t rssi_min;
+    int8_t rssi_max;
+    int8_t rssi_avg;
+
+    //! @brief Frames on air, retransmissions, attempts which found channel busy, acknowledged and given up messages
+    uint16_t tx_count;
+    uint16_t tx_retry;
+    uint16_t tx_busy;
+    uint16_t tx_success;
+    uint16_t tx_error;
+
+    //! @brief Messages which did not fit into publish queue
+    uint16_t pub_queue_overflow;
+
+} twr_radio_pub_link_t;
+
 //! @brief Publish event count
 //! @param[in] event_id Event id is from enum TWR_RADIO_PUB_EVENT_*
 //! @param[in] event_count Pointer to value, can be null
@@ -208,12 +229,25 @@ bool twr_radio_pub_float(const char *subtopic, float *value);
 
 bool twr_radio_pub_string(const char *subtopic, const char *value);
 
+//! @brief Publish statistics of link to gateway, node does it on its own with TWR_RADIO_LINK_PUB_INTERVAL_MS set
+//! @details Without TWR_RADIO_LINK_STATS the RSSI minimum, maximum and average are all the last RSSI
+//! @return true On success
+//! @return false On failure
+
+bool twr_radio_pub_link(void);
+
+//! @brief Internal function for twr_radio.c, subtopics are registered with gateway again
+
+void twr_radio_pub_topic_reset(void);
+
 //! @brief Internal decode function for twr_radio.c
 //! @param[in] id Pointer on sender id
 //! @param[in] buffer Pointer to RX buffer
 //! @param[in] length RX buffer length
+//! @return true If header belongs to this module
+//! @return false If header is decoded elsewhere
 
-void twr_radio_pub_decode(uint64_t *id, uint8_t *buffer, size_t length);
+bool twr_radio_pub_decode(uint64_t *id, uint8_t *buffer, size_t length);
 
 //! @}
 
@@ -0,0 +1,19 @@
+#ifndef _TWR_RNG_H
+#define _TWR_RNG_H
+
+#include <twr_common.h>
+
+//! @addtogroup twr_rng twr_rng
+//! @brief Driver for true random number generator
+//! @{
+
+//! @brief Read random number, generator and its clock run only for the time of reading
+//! @param[out] random Pointer to destination
+//! @return true On success
+//! @return false On failure
+
+bool twr_rng_read(uint32_t *random);
+
+//! @}
+
+#endif // _TWR_RNG_H
@@ -17,10 +17,66 @@
 #define TWR_SCHEDULER_INTERVAL_MS 10
 #endif
 
+//! @brief Enable tickless idle (RTC wake-up timer is programmed to the next task deadline before sleep)
+
+#ifndef TWR_SCHEDULER_TICKLESS
+#define TWR_SCHEDULER_TICKLESS 0
+#endif
+
+//! @brief Keep planned tasks in binary heap ordered by deadline instead of scanning whole task pool in every spin
+//! @details Pays off only with large task pools (about a hundred tasks and more, see tools/scheduler-bench), with default
+//!          TWR_SCHEDULER_MAX_TASKS linear scan is as fast and heap only adds code and interrupt masking on every plan
+
+#ifndef TWR_SCHEDULER_HEAP
+#define TWR_SCHEDULER_HEAP 0
+#endif
+
+//! @brief Collect execution statistics of every task
+
+#ifndef TWR_SCHEDULER_STATS
+#define TWR_SCHEDULER_STATS 0
+#endif
+
 //! @brief Task ID assigned by scheduler
 
 typedef size_t twr_scheduler_task_id_t;
 
+//! @brief Task priority
+
+typedef enum
+{
+    //! @brief Task is dispatched after all other due tasks
+    TWR_SCHEDULER_PRIORITY_LOW = 0,
+
+    //! @brief Default priority
+    TWR_SCHEDULER_PRIORITY_NORMAL = 1,
+
+    //! @brief Task is dispatched before all other due tasks
+    TWR_SCHEDULER_PRIORITY_HIGH = 2
+
+} twr_scheduler_priority_t;
+
+//! @brief Task execution statistics
+
+typedef struct
+{
+    //! @brief Task function address
+    void (*task)(void *);
+
+    //! @brief Number of task invocations
+    uint32_t run_count;
+
+    //! @brief Cumulative execution time in microseconds
+    uint64_t time_total;
+
+    //! @brief Worst-case execution time in microseconds
+    uint32_t time_max;
+
+    //! @brief Worst-case delay between planned and actual dispatch in ticks
+    twr_tick_t lateness_max;
+
+} twr_scheduler_stats_t;
+
 //! @brief Initialize task scheduler
 
 void twr_scheduler_init(void);
@@ -37,6 +93,15 @@ void twr_scheduler_run(void);
 
 twr_scheduler_task_id_t twr_scheduler_register(void (*task)(void *), void *param, twr_tick_t tick);
 
+//! @brief Register task in scheduler with specified priority
+//! @param[in] task Task function address
+//! @param[in] param Optional parameter which is passed to task function (can be NULL)
+//! @param[in] tick Absolute tick when task will be scheduled
+//! @param[in] priority Priority of task (due tasks are dispatched in order of priority, tasks with equal priority in order of their deadline or ID)
+//! @return Assigned task ID
+
+twr_scheduler_task_id_t twr_scheduler_register_ex(void (*task)(void *), void *param, twr_tick_t tick, twr_scheduler_priority_t priority);
+
 //! @brief Unregister specified task
 //! @param[in] task_id Task ID to be unregistered
 
@@ -52,6 +117,27 @@ twr_scheduler_task_id_t twr_scheduler_get_current_task_id(void);
 
 twr_tick_t twr_scheduler_get_spin_tick(void);
 
+//! @brief Get absolute tick of the earliest planned task
+//! @return Tick of the nearest deadline or TWR_TICK_INFINITY if no task is planned
+
+twr_tick_t twr_scheduler_get_next_tick(void);
+
+#if TWR_SCHEDULER_STATS
+
+//! @brief Get execution statistics of specified task
+//! @param[in] task_id Task ID
+//! @param[out] stats Pointer to statistics structure
+//! @return true If task is registered
+//! @return false If task is not registered
+
+bool twr_scheduler_get_stats(twr_scheduler_task_id_t task_id, twr_scheduler_stats_t *stats);
+
+//! @brief Clear execution statistics of all tasks
+
+void twr_scheduler_reset_stats(void);
+
+#endif
+
 //! @brief Disable sleep mode, implemented as semaphore
 
 void twr_scheduler_disable_sleep(void);
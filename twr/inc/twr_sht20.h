@@ -3,6 +3,7 @@
 
 #include <twr_i2c.h>
 #include <twr_scheduler.h>
+#include <twr_coroutine.h>
 
 //! @addtogroup twr_sht20 twr_sht20
 //! @brief Driver for SHT20 humidity sensor
@@ -24,7 +25,8 @@ typedef enum
 
 typedef struct twr_sht20_t twr_sht20_t;
 
-//! @cond
+//! @brief Former states of measurement
+//! @deprecated Measurement is driven by coroutine, the enumeration is no longer used by the driver
 
 typedef enum
 {
@@ -36,7 +38,9 @@ typedef enum
     TWR_SHT20_STATE_READ_T = 4,
     TWR_SHT20_STATE_UPDATE = 5
 
-} twr_sht20_state_t;
+} twr_sht20_state_t __attribute__((deprecated));
+
+//! @cond
 
 struct twr_sht20_t
 {
@@ -48,7 +52,7 @@ struct twr_sht20_t
     void *_event_param;
     bool _measurement_active;
     twr_tick_t _update_interval;
-    twr_sht20_state_t _state;
+    twr_coroutine_t _coroutine;
     twr_tick_t _tick_ready;
     bool _humidity_valid;
     bool _temperature_valid;
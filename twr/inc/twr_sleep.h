@@ -2,11 +2,62 @@
 #define _TWR_SLEEP_H
 
 #include <twr_system.h>
+#include <twr_scheduler.h>
+
+/**
+ * Minimum idle time for which Stop mode is entered
+ *
+ * Stop mode turns the regulator to low-power mode and stops all clocks except
+ * LSE, so it pays off only if the core stays in it longer than the wake-up
+ * latency of the regulator and MSI. For shorter idle periods Sleep mode is
+ * used instead.
+ */
+#ifndef TWR_SLEEP_STOP_MIN_RESIDENCY_MS
+#define TWR_SLEEP_STOP_MIN_RESIDENCY_MS 2
+#endif
 
 typedef struct twr_sleep_manager {
     int disable_sleep;
 } twr_sleep_manager_t;
 
+/**
+ * Low power mode selected by twr_sleep
+ */
+typedef enum
+{
+    /** Core clock stopped, peripherals keep running */
+    TWR_SLEEP_MODE_SLEEP = 0,
+
+    /** All clocks except LSE stopped, RAM and registers retained */
+    TWR_SLEEP_MODE_STOP = 1,
+
+    /** Everything powered down except wake-up logic, ends with reset */
+    TWR_SLEEP_MODE_STANDBY = 2
+
+} twr_sleep_mode_t;
+
+/**
+ * Residency statistics of low power modes
+ */
+typedef struct
+{
+    /** Number of entries to Sleep mode */
+    uint32_t sleep_count;
+
+    /** Time spent in Sleep mode in ticks */
+    twr_tick_t sleep_time;
+
+    /** Number of entries to Stop mode */
+    uint32_t stop_count;
+
+    /** Time spent in Stop mode in ticks */
+    twr_tick_t stop_time;
+
+    /** Time spent in run mode in ticks */
+    twr_tick_t run_time;
+
+} twr_sleep_stats_t;
+
 extern twr_sleep_manager_t sleep_manager;
 
 /**
@@ -32,15 +83,45 @@ void twr_sleep_enable(void);
  *
  * Transition the processor core to a low power mode in the absence of work to
  * do, unless sleeping has been disabled with twr_sleep_disable. The function
- * returns immediately if sleeping has been disabled by the application.
+ * returns immediately if sleeping has been disabled by the application or by
+ * an enabled HSI16 or PLL clock.
  *
  * Sleeping is enabled by default (upon application startup).
+ *
+ * The mode is chosen from the deadline of the earliest planned task and from
+ * the peripherals which are active: Stop mode is used unless a driver has
+ * disabled deep sleep (e.g. UART in async mode) or the deadline is closer
+ * than TWR_SLEEP_STOP_MIN_RESIDENCY_MS, in which case Sleep mode is used.
+ * Standby mode is used only if allowed by twr_sleep_allow_standby and no task
+ * is planned at all.
+ *
+ * In tickless mode (TWR_SCHEDULER_TICKLESS), the RTC wake-up timer is
+ * programmed to the deadline of the earliest planned task instead of waking up
+ * every TWR_SCHEDULER_INTERVAL_MS.
  */
-static inline void twr_sleep(void)
-{
-    if (sleep_manager.disable_sleep == 0) {
-        twr_system_sleep();
-    }
-}
+void twr_sleep(void);
+
+/**
+ * Allow the processor to enter Standby mode when no task is planned
+ *
+ * Standby mode is left only by reset or wake-up pin and the content of RAM is
+ * lost, so it is disallowed by default.
+ */
+void twr_sleep_allow_standby(bool allow);
+
+/**
+ * Get mode which twr_sleep would select now
+ */
+twr_sleep_mode_t twr_sleep_get_mode(void);
+
+/**
+ * Get residency statistics of low power modes since their last reset
+ */
+void twr_sleep_get_stats(twr_sleep_stats_t *stats);
+
+/**
+ * Reset residency statistics of low power modes
+ */
+void twr_sleep_reset_stats(void);
 
 #endif /* _TWR_SLEEP_H */
@@ -13,6 +13,11 @@
 
 //! @endcond
 
+// Channel is considered busy by clear channel assessment if RSSI is above this level (dBm)
+#ifndef TWR_SPIRIT1_CCA_RSSI_THRESHOLD
+#define TWR_SPIRIT1_CCA_RSSI_THRESHOLD -90
+#endif
+
 //! @brief Callback events
 
 typedef enum
@@ -24,7 +29,10 @@ typedef enum
     TWR_SPIRIT1_EVENT_RX_DONE = 1,
 
     //! @brief Event is RX timeout
-    TWR_SPIRIT1_EVENT_RX_TIMEOUT = 2
+    TWR_SPIRIT1_EVENT_RX_TIMEOUT = 2,
+
+    //! @brief Event is TX not done because channel is busy (only after twr_spirit1_tx_cca)
+    TWR_SPIRIT1_EVENT_TX_BUSY = 3
 
 } twr_spirit1_event_t;
 
@@ -85,10 +93,24 @@ void twr_spirit1_set_rx_timeout(twr_tick_t timeout);
 
 void twr_spirit1_tx(void);
 
+//! @brief Enter TX state after clear channel assessment
+//! @details Packet is sent only if RSSI stays below TWR_SPIRIT1_CCA_RSSI_THRESHOLD while listening,
+//! otherwise TWR_SPIRIT1_EVENT_TX_BUSY is reported instead of TWR_SPIRIT1_EVENT_TX_DONE and radio enters sleep state.
+//! There is no back-off in driver, it is up to caller when to try again.
+
+void twr_spirit1_tx_cca(void);
+
 //! @brief Enter RX state
 
 void twr_spirit1_rx(void);
 
+//! @brief Enter RX state only if carrier is sensed
+//! @param[in] timeout Time for which channel is sampled
+//! @details RX state is left with TWR_SPIRIT1_EVENT_RX_TIMEOUT as soon as timeout elapses without RSSI getting above
+//! TWR_SPIRIT1_CCA_RSSI_THRESHOLD, otherwise radio keeps receiving until timeout set by twr_spirit1_set_rx_timeout.
+
+void twr_spirit1_rx_sniff(twr_tick_t timeout);
+
 //! @brief Enter sleep state
 
 void twr_spirit1_sleep(void);
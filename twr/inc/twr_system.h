@@ -42,6 +42,8 @@ static inline void twr_system_sleep(void)
     }
 }
 
+void twr_system_sleep_tickless(void);
+
 twr_system_clock_t twr_system_clock_get(void);
 
 void twr_system_hsi16_enable(void);
@@ -56,6 +58,8 @@ void twr_system_deep_sleep_disable(void);
 
 void twr_system_deep_sleep_enable(void);
 
+bool twr_system_get_deep_sleep(void);
+
 void twr_system_enter_standby_mode(void);
 
 uint32_t twr_system_get_clock(void);
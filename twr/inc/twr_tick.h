@@ -7,6 +7,12 @@
 //! @brief Timestamp functions
 //! @{
 
+//! @brief Interpolate twr_tick_get_us by LPTIM1 counting LSE (resolution 1/32768 s instead of 1/TWR_RTC_PREDIV_S s), LPTIM1 then runs all the time
+
+#ifndef TWR_TICK_LPTIM
+#define TWR_TICK_LPTIM 0
+#endif
+
 //! @brief Maximum timestamp value
 
 #define TWR_TICK_INFINITY UINT64_C(0xffffffffffffffff)
@@ -20,6 +26,11 @@ typedef uint64_t twr_tick_t;
 
 twr_tick_t twr_tick_get(void);
 
+//! @brief Get absolute timestamp since start of program with sub-millisecond part taken from RTC
+//! @return Timestamp in microseconds (resolution is 1/32768 s with TWR_TICK_LPTIM, 1/TWR_RTC_PREDIV_S s otherwise)
+
+uint64_t twr_tick_get_us(void);
+
 //! @brief Delay execution for specified amount of ticks
 //! @param[in] delay Number of ticks to wait
 
@@ -27,6 +38,14 @@ void twr_tick_wait(twr_tick_t delay);
 
 void twr_tick_increment_irq(twr_tick_t delta);
 
+//! @brief Advance tick counter by time elapsed on RTC since last synchronization (tickless mode only)
+
+void twr_tick_rtc_sync_irq(void);
+
+//! @brief Set RTC reference of tick counter to current RTC time, e.g. after calendar change
+
+void twr_tick_rtc_reset_irq(void);
+
 //! @}
 
 #endif // _TWR_TICK_H
@@ -3,6 +3,7 @@
 
 #include <twr_i2c.h>
 #include <twr_scheduler.h>
+#include <twr_coroutine.h>
 
 //! @addtogroup twr_tmp112 twr_tmp112
 //! @brief Driver for TMP112 temperature sensor
@@ -24,7 +25,8 @@ typedef enum
 
 typedef struct twr_tmp112_t twr_tmp112_t;
 
-//! @cond
+//! @brief Former states of measurement
+//! @deprecated Measurement is driven by coroutine, the enumeration is no longer used by the driver
 
 typedef enum
 {
@@ -34,7 +36,9 @@ typedef enum
     TWR_TMP112_STATE_READ = 2,
     TWR_TMP112_STATE_UPDATE = 3
 
-} twr_tmp112_state_t;
+} twr_tmp112_state_t __attribute__((deprecated));
+
+//! @cond
 
 struct twr_tmp112_t
 {
@@ -46,7 +50,7 @@ struct twr_tmp112_t
     void *_event_param;
     bool _measurement_active;
     twr_tick_t _update_interval;
-    twr_tmp112_state_t _state;
+    twr_coroutine_t _coroutine;
     twr_tick_t _tick_ready;
     bool _temperature_valid;
     uint16_t _reg_temperature;
@@ -137,18 +137,39 @@ typedef enum
 
 } twr_uart_event_t;
 
+//! @brief Maximum number of segments of one vectored write
+
+#ifndef TWR_UART_WRITEV_SEGMENTS
+#define TWR_UART_WRITEV_SEGMENTS 8
+#endif
+
+//! @brief Segment of vectored write
+
+typedef struct
+{
+    //! @brief Pointer to data
+    const void *buffer;
+
+    //! @brief Length of data
+    size_t length;
+
+} twr_uart_segment_t;
+
 //! @brief Initialize UART channel
+//! @details Async write in progress is completed first, its done handler and event are delivered before channel is set up again
 //! @param[in] channel UART channel
 //! @param[in] config UART configuration
 
 void twr_uart_init(twr_uart_channel_t channel, twr_uart_baudrate_t baudrate, twr_uart_setting_t setting);
 
 //! @brief Deinitialize UART channel
+//! @details Async write in progress is completed first, its done handler and event are delivered before channel is shut down
 //! @param[in] channel UART channel
 
 void twr_uart_deinit(twr_uart_channel_t channel);
 
 //! @brief Write data to UART channel (blocking call)
+//! @details Data of async write in progress are written first
 //! @param[in] channel UART channel
 //! @param[in] buffer Pointer to source buffer
 //! @param[in] length Number of bytes to be written
@@ -187,6 +208,27 @@ void twr_uart_set_async_fifo(twr_uart_channel_t channel, twr_fifo_t *write_fifo,
 
 size_t twr_uart_async_write(twr_uart_channel_t channel, const void *buffer, size_t length);
 
+//! @brief Write segments in async mode straight from caller buffers
+//! @details Segments are transmitted in order without being copied to FIFO, so their buffers have to stay untouched
+//!          until done handler is called. Array of segments itself is copied. Data added by twr_uart_async_write
+//!          in the meantime are transmitted after segments.
+//! @param[in] channel UART channel
+//! @param[in] segment Array of segments
+//! @param[in] count Number of segments (at most TWR_UART_WRITEV_SEGMENTS)
+//! @param[in] done_handler Function called once transmission is done (can be NULL)
+//! @param[in] done_param Optional done handler parameter (can be NULL)
+//! @return true On success
+//! @return false On failure (async write is in progress or there are too many segments)
+
+bool twr_uart_async_writev(twr_uart_channel_t channel, const twr_uart_segment_t *segment, size_t count, void (*done_handler)(twr_uart_channel_t, void *), void *done_param);
+
+//! @brief Complete async write in progress (blocking call)
+//! @details Data left in segments and FIFO are written out by polling, so that it works with interrupts disabled
+//!          or outside of scheduler. Async write is still reported as done by event once scheduler runs.
+//! @param[in] channel UART channel
+
+void twr_uart_flush(twr_uart_channel_t channel);
+
 //! @brief Start async reading
 //! @param[in] channel UART channel
 //! @param[in] timeout Maximum timeout in ms
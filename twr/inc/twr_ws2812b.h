@@ -31,6 +31,8 @@ bool twr_ws2812b_write(void);
 
 bool twr_ws2812b_is_ready(void);
 
+void twr_ws2812b_wait_ready(void);
+
 //! @}
 
 #endif // _TWR_WS2812B_H
@@ -56,6 +56,9 @@ __attribute__((weak)) void application_error(twr_error_t code)
 
     twr_log_init(TWR_LOG_LEVEL_DEBUG, TWR_LOG_TIMESTAMP_ABS);
 
+    // Scheduler does not run anymore, so messages are written out here
+    twr_log_flush();
+
     twr_tick_t timeout = 0;
 
     int cnt = 0;
@@ -94,6 +97,8 @@ __attribute__((weak)) void application_error(twr_error_t code)
                     break;
                 }
             }
+
+            twr_log_flush();
         }
 
         twr_gpio_set_output(TWR_GPIO_LED, 1);
@@ -77,7 +77,7 @@ bool twr_aes_ecb_decrypt(void *buffer_out, const void *buffer_in, size_t length,
     return _twr_aes_process(buffer_out, buffer_in, length);
 }
 
-bool twr_aes_ctwr_encrypt(void *buffer_out, const void *buffer_in, size_t length, twr_aes_key_t key, twr_aes_iv_t iv)
+bool twr_aes_ctwr_encrypt(void *buffer_out, const void *buffer_in, size_t length, const twr_aes_key_t key, const twr_aes_iv_t iv)
 {
     if ((length % 16) != 0)
     {
@@ -93,7 +93,7 @@ bool twr_aes_ctwr_encrypt(void *buffer_out, const void *buffer_in, size_t length
     return _twr_aes_process(buffer_out, buffer_in, length);
 }
 
-bool twr_aes_ctwr_decrypt(void *buffer_out, const void *buffer_in, size_t length, twr_aes_key_t key, twr_aes_iv_t iv)
+bool twr_aes_ctwr_decrypt(void *buffer_out, const void *buffer_in, size_t length, const twr_aes_key_t key, const twr_aes_iv_t iv)
 {
     if ((length % 16) != 0)
     {
@@ -109,6 +109,22 @@ bool twr_aes_ctwr_decrypt(void *buffer_out, const void *buffer_in, size_t length
     return _twr_aes_process(buffer_out, buffer_in, length);
 }
 
+bool twr_aes_ctr_encrypt(void *buffer_out, const void *buffer_in, size_t length, const twr_aes_key_t key, const twr_aes_iv_t iv)
+{
+    if ((length % 16) != 0)
+    {
+        return false;
+    }
+
+    AES->CR = AES_CR_CHMOD_1 | _TWR_AES_DATATYPE;
+
+    _twr_aes_set_key(key);
+
+    _twr_aes_set_iv(iv);
+
+    return _twr_aes_process(buffer_out, buffer_in, length);
+}
+
 void twr_aes_key_from_uint8(twr_aes_key_t key, const uint8_t *buffer)
 {
     uint8_t *tmp = (uint8_t *) key;
@@ -0,0 +1,171 @@
+#include <twr_aes.h>
+
+// CCM is composed of CBC and CTR modes of AES driver, so that it runs on hardware block where it is available.
+// Length field of blocks takes 2 bytes (L = 2), which is plenty for radio frames.
+
+#define _TWR_AES_CCM_BLOCK_SIZE 16
+#define _TWR_AES_CCM_FLAG_ADATA 0x40
+#define _TWR_AES_CCM_L 2
+
+// First block of CBC-MAC, additional data with its length prefix and payload, each of them padded to whole blocks
+#define _TWR_AES_CCM_BUFFER_SIZE (3 * _TWR_AES_CCM_BLOCK_SIZE + TWR_AES_CCM_MAX_LENGTH)
+
+static bool _twr_aes_ccm_check(size_t length, size_t aad_length, size_t tag_length);
+static bool _twr_aes_ccm_mac(uint8_t *mac, const uint8_t *payload, size_t length, const uint8_t *aad, size_t aad_length, const twr_aes_key_t key, const uint8_t *nonce, size_t tag_length);
+static bool _twr_aes_ccm_ctr(uint8_t *buffer_out, uint8_t *s0, const uint8_t *buffer_in, size_t length, const twr_aes_key_t key, const uint8_t *nonce);
+static size_t _twr_aes_ccm_pad(size_t length);
+
+bool twr_aes_ccm_encrypt(void *buffer_out, void *tag, const void *buffer_in, size_t length, const void *aad, size_t aad_length, const twr_aes_key_t key, const uint8_t *nonce, size_t tag_length)
+{
+    uint8_t mac[_TWR_AES_CCM_BLOCK_SIZE];
+    uint8_t s0[_TWR_AES_CCM_BLOCK_SIZE];
+
+    if (!_twr_aes_ccm_check(length, aad_length, tag_length))
+    {
+        return false;
+    }
+
+    // MAC is computed over plaintext before it is overwritten in place
+    if (!_twr_aes_ccm_mac(mac, buffer_in, length, aad, aad_length, key, nonce, tag_length))
+    {
+        return false;
+    }
+
+    if (!_twr_aes_ccm_ctr(buffer_out, s0, buffer_in, length, key, nonce))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < tag_length; i++)
+    {
+        ((uint8_t *) tag)[i] = mac[i] ^ s0[i];
+    }
+
+    return true;
+}
+
+bool twr_aes_ccm_decrypt(void *buffer_out, const void *buffer_in, size_t length, const void *aad, size_t aad_length, const twr_aes_key_t key, const uint8_t *nonce, const void *tag, size_t tag_length)
+{
+    uint8_t mac[_TWR_AES_CCM_BLOCK_SIZE];
+    uint8_t s0[_TWR_AES_CCM_BLOCK_SIZE];
+
+    if (!_twr_aes_ccm_check(length, aad_length, tag_length))
+    {
+        return false;
+    }
+
+    if (!_twr_aes_ccm_ctr(buffer_out, s0, buffer_in, length, key, nonce))
+    {
+        return false;
+    }
+
+    if (!_twr_aes_ccm_mac(mac, buffer_out, length, aad, aad_length, key, nonce, tag_length))
+    {
+        memset(buffer_out, 0, length);
+
+        return false;
+    }
+
+    // Every byte of tag is compared, so that time does not tell how much of it matched
+    uint8_t difference = 0;
+
+    for (size_t i = 0; i < tag_length; i++)
+    {
+        difference |= ((const uint8_t *) tag)[i] ^ mac[i] ^ s0[i];
+    }
+
+    if (difference != 0)
+    {
+        memset(buffer_out, 0, length);
+
+        return false;
+    }
+
+    return true;
+}
+
+static bool _twr_aes_ccm_check(size_t length, size_t aad_length, size_t tag_length)
+{
+    if ((length + aad_length > TWR_AES_CCM_MAX_LENGTH) || (tag_length < 4) || (tag_length > 16) || ((tag_length % 2) != 0))
+    {
+        return false;
+    }
+
+    return true;
+}
+
+static bool _twr_aes_ccm_mac(uint8_t *mac, const uint8_t *payload, size_t length, const uint8_t *aad, size_t aad_length, const twr_aes_key_t key, const uint8_t *nonce, size_t tag_length)
+{
+    uint8_t buffer[_TWR_AES_CCM_BUFFER_SIZE];
+    size_t position = _TWR_AES_CCM_BLOCK_SIZE;
+    twr_aes_iv_t iv = { 0 };
+
+    memset(buffer, 0, sizeof(buffer));
+
+    buffer[0] = (aad_length != 0 ? _TWR_AES_CCM_FLAG_ADATA : 0) | (((tag_length - 2) / 2) << 3) | (_TWR_AES_CCM_L - 1);
+
+    memcpy(buffer + 1, nonce, TWR_AES_CCM_NONCE_SIZE);
+
+    buffer[14] = length >> 8;
+    buffer[15] = length;
+
+    if (aad_length != 0)
+    {
+        buffer[position] = aad_length >> 8;
+        buffer[position + 1] = aad_length;
+
+        memcpy(buffer + position + 2, aad, aad_length);
+
+        position += _twr_aes_ccm_pad(2 + aad_length);
+    }
+
+    memcpy(buffer + position, payload, length);
+
+    position += _twr_aes_ccm_pad(length);
+
+    // CBC-MAC is the last block of CBC encryption with zero initialization vector
+    if (!twr_aes_ctwr_encrypt(buffer, buffer, position, key, iv))
+    {
+        return false;
+    }
+
+    memcpy(mac, buffer + position - _TWR_AES_CCM_BLOCK_SIZE, _TWR_AES_CCM_BLOCK_SIZE);
+
+    return true;
+}
+
+static bool _twr_aes_ccm_ctr(uint8_t *buffer_out, uint8_t *s0, const uint8_t *buffer_in, size_t length, const twr_aes_key_t key, const uint8_t *nonce)
+{
+    uint8_t buffer[_TWR_AES_CCM_BLOCK_SIZE + TWR_AES_CCM_MAX_LENGTH];
+    uint8_t block[_TWR_AES_CCM_BLOCK_SIZE];
+    twr_aes_iv_t iv;
+
+    // Counter block A0 encrypts tag, payload starts with A1
+    memset(block, 0, sizeof(block));
+
+    block[0] = _TWR_AES_CCM_L - 1;
+
+    memcpy(block + 1, nonce, TWR_AES_CCM_NONCE_SIZE);
+
+    twr_aes_iv_from_uint8(iv, block);
+
+    memset(buffer, 0, sizeof(buffer));
+
+    memcpy(buffer + _TWR_AES_CCM_BLOCK_SIZE, buffer_in, length);
+
+    if (!twr_aes_ctr_encrypt(buffer, buffer, _TWR_AES_CCM_BLOCK_SIZE + _twr_aes_ccm_pad(length), key, iv))
+    {
+        return false;
+    }
+
+    memcpy(s0, buffer, _TWR_AES_CCM_BLOCK_SIZE);
+
+    memcpy(buffer_out, buffer + _TWR_AES_CCM_BLOCK_SIZE, length);
+
+    return true;
+}
+
+static size_t _twr_aes_ccm_pad(size_t length)
+{
+    return (length + _TWR_AES_CCM_BLOCK_SIZE - 1) & ~(_TWR_AES_CCM_BLOCK_SIZE - 1);
+}
@@ -1,6 +1,7 @@
 #include <twr_atci.h>
 #include <twr_scheduler.h>
 #include <twr_system.h>
+#include <twr_sleep.h>
 
 static void _twr_atci_uart_event_handler(twr_uart_channel_t channel, twr_uart_event_t event, void  *event_param);
 static void _twr_atci_uart_active_test(void);
@@ -159,6 +160,69 @@ bool twr_atci_help_action(void)
     return true;
 }
 
+bool twr_atci_sleep_action(void)
+{
+    twr_sleep_stats_t stats;
+
+    twr_sleep_get_stats(&stats);
+
+    twr_atci_printfln("$SLEEP: %lu,%lu,%lu,%lu,%lu", (unsigned long) stats.sleep_count, (unsigned long) stats.sleep_time,
+            (unsigned long) stats.stop_count, (unsigned long) stats.stop_time, (unsigned long) stats.run_time);
+
+    return true;
+}
+
+bool twr_atci_sleep_set(twr_atci_param_t *param)
+{
+    uint32_t value;
+
+    if (!twr_atci_get_uint(param, &value) || value != 0)
+    {
+        return false;
+    }
+
+    twr_sleep_reset_stats();
+
+    return true;
+}
+
+#if TWR_SCHEDULER_STATS
+
+bool twr_atci_sched_action(void)
+{
+    twr_scheduler_stats_t stats;
+
+    for (twr_scheduler_task_id_t i = 0; i < TWR_SCHEDULER_MAX_TASKS; i++)
+    {
+        if (!twr_scheduler_get_stats(i, &stats))
+        {
+            continue;
+        }
+
+        twr_atci_printfln("$SCHED: %u,0x%08lx,%lu,%lu,%lu,%lu", (unsigned) i, (unsigned long) (uintptr_t) stats.task,
+                (unsigned long) stats.run_count, (unsigned long) (stats.time_total / 1000),
+                (unsigned long) stats.time_max, (unsigned long) stats.lateness_max);
+    }
+
+    return true;
+}
+
+bool twr_atci_sched_set(twr_atci_param_t *param)
+{
+    uint32_t value;
+
+    if (!twr_atci_get_uint(param, &value) || value != 0)
+    {
+        return false;
+    }
+
+    twr_scheduler_reset_stats();
+
+    return true;
+}
+
+#endif
+
 static bool _twr_atci_process_line(void)
 {
     if (_twr_atci.rx_length < 2 || _twr_atci.rx_buffer[0] != 'A' || _twr_atci.rx_buffer[1] != 'T')
@@ -246,11 +246,12 @@ bool twr_dac_async_run(twr_dac_channel_t channel)
 
     twr_dma_init();
 
+    // Event handler is set first, so that UART which may have borrowed the channel hands it over
+    twr_dma_set_event_handler(dac_channel_setup->dma_channel, _twr_dac_dma_handler, (void *)channel);
+
     // Update DMA channel with image of DAC DMA channel
     twr_dma_channel_config(dac_channel_setup->dma_channel, &dac_channel_setup->dma_config);
 
-    twr_dma_set_event_handler(dac_channel_setup->dma_channel, _twr_dac_dma_handler, (void *)channel);
-
     twr_dma_channel_run(dac_channel_setup->dma_channel);
 
     // Start timer
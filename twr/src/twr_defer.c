@@ -0,0 +1,118 @@
+#include <twr_defer.h>
+#include <twr_scheduler.h>
+#include <twr_irq.h>
+#include <stm32l0xx.h>
+
+static struct
+{
+    twr_defer_t *head;
+    twr_scheduler_task_id_t task_id;
+    bool initialized;
+
+} _twr_defer;
+
+static void _twr_defer_task(void *param);
+
+void twr_defer_init(twr_defer_t *self, void *buffer, size_t item_size, size_t item_count, void (*handler)(const void *item, void *param), void *param)
+{
+    memset(self, 0, sizeof(*self));
+
+    self->_buffer = buffer;
+    self->_item_size = item_size;
+    self->_item_count = item_count;
+    self->_handler = handler;
+    self->_param = param;
+
+    if (!_twr_defer.initialized)
+    {
+        // Bottom halves run ahead of regular tasks, as their interrupts would
+        _twr_defer.task_id = twr_scheduler_register_ex(_twr_defer_task, NULL, TWR_TICK_INFINITY, TWR_SCHEDULER_PRIORITY_HIGH);
+
+        _twr_defer.initialized = true;
+    }
+
+    twr_irq_disable();
+
+    self->_next = _twr_defer.head;
+
+    _twr_defer.head = self;
+
+    twr_irq_enable();
+}
+
+bool twr_defer_irq_push(twr_defer_t *self, const void *item)
+{
+    size_t head = self->_head;
+    size_t next = head + 1;
+
+    if (next == self->_item_count)
+    {
+        next = 0;
+    }
+
+    if (next == self->_tail)
+    {
+        self->_overflow_count++;
+
+        return false;
+    }
+
+    memcpy(self->_buffer + head * self->_item_size, item, self->_item_size);
+
+    // Record must be complete before it is published to consumer
+    __DMB();
+
+    self->_head = next;
+
+    twr_scheduler_plan_now(_twr_defer.task_id);
+
+    return true;
+}
+
+uint32_t twr_defer_get_overflow_count(twr_defer_t *self)
+{
+    return self->_overflow_count;
+}
+
+void twr_defer_process(twr_defer_t *self)
+{
+    // Handler which calls this again for the same source would get the record it is handling once more
+    if (self->_processing)
+    {
+        return;
+    }
+
+    self->_processing = true;
+
+    // Only records published before this pass are processed, newer ones plan the task again
+    size_t head = self->_head;
+
+    while (self->_tail != head)
+    {
+        size_t tail = self->_tail;
+
+        self->_handler(self->_buffer + tail * self->_item_size, self->_param);
+
+        if (++tail == self->_item_count)
+        {
+            tail = 0;
+        }
+
+        // Slot must not be reused by producer before handler is done with it
+        __DMB();
+
+        self->_tail = tail;
+    }
+
+    self->_processing = false;
+}
+
+static void _twr_defer_task(void *param)
+{
+    (void) param;
+
+    for (twr_defer_t *self = _twr_defer.head; self != NULL; self = self->_next)
+    {
+        twr_defer_process(self);
+    }
+}
@@ -1,9 +1,12 @@
 #include <twr_dma.h>
 #include <twr_irq.h>
-#include <twr_scheduler.h>
-#include <twr_fifo.h>
+#include <twr_defer.h>
 #include <stm32l0xx.h>
 
+// Events of channels which share interrupt vector are deferred through one ring, each vector has its own,
+// as vectors of different priority preempt each other
+#define _TWR_DMA_DEFER_SIZE 8
+
 #define _TWR_DMA_CHECK_IRQ_OF_CHANNEL_(__CHANNEL) \
     if ((DMA1->ISR & DMA_ISR_GIF##__CHANNEL) != 0) \
     { \
@@ -26,12 +29,11 @@
 typedef struct
 {
     uint8_t channel : 4;
-    uint8_t event : 4;
+    uint8_t event : 3;
+    uint8_t lent : 1;
 
 } twr_dma_pending_event_t;
 
-static twr_dma_pending_event_t _twr_dma_pending_event_buffer[2 * 7 * sizeof(twr_dma_pending_event_t)];
-
 static struct
 {
     bool is_initialized;
@@ -42,14 +44,20 @@ static struct
         void (*event_handler)(twr_dma_channel_t, twr_dma_event_t, void *);
         void *event_param;
 
+        // Set while channel is borrowed, called when its owner takes it
+        void (*release_handler)(twr_dma_channel_t, void *);
+
     } channel[7];
 
-    twr_fifo_t fifo_pending;
-    twr_scheduler_task_id_t task_id;
+    // Sources of channel 1, channels 2 and 3 and channels 4 to 7
+    twr_defer_t defer[3];
+    twr_dma_pending_event_t defer_buffer[3][_TWR_DMA_DEFER_SIZE];
 
 } _twr_dma;
 
-static void _twr_dma_task(void *param);
+static void _twr_dma_defer_handler(const void *item, void *param);
+
+static twr_defer_t *_twr_dma_get_defer(twr_dma_channel_t channel);
 
 static void _twr_dma_irq_handler(twr_dma_channel_t channel, twr_dma_event_t event);
 
@@ -69,9 +77,10 @@ void twr_dma_init(void)
     _twr_dma.channel[TWR_DMA_CHANNEL_6].instance = DMA1_Channel6;
     _twr_dma.channel[TWR_DMA_CHANNEL_7].instance = DMA1_Channel7;
 
-    twr_fifo_init(&_twr_dma.fifo_pending, _twr_dma_pending_event_buffer, sizeof(_twr_dma_pending_event_buffer));
-
-    _twr_dma.task_id = twr_scheduler_register(_twr_dma_task, NULL, TWR_TICK_INFINITY);
+    for (int i = 0; i < 3; i++)
+    {
+        twr_defer_init(&_twr_dma.defer[i], _twr_dma.defer_buffer[i], sizeof(twr_dma_pending_event_t), _TWR_DMA_DEFER_SIZE, _twr_dma_defer_handler, NULL);
+    }
 
     // Enable DMA1
     RCC->AHBENR |= RCC_AHBENR_DMA1EN;
@@ -172,10 +181,62 @@ void twr_dma_channel_config(twr_dma_channel_t channel, twr_dma_channel_config_t
 
 void twr_dma_set_event_handler(twr_dma_channel_t channel, void (*event_handler)(twr_dma_channel_t, twr_dma_event_t, void *), void *event_param)
 {
+    void (*release_handler)(twr_dma_channel_t, void *) = _twr_dma.channel[channel].release_handler;
+
+    if (release_handler != NULL)
+    {
+        _twr_dma.channel[channel].release_handler = NULL;
+
+        // Borrower completes its transfer and stops channel
+        release_handler(channel, _twr_dma.channel[channel].event_param);
+
+        twr_irq_disable();
+
+        // Clear interrupt flags of the stopped transfer
+        DMA1->IFCR = DMA_IFCR_CGIF1 << (channel * 4);
+
+        twr_irq_enable();
+    }
+
     _twr_dma.channel[channel].event_handler = event_handler;
     _twr_dma.channel[channel].event_param = event_param;
 }
 
+bool twr_dma_channel_borrow(twr_dma_channel_t channel, void (*event_handler)(twr_dma_channel_t, twr_dma_event_t, void *), void (*release_handler)(twr_dma_channel_t, void *), void *event_param)
+{
+    bool borrowed = false;
+
+    twr_irq_disable();
+
+    // Channel is lent only if no driver has set its event handler
+    if (_twr_dma.channel[channel].event_handler == NULL)
+    {
+        _twr_dma.channel[channel].event_handler = event_handler;
+        _twr_dma.channel[channel].event_param = event_param;
+        _twr_dma.channel[channel].release_handler = release_handler;
+
+        borrowed = true;
+    }
+
+    twr_irq_enable();
+
+    return borrowed;
+}
+
+void twr_dma_channel_return(twr_dma_channel_t channel)
+{
+    twr_irq_disable();
+
+    if (_twr_dma.channel[channel].release_handler != NULL)
+    {
+        _twr_dma.channel[channel].event_handler = NULL;
+        _twr_dma.channel[channel].event_param = NULL;
+        _twr_dma.channel[channel].release_handler = NULL;
+    }
+
+    twr_irq_enable();
+}
+
 void twr_dma_channel_run(twr_dma_channel_t channel)
 {
     _twr_dma.channel[channel].instance->CCR |= DMA_CCR_EN;
@@ -191,18 +252,37 @@ size_t twr_dma_channel_get_length(twr_dma_channel_t channel)
     return (size_t) _twr_dma.channel[channel].instance->CNDTR;
 }
 
-void _twr_dma_task(void *param)
+static void _twr_dma_defer_handler(const void *item, void *param)
 {
     (void) param;
 
-    twr_dma_pending_event_t pending_event;
+    const twr_dma_pending_event_t *pending_event = item;
 
-    while (twr_fifo_read(&_twr_dma.fifo_pending, &pending_event, sizeof(twr_dma_pending_event_t)) != 0)
+    // Event of borrower which comes after channel has been taken over is of the transfer completed by release handler
+    if (pending_event->lent && (_twr_dma.channel[pending_event->channel].release_handler == NULL))
     {
-        if (_twr_dma.channel[pending_event.channel].event_handler != NULL)
-        {
-            _twr_dma.channel[pending_event.channel].event_handler(pending_event.channel, pending_event.event, _twr_dma.channel[pending_event.channel].event_param);
-        }
+        return;
+    }
+
+    if (_twr_dma.channel[pending_event->channel].event_handler != NULL)
+    {
+        _twr_dma.channel[pending_event->channel].event_handler(pending_event->channel, pending_event->event, _twr_dma.channel[pending_event->channel].event_param);
+    }
+}
+
+static twr_defer_t *_twr_dma_get_defer(twr_dma_channel_t channel)
+{
+    if (channel == TWR_DMA_CHANNEL_1)
+    {
+        return &_twr_dma.defer[0];
+    }
+    else if (channel <= TWR_DMA_CHANNEL_3)
+    {
+        return &_twr_dma.defer[1];
+    }
+    else
+    {
+        return &_twr_dma.defer[2];
     }
 }
 
@@ -213,11 +293,9 @@ void _twr_dma_irq_handler(twr_dma_channel_t channel, twr_dma_event_t event)
         twr_dma_channel_stop(channel);
     }
 
-    twr_dma_pending_event_t pending_event = { channel, event };
-
-    twr_fifo_irq_write(&_twr_dma.fifo_pending, &pending_event, sizeof(twr_dma_pending_event_t));
+    twr_dma_pending_event_t pending_event = { channel, event, _twr_dma.channel[channel].release_handler != NULL };
 
-    twr_scheduler_plan_now(_twr_dma.task_id);
+    twr_defer_irq_push(_twr_dma_get_defer(channel), &pending_event);
 }
 
 void DMA1_Channel1_IRQHandler(void)
@@ -4,10 +4,14 @@
 #include <twr_tick.h>
 #include <twr_timer.h>
 #include <twr_scheduler.h>
+#include <twr_event_flags.h>
 
 #define _TWR_EEPROM_BASE DATA_EEPROM_BASE
 #define _TWR_EEPROM_END  DATA_EEPROM_BANK2_END
 #define _TWR_EEPROM_IS_BUSY() ((FLASH->SR & FLASH_SR_BSY) != 0UL)
+#define _TWR_EEPROM_PROGRAM_TIMEOUT 10
+
+#define _TWR_EEPROM_FLAG_EOP (1 << 0)
 
 static struct
 {
@@ -19,6 +23,7 @@ static struct
     void *event_param;
     size_t i;
     twr_scheduler_task_id_t task_id;
+    twr_event_flags_t event_flags;
 
 } _twr_eeprom;
 
@@ -27,6 +32,7 @@ static void _twr_eeprom_unlock(void);
 static void _twr_eeprom_lock(void);
 static bool _twr_eeprom_write(uint32_t address, size_t *i, uint8_t *buffer, size_t length);
 static void _twr_eeprom_async_write_task(void *param);
+static void _twr_eeprom_set_eop_irq(bool enable);
 
 bool twr_eeprom_write(uint32_t address, const void *buffer, size_t length)
 {
@@ -52,6 +58,11 @@ bool twr_eeprom_write(uint32_t address, const void *buffer, size_t length)
     while (i < length)
     {
         _twr_eeprom_write(address, &i, (uint8_t *) buffer, length);
+
+        while (_TWR_EEPROM_IS_BUSY())
+        {
+            continue;
+        }
     }
 
     _twr_eeprom_lock();
@@ -93,6 +104,8 @@ bool twr_eeprom_async_write(uint32_t address, const void *buffer, size_t length,
 
     _twr_eeprom.i = 0;
 
+    twr_event_flags_init(&_twr_eeprom.event_flags);
+
     _twr_eeprom.task_id = twr_scheduler_register(_twr_eeprom_async_write_task, NULL, 0);
 
     _twr_eeprom.running = true;
@@ -106,6 +119,10 @@ void twr_eeprom_async_cancel(void)
     {
         twr_scheduler_unregister(_twr_eeprom.task_id);
 
+        _twr_eeprom_set_eop_irq(false);
+
+        _twr_eeprom_lock();
+
         _twr_eeprom.running = false;
     }
 }
@@ -238,11 +255,6 @@ static bool _twr_eeprom_write(uint32_t address, size_t *i, uint8_t *buffer, size
         *i += 1;
     }
 
-    while (_TWR_EEPROM_IS_BUSY())
-    {
-        continue;
-    }
-
     return write;
 }
 
@@ -251,31 +263,31 @@ static void _twr_eeprom_async_write_task(void *param)
 {
     (void) param;
 
+    // Task is planned by end of programming interrupt, timeout only guards against missed interrupt
     if (_TWR_EEPROM_IS_BUSY())
     {
-        twr_scheduler_plan_current_now();
+        twr_event_flags_wait(&_twr_eeprom.event_flags, _TWR_EEPROM_FLAG_EOP, _TWR_EEPROM_PROGRAM_TIMEOUT);
 
         return;
     }
 
     _twr_eeprom_unlock();
 
-    while(_twr_eeprom.i < _twr_eeprom.length)
+    _twr_eeprom_set_eop_irq(true);
+
+    while (_twr_eeprom.i < _twr_eeprom.length)
     {
-        if(_twr_eeprom_write(_twr_eeprom.address, &_twr_eeprom.i, _twr_eeprom.buffer, _twr_eeprom.length))
+        if (_twr_eeprom_write(_twr_eeprom.address, &_twr_eeprom.i, _twr_eeprom.buffer, _twr_eeprom.length))
         {
-            break;
-        }
-    };
+            twr_event_flags_wait(&_twr_eeprom.event_flags, _TWR_EEPROM_FLAG_EOP, _TWR_EEPROM_PROGRAM_TIMEOUT);
 
-    _twr_eeprom_lock();
+            return;
+        }
+    }
 
-    if(_twr_eeprom.i < _twr_eeprom.length)
-    {
-        twr_scheduler_plan_current_now();
+    _twr_eeprom_set_eop_irq(false);
 
-        return;
-    }
+    _twr_eeprom_lock();
 
     _twr_eeprom.running = false;
 
@@ -296,3 +308,38 @@ static void _twr_eeprom_async_write_task(void *param)
         }
     }
 }
+
+static void _twr_eeprom_set_eop_irq(bool enable)
+{
+    twr_irq_disable();
+
+    // Clear end of programming flag left by previous operations
+    FLASH->SR = FLASH_SR_EOP;
+
+    twr_event_flags_clear(&_twr_eeprom.event_flags, _TWR_EEPROM_FLAG_EOP);
+
+    if (enable)
+    {
+        FLASH->PECR |= FLASH_PECR_EOPIE;
+
+        NVIC_EnableIRQ(FLASH_IRQn);
+    }
+    else
+    {
+        FLASH->PECR &= ~FLASH_PECR_EOPIE;
+
+        NVIC_DisableIRQ(FLASH_IRQn);
+    }
+
+    twr_irq_enable();
+}
+
+void FLASH_IRQHandler(void)
+{
+    if ((FLASH->SR & FLASH_SR_EOP) != 0)
+    {
+        FLASH->SR = FLASH_SR_EOP;
+
+        twr_event_flags_set(&_twr_eeprom.event_flags, _TWR_EEPROM_FLAG_EOP);
+    }
+}
@@ -0,0 +1,80 @@
+#include <twr_event_flags.h>
+#include <twr_irq.h>
+
+void twr_event_flags_init(twr_event_flags_t *self)
+{
+    memset(self, 0, sizeof(*self));
+}
+
+void twr_event_flags_set(twr_event_flags_t *self, uint32_t flags)
+{
+    twr_irq_disable();
+
+    self->_flags |= flags;
+
+    if ((self->_wait_mask & flags) != 0)
+    {
+        self->_wait_mask = 0;
+
+        twr_scheduler_plan_now(self->_task_id);
+    }
+
+    twr_irq_enable();
+}
+
+void twr_event_flags_clear(twr_event_flags_t *self, uint32_t flags)
+{
+    twr_irq_disable();
+
+    self->_flags &= ~flags;
+
+    twr_irq_enable();
+}
+
+uint32_t twr_event_flags_get(twr_event_flags_t *self)
+{
+    return self->_flags;
+}
+
+uint32_t twr_event_flags_take(twr_event_flags_t *self, uint32_t mask)
+{
+    twr_irq_disable();
+
+    uint32_t flags = self->_flags & mask;
+
+    self->_flags &= ~flags;
+
+    twr_irq_enable();
+
+    return flags;
+}
+
+void twr_event_flags_wait(twr_event_flags_t *self, uint32_t mask, twr_tick_t timeout)
+{
+    // Flags are checked with interrupts disabled so that flag set meanwhile is not missed
+    twr_irq_disable();
+
+    if ((self->_flags & mask) != 0)
+    {
+        self->_wait_mask = 0;
+
+        twr_scheduler_plan_current_now();
+    }
+    else
+    {
+        self->_task_id = twr_scheduler_get_current_task_id();
+
+        self->_wait_mask = mask;
+
+        if (timeout == TWR_TICK_INFINITY)
+        {
+            twr_scheduler_plan_current_absolute(TWR_TICK_INFINITY);
+        }
+        else
+        {
+            twr_scheduler_plan_current_from_now(timeout);
+        }
+    }
+
+    twr_irq_enable();
+}
@@ -1,4 +1,5 @@
 #include <twr_exti.h>
+#include <twr_defer.h>
 #include <twr_irq.h>
 #include <stm32l0xx.h>
 
@@ -9,12 +10,42 @@ static struct
     twr_exti_line_t line;
     void (*callback)(twr_exti_line_t, void *);
     void *param;
+    bool deferred;
 
 } _twr_exti[16];
 
+// Every line has at most one record pending, so the ring never overflows
+static struct
+{
+    bool initialized;
+    twr_defer_t defer;
+    uint8_t buffer[16 + 1];
+    volatile uint16_t pending;
+
+} _twr_exti_defer;
+
+static void _twr_exti_register(twr_exti_line_t line, twr_exti_edge_t edge, void (*callback)(twr_exti_line_t, void *), void *param, bool deferred);
+static void _twr_exti_defer_handler(const void *item, void *param);
 static inline void _twr_exti_irq_handler(void);
 
 void twr_exti_register(twr_exti_line_t line, twr_exti_edge_t edge, void (*callback)(twr_exti_line_t, void *), void *param)
+{
+    _twr_exti_register(line, edge, callback, param, false);
+}
+
+void twr_exti_register_deferred(twr_exti_line_t line, twr_exti_edge_t edge, void (*callback)(twr_exti_line_t, void *), void *param)
+{
+    if (!_twr_exti_defer.initialized)
+    {
+        twr_defer_init(&_twr_exti_defer.defer, _twr_exti_defer.buffer, 1, sizeof(_twr_exti_defer.buffer), _twr_exti_defer_handler, NULL);
+
+        _twr_exti_defer.initialized = true;
+    }
+
+    _twr_exti_register(line, edge, callback, param, true);
+}
+
+static void _twr_exti_register(twr_exti_line_t line, twr_exti_edge_t edge, void (*callback)(twr_exti_line_t, void *), void *param, bool deferred)
 {
     // Extract port number
     uint8_t port = ((uint8_t) line >> 4) & 7;
@@ -37,6 +68,9 @@ void twr_exti_register(twr_exti_line_t line, twr_exti_edge_t edge, void (*callba
     // Store callback parameter
     _twr_exti[pin].param = param;
 
+    // Store context of callback
+    _twr_exti[pin].deferred = deferred;
+
     // If this is the first call...
     if (!_twr_exti_initialized)
     {
@@ -50,6 +84,11 @@ void twr_exti_register(twr_exti_line_t line, twr_exti_edge_t edge, void (*callba
         NVIC_EnableIRQ(EXTI0_1_IRQn);
         NVIC_EnableIRQ(EXTI2_3_IRQn);
         NVIC_EnableIRQ(EXTI4_15_IRQn);
+
+        // Vectors must not preempt each other, deferred records have single producer
+        NVIC_SetPriority(EXTI0_1_IRQn, 0);
+        NVIC_SetPriority(EXTI2_3_IRQn, 0);
+        NVIC_SetPriority(EXTI4_15_IRQn, 0);
     }
 
     // Configure port selection for given line
@@ -112,25 +151,62 @@ void twr_exti_unregister(twr_exti_line_t line)
     twr_irq_enable();
 }
 
+static void _twr_exti_defer_handler(const void *item, void *param)
+{
+    (void) param;
+
+    uint8_t pin = *(const uint8_t *) item;
+    uint16_t mask = 1 << pin;
+
+    // Edges which come after this point are reported again
+    twr_irq_disable();
+
+    _twr_exti_defer.pending &= ~mask;
+
+    twr_irq_enable();
+
+    // Line might have been unregistered or registered again for interrupt context meanwhile
+    if ((EXTI->IMR & mask) != 0 && _twr_exti[pin].deferred)
+    {
+        _twr_exti[pin].callback(_twr_exti[pin].line, _twr_exti[pin].param);
+    }
+}
+
 static inline void _twr_exti_irq_handler(void)
 {
-    // Determine source of interrupt and call appropriate callback
-    if ((EXTI->PR & 0x0001) != 0) { EXTI->PR = 0x0001; _twr_exti[0].callback(_twr_exti[0].line, _twr_exti[0].param); return; }
-    if ((EXTI->PR & 0x0002) != 0) { EXTI->PR = 0x0002; _twr_exti[1].callback(_twr_exti[1].line, _twr_exti[1].param); return; }
-    if ((EXTI->PR & 0x0004) != 0) { EXTI->PR = 0x0004; _twr_exti[2].callback(_twr_exti[2].line, _twr_exti[2].param); return; }
-    if ((EXTI->PR & 0x0008) != 0) { EXTI->PR = 0x0008; _twr_exti[3].callback(_twr_exti[3].line, _twr_exti[3].param); return; }
-    if ((EXTI->PR & 0x0010) != 0) { EXTI->PR = 0x0010; _twr_exti[4].callback(_twr_exti[4].line, _twr_exti[4].param); return; }
-    if ((EXTI->PR & 0x0020) != 0) { EXTI->PR = 0x0020; _twr_exti[5].callback(_twr_exti[5].line, _twr_exti[5].param); return; }
-    if ((EXTI->PR & 0x0040) != 0) { EXTI->PR = 0x0040; _twr_exti[6].callback(_twr_exti[6].line, _twr_exti[6].param); return; }
-    if ((EXTI->PR & 0x0080) != 0) { EXTI->PR = 0x0080; _twr_exti[7].callback(_twr_exti[7].line, _twr_exti[7].param); return; }
-    if ((EXTI->PR & 0x0100) != 0) { EXTI->PR = 0x0100; _twr_exti[8].callback(_twr_exti[8].line, _twr_exti[8].param); return; }
-    if ((EXTI->PR & 0x0200) != 0) { EXTI->PR = 0x0200; _twr_exti[9].callback(_twr_exti[9].line, _twr_exti[9].param); return; }
-    if ((EXTI->PR & 0x0400) != 0) { EXTI->PR = 0x0400; _twr_exti[10].callback(_twr_exti[10].line, _twr_exti[10].param); return; }
-    if ((EXTI->PR & 0x0800) != 0) { EXTI->PR = 0x0800; _twr_exti[11].callback(_twr_exti[11].line, _twr_exti[11].param); return; }
-    if ((EXTI->PR & 0x1000) != 0) { EXTI->PR = 0x1000; _twr_exti[12].callback(_twr_exti[12].line, _twr_exti[12].param); return; }
-    if ((EXTI->PR & 0x2000) != 0) { EXTI->PR = 0x2000; _twr_exti[13].callback(_twr_exti[13].line, _twr_exti[13].param); return; }
-    if ((EXTI->PR & 0x4000) != 0) { EXTI->PR = 0x4000; _twr_exti[14].callback(_twr_exti[14].line, _twr_exti[14].param); return; }
-    if ((EXTI->PR & 0x8000) != 0) { EXTI->PR = 0x8000; _twr_exti[15].callback(_twr_exti[15].line, _twr_exti[15].param); return; }
+    uint16_t pr = EXTI->PR & EXTI->IMR & 0xffff;
+
+    if (pr == 0)
+    {
+        return;
+    }
+
+    uint8_t pin = 0;
+
+    // Lowest pending line is served first, the others raise interrupt again
+    while ((pr & (1 << pin)) == 0)
+    {
+        pin++;
+    }
+
+    uint16_t mask = 1 << pin;
+
+    EXTI->PR = mask;
+
+    if (!_twr_exti[pin].deferred)
+    {
+        _twr_exti[pin].callback(_twr_exti[pin].line, _twr_exti[pin].param);
+
+        return;
+    }
+
+    // Edges are coalesced until callback is run
+    if ((_twr_exti_defer.pending & mask) == 0)
+    {
+        _twr_exti_defer.pending |= mask;
+
+        twr_defer_irq_push(&_twr_exti_defer.defer, &pin);
+    }
 }
 
 void EXTI0_1_IRQHandler(void)
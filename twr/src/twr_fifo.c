@@ -1,5 +1,9 @@
 #include <twr_fifo.h>
-#include <twr_irq.h>
+#include <stm32l0xx.h>
+
+// Writer only moves head and reader only moves tail, each of them reads the other position once per call,
+// so they can run in task and interrupt without masking interrupts. Data are copied by at most two memcpy,
+// the second one takes the part which wraps around to start of buffer.
 
 void twr_fifo_init(twr_fifo_t *fifo, void *buffer, size_t size)
 {
@@ -17,154 +21,157 @@ void twr_fifo_purge(twr_fifo_t *fifo)
 
 size_t twr_fifo_write(twr_fifo_t *fifo, const void *buffer, size_t length)
 {
-    // Disable interrupts
-    twr_irq_disable();
-
-    // For each byte in buffer...
-    for (size_t i = 0; i < length; i++)
-    {
-        if ((fifo->head + 1) == fifo->tail)
-        {
-            // Enable interrupts
-            twr_irq_enable();
+    size_t head = fifo->head;
+    size_t tail = fifo->tail;
 
-            // Return number of bytes written
-            return i;
-        }
+    // Reader may free more space meanwhile, it is used by the next call
+    size_t space = (tail > head ? tail - head : fifo->size - head + tail) - 1;
 
-        if (((fifo->head + 1) == fifo->size) && (fifo->tail == 0))
-        {
-            // Enable interrupts
-            twr_irq_enable();
+    if (length > space)
+    {
+        length = space;
+    }
 
-            // Return number of bytes written
-            return i;
-        }
+    size_t first = fifo->size - head;
 
-        *((uint8_t *) fifo->buffer + fifo->head) = *(uint8_t *) buffer;
+    if (first > length)
+    {
+        first = length;
+    }
 
-        buffer = (uint8_t *) buffer + 1;
+    memcpy((uint8_t *) fifo->buffer + head, buffer, first);
+    memcpy(fifo->buffer, (const uint8_t *) buffer + first, length - first);
 
-        fifo->head++;
+    head += length;
 
-        if (fifo->head == fifo->size)
-        {
-            fifo->head = 0;
-        }
+    if (head >= fifo->size)
+    {
+        head -= fifo->size;
     }
 
-    // Enable interrupts
-    twr_irq_enable();
+    // Data must be complete before they are published to reader
+    __DMB();
+
+    fifo->head = head;
 
-    // Return number of bytes written
     return length;
 }
 
 size_t twr_fifo_read(twr_fifo_t *fifo, void *buffer, size_t length)
 {
-    // Disable interrupts
-    twr_irq_disable();
+    size_t head = fifo->head;
+    size_t tail = fifo->tail;
+
+    // Data must not be read before head which publishes them
+    __DMB();
 
-    // For desired number of bytes...
-    for (size_t i = 0; i < length; i++)
+    size_t available = head >= tail ? head - tail : fifo->size - tail + head;
+
+    if (length > available)
     {
-        if (fifo->tail != fifo->head)
-        {
-            *(uint8_t *) buffer = *((uint8_t *) fifo->buffer + fifo->tail);
-
-            buffer = (uint8_t *) buffer + 1;
-
-            fifo->tail++;
-
-            if (fifo->tail == fifo->size)
-            {
-                fifo->tail = 0;
-            }
-        }
-        else
-        {
-            // Enable interrupts
-            twr_irq_enable();
-
-            // Return number of bytes read
-            return i;
-        }
+        length = available;
     }
 
-    // Enable interrupts
-    twr_irq_enable();
+    size_t first = fifo->size - tail;
+
+    if (first > length)
+    {
+        first = length;
+    }
+
+    memcpy(buffer, (uint8_t *) fifo->buffer + tail, first);
+    memcpy((uint8_t *) buffer + first, fifo->buffer, length - first);
+
+    tail += length;
+
+    if (tail >= fifo->size)
+    {
+        tail -= fifo->size;
+    }
+
+    // Space must not be reused by writer before data are read
+    __DMB();
+
+    fifo->tail = tail;
 
-    // Return number of bytes read
     return length;
 }
 
 size_t twr_fifo_irq_write(twr_fifo_t *fifo, const void *buffer, size_t length)
 {
-    for (size_t i = 0; i < length; i++)
-    {
-        if ((fifo->head + 1) == fifo->tail)
-        {
-            // Return number of bytes written
-            return i;
-        }
+    return twr_fifo_write(fifo, buffer, length);
+}
 
-        if (((fifo->head + 1) == fifo->size) && (fifo->tail == 0))
-        {
-            // Return number of bytes written
-            return i;
-        }
+size_t twr_fifo_irq_read(twr_fifo_t *fifo, void *buffer, size_t length)
+{
+    return twr_fifo_read(fifo, buffer, length);
+}
+
+bool twr_fifo_is_empty(twr_fifo_t *fifo)
+{
+    return fifo->tail == fifo->head;
+}
+
+size_t twr_fifo_get_free(twr_fifo_t *fifo)
+{
+    size_t head = fifo->head;
+    size_t tail = fifo->tail;
 
-        *((uint8_t *) fifo->buffer + fifo->head) = *(uint8_t *) buffer;
+    return (tail > head ? tail - head : fifo->size - head + tail) - 1;
+}
 
-        buffer = (uint8_t *) buffer + 1;
+size_t twr_fifo_get_write_span(twr_fifo_t *fifo, void **buffer)
+{
+    size_t head = fifo->head;
+    size_t tail = fifo->tail;
 
-        fifo->head++;
+    *buffer = (uint8_t *) fifo->buffer + head;
 
-        if (fifo->head == fifo->size)
-        {
-            fifo->head = 0;
-        }
+    if (tail > head)
+    {
+        return tail - head - 1;
     }
 
-    // Return number of bytes written
-    return length;
+    // Span may reach end of buffer unless tail sits at its start, then the last byte is left free
+    return fifo->size - head - (tail == 0 ? 1 : 0);
 }
 
-size_t twr_fifo_irq_read(twr_fifo_t *fifo, void *buffer, size_t length)
+void twr_fifo_commit_write(twr_fifo_t *fifo, size_t length)
 {
-    for (size_t i = 0; i < length; i++)
+    size_t head = fifo->head + length;
+
+    if (head >= fifo->size)
     {
-        if (fifo->tail != fifo->head)
-        {
-            *(uint8_t *) buffer = *((uint8_t *) fifo->buffer + fifo->tail);
-
-            buffer = (uint8_t *) buffer + 1;
-
-            fifo->tail++;
-
-            if (fifo->tail == fifo->size)
-            {
-                fifo->tail = 0;
-            }
-        }
-        else
-        {
-            // Return number of bytes read
-            return i;
-        }
+        head -= fifo->size;
     }
 
-    // Return number of bytes read
-    return length;
+    __DMB();
+
+    fifo->head = head;
 }
 
-bool twr_fifo_is_empty(twr_fifo_t *fifo)
+size_t twr_fifo_get_read_span(twr_fifo_t *fifo, void **buffer)
+{
+    size_t head = fifo->head;
+    size_t tail = fifo->tail;
+
+    __DMB();
+
+    *buffer = (uint8_t *) fifo->buffer + tail;
+
+    return head >= tail ? head - tail : fifo->size - tail;
+}
+
+void twr_fifo_commit_read(twr_fifo_t *fifo, size_t length)
 {
-    twr_irq_disable();
+    size_t tail = fifo->tail + length;
 
-	bool result = fifo->tail == fifo->head;
+    if (tail >= fifo->size)
+    {
+        tail -= fifo->size;
+    }
 
-	twr_irq_enable();
+    __DMB();
 
-	return result;
+    fifo->tail = tail;
 }
@@ -4,6 +4,7 @@
 
 static uint32_t _twr_led_strip_wheel(int position);
 static void _twr_led_strip_get_heat_map_color(float value, float *red, float *green, float *blue);
+static bool _twr_led_strip_is_ready_or_wait(twr_led_strip_t *self);
 
 void twr_led_strip_init(twr_led_strip_t *self, const twr_led_strip_driver_t *driver, const twr_led_strip_buffer_t *buffer)
 {
@@ -135,14 +136,31 @@ static void _twr_led_strip_effect_done(twr_led_strip_t *self)
     }
 }
 
-static void _twr_led_strip_effect_test_task(void *param)
+static bool _twr_led_strip_is_ready_or_wait(twr_led_strip_t *self)
 {
-    twr_led_strip_t *self = (twr_led_strip_t *)param;
+    if (self->_driver->is_ready())
+    {
+        return true;
+    }
 
-    if (!self->_driver->is_ready())
+    if (self->_driver->wait_ready != NULL)
+    {
+        self->_driver->wait_ready();
+    }
+    else
     {
         twr_scheduler_plan_current_now();
+    }
 
+    return false;
+}
+
+static void _twr_led_strip_effect_test_task(void *param)
+{
+    twr_led_strip_t *self = (twr_led_strip_t *)param;
+
+    if (!_twr_led_strip_is_ready_or_wait(self))
+    {
         return;
     }
 
@@ -213,10 +231,8 @@ static void _twr_led_strip_effect_rainbow_task(void *param)
 {
     twr_led_strip_t *self = (twr_led_strip_t *)param;
 
-    if (!self->_driver->is_ready())
+    if (!_twr_led_strip_is_ready_or_wait(self))
     {
-        twr_scheduler_plan_current_now();
-
         return;
     }
 
@@ -245,10 +261,8 @@ static void _twr_led_strip_effect_rainbow_cycle_task(void *param)
 {
     twr_led_strip_t *self = (twr_led_strip_t *)param;
 
-    if (!self->_driver->is_ready())
+    if (!_twr_led_strip_is_ready_or_wait(self))
     {
-        twr_scheduler_plan_current_now();
-
         return;
     }
 
@@ -277,10 +291,8 @@ static void _twr_led_strip_effect_color_wipe_task(void *param)
 {
     twr_led_strip_t *self = (twr_led_strip_t *)param;
 
-    if (!self->_driver->is_ready())
+    if (!_twr_led_strip_is_ready_or_wait(self))
     {
-        twr_scheduler_plan_current_now();
-
         return;
     }
 
@@ -313,10 +325,8 @@ static void _twr_led_strip_effect_theater_chase_task(void *param)
 {
     twr_led_strip_t *self = (twr_led_strip_t *)param;
 
-    if (!self->_driver->is_ready())
+    if (!_twr_led_strip_is_ready_or_wait(self))
     {
-        twr_scheduler_plan_current_now();
-
         return;
     }
 
@@ -357,10 +367,8 @@ static void _twr_led_strip_effect_theater_chase_rainbow_task(void *param)
 {
     twr_led_strip_t *self = (twr_led_strip_t *)param;
 
-    if (!self->_driver->is_ready())
+    if (!_twr_led_strip_is_ready_or_wait(self))
     {
-        twr_scheduler_plan_current_now();
-
         return;
     }
 
@@ -402,10 +410,8 @@ static void twr_led_strip_effect_stroboscope_task(void *param)
 {
     twr_led_strip_t *self = (twr_led_strip_t *)param;
 
-    if (!self->_driver->is_ready())
+    if (!_twr_led_strip_is_ready_or_wait(self))
     {
-        twr_scheduler_plan_current_now();
-
         return;
     }
 
@@ -437,10 +443,8 @@ void _twr_led_strip_effect_icicle_task(void *param)
 {
     twr_led_strip_t *self = (twr_led_strip_t *)param;
 
-    if (!self->_driver->is_ready())
+    if (!_twr_led_strip_is_ready_or_wait(self))
     {
-        twr_scheduler_plan_current_now();
-
         return;
     }
 
@@ -513,10 +517,8 @@ static void _twr_led_strip_effect_pulse_color_task(void *param)
 {
     twr_led_strip_t *self = (twr_led_strip_t *)param;
 
-    if (!self->_driver->is_ready())
+    if (!_twr_led_strip_is_ready_or_wait(self))
     {
-        twr_scheduler_plan_current_now();
-
         return;
     }
 
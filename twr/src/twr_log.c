@@ -1,5 +1,25 @@
 #include <twr_log.h>
 #include <twr_error.h>
+#include <twr_scheduler.h>
+
+// Messages are formatted by caller and queued in FIFO, low priority task transmits them straight from FIFO
+// by async write, so caller does not wait for UART. Message which does not fit in FIFO as a whole is dropped
+// and counted, count is logged ahead of the next message which fits.
+
+#define _TWR_LOG_RETRY_INTERVAL 10
+
+// Frame of tokenized log starts with header byte, which holds level in bits 0-2, timestamp in bits 3-4 (0 off,
+// 1 absolute, 2 relative) and flag of overflow record in bit 7. Token, tick and arguments follow as varints
+// (signed ones zigzag encoded), floats as 4 bytes and strings with dump data as length and bytes.
+// Frames are COBS encoded and delimited by zero byte.
+
+#define _TWR_LOG_TOKEN_TYPE_INT32 0
+#define _TWR_LOG_TOKEN_TYPE_INT64 1
+#define _TWR_LOG_TOKEN_TYPE_FLOAT 2
+#define _TWR_LOG_TOKEN_HEADER_TIMESTAMP_ABS (1 << 3)
+#define _TWR_LOG_TOKEN_HEADER_TIMESTAMP_REL (2 << 3)
+#define _TWR_LOG_TOKEN_HEADER_OVERFLOW 0x80
+#define _TWR_LOG_TOKEN_FRAME_LENGTH(length) ((length) + (length) / 254 + 2)
 
 typedef struct
 {
@@ -8,6 +28,11 @@ typedef struct
     twr_log_timestamp_t timestamp;
     twr_tick_t tick_last;
     char buffer[TWR_LOG_BUFFER_SIZE];
+    twr_fifo_t fifo;
+    uint8_t fifo_buffer[TWR_LOG_FIFO_SIZE];
+    size_t length_in_progress;
+    uint32_t overflow;
+    twr_scheduler_task_id_t task_id;
 
 } twr_log_t;
 
@@ -17,7 +42,26 @@ static twr_log_t _twr_log = { .initialized = false };
 
 void application_error(twr_error_t code);
 
+#if TWR_LOG_TOKEN
+
+extern const char __start_twr_log_fmt[];
+
+static bool _twr_log_token_put(size_t *offset, const void *data, size_t length);
+static bool _twr_log_token_put_varint(size_t *offset, uint64_t value);
+static bool _twr_log_token_put_bytes(size_t *offset, const void *data, size_t length);
+static size_t _twr_log_token_varint(uint8_t *buffer, uint64_t value);
+static void _twr_log_token_push(size_t length);
+static void _twr_log_token_write(const uint8_t *payload, size_t length);
+
+#else
+
 static void _twr_log_message(twr_log_level_t level, char id, const char *format, va_list ap);
+static void _twr_log_push(const char *buffer, size_t length);
+
+#endif
+
+static void _twr_log_task(void *param);
+static void _twr_log_uart_done_handler(twr_uart_channel_t channel, void *param);
 
 void twr_log_init(twr_log_level_t level, twr_log_timestamp_t timestamp)
 {
@@ -31,12 +75,284 @@ void twr_log_init(twr_log_level_t level, twr_log_timestamp_t timestamp)
     _twr_log.level = level;
     _twr_log.timestamp = timestamp;
 
+    twr_fifo_init(&_twr_log.fifo, _twr_log.fifo_buffer, sizeof(_twr_log.fifo_buffer));
+
     twr_uart_init(TWR_LOG_UART, TWR_UART_BAUDRATE_115200, TWR_UART_SETTING_8N1);
+
+#if TWR_LOG_TOKEN
+    // Delimiter lets decoder drop whatever it has received so far
+    twr_uart_write(TWR_LOG_UART, "", 1);
+#else
     twr_uart_write(TWR_LOG_UART, "\r\n", 2);
+#endif
 
     _twr_log.initialized = true;
+
+    _twr_log.task_id = twr_scheduler_register_ex(_twr_log_task, NULL, TWR_TICK_INFINITY, TWR_SCHEDULER_PRIORITY_LOW);
+}
+
+void twr_log_flush(void)
+{
+    if (!_twr_log.initialized)
+    {
+        return;
+    }
+
+    // Message being transmitted is completed by UART itself
+    if (_twr_log.length_in_progress != 0)
+    {
+        twr_uart_flush(TWR_LOG_UART);
+
+        twr_fifo_commit_read(&_twr_log.fifo, _twr_log.length_in_progress);
+
+        _twr_log.length_in_progress = 0;
+    }
+
+    void *buffer;
+    size_t length;
+
+    while ((length = twr_fifo_get_read_span(&_twr_log.fifo, &buffer)) != 0)
+    {
+        twr_uart_write(TWR_LOG_UART, buffer, length);
+
+        twr_fifo_commit_read(&_twr_log.fifo, length);
+    }
+}
+
+#if TWR_LOG_TOKEN
+
+void _twr_log_token(twr_log_level_t level, const void *entry, const void *buffer, size_t length, uint32_t types, ...)
+{
+    if (!_twr_log.initialized)
+    {
+        application_error(TWR_ERROR_LOG_NOT_INITIALIZED);
+    }
+
+    if (_twr_log.level > level)
+    {
+        return;
+    }
+
+    size_t offset = 0;
+    uint8_t header = level;
+    twr_tick_t tick_now = twr_tick_get();
+
+    if (_twr_log.timestamp == TWR_LOG_TIMESTAMP_ABS)
+    {
+        header |= _TWR_LOG_TOKEN_HEADER_TIMESTAMP_ABS;
+    }
+    else if (_twr_log.timestamp == TWR_LOG_TIMESTAMP_REL)
+    {
+        header |= _TWR_LOG_TOKEN_HEADER_TIMESTAMP_REL;
+    }
+
+    _twr_log_token_put(&offset, &header, 1);
+
+    // Entries sit in section starting at zero on target, so token is offset of entry in dictionary
+    _twr_log_token_put_varint(&offset, (uintptr_t) entry - (uintptr_t) __start_twr_log_fmt);
+
+    if (_twr_log.timestamp == TWR_LOG_TIMESTAMP_ABS)
+    {
+        _twr_log_token_put_varint(&offset, tick_now);
+    }
+    else if (_twr_log.timestamp == TWR_LOG_TIMESTAMP_REL)
+    {
+        _twr_log_token_put_varint(&offset, tick_now - _twr_log.tick_last);
+
+        _twr_log.tick_last = tick_now;
+    }
+
+    va_list ap;
+
+    va_start(ap, types);
+
+    for (uint32_t i = 0; i < (types & 0x0f); i++)
+    {
+        uint32_t type = (types >> (4 + 2 * i)) & 0x03;
+        bool ok;
+
+        if (type == _TWR_LOG_TOKEN_TYPE_INT32)
+        {
+            int32_t value = va_arg(ap, int);
+
+            ok = _twr_log_token_put_varint(&offset, ((uint32_t) value << 1) ^ (uint32_t) (value >> 31));
+        }
+        else if (type == _TWR_LOG_TOKEN_TYPE_INT64)
+        {
+            int64_t value = va_arg(ap, long long);
+
+            ok = _twr_log_token_put_varint(&offset, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+        }
+        else if (type == _TWR_LOG_TOKEN_TYPE_FLOAT)
+        {
+            float value = va_arg(ap, double);
+
+            ok = _twr_log_token_put(&offset, &value, sizeof(value));
+        }
+        else
+        {
+            const char *string = va_arg(ap, const char *);
+
+            if (string == NULL)
+            {
+                string = "(null)";
+            }
+
+            ok = _twr_log_token_put_bytes(&offset, string, strlen(string));
+        }
+
+        // Decoder shows arguments which did not fit as missing
+        if (!ok)
+        {
+            break;
+        }
+    }
+
+    va_end(ap);
+
+    if (level == TWR_LOG_LEVEL_DUMP)
+    {
+        _twr_log_token_put_bytes(&offset, buffer, buffer != NULL ? length : 0);
+    }
+
+    _twr_log_token_push(offset);
+}
+
+static bool _twr_log_token_put(size_t *offset, const void *data, size_t length)
+{
+    if (*offset + length > sizeof(_twr_log.buffer))
+    {
+        return false;
+    }
+
+    memcpy(_twr_log.buffer + *offset, data, length);
+
+    *offset += length;
+
+    return true;
+}
+
+static bool _twr_log_token_put_varint(size_t *offset, uint64_t value)
+{
+    uint8_t buffer[10];
+
+    return _twr_log_token_put(offset, buffer, _twr_log_token_varint(buffer, value));
+}
+
+static bool _twr_log_token_put_bytes(size_t *offset, const void *data, size_t length)
+{
+    // Data are cut to fit, length takes at most 2 bytes
+    if (*offset + 2 > sizeof(_twr_log.buffer))
+    {
+        return false;
+    }
+
+    if (length > sizeof(_twr_log.buffer) - *offset - 2)
+    {
+        length = sizeof(_twr_log.buffer) - *offset - 2;
+    }
+
+    return _twr_log_token_put_varint(offset, length) && _twr_log_token_put(offset, data, length);
+}
+
+static size_t _twr_log_token_varint(uint8_t *buffer, uint64_t value)
+{
+    size_t length = 0;
+
+    do
+    {
+        buffer[length] = value & 0x7f;
+
+        value >>= 7;
+
+        if (value != 0)
+        {
+            buffer[length] |= 0x80;
+        }
+
+        length++;
+    }
+    while (value != 0);
+
+    return length;
 }
 
+static void _twr_log_token_push(size_t length)
+{
+    if (_twr_log.overflow != 0)
+    {
+        uint8_t notice[1 + 10];
+
+        notice[0] = _TWR_LOG_TOKEN_HEADER_OVERFLOW | TWR_LOG_LEVEL_WARNING;
+
+        size_t notice_length = 1 + _twr_log_token_varint(notice + 1, _twr_log.overflow);
+
+        if (twr_fifo_get_free(&_twr_log.fifo) < _TWR_LOG_TOKEN_FRAME_LENGTH(notice_length) + _TWR_LOG_TOKEN_FRAME_LENGTH(length))
+        {
+            _twr_log.overflow++;
+
+            return;
+        }
+
+        _twr_log_token_write(notice, notice_length);
+
+        _twr_log.overflow = 0;
+    }
+    else if (twr_fifo_get_free(&_twr_log.fifo) < _TWR_LOG_TOKEN_FRAME_LENGTH(length))
+    {
+        _twr_log.overflow++;
+
+        return;
+    }
+
+    _twr_log_token_write((const uint8_t *) _twr_log.buffer, length);
+
+    twr_scheduler_plan_now(_twr_log.task_id);
+}
+
+static void _twr_log_token_write(const uint8_t *payload, size_t length)
+{
+    size_t start = 0;
+    size_t i = 0;
+
+    // Every block of COBS goes as code byte, which is its length plus one, and its bytes other than zero,
+    // zero which ends block is left out, block of 254 bytes is not ended by zero
+    while (true)
+    {
+        if ((i - start == 254) || (i == length) || (payload[i] == 0))
+        {
+            uint8_t code = i - start + 1;
+
+            twr_fifo_write(&_twr_log.fifo, &code, 1);
+            twr_fifo_write(&_twr_log.fifo, payload + start, i - start);
+
+            if (code == 0xff)
+            {
+                start = i;
+
+                continue;
+            }
+
+            if (i == length)
+            {
+                break;
+            }
+
+            start = ++i;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    uint8_t delimiter = 0;
+
+    twr_fifo_write(&_twr_log.fifo, &delimiter, 1);
+}
+
+#else
+
 void twr_log_dump(const void *buffer, size_t length, const char *format, ...)
 {
     va_list ap;
@@ -70,7 +386,7 @@ void twr_log_dump(const void *buffer, size_t length, const char *format, ...)
     {
         for (position = 0; position < length; position += TWR_LOG_DUMP_WIDTH)
         {
-            offset = offset_base + snprintf(_twr_log.buffer + offset_base, sizeof(_twr_log.buffer) - offset_base, "%3d: ", position);
+            offset = offset_base + snprintf(_twr_log.buffer + offset_base, sizeof(_twr_log.buffer) - offset_base, "%3d: ", (int) position);
 
             char *ptr_hex = _twr_log.buffer + offset;
 
@@ -135,7 +451,7 @@ void twr_log_dump(const void *buffer, size_t length, const char *format, ...)
             _twr_log.buffer[offset++] = '\r';
             _twr_log.buffer[offset++] = '\n';
 
-            twr_uart_write(TWR_LOG_UART, _twr_log.buffer, offset);
+            _twr_log_push(_twr_log.buffer, offset);
         }
     }
 }
@@ -196,7 +512,7 @@ static void _twr_log_message(twr_log_level_t level, char id, const char *format,
 
         uint32_t timestamp_abs = tick_now / 10;
 
-        offset = sprintf(_twr_log.buffer, "# %lu.%02lu <%c> ", timestamp_abs / 100, timestamp_abs % 100, id);
+        offset = sprintf(_twr_log.buffer, "# %" PRIu32 ".%02" PRIu32 " <%c> ", timestamp_abs / 100, timestamp_abs % 100, id);
     }
     else if (_twr_log.timestamp == TWR_LOG_TIMESTAMP_REL)
     {
@@ -204,7 +520,7 @@ static void _twr_log_message(twr_log_level_t level, char id, const char *format,
 
         uint32_t timestamp_rel = (tick_now - _twr_log.tick_last) / 10;
 
-        offset = sprintf(_twr_log.buffer, "# +%lu.%02lu <%c> ", timestamp_rel / 100, timestamp_rel % 100, id);
+        offset = sprintf(_twr_log.buffer, "# +%" PRIu32 ".%02" PRIu32 " <%c> ", timestamp_rel / 100, timestamp_rel % 100, id);
 
         _twr_log.tick_last = tick_now;
     }
@@ -230,7 +546,87 @@ static void _twr_log_message(twr_log_level_t level, char id, const char *format,
     _twr_log.buffer[offset++] = '\r';
     _twr_log.buffer[offset++] = '\n';
 
-    twr_uart_write(TWR_LOG_UART, _twr_log.buffer, offset);
+    _twr_log_push(_twr_log.buffer, offset);
+}
+
+static void _twr_log_push(const char *buffer, size_t length)
+{
+    if (_twr_log.overflow != 0)
+    {
+        char notice[40];
+
+        size_t notice_length = snprintf(notice, sizeof(notice), "# <W> %" PRIu32 " messages dropped\r\n", _twr_log.overflow);
+
+        if (twr_fifo_get_free(&_twr_log.fifo) < notice_length + length)
+        {
+            _twr_log.overflow++;
+
+            return;
+        }
+
+        twr_fifo_write(&_twr_log.fifo, notice, notice_length);
+
+        _twr_log.overflow = 0;
+    }
+    else if (twr_fifo_get_free(&_twr_log.fifo) < length)
+    {
+        _twr_log.overflow++;
+
+        return;
+    }
+
+    twr_fifo_write(&_twr_log.fifo, buffer, length);
+
+    twr_scheduler_plan_now(_twr_log.task_id);
+}
+
+#endif
+
+static void _twr_log_task(void *param)
+{
+    (void) param;
+
+    if (_twr_log.length_in_progress != 0)
+    {
+        return;
+    }
+
+    void *buffer;
+
+    size_t length = twr_fifo_get_read_span(&_twr_log.fifo, &buffer);
+
+    if (length == 0)
+    {
+        return;
+    }
+
+    twr_uart_segment_t segment = { .buffer = buffer, .length = length };
+
+    if (!twr_uart_async_writev(TWR_LOG_UART, &segment, 1, _twr_log_uart_done_handler, NULL))
+    {
+        // Someone else writes to UART asynchronously
+        twr_scheduler_plan_current_relative(_TWR_LOG_RETRY_INTERVAL);
+
+        return;
+    }
+
+    _twr_log.length_in_progress = length;
+}
+
+static void _twr_log_uart_done_handler(twr_uart_channel_t channel, void *param)
+{
+    (void) channel;
+    (void) param;
+
+    // Message might have been completed by twr_log_flush already
+    if (_twr_log.length_in_progress != 0)
+    {
+        twr_fifo_commit_read(&_twr_log.fifo, _twr_log.length_in_progress);
+
+        _twr_log.length_in_progress = 0;
+    }
+
+    twr_scheduler_plan_now(_twr_log.task_id);
 }
 
 #endif
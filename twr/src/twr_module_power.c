@@ -30,7 +30,8 @@ const twr_led_strip_driver_t twr_module_power_led_strip_driver =
     .write = twr_ws2812b_write,
     .set_pixel = twr_ws2812b_set_pixel_from_uint32,
     .set_pixel_rgbw = twr_ws2812b_set_pixel_from_rgb,
-    .is_ready = twr_ws2812b_is_ready
+    .is_ready = twr_ws2812b_is_ready,
+    .wait_ready = twr_ws2812b_wait_ready
 };
 
 #else
@@ -41,7 +42,8 @@ const twr_led_strip_driver_t twr_module_power_led_strip_driver =
     .write = twr_ws2812b_write,
     .set_pixel = twr_ws2812b_set_pixel_from_uint32_swap_rg,
     .set_pixel_rgbw = twr_ws2812b_set_pixel_from_rgb_swap_rg,
-    .is_ready = twr_ws2812b_is_ready
+    .is_ready = twr_ws2812b_is_ready,
+    .wait_ready = twr_ws2812b_wait_ready
 };
 
 #endif
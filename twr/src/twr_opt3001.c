@@ -107,105 +107,53 @@ static void _twr_opt3001_task_measure(void *param)
 {
     twr_opt3001_t *self = param;
 
-start:
+    uint16_t reg_configuration;
 
-    switch (self->_state)
-    {
-        case TWR_OPT3001_STATE_ERROR:
-        {
-            self->_illuminance_valid = false;
-
-            self->_measurement_active = false;
+    TWR_COROUTINE_BEGIN(&self->_coroutine);
 
-            if (self->_event_handler != NULL)
-            {
-                self->_event_handler(self, TWR_OPT3001_EVENT_ERROR, self->_event_param);
-            }
+    TWR_COROUTINE_TRY_I2C(&self->_coroutine, twr_i2c_memory_write_16b(self->_i2c_channel, self->_i2c_address, 0x01, 0xc810));
 
-            self->_state = TWR_OPT3001_STATE_INITIALIZE;
+    self->_tick_ready = twr_tick_get() + _TWR_OPT3001_DELAY_INITIALIZATION;
 
-            return;
-        }
-        case TWR_OPT3001_STATE_INITIALIZE:
-        {
-            self->_state = TWR_OPT3001_STATE_ERROR;
+    while (true)
+    {
+        TWR_AWAIT_EVENT(&self->_coroutine, self->_measurement_active);
 
-            if (!twr_i2c_memory_write_16b(self->_i2c_channel, self->_i2c_address, 0x01, 0xc810))
-            {
-                goto start;
-            }
+        TWR_AWAIT_TICK(&self->_coroutine, self->_tick_ready);
 
-            self->_state = TWR_OPT3001_STATE_MEASURE;
+        TWR_COROUTINE_TRY_I2C(&self->_coroutine, twr_i2c_memory_write_16b(self->_i2c_channel, self->_i2c_address, 0x01, 0xca10));
 
-            self->_tick_ready = twr_tick_get() + _TWR_OPT3001_DELAY_INITIALIZATION;
+        TWR_AWAIT_MS(&self->_coroutine, _TWR_OPT3001_DELAY_MEASUREMENT);
 
-            if (self->_measurement_active)
-            {
-                twr_scheduler_plan_current_absolute(self->_tick_ready);
-            }
+        TWR_COROUTINE_TRY_I2C(&self->_coroutine, twr_i2c_memory_read_16b(self->_i2c_channel, self->_i2c_address, 0x01, &reg_configuration));
 
-            return;
-        }
-        case TWR_OPT3001_STATE_MEASURE:
+        if ((reg_configuration & 0x0680) != 0x0080)
         {
-            self->_state = TWR_OPT3001_STATE_ERROR;
-
-            if (!twr_i2c_memory_write_16b(self->_i2c_channel, self->_i2c_address, 0x01, 0xca10))
-            {
-                goto start;
-            }
-
-            self->_state = TWR_OPT3001_STATE_READ;
-
-            twr_scheduler_plan_current_from_now(_TWR_OPT3001_DELAY_MEASUREMENT);
-
-            return;
+            TWR_COROUTINE_THROW(&self->_coroutine);
         }
-        case TWR_OPT3001_STATE_READ:
-        {
-            self->_state = TWR_OPT3001_STATE_ERROR;
 
-            uint16_t reg_configuration;
+        TWR_COROUTINE_TRY_I2C(&self->_coroutine, twr_i2c_memory_read_16b(self->_i2c_channel, self->_i2c_address, 0x00, &self->_reg_result));
 
-            if (!twr_i2c_memory_read_16b(self->_i2c_channel, self->_i2c_address, 0x01, &reg_configuration))
-            {
-                goto start;
-            }
+        self->_illuminance_valid = true;
 
-            if ((reg_configuration & 0x0680) != 0x0080)
-            {
-                goto start;
-            }
+        self->_measurement_active = false;
 
-            if (!twr_i2c_memory_read_16b(self->_i2c_channel, self->_i2c_address, 0x00, &self->_reg_result))
-            {
-                goto start;
-            }
-
-            self->_illuminance_valid = true;
-
-            self->_state = TWR_OPT3001_STATE_UPDATE;
-
-            goto start;
-        }
-        case TWR_OPT3001_STATE_UPDATE:
+        if (self->_event_handler != NULL)
         {
-            self->_measurement_active = false;
+            self->_event_handler(self, TWR_OPT3001_EVENT_UPDATE, self->_event_param);
+        }
+    }
 
-            if (self->_event_handler != NULL)
-            {
-                self->_event_handler(self, TWR_OPT3001_EVENT_UPDATE, self->_event_param);
-            }
+    TWR_COROUTINE_CATCH(&self->_coroutine);
 
-            self->_state = TWR_OPT3001_STATE_MEASURE;
+    self->_illuminance_valid = false;
 
-            return;
-        }
-        default:
-        {
-            self->_state = TWR_OPT3001_STATE_ERROR;
+    self->_measurement_active = false;
 
-            goto start;
-        }
+    if (self->_event_handler != NULL)
+    {
+        self->_event_handler(self, TWR_OPT3001_EVENT_ERROR, self->_event_param);
     }
+
+    TWR_COROUTINE_END(&self->_coroutine);
 }
@@ -1,5 +1,11 @@
 #include <twr_queue.h>
 
+// Items are stored as length followed by data and never wrap around the end of buffer, so they can be read in place.
+// Item that does not fit at the end is placed at the beginning and the rest of buffer is skipped, skipped space is
+// marked by zero length if there is room for it (empty items are never stored).
+
+static void _twr_queue_skip_padding(twr_queue_t *queue);
+
 void twr_queue_init(twr_queue_t *queue, void *buffer, size_t size)
 {
     memset(queue, 0, sizeof(*queue));
@@ -15,21 +21,45 @@ bool twr_queue_put(twr_queue_t *queue, const void *buffer, size_t length)
         return true;
     }
 
-    if (sizeof(length) + length > queue->_size - queue->_length)
+    size_t item_size = sizeof(length) + length;
+
+    if (queue->_length == 0)
     {
-        return false;
+        queue->_head = 0;
+        queue->_tail = 0;
     }
 
-    uint8_t *p = queue->_buffer;
+    if ((queue->_tail > queue->_head) || (queue->_length == 0))
+    {
+        if (item_size > queue->_size - queue->_tail)
+        {
+            if (item_size > queue->_head)
+            {
+                return false;
+            }
+
+            size_t padding = queue->_size - queue->_tail;
+
+            if (padding >= sizeof(length))
+            {
+                memset((uint8_t *) queue->_buffer + queue->_tail, 0, sizeof(length));
+            }
+
+            queue->_length += padding;
+            queue->_tail = 0;
+        }
+    }
+    else if (item_size > queue->_head - queue->_tail)
+    {
+        return false;
+    }
 
-    p += queue->_length;
+    uint8_t *p = (uint8_t *) queue->_buffer + queue->_tail;
 
     memcpy(p, &length, sizeof(length));
 
     p += sizeof(length);
 
-    queue->_length += sizeof(length) + length;
-
     if (buffer != NULL)
     {
         memcpy(p, buffer, length);
@@ -39,35 +69,105 @@ bool twr_queue_put(twr_queue_t *queue, const void *buffer, size_t length)
         memset(p, 0, length);
     }
 
+    queue->_tail += item_size;
+    queue->_length += item_size;
+
     return true;
 }
 
 bool twr_queue_get(twr_queue_t *queue, void *buffer, size_t *length)
 {
-    if (queue->_length == 0)
+    void *item;
+
+    if (!twr_queue_peek_in_place(queue, &item, length))
     {
         return false;
     }
 
-    uint8_t *p = queue->_buffer;
+    if (buffer != NULL)
+    {
+        memcpy(buffer, item, *length);
+    }
 
-    memcpy(length, p, sizeof(*length));
+    twr_queue_consume(queue);
 
-    p += sizeof(*length);
+    return true;
+}
 
-    queue->_length -= sizeof(*length) + *length;
+bool twr_queue_peek(twr_queue_t *queue, void *buffer, size_t *length)
+{
+    void *item;
+
+    if (!twr_queue_peek_in_place(queue, &item, length))
+    {
+        return false;
+    }
 
     if (buffer != NULL)
     {
-        memcpy(buffer, p, *length);
+        memcpy(buffer, item, *length);
     }
 
-    memmove(queue->_buffer, p + *length, queue->_length);
+    return true;
+}
+
+bool twr_queue_peek_in_place(twr_queue_t *queue, void **item, size_t *length)
+{
+    if (queue->_length == 0)
+    {
+        return false;
+    }
+
+    uint8_t *p = (uint8_t *) queue->_buffer + queue->_head;
+
+    memcpy(length, p, sizeof(*length));
+
+    *item = p + sizeof(*length);
 
     return true;
 }
 
+void twr_queue_consume(twr_queue_t *queue)
+{
+    if (queue->_length == 0)
+    {
+        return;
+    }
+
+    size_t length;
+
+    memcpy(&length, (uint8_t *) queue->_buffer + queue->_head, sizeof(length));
+
+    queue->_head += sizeof(length) + length;
+    queue->_length -= sizeof(length) + length;
+
+    _twr_queue_skip_padding(queue);
+}
+
 void twr_queue_clear(twr_queue_t *queue)
 {
+    queue->_head = 0;
+    queue->_tail = 0;
     queue->_length = 0;
 }
+
+static void _twr_queue_skip_padding(twr_queue_t *queue)
+{
+    if (queue->_length == 0)
+    {
+        return;
+    }
+
+    size_t length = 0;
+
+    if (queue->_size - queue->_head >= sizeof(length))
+    {
+        memcpy(&length, (uint8_t *) queue->_buffer + queue->_head, sizeof(length));
+    }
+
+    if (length == 0)
+    {
+        queue->_length -= queue->_size - queue->_head;
+        queue->_head = 0;
+    }
+}
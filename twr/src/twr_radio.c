@@ -2,17 +2,118 @@
 #include <twr_queue.h>
 #include <twr_atsha204.h>
 #include <twr_scheduler.h>
+#include <twr_event_flags.h>
 #include <twr_eeprom.h>
 #include <twr_i2c.h>
 #include <twr_radio_pub.h>
 #include <twr_radio_node.h>
+#include <twr_crc.h>
+#include <twr_rng.h>
 #include <math.h>
 
 #define _TWR_RADIO_SCAN_CACHE_LENGTH	4
-#define _TWR_RADIO_ACK_TIMEOUT       100
+#define _TWR_RADIO_ACK_TIMEOUT       50
 #define _TWR_RADIO_SLEEP_RX_TIMEOUT  100
-#define _TWR_RADIO_TX_MAX_COUNT      6
 #define _TWR_RADIO_ACK_SUB_REQUEST   0x11
+#define _TWR_RADIO_ID_TIMEOUT        100
+// Gateway sends acknowledgement twice, the copy is over within this time
+#define _TWR_RADIO_ACK_REPEAT_TIME   15
+// Copies of wake-up burst are apart by pause for acknowledgement, sleeping node samples channel for longer than that
+// and once it senses carrier it listens long enough to catch the next copy from its start
+#define _TWR_RADIO_WAKE_ACK_TIMEOUT  15
+#define _TWR_RADIO_WAKE_SNIFF_TIME   25
+#define _TWR_RADIO_WAKE_RX_TIMEOUT   100
+
+#if TWR_RADIO_SECURITY
+// Gateway has no session key for node which sent the frame, node has to pair again
+#define _TWR_RADIO_ACK_REKEY         0x12
+// Pairing request and its acknowledgement carry random nonce of node and gateway, session key is derived from both
+#define _TWR_RADIO_PAIRING_NONCE_SIZE 4
+#define _TWR_RADIO_NONCE_DATA         0x00
+#define _TWR_RADIO_NONCE_PAIRING      0x01
+#define _TWR_RADIO_NONCE_PAIRING_ACK  0x02
+#define _TWR_RADIO_NONCE_ACK          0x03
+#define _TWR_RADIO_NONCE_CONTROL      0x04
+#define _TWR_RADIO_NONCE_CONTROL_ACK  0x05
+#define _TWR_RADIO_NONCE_REKEY        0x06
+// Attach and detach frames carry random nonce as they are authenticated by network key
+#define _TWR_RADIO_CONTROL_NONCE_SIZE 4
+// Attach and detach frames carry message id of the last frame sender has received from peer, detach is taken
+// only if it is the id of the last frame peer has sent, so that recorded one does not unpair it later
+#define _TWR_RADIO_CONTROL_MESSAGE_ID_SIZE 2
+#else
+#define _TWR_RADIO_PAIRING_NONCE_SIZE 0
+#define _TWR_RADIO_CONTROL_NONCE_SIZE 0
+#define _TWR_RADIO_CONTROL_MESSAGE_ID_SIZE 0
+#endif
+
+#define _TWR_RADIO_CONTROL_LENGTH (TWR_RADIO_HEAD_SIZE + 1 + TWR_RADIO_ID_SIZE + _TWR_RADIO_CONTROL_MESSAGE_ID_SIZE)
+
+#define _TWR_RADIO_FLAG_ID   (1 << 0)
+#define _TWR_RADIO_FLAG_IDLE (1 << 1)
+
+// Peer index is an open addressing hash table kept at most half full
+#if TWR_RADIO_MAX_DEVICES <= 4
+#define _TWR_RADIO_PEER_INDEX_BITS 3
+#elif TWR_RADIO_MAX_DEVICES <= 8
+#define _TWR_RADIO_PEER_INDEX_BITS 4
+#elif TWR_RADIO_MAX_DEVICES <= 16
+#define _TWR_RADIO_PEER_INDEX_BITS 5
+#elif TWR_RADIO_MAX_DEVICES <= 32
+#define _TWR_RADIO_PEER_INDEX_BITS 6
+#elif TWR_RADIO_MAX_DEVICES <= 64
+#define _TWR_RADIO_PEER_INDEX_BITS 7
+#elif TWR_RADIO_MAX_DEVICES <= 128
+#define _TWR_RADIO_PEER_INDEX_BITS 8
+#elif TWR_RADIO_MAX_DEVICES <= 256
+#define _TWR_RADIO_PEER_INDEX_BITS 9
+#elif TWR_RADIO_MAX_DEVICES <= 512
+#define _TWR_RADIO_PEER_INDEX_BITS 10
+#else
+#error "TWR_RADIO_MAX_DEVICES is limited to 512"
+#endif
+
+#define _TWR_RADIO_PEER_INDEX_SIZE (1 << _TWR_RADIO_PEER_INDEX_BITS)
+#define _TWR_RADIO_PEER_INDEX_MASK (_TWR_RADIO_PEER_INDEX_SIZE - 1)
+
+// Peer list is kept as a journal of 8 byte records in a ring at the end of EEPROM, below 8 byte header
+#define _TWR_RADIO_PEER_JOURNAL_MAGIC       0x324c5250
+#define _TWR_RADIO_PEER_JOURNAL_HEADER_SIZE 8
+#define _TWR_RADIO_PEER_JOURNAL_RECORD_SIZE 8
+#define _TWR_RADIO_PEER_JOURNAL_QUEUE_LENGTH 8
+#define _TWR_RADIO_PEER_JOURNAL_ADD    0xa1
+#define _TWR_RADIO_PEER_JOURNAL_REMOVE 0xa2
+#define _TWR_RADIO_PEER_JOURNAL_CLEAR  0xa3
+#define _TWR_RADIO_PEER_JOURNAL_LAP    0x08
+
+#if (TWR_RADIO_LINK_WINDOW < 1) || (TWR_RADIO_LINK_WINDOW > 255)
+#error "TWR_RADIO_LINK_WINDOW has to be from 1 to 255"
+#endif
+
+// Message id which jumps further than this is restart of node rather than lost messages
+#define _TWR_RADIO_LINK_GAP_MAX 1000
+
+#if TWR_RADIO_PEER_JOURNAL_LENGTH < TWR_RADIO_MAX_DEVICES + 2
+#error "TWR_RADIO_PEER_JOURNAL_LENGTH has to exceed TWR_RADIO_MAX_DEVICES at least by 2"
+#endif
+
+#if (TWR_RADIO_PEER_JOURNAL_LENGTH + 1) * 8 > 6144
+#error "TWR_RADIO_PEER_JOURNAL_LENGTH does not fit EEPROM"
+#endif
+
+// Peer list layout written by earlier firmware, one record per slot under header
+#define _TWR_RADIO_PEER_SLOTS_MAGIC 0x31524550
+
+typedef enum
+{
+    TWR_RADIO_PEER_JOURNAL_SOURCE_NONE = 0,
+    TWR_RADIO_PEER_JOURNAL_SOURCE_CARRY = 1,
+    TWR_RADIO_PEER_JOURNAL_SOURCE_CLEAR = 2,
+    TWR_RADIO_PEER_JOURNAL_SOURCE_QUEUE = 3,
+    TWR_RADIO_PEER_JOURNAL_SOURCE_ADD = 4,
+    TWR_RADIO_PEER_JOURNAL_SOURCE_HEADER = 5
+
+} twr_radio_peer_journal_source_t;
 
 typedef enum
 {
@@ -31,11 +132,15 @@ static struct
     twr_atsha204_t atsha204;
     twr_radio_state_t state;
     uint64_t my_id;
-    uint16_t message_id;
+    uint32_t message_id;
     int transmit_count;
+    int busy_count;
+    uint32_t random;
+    twr_tick_t tx_tick_free;
     void (*event_handler)(twr_radio_event_t, void *);
     void *event_param;
     twr_scheduler_task_id_t task_id;
+    twr_event_flags_t event_flags;
     bool pairing_request_to_gateway;
     const char *firmware;
     const char *firmware_version;
@@ -43,10 +148,16 @@ static struct
 
     twr_queue_t pub_queue;
     twr_queue_t rx_queue;
+    twr_tick_t pub_tick_first;
+    uint16_t pub_queue_overflow;
+    uint16_t rx_queue_overflow;
+#if TWR_RADIO_LINK_PUB_INTERVAL_MS
+    twr_tick_t link_pub_tick;
+#endif
     uint8_t pub_queue_buffer[TWR_RADIO_PUB_QUEUE_BUFFER_SIZE];
     uint8_t rx_queue_buffer[TWR_RADIO_RX_QUEUE_BUFFER_SIZE];
 
-    uint8_t ack_tx_cache_buffer[15];
+    uint8_t ack_tx_cache_buffer[TWR_SPIRIT1_MAX_PACKET_SIZE];
     size_t ack_tx_cache_length;
     int ack_transmit_count;
     twr_tick_t rx_timeout;
@@ -54,34 +165,100 @@ static struct
 
     twr_radio_peer_t peer_devices[TWR_RADIO_MAX_DEVICES];
     int peer_devices_length;
+    uint16_t peer_devices_index[_TWR_RADIO_PEER_INDEX_SIZE];
+    uint16_t peer_devices_record[TWR_RADIO_MAX_DEVICES];
+
+    twr_queue_t peer_journal_queue;
+    uint8_t peer_journal_queue_buffer[_TWR_RADIO_PEER_JOURNAL_QUEUE_LENGTH * (sizeof(size_t) + 1 + TWR_RADIO_ID_SIZE)];
+    uint8_t peer_journal_buffer[_TWR_RADIO_PEER_JOURNAL_RECORD_SIZE];
+    twr_radio_peer_journal_source_t peer_journal_source;
+    uint16_t peer_journal_head;
+    uint8_t peer_journal_lap;
+    int peer_journal_unsaved;
+    bool peer_journal_clear;
+    bool peer_journal_header;
 
     uint64_t peer_id;
 
     twr_tick_t sleeping_mode_rx_timeout;
     twr_tick_t rx_timeout_sleeping;
 
+    twr_tick_t wake_interval;
+    twr_tick_t wake_tick;
+    twr_tick_t wake_tick_end;
+
     bool scan;
     uint64_t scan_cache[_TWR_RADIO_SCAN_CACHE_LENGTH];
     uint8_t scan_length;
     uint8_t scan_head;
 
     bool automatic_pairing;
-    bool save_peer_devices;
 
     twr_radio_sub_t *subs;
     int subs_length;
     int sent_subs;
 
+    const twr_radio_decoder_t *decoders;
+    int decoders_length;
+
+#if TWR_RADIO_SECURITY
+    twr_aes_key_t key;
+    uint64_t tx_peer_id;
+    uint32_t pairing_nonce;
+    uint32_t pairing_nonce_node;
+    uint32_t pairing_nonce_gateway;
+    uint64_t pairing_answer_id;
+    uint32_t pairing_answer_nonce;
+    bool session_request;
+#endif
+
 } _twr_radio;
 
 static void _twr_radio_task(void *param);
 static void _twr_radio_go_to_state_rx_or_sleep(void);
+static void _twr_radio_tx(void);
+static twr_tick_t _twr_radio_get_backoff(void);
+static uint32_t _twr_radio_rand(void);
+static twr_radio_peer_t *_twr_radio_get_tx_peer(void);
+static void _twr_radio_peer_rssi_update(twr_radio_peer_t *peer, int8_t rssi);
+static void _twr_radio_wake_announce(void);
+#if TWR_RADIO_SECURITY
+static bool _twr_radio_session_check(void);
+static void _twr_radio_session_request(void);
+static void _twr_radio_session_key(twr_aes_key_t key, const uint8_t *node_id, uint32_t node_nonce, uint32_t gateway_nonce);
+static void _twr_radio_session_start(twr_radio_peer_t *peer, const uint8_t *node_id, uint32_t node_nonce, uint32_t gateway_nonce, uint32_t rx_counter);
+static bool _twr_radio_seal(void);
+static bool _twr_radio_seal_pairing_ack(twr_radio_peer_t *peer, uint16_t message_id);
+static bool _twr_radio_seal_ack(void);
+static bool _twr_radio_open(uint8_t *buffer, size_t *length);
+static bool _twr_radio_open_pending(uint8_t *buffer, size_t length, uint8_t *mic, twr_radio_peer_t *peer);
+static bool _twr_radio_control_is_response(const uint8_t *buffer);
+static bool _twr_radio_open_pairing_ack(uint8_t *buffer, size_t *length);
+static bool _twr_radio_open_ack(uint8_t *buffer, size_t *length);
+static void _twr_radio_nonce(uint8_t *nonce, const uint8_t *id, uint32_t counter, uint8_t type);
+#endif
 static void _twr_radio_spirit1_event_handler(twr_spirit1_event_t event, void *event_param);
 static void _twr_radio_load_peer_devices(void);
-static void _twr_radio_save_peer_devices(void);
+static void _twr_radio_load_peer_devices_slots(void);
+static void _twr_radio_load_peer_devices_legacy(void);
+static void _twr_radio_peer_journal_clear(void);
+static void _twr_radio_peer_journal_remove(uint64_t id);
+static void _twr_radio_peer_journal_update(void);
+static bool _twr_radio_peer_journal_read(uint16_t position, uint8_t *record);
+static uint32_t _twr_radio_peer_journal_address(uint16_t position);
+static void _twr_radio_peer_journal_event_handler(twr_eepromc_event_t event, void *event_param);
+static uint32_t _twr_radio_peer_hash(uint64_t id);
+static uint16_t *_twr_radio_peer_index_find(uint64_t id);
+static twr_radio_peer_t *_twr_radio_peer_insert(uint64_t id);
+static void _twr_radio_peer_erase(uint16_t *entry);
+static void _twr_radio_peer_clear(void);
 static void _twr_radio_atsha204_event_handler(twr_atsha204_t *self, twr_atsha204_event_t event, void *event_param);
 static bool _twr_radio_peer_device_add(uint64_t id);
 static bool _twr_radio_peer_device_remove(uint64_t id);
+#if TWR_RADIO_PUB_BATCH
+static size_t _twr_radio_pub_batch(uint8_t *buffer, size_t length);
+static bool _twr_radio_pub_is_batchable(uint8_t header);
+#endif
 
 __attribute__((weak)) void twr_radio_on_info(uint64_t *id, char *firmware, char *version, twr_radio_mode_t mode) { (void) id; (void) firmware; (void) version; (void) mode;}
 __attribute__((weak)) void twr_radio_on_sub(uint64_t *id, uint8_t *order, twr_radio_sub_pt_t *pt, char *topic) { (void) id; (void) order; (void) pt; (void) topic; }
@@ -92,19 +269,26 @@ void twr_radio_init(twr_radio_mode_t mode)
 
     _twr_radio.mode = mode;
 
+    twr_event_flags_init(&_twr_radio.event_flags);
+
     twr_atsha204_init(&_twr_radio.atsha204, TWR_I2C_I2C0, 0x64);
     twr_atsha204_set_event_handler(&_twr_radio.atsha204, _twr_radio_atsha204_event_handler, NULL);
     twr_atsha204_read_serial_number(&_twr_radio.atsha204);
 
     twr_queue_init(&_twr_radio.pub_queue, _twr_radio.pub_queue_buffer, sizeof(_twr_radio.pub_queue_buffer));
     twr_queue_init(&_twr_radio.rx_queue, _twr_radio.rx_queue_buffer, sizeof(_twr_radio.rx_queue_buffer));
+    twr_queue_init(&_twr_radio.peer_journal_queue, _twr_radio.peer_journal_queue_buffer, sizeof(_twr_radio.peer_journal_queue_buffer));
 
     twr_spirit1_init();
     twr_spirit1_set_event_handler(_twr_radio_spirit1_event_handler, NULL);
 
+#if TWR_RADIO_SECURITY
+    twr_aes_init();
+#endif
+
     _twr_radio_load_peer_devices();
 
-    _twr_radio.task_id = twr_scheduler_register(_twr_radio_task, NULL, TWR_TICK_INFINITY);
+    _twr_radio.task_id = twr_scheduler_register_ex(_twr_radio_task, NULL, TWR_TICK_INFINITY, TWR_SCHEDULER_PRIORITY_HIGH);
 
     _twr_radio_go_to_state_rx_or_sleep();
 }
@@ -151,12 +335,20 @@ bool twr_radio_peer_device_add(uint64_t id)
         return false;
     }
 
-    uint8_t buffer[1 + TWR_RADIO_ID_SIZE];
+    uint8_t buffer[1 + TWR_RADIO_ID_SIZE + _TWR_RADIO_CONTROL_MESSAGE_ID_SIZE];
 
     buffer[0] = TWR_RADIO_HEADER_NODE_ATTACH;
 
     twr_radio_id_to_buffer(&id, buffer + 1);
 
+#if TWR_RADIO_SECURITY
+
+    // Peer has just been added, no frame has been received from it
+    buffer[1 + TWR_RADIO_ID_SIZE] = 0;
+    buffer[1 + TWR_RADIO_ID_SIZE + 1] = 0;
+
+#endif
+
     twr_queue_put(&_twr_radio.pub_queue, buffer, sizeof(buffer));
 
     twr_scheduler_plan_now(_twr_radio.task_id);
@@ -166,13 +358,25 @@ bool twr_radio_peer_device_add(uint64_t id)
 
 bool twr_radio_peer_device_remove(uint64_t id)
 {
+    uint8_t buffer[1 + TWR_RADIO_ID_SIZE + _TWR_RADIO_CONTROL_MESSAGE_ID_SIZE];
+
+#if TWR_RADIO_SECURITY
+
+    twr_radio_peer_t *peer = twr_radio_get_peer_device(id);
+
+    if (peer != NULL)
+    {
+        buffer[1 + TWR_RADIO_ID_SIZE] = peer->message_id;
+        buffer[1 + TWR_RADIO_ID_SIZE + 1] = peer->message_id >> 8;
+    }
+
+#endif
+
     if (!_twr_radio_peer_device_remove(id))
     {
         return false;
     }
 
-    uint8_t buffer[1 + TWR_RADIO_ID_SIZE];
-
     buffer[0] = TWR_RADIO_HEADER_NODE_DETACH;
 
     twr_radio_id_to_buffer(&id, buffer + 1);
@@ -247,20 +451,22 @@ uint64_t twr_radio_get_event_id(void)
 
 bool twr_radio_is_peer_device(uint64_t id)
 {
-    for (int i = 0; i < _twr_radio.peer_devices_length; i++)
-    {
-        if (id == _twr_radio.peer_devices[i].id)
-        {
-            return true;
-        }
-    }
-    return false;
+    return _twr_radio_peer_index_find(id) != NULL;
 }
 
 bool twr_radio_pub_queue_put(const void *buffer, size_t length)
 {
+    size_t queue_item_length;
+
+    if (!twr_queue_peek(&_twr_radio.pub_queue, NULL, &queue_item_length))
+    {
+        _twr_radio.pub_tick_first = twr_tick_get();
+    }
+
     if (!twr_queue_put(&_twr_radio.pub_queue, buffer, length))
     {
+        _twr_radio.pub_queue_overflow++;
+
         return false;
     }
 
@@ -272,6 +478,8 @@ bool twr_radio_pub_queue_put(const void *buffer, size_t length)
 void twr_radio_pub_queue_clear()
 {
     twr_queue_clear(&_twr_radio.pub_queue);
+
+    twr_radio_pub_topic_reset();
 }
 
 void twr_radio_set_subs(twr_radio_sub_t *subs, int length)
@@ -283,6 +491,13 @@ void twr_radio_set_subs(twr_radio_sub_t *subs, int length)
     _twr_radio.sent_subs = 0;
 }
 
+void twr_radio_set_decoders(const twr_radio_decoder_t *decoders, int length)
+{
+    _twr_radio.decoders = decoders;
+
+    _twr_radio.decoders_length = length;
+}
+
 bool twr_radio_send_sub_data(uint64_t *id, uint8_t order, void *payload, size_t size)
 {
     uint8_t qbuffer[1 + TWR_RADIO_ID_SIZE + TWR_RADIO_NODE_MAX_BUFFER_SIZE];
@@ -316,29 +531,162 @@ void twr_radio_set_rx_timeout_for_sleeping_node(twr_tick_t timeout)
     _twr_radio.sleeping_mode_rx_timeout = timeout;
 }
 
+void twr_radio_set_wake_interval(twr_tick_t interval)
+{
+    _twr_radio.wake_interval = interval > UINT16_MAX ? UINT16_MAX : interval;
+
+    _twr_radio.wake_tick = twr_tick_get() + _twr_radio.wake_interval;
+
+    _twr_radio_wake_announce();
+
+    twr_scheduler_plan_now(_twr_radio.task_id);
+}
+
+#if TWR_RADIO_SECURITY
+
+void twr_radio_set_key(const uint8_t *key)
+{
+    twr_aes_key_from_uint8(_twr_radio.key, key);
+}
+
+#endif
+
 static void _twr_radio_task(void *param)
 {
     (void) param;
 
     if (_twr_radio.my_id == 0)
     {
+        twr_event_flags_clear(&_twr_radio.event_flags, _TWR_RADIO_FLAG_ID);
+
         twr_atsha204_read_serial_number(&_twr_radio.atsha204);
 
-        twr_scheduler_plan_current_now();
+        // Wait for result of pending request, request is repeated after timeout if it has not been sent
+        twr_event_flags_wait(&_twr_radio.event_flags, _TWR_RADIO_FLAG_ID, _TWR_RADIO_ID_TIMEOUT);
 
         return;
     }
 
+    _twr_radio_peer_journal_update();
+
+    void *queue_item_buffer;
+    uint8_t *queue_item;
+    size_t queue_item_length;
+    uint64_t id;
+
+    // Received messages are decoded in place and removed from queue once they are handled,
+    // this does not wait for radio to become idle, otherwise busy gateway would let queue overflow
+    while (twr_queue_peek_in_place(&_twr_radio.rx_queue, &queue_item_buffer, &queue_item_length))
+    {
+        queue_item = queue_item_buffer;
+
+        twr_radio_id_from_buffer(queue_item, &id);
+
+        queue_item_length -= TWR_RADIO_HEAD_SIZE;
+
+        uint8_t header = queue_item[TWR_RADIO_HEAD_SIZE];
+
+        if (twr_radio_pub_decode(&id, queue_item + TWR_RADIO_HEAD_SIZE, queue_item_length) ||
+            twr_radio_node_decode(&id, queue_item + TWR_RADIO_HEAD_SIZE, queue_item_length))
+        {
+            // Header was found in decoder table of pub or node module
+        }
+        else if (header == TWR_RADIO_HEADER_SUB_DATA)
+        {
+            uint8_t order = queue_item[TWR_RADIO_HEAD_SIZE + 1 + TWR_RADIO_ID_SIZE];
+
+            if (order >= _twr_radio.subs_length)
+            {
+                twr_queue_consume(&_twr_radio.rx_queue);
+
+                continue;
+            }
+
+            twr_radio_sub_t *sub = &_twr_radio.subs[order];
+
+            if (sub->callback != NULL)
+            {
+                uint8_t *payload = NULL;
+
+                if (queue_item_length > 1 + TWR_RADIO_ID_SIZE + 1)
+                {
+                    payload = queue_item + TWR_RADIO_HEAD_SIZE + 1 + TWR_RADIO_ID_SIZE + 1;
+                }
+
+                sub->callback(&id, sub->topic, payload, sub->param);
+            }
+        }
+        else if (header == TWR_RADIO_HEADER_PUB_INFO)
+        {
+            queue_item[queue_item_length + TWR_RADIO_HEAD_SIZE - 1] = 0;
+
+            twr_radio_on_info(&id, (char *) queue_item + TWR_RADIO_HEAD_SIZE + 1, "", TWR_RADIO_MODE_UNKNOWN);
+        }
+        else if ((header == TWR_RADIO_HEADER_WAKE_INTERVAL) && (queue_item_length == 3))
+        {
+            twr_radio_peer_t *peer = twr_radio_get_peer_device(id);
+
+            if (peer != NULL)
+            {
+                peer->wake_interval = queue_item[TWR_RADIO_HEAD_SIZE + 1] | (uint16_t) queue_item[TWR_RADIO_HEAD_SIZE + 2] << 8;
+            }
+        }
+        else if (header == TWR_RADIO_HEADER_SUB_REG)
+        {
+            uint8_t *order = queue_item + TWR_RADIO_HEAD_SIZE + 1;
+
+            twr_radio_sub_pt_t *pt = (twr_radio_sub_pt_t *) queue_item + TWR_RADIO_HEAD_SIZE + 2;
+
+            char *topic = (char *) queue_item + TWR_RADIO_HEAD_SIZE + 3;
+
+            twr_radio_on_sub(&id, order, pt, topic);
+        }
+        else
+        {
+            for (int i = 0; i < _twr_radio.decoders_length; i++)
+            {
+                const twr_radio_decoder_t *decoder = &_twr_radio.decoders[i];
+
+                if ((decoder->header == header) && ((decoder->length == 0) || (decoder->length == queue_item_length - 1)))
+                {
+                    decoder->callback(&id, queue_item + TWR_RADIO_HEAD_SIZE + 1, queue_item_length - 1, decoder->param);
+
+                    break;
+                }
+            }
+        }
+
+        twr_queue_consume(&_twr_radio.rx_queue);
+    }
+
     if ((_twr_radio.state != TWR_RADIO_STATE_RX) && (_twr_radio.state != TWR_RADIO_STATE_SLEEP))
     {
-        twr_scheduler_plan_current_now();
+        twr_event_flags_clear(&_twr_radio.event_flags, _TWR_RADIO_FLAG_IDLE);
+
+        twr_event_flags_wait(&_twr_radio.event_flags, _TWR_RADIO_FLAG_IDLE, TWR_TICK_INFINITY);
+
+        return;
+    }
+
+    // Next frame would collide with the copy of acknowledgement or find channel busy because of it
+    if (twr_tick_get() < _twr_radio.tx_tick_free)
+    {
+        twr_scheduler_plan_current_absolute(_twr_radio.tx_tick_free);
 
         return;
     }
 
-    if (_twr_radio.save_peer_devices)
+    // Sleeping node samples channel on its own schedule, transmission planned in the meantime goes first
+    if ((_twr_radio.wake_interval != 0) && (_twr_radio.state == TWR_RADIO_STATE_SLEEP))
     {
-        _twr_radio_save_peer_devices();
+        if (twr_tick_get() >= _twr_radio.wake_tick)
+        {
+            _twr_radio_go_to_state_rx_or_sleep();
+
+            return;
+        }
+
+        twr_scheduler_plan_current_absolute(_twr_radio.wake_tick);
     }
 
     if (_twr_radio.pairing_request_to_gateway)
@@ -349,7 +697,7 @@ static void _twr_radio_task(void *param)
 
         size_t len = len_firmware + strlen(_twr_radio.firmware_version);
 
-        if (len > TWR_RADIO_MAX_BUFFER_SIZE - 5)
+        if (len > TWR_RADIO_MAX_BUFFER_SIZE - 5 - _TWR_RADIO_PAIRING_NONCE_SIZE)
         {
             return;
         }
@@ -373,9 +721,20 @@ static void _twr_radio_task(void *param)
 
         twr_spirit1_set_tx_length(10 + len + 2);
 
-        twr_spirit1_tx();
+#if TWR_RADIO_SECURITY
+
+        if (!_twr_radio_seal())
+        {
+            return;
+        }
+
+#endif
+
+        _twr_radio.transmit_count = TWR_RADIO_TX_MAX_COUNT;
 
-        _twr_radio.transmit_count = _TWR_RADIO_TX_MAX_COUNT;
+        _twr_radio.busy_count = 0;
+
+        _twr_radio_tx();
 
         _twr_radio.state = TWR_RADIO_STATE_TX;
 
@@ -405,93 +764,200 @@ static void _twr_radio_task(void *param)
 
         twr_spirit1_set_tx_length(11 + strlen(sub->topic) + 1);
 
-        twr_spirit1_tx();
+#if TWR_RADIO_SECURITY
+
+        // Registration goes on with the next acknowledgement, which comes once node has session key
+        if (!_twr_radio_seal())
+        {
+            _twr_radio.ack = false;
+
+            return;
+        }
+
+#endif
 
-        _twr_radio.transmit_count = _TWR_RADIO_TX_MAX_COUNT;
+        _twr_radio.transmit_count = TWR_RADIO_TX_MAX_COUNT;
+
+        _twr_radio.busy_count = 0;
+
+        _twr_radio_tx();
 
         _twr_radio.state = TWR_RADIO_STATE_TX;
 
         return;
     }
 
-    uint8_t queue_item_buffer[sizeof(_twr_radio.pub_queue_buffer)];
-    size_t queue_item_length;
-    uint64_t id;
+#if TWR_RADIO_PUB_BATCH && TWR_RADIO_PUB_BATCH_LATENCY_MS
 
-    while (twr_queue_get(&_twr_radio.rx_queue, queue_item_buffer, &queue_item_length))
+    // Give other publish messages a chance to join the first one in its frame
+    if (twr_queue_peek(&_twr_radio.pub_queue, NULL, &queue_item_length) && (twr_tick_get() < _twr_radio.pub_tick_first + TWR_RADIO_PUB_BATCH_LATENCY_MS))
     {
-        twr_radio_id_from_buffer(queue_item_buffer, &id);
+        twr_scheduler_plan_current_absolute(_twr_radio.pub_tick_first + TWR_RADIO_PUB_BATCH_LATENCY_MS);
 
-        queue_item_length -= TWR_RADIO_HEAD_SIZE;
+        return;
+    }
 
-        twr_radio_pub_decode(&id, queue_item_buffer + TWR_RADIO_HEAD_SIZE, queue_item_length);
+#endif
 
-        twr_radio_node_decode(&id, queue_item_buffer + TWR_RADIO_HEAD_SIZE, queue_item_length);
+#if TWR_RADIO_LINK_PUB_INTERVAL_MS
 
-        if (queue_item_buffer[TWR_RADIO_HEAD_SIZE] == TWR_RADIO_HEADER_SUB_DATA)
+    // Link statistics join a frame which is about to be sent anyway, so they never wake up the node on their own
+    if ((_twr_radio.mode != TWR_RADIO_MODE_GATEWAY) && (_twr_radio.peer_devices_length != 0) &&
+        twr_queue_peek(&_twr_radio.pub_queue, NULL, &queue_item_length) && (twr_tick_get() >= _twr_radio.link_pub_tick))
+    {
+        if (twr_radio_pub_link())
         {
-            uint8_t order = queue_item_buffer[TWR_RADIO_HEAD_SIZE + 1 + TWR_RADIO_ID_SIZE];
+            _twr_radio.link_pub_tick = twr_tick_get() + TWR_RADIO_LINK_PUB_INTERVAL_MS;
+        }
+    }
 
-            if (order >= _twr_radio.subs_length)
-            {
-                return;
-            }
+#endif
 
-            twr_radio_sub_t *sub = &_twr_radio.subs[order];
+    if (twr_queue_peek_in_place(&_twr_radio.pub_queue, &queue_item_buffer, &queue_item_length))
+    {
+#if TWR_RADIO_SECURITY
 
-            if (sub->callback != NULL)
-            {
-                uint8_t *payload = NULL;
+        if (!_twr_radio_session_check())
+        {
+            return;
+        }
 
-                if (queue_item_length > 1 + TWR_RADIO_ID_SIZE + 1)
-                {
-                    payload = queue_item_buffer + TWR_RADIO_HEAD_SIZE + 1 + TWR_RADIO_ID_SIZE + 1;
-                }
+#endif
 
-                sub->callback(&id, sub->topic, payload, sub->param);
+        uint8_t *buffer = twr_spirit1_get_tx_buffer();
+
+        twr_radio_id_to_buffer(&_twr_radio.my_id, buffer);
+
+        _twr_radio.message_id++;
+
+        buffer[6] = _twr_radio.message_id;
+        buffer[7] = _twr_radio.message_id >> 8;
+
+        memcpy(buffer + 8, queue_item_buffer, queue_item_length);
+
+        twr_queue_consume(&_twr_radio.pub_queue);
+
+        size_t length = 8 + queue_item_length;
+
+#if TWR_RADIO_PUB_BATCH
+
+        length = _twr_radio_pub_batch(buffer, length);
+
+#endif
+
+        twr_spirit1_set_tx_length(length);
+
+#if TWR_RADIO_SECURITY
+
+        // Message for peer without session key is given up
+        if (!_twr_radio_seal())
+        {
+            if (_twr_radio.event_handler)
+            {
+                _twr_radio.event_handler(TWR_RADIO_EVENT_TX_ERROR, _twr_radio.event_param);
             }
+
+            twr_scheduler_plan_current_now();
+
+            return;
         }
-        else if (queue_item_buffer[TWR_RADIO_HEAD_SIZE] == TWR_RADIO_HEADER_PUB_INFO)
-        {
-            queue_item_buffer[queue_item_length + TWR_RADIO_HEAD_SIZE - 1] = 0;
 
-            twr_radio_on_info(&id, (char *) queue_item_buffer + TWR_RADIO_HEAD_SIZE + 1, "", TWR_RADIO_MODE_UNKNOWN);
+#endif
+
+        twr_radio_peer_t *peer = _twr_radio_get_tx_peer();
+
+        // Node which samples channel hears the frame only if it is repeated for the whole interval
+        if ((peer != NULL) && (peer->wake_interval != 0))
+        {
+            _twr_radio.wake_tick_end = twr_tick_get() + peer->wake_interval + _TWR_RADIO_WAKE_SNIFF_TIME;
         }
-        else if (queue_item_buffer[TWR_RADIO_HEAD_SIZE] == TWR_RADIO_HEADER_SUB_REG)
+        else
         {
-            uint8_t *order = queue_item_buffer + TWR_RADIO_HEAD_SIZE + 1;
+            _twr_radio.wake_tick_end = 0;
+        }
 
-            twr_radio_sub_pt_t *pt = (twr_radio_sub_pt_t *) queue_item_buffer + TWR_RADIO_HEAD_SIZE + 2;
+        _twr_radio.transmit_count = TWR_RADIO_TX_MAX_COUNT;
 
-            char *topic = (char *) queue_item_buffer + TWR_RADIO_HEAD_SIZE + 3;
+        _twr_radio.busy_count = 0;
 
-            twr_radio_on_sub(&id, order, pt, topic);
-        }
+        _twr_radio_tx();
+
+        _twr_radio.state = TWR_RADIO_STATE_TX;
     }
+}
+
+#if TWR_RADIO_PUB_BATCH
+
+static size_t _twr_radio_pub_batch(uint8_t *buffer, size_t length)
+{
+    size_t queue_item_length;
 
-    if (twr_queue_get(&_twr_radio.pub_queue, queue_item_buffer, &queue_item_length))
+    if (!_twr_radio_pub_is_batchable(buffer[TWR_RADIO_HEAD_SIZE]))
     {
-        uint8_t *buffer = twr_spirit1_get_tx_buffer();
+        return length;
+    }
 
-        twr_radio_id_to_buffer(&_twr_radio.my_id, buffer);
+    // Batch header and record length make frame two bytes longer, it pays off only if the next message fits in too
+    if (!twr_queue_peek(&_twr_radio.pub_queue, NULL, &queue_item_length) || (length + 2 + 1 + queue_item_length > TWR_RADIO_HEAD_SIZE + TWR_RADIO_MAX_BUFFER_SIZE))
+    {
+        return length;
+    }
 
-        _twr_radio.message_id++;
+    twr_queue_peek(&_twr_radio.pub_queue, buffer + length + 2 + 1, &queue_item_length);
 
-        buffer[6] = _twr_radio.message_id;
-        buffer[7] = _twr_radio.message_id >> 8;
+    if (!_twr_radio_pub_is_batchable(buffer[length + 2 + 1]))
+    {
+        return length;
+    }
 
-        memcpy(buffer + 8, queue_item_buffer, queue_item_length);
+    size_t record_length = length - TWR_RADIO_HEAD_SIZE;
 
-        twr_spirit1_set_tx_length(8 + queue_item_length);
+    memmove(buffer + TWR_RADIO_HEAD_SIZE + 2, buffer + TWR_RADIO_HEAD_SIZE, record_length);
 
-        twr_spirit1_tx();
+    buffer[TWR_RADIO_HEAD_SIZE] = TWR_RADIO_HEADER_PUB_BATCH;
+    buffer[TWR_RADIO_HEAD_SIZE + 1] = record_length;
 
-        _twr_radio.transmit_count = _TWR_RADIO_TX_MAX_COUNT;
+    length += 2;
 
-        _twr_radio.state = TWR_RADIO_STATE_TX;
+    // Every record is prefixed by its length, records keep the order in which they were queued
+    while (twr_queue_peek(&_twr_radio.pub_queue, NULL, &queue_item_length))
+    {
+        if (length + 1 + queue_item_length > TWR_RADIO_HEAD_SIZE + TWR_RADIO_MAX_BUFFER_SIZE)
+        {
+            break;
+        }
+
+        twr_queue_peek(&_twr_radio.pub_queue, buffer + length + 1, &queue_item_length);
+
+        if (!_twr_radio_pub_is_batchable(buffer[length + 1]))
+        {
+            break;
+        }
+
+        twr_queue_get(&_twr_radio.pub_queue, NULL, &queue_item_length);
+
+        buffer[length] = queue_item_length;
+
+        length += 1 + queue_item_length;
     }
+
+    return length;
+}
+
+static bool _twr_radio_pub_is_batchable(uint8_t header)
+{
+    // Only messages handled by twr_radio_pub_decode, messages addressed to nodes are checked by receiver before they are queued
+    return ((header >= TWR_RADIO_HEADER_PUB_PUSH_BUTTON) && (header <= TWR_RADIO_HEADER_PUB_BUFFER)) ||
+           (header == TWR_RADIO_HEADER_PUB_BATTERY) ||
+           ((header >= TWR_RADIO_HEADER_PUB_ACCELERATION) && (header <= TWR_RADIO_HEADER_PUB_STATE)) ||
+           (header == TWR_RADIO_HEADER_PUB_VALUE_INT) ||
+           (header == TWR_RADIO_HEADER_PUB_TOPIC_REG) ||
+           (header == TWR_RADIO_HEADER_PUB_TOPIC_ID) ||
+           (header == TWR_RADIO_HEADER_PUB_LINK);
 }
 
+#endif
+
 static bool _twr_radio_scan_cache_push(void)
 {
     for (uint8_t i = 0; i < _twr_radio.scan_length; i++)
@@ -517,7 +983,7 @@ static bool _twr_radio_scan_cache_push(void)
     return true;
 }
 
-static void _twr_radio_send_ack(void)
+static void _twr_radio_send_ack(uint8_t code)
 {
     uint8_t *tx_buffer = twr_spirit1_get_tx_buffer();
 
@@ -528,14 +994,8 @@ static void _twr_radio_send_ack(void)
         _twr_radio.ack_tx_cache_length = twr_spirit1_get_tx_length();
 
         memcpy(_twr_radio.ack_tx_cache_buffer, tx_buffer, sizeof(_twr_radio.ack_tx_cache_buffer));
-
-        _twr_radio.state = TWR_RADIO_STATE_TX_SEND_ACK;
-    }
-    else if (_twr_radio.state == TWR_RADIO_STATE_RX)
-    {
-        _twr_radio.state = TWR_RADIO_STATE_RX_SEND_ACK;
     }
-    else
+    else if (_twr_radio.state != TWR_RADIO_STATE_RX)
     {
         return;
     }
@@ -546,26 +1006,702 @@ static void _twr_radio_send_ack(void)
 
     tx_buffer[8] = TWR_RADIO_HEADER_ACK;
 
-    twr_spirit1_set_tx_length(9);
-
-    _twr_radio.transmit_count = 2;
+    if (code != 0)
+    {
+        tx_buffer[9] = code;
 
-    twr_spirit1_tx();
-}
+        twr_spirit1_set_tx_length(10);
+    }
+    else if (rx_buffer[8] == TWR_RADIO_HEADER_PAIRING)
+    {
+        // Pairing is acknowledged with ID of gateway
+        twr_radio_id_to_buffer(&_twr_radio.my_id, tx_buffer + 9);
 
-static void _twr_radio_go_to_state_rx_or_sleep(void)
-{
-    if (_twr_radio.mode == TWR_RADIO_MODE_NODE_SLEEPING)
+        twr_spirit1_set_tx_length(15);
+    }
+    else
     {
-        twr_tick_t now = twr_tick_get();
+        twr_spirit1_set_tx_length(9);
+    }
 
-        if (_twr_radio.rx_timeout_sleeping > now)
-        {
-            _twr_radio.rx_timeout = _twr_radio.rx_timeout_sleeping;
+#if TWR_RADIO_SECURITY
 
-            twr_spirit1_set_rx_timeout(_twr_radio.rx_timeout - now);
+    if (!_twr_radio_seal_ack())
+    {
+        // Frame which waits for acknowledgement is put back
+        if (_twr_radio.state == TWR_RADIO_STATE_TX_WAIT_ACK)
+        {
+            memcpy(tx_buffer, _twr_radio.ack_tx_cache_buffer, sizeof(_twr_radio.ack_tx_cache_buffer));
 
-            twr_spirit1_rx();
+            twr_spirit1_set_tx_length(_twr_radio.ack_tx_cache_length);
+        }
+
+        return;
+    }
+
+#endif
+
+    if (_twr_radio.state == TWR_RADIO_STATE_TX_WAIT_ACK)
+    {
+        _twr_radio.state = TWR_RADIO_STATE_TX_SEND_ACK;
+    }
+    else
+    {
+        _twr_radio.state = TWR_RADIO_STATE_RX_SEND_ACK;
+    }
+
+    _twr_radio.transmit_count = 2;
+
+    twr_spirit1_tx();
+}
+
+static void _twr_radio_tx(void)
+{
+#if TWR_RADIO_CCA
+
+    twr_spirit1_tx_cca();
+
+#else
+
+    twr_spirit1_tx();
+
+#endif
+}
+
+static twr_tick_t _twr_radio_get_backoff(void)
+{
+    int attempt = TWR_RADIO_TX_MAX_COUNT - _twr_radio.transmit_count + _twr_radio.busy_count;
+
+    uint32_t window = TWR_RADIO_BACKOFF_MIN_MS;
+
+    // Window doubles with every attempt made so far and every time channel was busy, so that contending nodes spread out
+    while ((--attempt > 0) && (window < TWR_RADIO_BACKOFF_MAX_MS))
+    {
+        window <<= 1;
+    }
+
+    if (window > TWR_RADIO_BACKOFF_MAX_MS)
+    {
+        window = TWR_RADIO_BACKOFF_MAX_MS;
+    }
+
+    return _twr_radio_rand() % window;
+}
+
+static uint32_t _twr_radio_rand(void)
+{
+    // Xorshift generator seeded from radio ID
+    _twr_radio.random ^= _twr_radio.random << 13;
+    _twr_radio.random ^= _twr_radio.random >> 17;
+    _twr_radio.random ^= _twr_radio.random << 5;
+
+    return _twr_radio.random;
+}
+
+static twr_radio_peer_t *_twr_radio_get_tx_peer(void)
+{
+    // Node talks to its gateway only, gateway addresses node by ID which follows header
+    if (_twr_radio.mode != TWR_RADIO_MODE_GATEWAY)
+    {
+        return _twr_radio.peer_devices_length > 0 ? &_twr_radio.peer_devices[0] : NULL;
+    }
+
+#if TWR_RADIO_SECURITY
+
+    // ID of node is encrypted once frame is sealed
+    return twr_radio_get_peer_device(_twr_radio.tx_peer_id);
+
+#else
+
+    if (twr_spirit1_get_tx_length() < TWR_RADIO_HEAD_SIZE + 1 + TWR_RADIO_ID_SIZE)
+    {
+        return NULL;
+    }
+
+    uint64_t id;
+
+    twr_radio_id_from_buffer((uint8_t *) twr_spirit1_get_tx_buffer() + TWR_RADIO_HEAD_SIZE + 1, &id);
+
+    return twr_radio_get_peer_device(id);
+
+#endif
+}
+
+static void _twr_radio_peer_rssi_update(twr_radio_peer_t *peer, int8_t rssi)
+{
+    peer->rssi = rssi;
+
+#if TWR_RADIO_LINK_STATS
+
+    if ((peer->rssi_window_count == 0) || (rssi < peer->rssi_window_min))
+    {
+        peer->rssi_window_min = rssi;
+    }
+
+    if ((peer->rssi_window_count == 0) || (rssi > peer->rssi_window_max))
+    {
+        peer->rssi_window_max = rssi;
+    }
+
+    peer->rssi_window_sum += rssi;
+
+    peer->rssi_window_count++;
+
+    // Statistics follow the first window as it fills up and then change once per window
+    if ((peer->rssi_window_count == TWR_RADIO_LINK_WINDOW) || (peer->rssi_avg == 0))
+    {
+        peer->rssi_min = peer->rssi_window_min;
+        peer->rssi_max = peer->rssi_window_max;
+        peer->rssi_avg = peer->rssi_window_sum / peer->rssi_window_count;
+    }
+
+    if (peer->rssi_window_count == TWR_RADIO_LINK_WINDOW)
+    {
+        peer->rssi_window_sum = 0;
+
+        peer->rssi_window_count = 0;
+    }
+#endif
+}
+
+static void _twr_radio_wake_announce(void)
+{
+    uint8_t buffer[3];
+
+    buffer[0] = TWR_RADIO_HEADER_WAKE_INTERVAL;
+    buffer[1] = _twr_radio.wake_interval;
+    buffer[2] = _twr_radio.wake_interval >> 8;
+
+    twr_radio_pub_queue_put(buffer, sizeof(buffer));
+}
+
+#if TWR_RADIO_SECURITY
+
+static bool _twr_radio_session_check(void)
+{
+    if ((_twr_radio.mode == TWR_RADIO_MODE_GATEWAY) || (_twr_radio.peer_devices_length == 0) || _twr_radio.peer_devices[0].key_valid)
+    {
+        return true;
+    }
+
+    // Pairing did not bring session key, message is given up by _twr_radio_seal and the next one tries again
+    if (_twr_radio.session_request)
+    {
+        _twr_radio.session_request = false;
+
+        return true;
+    }
+
+    // Session key is kept in RAM only, node paired before reset has to pair again before it sends anything
+    _twr_radio.session_request = true;
+
+    _twr_radio_session_request();
+
+    return false;
+}
+
+static void _twr_radio_session_request(void)
+{
+    if (_twr_radio.firmware == NULL)
+    {
+        _twr_radio.firmware = "";
+
+        _twr_radio.firmware_version = "";
+    }
+
+    _twr_radio.pairing_request_to_gateway = true;
+
+    twr_scheduler_plan_now(_twr_radio.task_id);
+}
+
+static void _twr_radio_session_key(twr_aes_key_t key, const uint8_t *node_id, uint32_t node_nonce, uint32_t gateway_nonce)
+{
+    uint8_t block[16];
+
+    // Session key is network key applied to ID of node and nonces of both sides
+    memset(block, 0, sizeof(block));
+
+    memcpy(block, node_id, TWR_RADIO_ID_SIZE);
+
+    twr_radio_uint32_to_buffer(&node_nonce, block + 6);
+    twr_radio_uint32_to_buffer(&gateway_nonce, block + 10);
+
+    block[15] = 0x5a;
+
+    twr_aes_ecb_encrypt(block, block, sizeof(block), _twr_radio.key);
+
+    twr_aes_key_from_uint8(key, block);
+}
+
+static void _twr_radio_session_start(twr_radio_peer_t *peer, const uint8_t *node_id, uint32_t node_nonce, uint32_t gateway_nonce, uint32_t rx_counter)
+{
+    _twr_radio_session_key(peer->key, node_id, node_nonce, gateway_nonce);
+
+    peer->rx_counter = rx_counter;
+
+    peer->tx_counter = 0;
+
+    peer->key_valid = true;
+
+    _twr_radio.session_request = false;
+}
+
+static bool _twr_radio_seal(void)
+{
+    uint8_t *buffer = twr_spirit1_get_tx_buffer();
+    size_t length = twr_spirit1_get_tx_length();
+    uint8_t header = buffer[TWR_RADIO_HEAD_SIZE];
+    uint8_t nonce[TWR_AES_CCM_NONCE_SIZE];
+
+    _twr_radio.tx_peer_id = 0;
+
+    if ((_twr_radio.mode == TWR_RADIO_MODE_GATEWAY) && (length >= TWR_RADIO_HEAD_SIZE + 1 + TWR_RADIO_ID_SIZE))
+    {
+        twr_radio_id_from_buffer(buffer + TWR_RADIO_HEAD_SIZE + 1, &_twr_radio.tx_peer_id);
+    }
+
+    // Node is invited to pair or told it was removed when gateway has no session with it, both go under network key
+    if ((header == TWR_RADIO_HEADER_NODE_ATTACH) || (header == TWR_RADIO_HEADER_NODE_DETACH))
+    {
+        uint32_t control_nonce;
+
+        if (!twr_rng_read(&control_nonce))
+        {
+            control_nonce = _twr_radio_rand();
+        }
+
+        twr_radio_uint32_to_buffer(&control_nonce, buffer + length);
+
+        length += _TWR_RADIO_CONTROL_NONCE_SIZE;
+
+        _twr_radio_nonce(nonce, buffer, control_nonce, _TWR_RADIO_NONCE_CONTROL);
+
+        if (!twr_aes_ccm_encrypt(buffer + length, buffer + length, buffer + length, 0, buffer, length, _twr_radio.key, nonce, TWR_RADIO_MIC_SIZE))
+        {
+            return false;
+        }
+    }
+    else if (header == TWR_RADIO_HEADER_PAIRING)
+    {
+        // Pairing request is authenticated by network key only, so that gateway can read firmware of new node
+        if (!twr_rng_read(&_twr_radio.pairing_nonce))
+        {
+            _twr_radio.pairing_nonce = _twr_radio_rand();
+        }
+
+        twr_radio_uint32_to_buffer(&_twr_radio.pairing_nonce, buffer + length);
+
+        length += _TWR_RADIO_PAIRING_NONCE_SIZE;
+
+        _twr_radio_nonce(nonce, buffer, _twr_radio.pairing_nonce, _TWR_RADIO_NONCE_PAIRING);
+
+        if (!twr_aes_ccm_encrypt(buffer + length, buffer + length, buffer + length, 0, buffer, length, _twr_radio.key, nonce, TWR_RADIO_MIC_SIZE))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        twr_radio_peer_t *peer = _twr_radio_get_tx_peer();
+
+        if ((peer == NULL) || !peer->key_valid)
+        {
+            return false;
+        }
+
+        // Gateway numbers frames for every node on its own, so that node can extend 16 bits of message id on air
+        if (_twr_radio.mode == TWR_RADIO_MODE_GATEWAY)
+        {
+            _twr_radio.message_id = ++peer->tx_counter;
+
+            buffer[6] = _twr_radio.message_id;
+            buffer[7] = _twr_radio.message_id >> 8;
+        }
+
+        _twr_radio_nonce(nonce, buffer, _twr_radio.message_id, _TWR_RADIO_NONCE_DATA);
+
+        if (!twr_aes_ccm_encrypt(buffer + TWR_RADIO_HEAD_SIZE + 1, buffer + length, buffer + TWR_RADIO_HEAD_SIZE + 1, length - TWR_RADIO_HEAD_SIZE - 1,
+                                 buffer, TWR_RADIO_HEAD_SIZE + 1, peer->key, nonce, TWR_RADIO_MIC_SIZE))
+        {
+            return false;
+        }
+    }
+
+    twr_spirit1_set_tx_length(length + TWR_RADIO_MIC_SIZE);
+
+    return true;
+}
+
+static bool _twr_radio_seal_pairing_ack(twr_radio_peer_t *peer, uint16_t message_id)
+{
+    uint8_t *buffer = twr_spirit1_get_tx_buffer();
+    size_t length = twr_spirit1_get_tx_length();
+    uint8_t nonce[TWR_AES_CCM_NONCE_SIZE];
+
+    // Copy of request gets the same answer and leaves session as it is, request may also be replayed by someone else
+    if ((_twr_radio.pairing_answer_id != peer->id) || (_twr_radio.pairing_answer_nonce != _twr_radio.pairing_nonce_node))
+    {
+        if (!twr_rng_read(&_twr_radio.pairing_nonce_gateway))
+        {
+            _twr_radio.pairing_nonce_gateway = _twr_radio_rand();
+        }
+
+        _twr_radio.pairing_answer_id = peer->id;
+
+        _twr_radio.pairing_answer_nonce = _twr_radio.pairing_nonce_node;
+
+        // Node continues numbering of its messages from pairing request, the current session stays until node proves the new key
+        _twr_radio_session_key(peer->pending_key, buffer, _twr_radio.pairing_nonce_node, _twr_radio.pairing_nonce_gateway);
+
+        peer->pending_rx_counter = message_id;
+
+        peer->pending_valid = true;
+    }
+
+    twr_radio_uint32_to_buffer(&_twr_radio.pairing_nonce_gateway, buffer + length);
+
+    length += _TWR_RADIO_PAIRING_NONCE_SIZE;
+
+    _twr_radio_nonce(nonce, buffer, _twr_radio.pairing_nonce_gateway, _TWR_RADIO_NONCE_PAIRING_ACK);
+
+    if (!twr_aes_ccm_encrypt(buffer + length, buffer + length, buffer + length, 0, buffer, length, _twr_radio.key, nonce, TWR_RADIO_MIC_SIZE))
+    {
+        return false;
+    }
+
+    twr_spirit1_set_tx_length(length + TWR_RADIO_MIC_SIZE);
+
+    return true;
+}
+
+static bool _twr_radio_seal_ack(void)
+{
+    uint8_t *buffer = twr_spirit1_get_tx_buffer();
+    size_t length = twr_spirit1_get_tx_length();
+    uint8_t *rx_buffer = twr_spirit1_get_rx_buffer();
+    uint8_t header = rx_buffer[TWR_RADIO_HEAD_SIZE];
+    uint8_t code = length > TWR_RADIO_HEAD_SIZE + 1 ? buffer[TWR_RADIO_HEAD_SIZE + 1] : 0;
+    uint8_t nonce[TWR_AES_CCM_NONCE_SIZE];
+    const uint32_t *key = _twr_radio.key;
+
+    if (header == TWR_RADIO_HEADER_PAIRING)
+    {
+        twr_radio_peer_t *peer = twr_radio_get_peer_device(_twr_radio.peer_id);
+
+        return (peer != NULL) && _twr_radio_seal_pairing_ack(peer, rx_buffer[6] | ((uint16_t) rx_buffer[7] << 8));
+    }
+
+    if ((header == TWR_RADIO_HEADER_NODE_ATTACH) || (header == TWR_RADIO_HEADER_NODE_DETACH))
+    {
+        uint32_t control_nonce;
+
+        memcpy(&control_nonce, rx_buffer + _TWR_RADIO_CONTROL_LENGTH, _TWR_RADIO_CONTROL_NONCE_SIZE);
+
+        _twr_radio_nonce(nonce, buffer, control_nonce, _TWR_RADIO_NONCE_CONTROL_ACK);
+    }
+    else if (code == _TWR_RADIO_ACK_REKEY)
+    {
+        // Gateway has no session key, the same 16-bit message id always gets the same acknowledgement
+        _twr_radio_nonce(nonce, buffer, buffer[6] | ((uint32_t) buffer[7] << 8), _TWR_RADIO_NONCE_REKEY);
+    }
+    else
+    {
+        twr_radio_peer_t *peer = twr_radio_get_peer_device(_twr_radio.peer_id);
+
+        // Acknowledgement goes without MIC, peer which has no session does not take it anyway
+        if ((peer == NULL) || !peer->key_valid)
+        {
+            return true;
+        }
+
+        // Frame was opened just now, so extended message id of the last frame received is the one acknowledged
+        _twr_radio_nonce(nonce, buffer, peer->rx_counter, _TWR_RADIO_NONCE_ACK);
+
+        nonce[11] = code;
+
+        key = peer->key;
+    }
+
+    if (!twr_aes_ccm_encrypt(buffer + length, buffer + length, buffer + length, 0, buffer, length, key, nonce, TWR_RADIO_MIC_SIZE))
+    {
+        return false;
+    }
+
+    twr_spirit1_set_tx_length(length + TWR_RADIO_MIC_SIZE);
+
+    return true;
+}
+
+static bool _twr_radio_open(uint8_t *buffer, size_t *length)
+{
+    uint8_t header = buffer[TWR_RADIO_HEAD_SIZE];
+    uint8_t nonce[TWR_AES_CCM_NONCE_SIZE];
+
+    if ((header == TWR_RADIO_HEADER_NODE_ATTACH) || (header == TWR_RADIO_HEADER_NODE_DETACH))
+    {
+        if (*length != _TWR_RADIO_CONTROL_LENGTH + _TWR_RADIO_CONTROL_NONCE_SIZE + TWR_RADIO_MIC_SIZE)
+        {
+            return false;
+        }
+
+        *length = _TWR_RADIO_CONTROL_LENGTH;
+
+        uint8_t *mic = buffer + *length + _TWR_RADIO_CONTROL_NONCE_SIZE;
+        uint32_t control_nonce;
+
+        memcpy(&control_nonce, buffer + *length, _TWR_RADIO_CONTROL_NONCE_SIZE);
+
+        _twr_radio_nonce(nonce, buffer, control_nonce, _TWR_RADIO_NONCE_CONTROL);
+
+        return twr_aes_ccm_decrypt(mic, mic, 0, buffer, *length + _TWR_RADIO_CONTROL_NONCE_SIZE, _twr_radio.key, nonce, mic, TWR_RADIO_MIC_SIZE);
+    }
+
+    if (*length < TWR_RADIO_HEAD_SIZE + 1 + TWR_RADIO_MIC_SIZE)
+    {
+        return false;
+    }
+
+    *length -= TWR_RADIO_MIC_SIZE;
+
+    uint8_t *mic = buffer + *length;
+
+    if (header == TWR_RADIO_HEADER_PAIRING)
+    {
+        if (*length < TWR_RADIO_HEAD_SIZE + 1 + _TWR_RADIO_PAIRING_NONCE_SIZE)
+        {
+            return false;
+        }
+
+        *length -= _TWR_RADIO_PAIRING_NONCE_SIZE;
+
+        memcpy(&_twr_radio.pairing_nonce_node, buffer + *length, _TWR_RADIO_PAIRING_NONCE_SIZE);
+
+        _twr_radio_nonce(nonce, buffer, _twr_radio.pairing_nonce_node, _TWR_RADIO_NONCE_PAIRING);
+
+        return twr_aes_ccm_decrypt(mic, mic, 0, buffer, *length + _TWR_RADIO_PAIRING_NONCE_SIZE, _twr_radio.key, nonce, mic, TWR_RADIO_MIC_SIZE);
+    }
+
+    twr_radio_peer_t *peer = twr_radio_get_peer_device(_twr_radio.peer_id);
+
+    // Frame of unknown device is not opened, its ID is enough for scan and automatic pairing
+    if (peer == NULL)
+    {
+        *length = TWR_RADIO_HEAD_SIZE + 1;
+
+        return true;
+    }
+
+    if (peer->pending_valid && _twr_radio_open_pending(buffer, *length, mic, peer))
+    {
+        return true;
+    }
+
+    if (!peer->key_valid)
+    {
+        // Gateway lost session key with reset, node is asked to pair again
+        if (_twr_radio.mode == TWR_RADIO_MODE_GATEWAY)
+        {
+            _twr_radio_send_ack(_TWR_RADIO_ACK_REKEY);
+        }
+
+        return false;
+    }
+
+    // Full counter is the nearest one from the last frame on, frame with older counter does not authenticate
+    uint32_t counter = (peer->rx_counter & 0xffff0000) | buffer[6] | ((uint32_t) buffer[7] << 8);
+
+    if (counter < peer->rx_counter)
+    {
+        counter += 0x10000;
+    }
+
+    _twr_radio_nonce(nonce, buffer, counter, _TWR_RADIO_NONCE_DATA);
+
+    if (!twr_aes_ccm_decrypt(buffer + TWR_RADIO_HEAD_SIZE + 1, buffer + TWR_RADIO_HEAD_SIZE + 1, *length - TWR_RADIO_HEAD_SIZE - 1,
+                             buffer, TWR_RADIO_HEAD_SIZE + 1, peer->key, nonce, mic, TWR_RADIO_MIC_SIZE))
+    {
+        return false;
+    }
+
+    peer->rx_counter = counter;
+
+    return true;
+}
+
+static bool _twr_radio_open_pending(uint8_t *buffer, size_t length, uint8_t *mic, twr_radio_peer_t *peer)
+{
+    uint8_t payload[TWR_SPIRIT1_MAX_PACKET_SIZE];
+    uint8_t nonce[TWR_AES_CCM_NONCE_SIZE];
+    size_t payload_length = length - TWR_RADIO_HEAD_SIZE - 1;
+
+    uint32_t counter = (peer->pending_rx_counter & 0xffff0000) | buffer[6] | ((uint32_t) buffer[7] << 8);
+
+    if (counter < peer->pending_rx_counter)
+    {
+        counter += 0x10000;
+    }
+
+    _twr_radio_nonce(nonce, buffer, counter, _TWR_RADIO_NONCE_DATA);
+
+    // Frame is tried on copy, as it may still be sealed by the current session
+    if (!twr_aes_ccm_decrypt(payload, buffer + TWR_RADIO_HEAD_SIZE + 1, payload_length, buffer, TWR_RADIO_HEAD_SIZE + 1,
+                             peer->pending_key, nonce, mic, TWR_RADIO_MIC_SIZE))
+    {
+        return false;
+    }
+
+    memcpy(buffer + TWR_RADIO_HEAD_SIZE + 1, payload, payload_length);
+
+    memcpy(peer->key, peer->pending_key, sizeof(peer->key));
+
+    peer->rx_counter = counter;
+
+    peer->tx_counter = 0;
+
+    peer->key_valid = true;
+
+    peer->pending_valid = false;
+
+    return true;
+}
+
+static bool _twr_radio_control_is_response(const uint8_t *buffer)
+{
+    const uint8_t *control = buffer + TWR_RADIO_HEAD_SIZE + 1 + TWR_RADIO_ID_SIZE;
+    uint16_t message_id = control[0] | ((uint16_t) control[1] << 8);
+
+    if (_twr_radio.mode != TWR_RADIO_MODE_GATEWAY)
+    {
+        // Frame which waits for acknowledgement may not have reached gateway yet
+        if ((_twr_radio.state == TWR_RADIO_STATE_TX_WAIT_ACK) && (message_id == (uint16_t) (_twr_radio.message_id - 1)))
+        {
+            return true;
+        }
+
+        return message_id == (uint16_t) _twr_radio.message_id;
+    }
+
+    // Node numbers frames of gateway by counter of its session
+    twr_radio_peer_t *peer = twr_radio_get_peer_device(_twr_radio.peer_id);
+
+    return (peer != NULL) && (message_id == (uint16_t) peer->tx_counter);
+}
+
+static bool _twr_radio_open_pairing_ack(uint8_t *buffer, size_t *length)
+{
+    uint8_t nonce[TWR_AES_CCM_NONCE_SIZE];
+
+    if (*length != TWR_RADIO_HEAD_SIZE + 1 + TWR_RADIO_ID_SIZE + _TWR_RADIO_PAIRING_NONCE_SIZE + TWR_RADIO_MIC_SIZE)
+    {
+        return false;
+    }
+
+    *length = TWR_RADIO_HEAD_SIZE + 1 + TWR_RADIO_ID_SIZE;
+
+    uint8_t *mic = buffer + *length + _TWR_RADIO_PAIRING_NONCE_SIZE;
+
+    memcpy(&_twr_radio.pairing_nonce_gateway, buffer + *length, _TWR_RADIO_PAIRING_NONCE_SIZE);
+
+    _twr_radio_nonce(nonce, buffer, _twr_radio.pairing_nonce_gateway, _TWR_RADIO_NONCE_PAIRING_ACK);
+
+    return twr_aes_ccm_decrypt(mic, mic, 0, buffer, *length + _TWR_RADIO_PAIRING_NONCE_SIZE, _twr_radio.key, nonce, mic, TWR_RADIO_MIC_SIZE);
+}
+
+static bool _twr_radio_open_ack(uint8_t *buffer, size_t *length)
+{
+    uint8_t *tx_buffer = twr_spirit1_get_tx_buffer();
+    uint8_t header = tx_buffer[TWR_RADIO_HEAD_SIZE];
+    uint8_t nonce[TWR_AES_CCM_NONCE_SIZE];
+    const uint32_t *key = _twr_radio.key;
+
+    if (header == TWR_RADIO_HEADER_PAIRING)
+    {
+        return _twr_radio_open_pairing_ack(buffer, length);
+    }
+
+    if ((*length != TWR_RADIO_HEAD_SIZE + 1 + TWR_RADIO_MIC_SIZE) && (*length != TWR_RADIO_HEAD_SIZE + 2 + TWR_RADIO_MIC_SIZE))
+    {
+        return false;
+    }
+
+    *length -= TWR_RADIO_MIC_SIZE;
+
+    uint8_t *mic = buffer + *length;
+    uint8_t code = *length > TWR_RADIO_HEAD_SIZE + 1 ? buffer[TWR_RADIO_HEAD_SIZE + 1] : 0;
+
+    if ((header == TWR_RADIO_HEADER_NODE_ATTACH) || (header == TWR_RADIO_HEADER_NODE_DETACH))
+    {
+        uint32_t control_nonce;
+
+        memcpy(&control_nonce, tx_buffer + _TWR_RADIO_CONTROL_LENGTH, _TWR_RADIO_CONTROL_NONCE_SIZE);
+
+        _twr_radio_nonce(nonce, buffer, control_nonce, _TWR_RADIO_NONCE_CONTROL_ACK);
+    }
+    else if (code == _TWR_RADIO_ACK_REKEY)
+    {
+        _twr_radio_nonce(nonce, buffer, buffer[6] | ((uint32_t) buffer[7] << 8), _TWR_RADIO_NONCE_REKEY);
+    }
+    else
+    {
+        twr_radio_peer_t *peer = _twr_radio_get_tx_peer();
+
+        if ((peer == NULL) || !peer->key_valid)
+        {
+            return false;
+        }
+
+        _twr_radio_nonce(nonce, buffer, _twr_radio.message_id, _TWR_RADIO_NONCE_ACK);
+
+        nonce[11] = code;
+
+        key = peer->key;
+    }
+
+    return twr_aes_ccm_decrypt(mic, mic, 0, buffer, *length, key, nonce, mic, TWR_RADIO_MIC_SIZE);
+}
+
+static void _twr_radio_nonce(uint8_t *nonce, const uint8_t *id, uint32_t counter, uint8_t type)
+{
+    // ID of sender (of node in case of pairing) and counter make nonce unique for every frame under one key
+    memcpy(nonce, id, TWR_RADIO_ID_SIZE);
+
+    nonce[6] = counter;
+    nonce[7] = counter >> 8;
+    nonce[8] = counter >> 16;
+    nonce[9] = counter >> 24;
+    nonce[10] = type;
+    nonce[11] = 0;
+    nonce[12] = 0;
+}
+
+#endif
+
+static void _twr_radio_go_to_state_rx_or_sleep(void)
+{
+    if (_twr_radio.mode == TWR_RADIO_MODE_NODE_SLEEPING)
+    {
+        twr_tick_t now = twr_tick_get();
+
+        if (_twr_radio.rx_timeout_sleeping > now)
+        {
+            _twr_radio.rx_timeout = _twr_radio.rx_timeout_sleeping;
+
+            twr_spirit1_set_rx_timeout(_twr_radio.rx_timeout - now);
+
+            twr_spirit1_rx();
+
+            _twr_radio.state = TWR_RADIO_STATE_RX;
+        }
+        else if ((_twr_radio.wake_interval != 0) && (now >= _twr_radio.wake_tick))
+        {
+            _twr_radio.wake_tick = now + _twr_radio.wake_interval;
+
+            // Sample ends early with RX timeout unless wake-up burst is on air
+            _twr_radio.rx_timeout = now + _TWR_RADIO_WAKE_RX_TIMEOUT;
+
+            twr_spirit1_set_rx_timeout(_TWR_RADIO_WAKE_RX_TIMEOUT);
+
+            twr_spirit1_rx_sniff(_TWR_RADIO_WAKE_SNIFF_TIME);
 
             _twr_radio.state = TWR_RADIO_STATE_RX;
         }
@@ -587,6 +1723,8 @@ static void _twr_radio_go_to_state_rx_or_sleep(void)
         _twr_radio.state = TWR_RADIO_STATE_RX;
     }
 
+    twr_event_flags_set(&_twr_radio.event_flags, _TWR_RADIO_FLAG_IDLE);
+
     twr_scheduler_plan_now(_twr_radio.task_id);
 }
 
@@ -603,7 +1741,32 @@ static void _twr_radio_spirit1_event_handler(twr_spirit1_event_t event, void *ev
 
         if (_twr_radio.state == TWR_RADIO_STATE_TX)
         {
-            twr_tick_t timeout = _TWR_RADIO_ACK_TIMEOUT - 50 + rand() % _TWR_RADIO_ACK_TIMEOUT;
+            twr_radio_peer_t *peer = _twr_radio_get_tx_peer();
+
+            if (peer != NULL)
+            {
+                peer->tx_count++;
+
+                if (_twr_radio.transmit_count < TWR_RADIO_TX_MAX_COUNT - 1)
+                {
+                    peer->tx_retry++;
+                }
+            }
+
+            twr_tick_t timeout;
+
+            if (twr_tick_get() < _twr_radio.wake_tick_end)
+            {
+                // Copies of wake-up burst do not use up attempts
+                _twr_radio.transmit_count++;
+
+                timeout = _TWR_RADIO_WAKE_ACK_TIMEOUT;
+            }
+            else
+            {
+                // Late ACK is still accepted while backing off before next attempt
+                timeout = _TWR_RADIO_ACK_TIMEOUT + _twr_radio_get_backoff();
+            }
 
             _twr_radio.rx_timeout = twr_tick_get() + timeout;
 
@@ -642,11 +1805,11 @@ static void _twr_radio_spirit1_event_handler(twr_spirit1_event_t event, void *ev
 
                 memcpy(tx_buffer, _twr_radio.ack_tx_cache_buffer, sizeof(_twr_radio.ack_tx_cache_buffer));
 
-                twr_tick_t timeout = _TWR_RADIO_ACK_TIMEOUT - 50 + rand() % _TWR_RADIO_ACK_TIMEOUT;
+                _twr_radio.transmit_count = _twr_radio.ack_transmit_count;
 
-                _twr_radio.rx_timeout = twr_tick_get() + timeout;
+                twr_tick_t timeout = _TWR_RADIO_ACK_TIMEOUT + _twr_radio_get_backoff();
 
-                _twr_radio.transmit_count = _twr_radio.ack_transmit_count;
+                _twr_radio.rx_timeout = twr_tick_get() + timeout;
 
                 twr_spirit1_set_rx_timeout(timeout);
 
@@ -662,13 +1825,55 @@ static void _twr_radio_spirit1_event_handler(twr_spirit1_event_t event, void *ev
 
         _twr_radio_go_to_state_rx_or_sleep();
     }
+    else if (event == TWR_SPIRIT1_EVENT_TX_BUSY)
+    {
+        if (_twr_radio.state == TWR_RADIO_STATE_TX)
+        {
+            twr_radio_peer_t *peer = _twr_radio_get_tx_peer();
+
+            if (peer != NULL)
+            {
+                peer->tx_busy++;
+            }
+
+            if (++_twr_radio.busy_count < TWR_RADIO_CCA_MAX_COUNT)
+            {
+                // Back off in RX state, earlier attempt may still be acknowledged
+                twr_tick_t timeout = _twr_radio_get_backoff();
+
+                _twr_radio.rx_timeout = twr_tick_get() + timeout;
+
+                twr_spirit1_set_rx_timeout(timeout);
+
+                twr_spirit1_rx();
+
+                _twr_radio.state = TWR_RADIO_STATE_TX_WAIT_ACK;
+
+                _twr_radio.ack = false;
+
+                return;
+            }
+
+            if (peer != NULL)
+            {
+                peer->tx_error++;
+            }
+
+            if (_twr_radio.event_handler)
+            {
+                _twr_radio.event_handler(TWR_RADIO_EVENT_TX_ERROR, _twr_radio.event_param);
+            }
+        }
+
+        _twr_radio_go_to_state_rx_or_sleep();
+    }
     else if (event == TWR_SPIRIT1_EVENT_RX_TIMEOUT)
     {
         if (_twr_radio.state == TWR_RADIO_STATE_TX_WAIT_ACK)
         {
             if (_twr_radio.transmit_count > 0)
             {
-                twr_spirit1_tx();
+                _twr_radio_tx();
 
                 _twr_radio.state = TWR_RADIO_STATE_TX;
 
@@ -676,6 +1881,13 @@ static void _twr_radio_spirit1_event_handler(twr_spirit1_event_t event, void *ev
             }
             else
             {
+                twr_radio_peer_t *peer = _twr_radio_get_tx_peer();
+
+                if (peer != NULL)
+                {
+                    peer->tx_error++;
+                }
+
                 if (_twr_radio.event_handler)
                 {
                     _twr_radio.event_handler(TWR_RADIO_EVENT_TX_ERROR, _twr_radio.event_param);
@@ -697,7 +1909,7 @@ static void _twr_radio_spirit1_event_handler(twr_spirit1_event_t event, void *ev
             {
                 if (_twr_radio.transmit_count > 0)
                 {
-                    twr_spirit1_tx();
+                    _twr_radio_tx();
 
                     _twr_radio.state = TWR_RADIO_STATE_TX;
 
@@ -725,12 +1937,63 @@ static void _twr_radio_spirit1_event_handler(twr_spirit1_event_t event, void *ev
                 {
                     uint8_t *tx_buffer = twr_spirit1_get_tx_buffer();
 
-                    if ((_twr_radio.peer_id == _twr_radio.my_id) && (_twr_radio.message_id == message_id) )
+                    if ((_twr_radio.peer_id == _twr_radio.my_id) && ((uint16_t) _twr_radio.message_id == message_id) )
                     {
+#if TWR_RADIO_SECURITY
+
+                        // Forged acknowledgement would make sender drop message, or pair again in case of rekey
+                        if (!_twr_radio_open_ack(buffer, &length))
+                        {
+                            return;
+                        }
+
+                        if ((length == 10) && (buffer[9] == _TWR_RADIO_ACK_REKEY))
+                        {
+                            // Gateway has no session key for this node, message is not delivered and node pairs again
+                            peer = _twr_radio_get_tx_peer();
+
+                            if (peer != NULL)
+                            {
+                                peer->tx_error++;
+
+                                peer->key_valid = false;
+                            }
+
+                            _twr_radio.transmit_count = 0;
+
+                            _twr_radio.tx_tick_free = twr_tick_get() + _TWR_RADIO_ACK_REPEAT_TIME;
+
+                            _twr_radio.session_request = true;
+
+                            _twr_radio_session_request();
+
+                            _twr_radio_go_to_state_rx_or_sleep();
+
+                            if (_twr_radio.event_handler)
+                            {
+                                _twr_radio.event_handler(TWR_RADIO_EVENT_TX_ERROR, _twr_radio.event_param);
+                            }
+
+                            return;
+                        }
+
+#endif
+
+                        peer = _twr_radio_get_tx_peer();
+
+                        if (peer != NULL)
+                        {
+                            peer->tx_success++;
+
+                            _twr_radio_peer_rssi_update(peer, twr_spirit1_get_rx_rssi());
+                        }
+
                         _twr_radio.transmit_count = 0;
 
                         _twr_radio.ack = true;
 
+                        _twr_radio.tx_tick_free = twr_tick_get() + _TWR_RADIO_ACK_REPEAT_TIME;
+
                         if (tx_buffer[8] == TWR_RADIO_HEADER_PAIRING)
                         {
                             if (length == 15)
@@ -739,20 +2002,39 @@ static void _twr_radio_spirit1_event_handler(twr_spirit1_event_t event, void *ev
 
                                 if ((_twr_radio.mode != TWR_RADIO_MODE_GATEWAY) && (_twr_radio.peer_devices[0].id != _twr_radio.peer_id))
                                 {
-                                    _twr_radio.peer_devices[0].id = _twr_radio.peer_id;
-                                    _twr_radio.peer_devices[0].message_id_synced = false;
-                                    _twr_radio.peer_devices_length = 1;
+                                    _twr_radio_peer_clear();
+                                    _twr_radio_peer_insert(_twr_radio.peer_id);
 
-                                    _twr_radio.save_peer_devices = true;
-                                    twr_scheduler_plan_now(_twr_radio.task_id);
+                                    _twr_radio_peer_journal_clear();
 
                                     _twr_radio.sent_subs = 0;
 
+                                    twr_radio_pub_topic_reset();
+
+                                    if (_twr_radio.wake_interval != 0)
+                                    {
+                                        _twr_radio_wake_announce();
+                                    }
+
                                     if (_twr_radio.event_handler)
                                     {
                                         _twr_radio.event_handler(TWR_RADIO_EVENT_PAIRED, _twr_radio.event_param);
                                     }
                                 }
+
+#if TWR_RADIO_SECURITY
+
+                                if ((_twr_radio.mode != TWR_RADIO_MODE_GATEWAY) && (_twr_radio.peer_devices_length != 0))
+                                {
+                                    _twr_radio_session_start(&_twr_radio.peer_devices[0], buffer, _twr_radio.pairing_nonce, _twr_radio.pairing_nonce_gateway, 0);
+
+                                    // Gateway knows only 16 bits of message id from pairing request, frames of gateway are numbered from 1
+                                    _twr_radio.message_id = (uint16_t) _twr_radio.message_id;
+
+                                    _twr_radio.peer_devices[0].message_id = 0;
+                                }
+
+#endif
                             }
                         }
                         else if (tx_buffer[8] == TWR_RADIO_HEADER_SUB_REG)
@@ -761,7 +2043,15 @@ static void _twr_radio_spirit1_event_handler(twr_spirit1_event_t event, void *ev
                         }
                         else if ((length == 10) && (buffer[9] == _TWR_RADIO_ACK_SUB_REQUEST))
                         {
+                            // Gateway lost track of this node, subscriptions and subtopics are registered again
                             _twr_radio.sent_subs = 0;
+
+                            twr_radio_pub_topic_reset();
+
+                            if (_twr_radio.wake_interval != 0)
+                            {
+                                _twr_radio_wake_announce();
+                            }
                         }
 
                         if (_twr_radio.sleeping_mode_rx_timeout != 0)
@@ -782,6 +2072,15 @@ static void _twr_radio_spirit1_event_handler(twr_spirit1_event_t event, void *ev
                 return;
             }
 
+#if TWR_RADIO_SECURITY
+
+            if (!_twr_radio_open(buffer, &length))
+            {
+                return;
+            }
+
+#endif
+
             if (buffer[8] == TWR_RADIO_HEADER_PAIRING)
             {
                 if (_twr_radio.pairing_mode)
@@ -796,13 +2095,7 @@ static void _twr_radio_spirit1_event_handler(twr_spirit1_event_t event, void *ev
 
                 if (peer != NULL)
                 {
-                    _twr_radio_send_ack();
-
-                    uint8_t *tx_buffer = twr_spirit1_get_tx_buffer();
-
-                    twr_radio_id_to_buffer(&_twr_radio.my_id, tx_buffer + 9);
-
-                    twr_spirit1_set_tx_length(15);
+                    _twr_radio_send_ack(0);
 
                     if ((length > 10) && (peer->message_id != message_id))
                     {
@@ -826,12 +2119,22 @@ static void _twr_radio_spirit1_event_handler(twr_spirit1_event_t event, void *ev
                 return;
             }
 
-            if ((length == 15) && ((buffer[8] == TWR_RADIO_HEADER_NODE_ATTACH) || (buffer[8] == TWR_RADIO_HEADER_NODE_DETACH)))
+            if ((length == _TWR_RADIO_CONTROL_LENGTH) && ((buffer[8] == TWR_RADIO_HEADER_NODE_ATTACH) || (buffer[8] == TWR_RADIO_HEADER_NODE_DETACH)))
             {
                 uint64_t id;
 
                 twr_radio_id_from_buffer(buffer + 9, &id);
 
+#if TWR_RADIO_SECURITY
+
+                // Detach is taken only as response to the last frame sent to peer, recorded one is stale by then
+                if ((buffer[8] == TWR_RADIO_HEADER_NODE_DETACH) && !_twr_radio_control_is_response(buffer))
+                {
+                    id = 0;
+                }
+
+#endif
+
                 if (id == _twr_radio.my_id)
                 {
                     if (buffer[8] == TWR_RADIO_HEADER_NODE_ATTACH)
@@ -851,7 +2154,7 @@ static void _twr_radio_spirit1_event_handler(twr_spirit1_event_t event, void *ev
                     }
                 }
 
-                _twr_radio_send_ack();
+                _twr_radio_send_ack(0);
 
                 return;
             }
@@ -864,6 +2167,19 @@ static void _twr_radio_spirit1_event_handler(twr_spirit1_event_t event, void *ev
                 {
                     bool send_subs_request = _twr_radio.mode == TWR_RADIO_MODE_GATEWAY && (!peer->message_id_synced || (peer->message_id > message_id));
 
+#if TWR_RADIO_LINK_STATS
+                    // Node numbers its messages one by one, only gateway receives all of them
+                    if ((_twr_radio.mode == TWR_RADIO_MODE_GATEWAY) && peer->message_id_synced)
+                    {
+                        uint16_t gap = message_id - peer->message_id - 1;
+
+                        if (gap < _TWR_RADIO_LINK_GAP_MAX)
+                        {
+                            peer->rx_lost += gap;
+                        }
+                    }
+#endif
+
                     peer->message_id = message_id;
 
                     peer->message_id_synced = false;
@@ -874,58 +2190,199 @@ static void _twr_radio_spirit1_event_handler(twr_spirit1_event_t event, void *ev
                         {
                             uint64_t for_id;
 
-                            twr_radio_id_from_buffer(buffer + 9, &for_id);
+                            twr_radio_id_from_buffer(buffer + 9, &for_id);
+
+                            if (for_id != _twr_radio.my_id)
+                            {
+                                return;
+                            }
+                        }
+
+                        if (!twr_queue_put(&_twr_radio.rx_queue, buffer, length))
+                        {
+                            _twr_radio.rx_queue_overflow++;
+                        }
+
+                        twr_scheduler_plan_now(_twr_radio.task_id);
+
+                        peer->message_id_synced = true;
+
+#if TWR_RADIO_LINK_STATS
+                        peer->rx_count++;
+#endif
+
+                        _twr_radio_peer_rssi_update(peer, twr_spirit1_get_rx_rssi());
+
+                        // Gateway may not hear acknowledgement and go on with wake-up burst, node stays to acknowledge the copy
+                        if (_twr_radio.wake_interval != 0)
+                        {
+                            _twr_radio.rx_timeout_sleeping = twr_tick_get() + _TWR_RADIO_WAKE_RX_TIMEOUT;
+                        }
+                    }
+
+                    if (peer->message_id_synced)
+                    {
+                        _twr_radio_send_ack(send_subs_request ? _TWR_RADIO_ACK_SUB_REQUEST : 0);
+                    }
+
+                    return;
+                }
+
+#if TWR_RADIO_LINK_STATS
+                peer->rx_duplicate++;
+#endif
+
+                // Copy of message comes again only if acknowledgement was lost
+                if (peer->message_id_synced)
+                {
+                    _twr_radio_send_ack(0);
+                }
+            }
+            else
+            {
+                if (_twr_radio.scan && (_twr_radio.event_handler != NULL) && _twr_radio_scan_cache_push())
+                {
+                    _twr_radio.event_handler(TWR_RADIO_EVENT_SCAN_FIND_DEVICE, _twr_radio.event_param);
+                }
+
+                if (_twr_radio.automatic_pairing)
+                {
+                    twr_radio_peer_device_add(_twr_radio.peer_id);
+                }
+            }
+        }
+    }
+}
+
+static void _twr_radio_load_peer_devices(void)
+{
+    uint8_t record[_TWR_RADIO_PEER_JOURNAL_RECORD_SIZE];
+    uint32_t magic;
+    uint64_t id;
+
+    _twr_radio_peer_clear();
+
+    _twr_radio.peer_journal_head = 0;
+    _twr_radio.peer_journal_lap = 0;
+
+    twr_eeprom_read(twr_eeprom_get_size() - _TWR_RADIO_PEER_JOURNAL_HEADER_SIZE, &magic, sizeof(magic));
+
+    if (magic != _TWR_RADIO_PEER_JOURNAL_MAGIC)
+    {
+        if (magic == _TWR_RADIO_PEER_SLOTS_MAGIC)
+        {
+            _twr_radio_load_peer_devices_slots();
+        }
+        else
+        {
+            _twr_radio_load_peer_devices_legacy();
+        }
+
+        // Journal starts with copy of the whole list, header is written as the last step
+        _twr_radio.peer_journal_clear = true;
+        _twr_radio.peer_journal_header = true;
 
-                            if (for_id != _twr_radio.my_id)
-                            {
-                                return;
-                            }
-                        }
+        return;
+    }
 
-                        twr_queue_put(&_twr_radio.rx_queue, buffer, length);
+    // Head is the first record which is damaged or was not written in the same lap as the first one
+    if (_twr_radio_peer_journal_read(0, record))
+    {
+        _twr_radio.peer_journal_lap = record[0] & _TWR_RADIO_PEER_JOURNAL_LAP;
 
-                        twr_scheduler_plan_now(_twr_radio.task_id);
+        while ((_twr_radio.peer_journal_head < TWR_RADIO_PEER_JOURNAL_LENGTH) &&
+               _twr_radio_peer_journal_read(_twr_radio.peer_journal_head, record) &&
+               ((record[0] & _TWR_RADIO_PEER_JOURNAL_LAP) == _twr_radio.peer_journal_lap))
+        {
+            _twr_radio.peer_journal_head++;
+        }
 
-                        peer->message_id_synced = true;
+        if (_twr_radio.peer_journal_head == TWR_RADIO_PEER_JOURNAL_LENGTH)
+        {
+            _twr_radio.peer_journal_head = 0;
+            _twr_radio.peer_journal_lap ^= _TWR_RADIO_PEER_JOURNAL_LAP;
+        }
+    }
+    else if (_twr_radio_peer_journal_read(TWR_RADIO_PEER_JOURNAL_LENGTH - 1, record))
+    {
+        _twr_radio.peer_journal_lap = (record[0] & _TWR_RADIO_PEER_JOURNAL_LAP) ^ _TWR_RADIO_PEER_JOURNAL_LAP;
+    }
 
-                        peer->rssi = twr_spirit1_get_rx_rssi();
-                    }
+    // Records are replayed from the oldest one, that is from head around the ring
+    for (uint16_t i = 0; i < TWR_RADIO_PEER_JOURNAL_LENGTH; i++)
+    {
+        uint16_t position = (_twr_radio.peer_journal_head + i) % TWR_RADIO_PEER_JOURNAL_LENGTH;
 
-                    if (peer->message_id_synced)
-                    {
-                        _twr_radio_send_ack();
+        if (!_twr_radio_peer_journal_read(position, record))
+        {
+            continue;
+        }
 
-                        if (send_subs_request)
-                        {
-                            uint8_t *tx_buffer = twr_spirit1_get_tx_buffer();
+        uint8_t operation = record[0] & ~_TWR_RADIO_PEER_JOURNAL_LAP;
 
-                            tx_buffer[9] = _TWR_RADIO_ACK_SUB_REQUEST;
+        twr_radio_id_from_buffer(record + 1, &id);
 
-                            twr_spirit1_set_tx_length(10);
-                        }
-                    }
+        if (operation == _TWR_RADIO_PEER_JOURNAL_CLEAR)
+        {
+            _twr_radio_peer_clear();
+        }
+        else if (operation == _TWR_RADIO_PEER_JOURNAL_ADD)
+        {
+            _twr_radio_peer_insert(id);
 
-                    return;
-                }
-            }
-            else
+            uint16_t *entry = _twr_radio_peer_index_find(id);
+
+            if (entry != NULL)
             {
-                if (_twr_radio.scan && (_twr_radio.event_handler != NULL) && _twr_radio_scan_cache_push())
+                if (_twr_radio.peer_devices_record[*entry - 1] == UINT16_MAX)
                 {
-                    _twr_radio.event_handler(TWR_RADIO_EVENT_SCAN_FIND_DEVICE, _twr_radio.event_param);
+                    _twr_radio.peer_journal_unsaved--;
                 }
 
-                if (_twr_radio.automatic_pairing)
-                {
-                    twr_radio_peer_device_add(_twr_radio.peer_id);
-                }
+                _twr_radio.peer_devices_record[*entry - 1] = position;
+            }
+        }
+        else if (operation == _TWR_RADIO_PEER_JOURNAL_REMOVE)
+        {
+            uint16_t *entry = _twr_radio_peer_index_find(id);
+
+            if (entry != NULL)
+            {
+                _twr_radio_peer_erase(entry);
             }
         }
     }
 }
 
-static void _twr_radio_load_peer_devices(void)
+static void _twr_radio_load_peer_devices_slots(void)
+{
+    uint8_t record[_TWR_RADIO_PEER_JOURNAL_RECORD_SIZE];
+    uint16_t length;
+    uint64_t id;
+
+    twr_eeprom_read(twr_eeprom_get_size() - 4, &length, sizeof(length));
+
+    for (int i = 0; (i < length) && (i < TWR_RADIO_MAX_DEVICES); i++)
+    {
+        twr_eeprom_read(twr_eeprom_get_size() - 8 - (i + 1) * 8, record, sizeof(record));
+
+        if ((twr_crc8(0x31, record, TWR_RADIO_ID_SIZE, 0xff) != record[6]) || ((record[6] ^ record[7]) != 0xff))
+        {
+            continue;
+        }
+
+        twr_radio_id_from_buffer(record, &id);
+
+        if (id != 0)
+        {
+            _twr_radio_peer_insert(id);
+        }
+    }
+}
+
+static void _twr_radio_load_peer_devices_legacy(void)
 {
+    // Length in the last byte and three copies of every ID below
     uint32_t address = (uint32_t) twr_eeprom_get_size() - 8;
     uint64_t buffer[3];
     uint32_t *pointer = (uint32_t *)buffer;
@@ -933,8 +2390,6 @@ static void _twr_radio_load_peer_devices(void)
 
     twr_eeprom_read(twr_eeprom_get_size() - 1, &length, 1);
 
-    _twr_radio.peer_devices_length = 0;
-
     for (int i = 0; (i < length) && (i < TWR_RADIO_MAX_DEVICES); i++)
     {
         address -= sizeof(buffer);
@@ -949,10 +2404,6 @@ static void _twr_radio_load_peer_devices(void)
             if (buffer[1] == buffer[2])
             {
                 buffer[0] = buffer[1];
-
-                _twr_radio.save_peer_devices = true;
-
-                twr_scheduler_plan_now(_twr_radio.task_id);
             }
             else
             {
@@ -962,66 +2413,231 @@ static void _twr_radio_load_peer_devices(void)
 
         if (buffer[0] != 0)
         {
-            _twr_radio.peer_devices[_twr_radio.peer_devices_length].id = buffer[0];
-            _twr_radio.peer_devices[_twr_radio.peer_devices_length].message_id_synced = false;
-            _twr_radio.peer_devices_length++;
+            _twr_radio_peer_insert(buffer[0]);
         }
     }
 }
 
-static void _twr_radio_save_peer_devices(void)
+static void _twr_radio_peer_journal_clear(void)
 {
-    uint32_t address = (uint32_t) twr_eeprom_get_size() - 8;
-    uint64_t buffer_write[3];
-    uint32_t *pointer_write = (uint32_t *)buffer_write;
-    uint64_t buffer_read[3];
+    // Records queued so far are covered by the clear record, peers which remain are written again after it
+    twr_queue_clear(&_twr_radio.peer_journal_queue);
+
+    _twr_radio.peer_journal_clear = true;
+
+    twr_scheduler_plan_now(_twr_radio.task_id);
+}
+
+static void _twr_radio_peer_journal_remove(uint64_t id)
+{
+    uint8_t record[1 + TWR_RADIO_ID_SIZE];
+
+    if (_twr_radio.peer_journal_clear)
+    {
+        return;
+    }
+
+    record[0] = _TWR_RADIO_PEER_JOURNAL_REMOVE;
+
+    twr_radio_id_to_buffer(&id, record + 1);
+
+    if (!twr_queue_put(&_twr_radio.peer_journal_queue, record, sizeof(record)))
+    {
+        _twr_radio_peer_journal_clear();
+    }
+
+    twr_scheduler_plan_now(_twr_radio.task_id);
+}
+
+static void _twr_radio_peer_journal_update(void)
+{
+    uint8_t *record = _twr_radio.peer_journal_buffer;
+    uint32_t address = _twr_radio_peer_journal_address(_twr_radio.peer_journal_head);
+    size_t length;
+    uint64_t id;
 
-    _twr_radio.save_peer_devices = false;
+    if (_twr_radio.peer_journal_source != TWR_RADIO_PEER_JOURNAL_SOURCE_NONE)
+    {
+        return;
+    }
 
-    for (int i = 0; i < _twr_radio.peer_devices_length; i++)
+    // Record at head which still holds a peer is carried over to the current lap instead of being overwritten
+    if (_twr_radio_peer_journal_read(_twr_radio.peer_journal_head, record) && ((record[0] & ~_TWR_RADIO_PEER_JOURNAL_LAP) == _TWR_RADIO_PEER_JOURNAL_ADD))
     {
-        buffer_write[0] = _twr_radio.peer_devices[i].id;
-        buffer_write[1] = _twr_radio.peer_devices[i].id;
-        buffer_write[2] = _twr_radio.peer_devices[i].id;
+        twr_radio_id_from_buffer(record + 1, &id);
+
+        uint16_t *entry = _twr_radio_peer_index_find(id);
 
-        pointer_write[2] = ~pointer_write[2];
-        pointer_write[5] = ~pointer_write[5];
+        if ((entry != NULL) && (_twr_radio.peer_devices_record[*entry - 1] == _twr_radio.peer_journal_head))
+        {
+            _twr_radio.peer_journal_source = TWR_RADIO_PEER_JOURNAL_SOURCE_CARRY;
+        }
+    }
 
-        address -= sizeof(buffer_write);
+    if (_twr_radio.peer_journal_source == TWR_RADIO_PEER_JOURNAL_SOURCE_NONE)
+    {
+        if (_twr_radio.peer_journal_clear)
+        {
+            record[0] = _TWR_RADIO_PEER_JOURNAL_CLEAR;
 
-        twr_eeprom_read(address, buffer_read, sizeof(buffer_read));
+            memset(record + 1, 0, TWR_RADIO_ID_SIZE);
 
-        if (memcmp(buffer_read, buffer_write, sizeof(buffer_write)) != 0)
+            _twr_radio.peer_journal_source = TWR_RADIO_PEER_JOURNAL_SOURCE_CLEAR;
+        }
+        else if (twr_queue_peek(&_twr_radio.peer_journal_queue, record, &length))
+        {
+            _twr_radio.peer_journal_source = TWR_RADIO_PEER_JOURNAL_SOURCE_QUEUE;
+        }
+        else if (_twr_radio.peer_journal_unsaved > 0)
         {
-            if (!twr_eeprom_write(address, buffer_write, sizeof(buffer_write)))
+            // Added peers go to journal only after all queued removals, so that replay ends with the same list
+            for (int i = 0; i < _twr_radio.peer_devices_length; i++)
             {
-                _twr_radio.save_peer_devices = true;
+                if (_twr_radio.peer_devices_record[i] == UINT16_MAX)
+                {
+                    record[0] = _TWR_RADIO_PEER_JOURNAL_ADD;
 
-                twr_scheduler_plan_now(_twr_radio.task_id);
+                    twr_radio_id_to_buffer(&_twr_radio.peer_devices[i].id, record + 1);
 
-                return;
+                    _twr_radio.peer_journal_source = TWR_RADIO_PEER_JOURNAL_SOURCE_ADD;
+
+                    break;
+                }
             }
         }
     }
 
-    if (!twr_eeprom_write(twr_eeprom_get_size() - 1, &_twr_radio.peer_devices_length, 1))
+    if (_twr_radio.peer_journal_source != TWR_RADIO_PEER_JOURNAL_SOURCE_NONE)
+    {
+        record[0] = (record[0] & ~_TWR_RADIO_PEER_JOURNAL_LAP) | _twr_radio.peer_journal_lap;
+
+        record[7] = twr_crc8(0x31, record, 7, 0xff);
+    }
+    else if (_twr_radio.peer_journal_header)
+    {
+        uint32_t magic = _TWR_RADIO_PEER_JOURNAL_MAGIC;
+
+        memset(record, 0, _TWR_RADIO_PEER_JOURNAL_HEADER_SIZE);
+        memcpy(record, &magic, sizeof(magic));
+
+        address = twr_eeprom_get_size() - _TWR_RADIO_PEER_JOURNAL_HEADER_SIZE;
+
+        _twr_radio.peer_journal_source = TWR_RADIO_PEER_JOURNAL_SOURCE_HEADER;
+    }
+    else
+    {
+        return;
+    }
+
+    if (!twr_eeprom_async_write(address, record, _TWR_RADIO_PEER_JOURNAL_RECORD_SIZE, _twr_radio_peer_journal_event_handler, NULL))
+    {
+        // EEPROM is busy with another write, try again later
+        _twr_radio.peer_journal_source = TWR_RADIO_PEER_JOURNAL_SOURCE_NONE;
+
+        twr_scheduler_plan_relative(_twr_radio.task_id, 10);
+    }
+}
+
+static bool _twr_radio_peer_journal_read(uint16_t position, uint8_t *record)
+{
+    twr_eeprom_read(_twr_radio_peer_journal_address(position), record, _TWR_RADIO_PEER_JOURNAL_RECORD_SIZE);
+
+    uint8_t operation = record[0] & ~_TWR_RADIO_PEER_JOURNAL_LAP;
+
+    if ((operation != _TWR_RADIO_PEER_JOURNAL_ADD) && (operation != _TWR_RADIO_PEER_JOURNAL_REMOVE) && (operation != _TWR_RADIO_PEER_JOURNAL_CLEAR))
+    {
+        return false;
+    }
+
+    return twr_crc8(0x31, record, 7, 0xff) == record[7];
+}
+
+static uint32_t _twr_radio_peer_journal_address(uint16_t position)
+{
+    return (uint32_t) twr_eeprom_get_size() - _TWR_RADIO_PEER_JOURNAL_HEADER_SIZE - (TWR_RADIO_PEER_JOURNAL_LENGTH - position) * _TWR_RADIO_PEER_JOURNAL_RECORD_SIZE;
+}
+
+static void _twr_radio_peer_journal_event_handler(twr_eepromc_event_t event, void *event_param)
+{
+    (void) event_param;
+
+    twr_radio_peer_journal_source_t source = _twr_radio.peer_journal_source;
+
+    uint8_t *record = _twr_radio.peer_journal_buffer;
+
+    size_t length;
+
+    uint64_t id;
+
+    _twr_radio.peer_journal_source = TWR_RADIO_PEER_JOURNAL_SOURCE_NONE;
+
+    twr_scheduler_plan_now(_twr_radio.task_id);
+
+    // On error the same record is attempted again
+    if (event != TWR_EEPROM_EVENT_ASYNC_WRITE_DONE)
     {
-        _twr_radio.save_peer_devices = true;
+        return;
+    }
 
-        twr_scheduler_plan_now(_twr_radio.task_id);
+    if (source == TWR_RADIO_PEER_JOURNAL_SOURCE_HEADER)
+    {
+        _twr_radio.peer_journal_header = false;
 
         return;
     }
+
+    if (source == TWR_RADIO_PEER_JOURNAL_SOURCE_CLEAR)
+    {
+        _twr_radio.peer_journal_clear = false;
+
+        for (int i = 0; i < _twr_radio.peer_devices_length; i++)
+        {
+            _twr_radio.peer_devices_record[i] = UINT16_MAX;
+        }
+
+        _twr_radio.peer_journal_unsaved = _twr_radio.peer_devices_length;
+    }
+    else if (source == TWR_RADIO_PEER_JOURNAL_SOURCE_QUEUE)
+    {
+        twr_queue_get(&_twr_radio.peer_journal_queue, NULL, &length);
+    }
+    else
+    {
+        twr_radio_id_from_buffer(record + 1, &id);
+
+        uint16_t *entry = _twr_radio_peer_index_find(id);
+
+        if (entry != NULL)
+        {
+            if (_twr_radio.peer_devices_record[*entry - 1] == UINT16_MAX)
+            {
+                _twr_radio.peer_journal_unsaved--;
+            }
+
+            _twr_radio.peer_devices_record[*entry - 1] = _twr_radio.peer_journal_head;
+        }
+    }
+
+    if (++_twr_radio.peer_journal_head == TWR_RADIO_PEER_JOURNAL_LENGTH)
+    {
+        _twr_radio.peer_journal_head = 0;
+        _twr_radio.peer_journal_lap ^= _TWR_RADIO_PEER_JOURNAL_LAP;
+    }
 }
 
 static void _twr_radio_atsha204_event_handler(twr_atsha204_t *self, twr_atsha204_event_t event, void *event_param)
 {
     (void) event_param;
 
+    twr_event_flags_set(&_twr_radio.event_flags, _TWR_RADIO_FLAG_ID);
+
     if (event == TWR_ATSHA204_EVENT_SERIAL_NUMBER)
     {
         if (twr_atsha204_get_serial_number(self, &_twr_radio.my_id, sizeof(_twr_radio.my_id)))
         {
+            // Nodes powered up at once draw different back-off, zero would stop the generator
+            _twr_radio.random = (uint32_t) ((_twr_radio.my_id * 0x9e3779b97f4a7c15) >> 32) | 1;
+
             if (_twr_radio.event_handler != NULL)
             {
                 _twr_radio.event_handler(TWR_RADIO_EVENT_INIT_DONE, _twr_radio.event_param);
@@ -1046,7 +2662,7 @@ static void _twr_radio_atsha204_event_handler(twr_atsha204_t *self, twr_atsha204
 
 static bool _twr_radio_peer_device_add(uint64_t id)
 {
-    if (_twr_radio.peer_devices_length + 1 == TWR_RADIO_MAX_DEVICES)
+    if (_twr_radio.peer_devices_length == TWR_RADIO_MAX_DEVICES)
     {
         if (_twr_radio.event_handler != NULL)
         {
@@ -1061,11 +2677,8 @@ static bool _twr_radio_peer_device_add(uint64_t id)
         return false;
     }
 
-    _twr_radio.peer_devices[_twr_radio.peer_devices_length].id = id;
-    _twr_radio.peer_devices[_twr_radio.peer_devices_length].message_id_synced = false;
-    _twr_radio.peer_devices_length++;
+    _twr_radio_peer_insert(id);
 
-    _twr_radio.save_peer_devices = true;
     twr_scheduler_plan_now(_twr_radio.task_id);
 
     if (_twr_radio.event_handler != NULL)
@@ -1079,47 +2692,159 @@ static bool _twr_radio_peer_device_add(uint64_t id)
 
 static bool _twr_radio_peer_device_remove(uint64_t id)
 {
-    for (int i = 0; i < _twr_radio.peer_devices_length; i++)
-    {
-        if (id == _twr_radio.peer_devices[i].id)
-        {
-            _twr_radio.peer_devices_length--;
-            _twr_radio.peer_devices[i].id = 0;
+    uint16_t *entry = _twr_radio_peer_index_find(id);
 
-            if (i != _twr_radio.peer_devices_length)
-            {
-                memcpy(_twr_radio.peer_devices + i, _twr_radio.peer_devices + _twr_radio.peer_devices_length, sizeof(twr_radio_peer_t));
-            }
+    if (entry == NULL)
+    {
+        return false;
+    }
 
-            _twr_radio.save_peer_devices = true;
-            twr_scheduler_plan_now(_twr_radio.task_id);
+    _twr_radio_peer_erase(entry);
 
-            if (_twr_radio.event_handler != NULL)
-            {
-                _twr_radio.peer_id = id;
-                _twr_radio.event_handler(TWR_RADIO_EVENT_DETACH, _twr_radio.event_param);
-            }
+    _twr_radio_peer_journal_remove(id);
 
-            return true;
-        }
+    if (_twr_radio.event_handler != NULL)
+    {
+        _twr_radio.peer_id = id;
+        _twr_radio.event_handler(TWR_RADIO_EVENT_DETACH, _twr_radio.event_param);
     }
 
-    return false;
+    return true;
 }
 
 twr_radio_peer_t *twr_radio_get_peer_device(uint64_t id)
 {
-    for (int i = 0; i < _twr_radio.peer_devices_length; i++)
+    uint16_t *entry = _twr_radio_peer_index_find(id);
+
+    return entry != NULL ? &_twr_radio.peer_devices[*entry - 1] : NULL;
+}
+
+uint16_t twr_radio_get_pub_queue_overflow(void)
+{
+    return _twr_radio.pub_queue_overflow;
+}
+
+uint16_t twr_radio_get_rx_queue_overflow(void)
+{
+    return _twr_radio.rx_queue_overflow;
+}
+
+static uint32_t _twr_radio_peer_hash(uint64_t id)
+{
+    // Multiplicative hashing of both halves of 48-bit ID, upper bits of product are the best mixed
+    uint32_t hash = ((uint32_t) id ^ (uint32_t) (id >> 24)) * 0x9e3779b1;
+
+    return hash >> (32 - _TWR_RADIO_PEER_INDEX_BITS);
+}
+
+static uint16_t *_twr_radio_peer_index_find(uint64_t id)
+{
+    uint32_t i = _twr_radio_peer_hash(id);
+
+    // Entry holds slot in peer_devices plus one, zero marks free entry which ends the probe sequence
+    while (_twr_radio.peer_devices_index[i] != 0)
     {
-        if (id == _twr_radio.peer_devices[i].id)
+        if (_twr_radio.peer_devices[_twr_radio.peer_devices_index[i] - 1].id == id)
         {
-            return &_twr_radio.peer_devices[i];
+            return &_twr_radio.peer_devices_index[i];
         }
+
+        i = (i + 1) & _TWR_RADIO_PEER_INDEX_MASK;
     }
 
     return NULL;
 }
 
+static twr_radio_peer_t *_twr_radio_peer_insert(uint64_t id)
+{
+    if ((_twr_radio.peer_devices_length == TWR_RADIO_MAX_DEVICES) || (_twr_radio_peer_index_find(id) != NULL))
+    {
+        return NULL;
+    }
+
+    uint32_t i = _twr_radio_peer_hash(id);
+
+    while (_twr_radio.peer_devices_index[i] != 0)
+    {
+        i = (i + 1) & _TWR_RADIO_PEER_INDEX_MASK;
+    }
+
+    twr_radio_peer_t *peer = &_twr_radio.peer_devices[_twr_radio.peer_devices_length++];
+
+    memset(peer, 0, sizeof(*peer));
+
+    peer->id = id;
+
+    // Peer is not in journal yet, record is written by _twr_radio_peer_journal_update
+    _twr_radio.peer_devices_record[_twr_radio.peer_devices_length - 1] = UINT16_MAX;
+
+    _twr_radio.peer_journal_unsaved++;
+
+    _twr_radio.peer_devices_index[i] = _twr_radio.peer_devices_length;
+
+    return peer;
+}
+
+static void _twr_radio_peer_erase(uint16_t *entry)
+{
+    int slot = *entry - 1;
+    uint32_t i = entry - _twr_radio.peer_devices_index;
+    uint32_t j = i;
+
+    // Entries which follow in the same probe sequence are shifted back, so no tombstones are needed
+    for (;;)
+    {
+        j = (j + 1) & _TWR_RADIO_PEER_INDEX_MASK;
+
+        if (_twr_radio.peer_devices_index[j] == 0)
+        {
+            break;
+        }
+
+        uint32_t k = _twr_radio_peer_hash(_twr_radio.peer_devices[_twr_radio.peer_devices_index[j] - 1].id);
+
+        // Entry at j can move to i only if its home position is not cyclically within (i, j]
+        if (((j - k) & _TWR_RADIO_PEER_INDEX_MASK) >= ((j - i) & _TWR_RADIO_PEER_INDEX_MASK))
+        {
+            _twr_radio.peer_devices_index[i] = _twr_radio.peer_devices_index[j];
+
+            i = j;
+        }
+    }
+
+    _twr_radio.peer_devices_index[i] = 0;
+
+    if (_twr_radio.peer_devices_record[slot] == UINT16_MAX)
+    {
+        _twr_radio.peer_journal_unsaved--;
+    }
+
+    _twr_radio.peer_devices_length--;
+
+    // Keep peer_devices dense by moving the last peer to the freed slot
+    if (slot != _twr_radio.peer_devices_length)
+    {
+        uint16_t *last = _twr_radio_peer_index_find(_twr_radio.peer_devices[_twr_radio.peer_devices_length].id);
+
+        _twr_radio.peer_devices[slot] = _twr_radio.peer_devices[_twr_radio.peer_devices_length];
+        _twr_radio.peer_devices_record[slot] = _twr_radio.peer_devices_record[_twr_radio.peer_devices_length];
+
+        *last = slot + 1;
+    }
+
+    memset(&_twr_radio.peer_devices[_twr_radio.peer_devices_length], 0, sizeof(twr_radio_peer_t));
+}
+
+static void _twr_radio_peer_clear(void)
+{
+    memset(_twr_radio.peer_devices, 0, sizeof(_twr_radio.peer_devices));
+    memset(_twr_radio.peer_devices_index, 0, sizeof(_twr_radio.peer_devices_index));
+
+    _twr_radio.peer_devices_length = 0;
+
+    _twr_radio.peer_journal_unsaved = 0;
+}
+
 uint8_t *twr_radio_id_to_buffer(uint64_t *id, uint8_t *buffer)
 {
     buffer[0] = *id;
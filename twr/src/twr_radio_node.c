@@ -9,6 +9,37 @@ __attribute__((weak)) void twr_radio_node_on_led_strip_compound_set(uint64_t *id
 __attribute__((weak)) void twr_radio_node_on_led_strip_effect_set(uint64_t *id, twr_radio_node_led_strip_effect_t type, uint16_t wait, uint32_t *color) { (void) id; (void) type; (void) wait; (void) color; }
 __attribute__((weak)) void twr_radio_node_on_led_strip_thermometer_set(uint64_t *id, float *temperature, int8_t *min, int8_t *max, uint8_t *white_dots, float *set_point, uint32_t *set_point_color) { (void) id; (void) temperature; (void) min; (void) max; (void) white_dots; (void) set_point; (void) set_point_color; }
 
+static void _twr_radio_node_decode_state_set(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_node_decode_state_get(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_node_decode_buffer(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_node_decode_led_strip_color_set(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_node_decode_led_strip_brightness_set(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_node_decode_led_strip_compound_set(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_node_decode_led_strip_effect_set(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_node_decode_led_strip_thermometer_set(uint64_t *id, uint8_t *buffer, size_t length);
+
+typedef struct
+{
+    // Length of message including header and id of addressed node, 0 when decoder checks it on its own,
+    // decoder is given length of data behind the id
+    uint8_t length;
+    void (*decode)(uint64_t *id, uint8_t *buffer, size_t length);
+
+} _twr_radio_node_decoder_t;
+
+// Indexed by header, headers without decoder are left zeroed
+static const _twr_radio_node_decoder_t _twr_radio_node_decoder[] =
+{
+    [TWR_RADIO_HEADER_NODE_STATE_SET]                = { 1 + TWR_RADIO_ID_SIZE + sizeof(uint8_t) + sizeof(bool), _twr_radio_node_decode_state_set },
+    [TWR_RADIO_HEADER_NODE_STATE_GET]                = { 1 + TWR_RADIO_ID_SIZE + sizeof(uint8_t), _twr_radio_node_decode_state_get },
+    [TWR_RADIO_HEADER_NODE_BUFFER]                   = { 0, _twr_radio_node_decode_buffer },
+    [TWR_RADIO_HEADER_NODE_LED_STRIP_COLOR_SET]      = { 1 + TWR_RADIO_ID_SIZE + sizeof(uint32_t), _twr_radio_node_decode_led_strip_color_set },
+    [TWR_RADIO_HEADER_NODE_LED_STRIP_BRIGHTNESS_SET] = { 1 + TWR_RADIO_ID_SIZE + sizeof(uint8_t), _twr_radio_node_decode_led_strip_brightness_set },
+    [TWR_RADIO_HEADER_NODE_LED_STRIP_COMPOUND_SET]   = { 0, _twr_radio_node_decode_led_strip_compound_set },
+    [TWR_RADIO_HEADER_NODE_LED_STRIP_EFFECT_SET]     = { 1 + TWR_RADIO_ID_SIZE + 1 + sizeof(uint16_t) + sizeof(uint32_t), _twr_radio_node_decode_led_strip_effect_set },
+    [TWR_RADIO_HEADER_NODE_LED_STRIP_THERMOMETER_SET] = { 0, _twr_radio_node_decode_led_strip_thermometer_set },
+};
+
 
 bool twr_radio_node_state_set(uint64_t *id, uint8_t state_id, bool *state)
 {
@@ -145,87 +176,126 @@ bool twr_radio_node_led_strip_thermometer_set(uint64_t *id, float temperature, i
     return twr_radio_pub_queue_put(buffer, sizeof(buffer));
 }
 
-void twr_radio_node_decode(uint64_t *id, uint8_t *buffer, size_t length)
+bool twr_radio_node_decode(uint64_t *id, uint8_t *buffer, size_t length)
 {
-    (void) id;
-
-    uint64_t for_id;
-
-    if (length < TWR_RADIO_ID_SIZE + 1)
+    if (buffer[0] >= sizeof(_twr_radio_node_decoder) / sizeof(_twr_radio_node_decoder[0]))
     {
-        return;
+        return false;
     }
 
-    uint8_t *pbuffer = buffer + 1 + TWR_RADIO_ID_SIZE;
-    length = length - 1 - TWR_RADIO_ID_SIZE;
+    const _twr_radio_node_decoder_t *decoder = &_twr_radio_node_decoder[buffer[0]];
 
-    if (buffer[0] == TWR_RADIO_HEADER_NODE_STATE_SET)
-    {
-        bool state;
-        bool *pstate;
-
-        twr_radio_bool_from_buffer(pbuffer + 1, &state, &pstate);
-        twr_radio_id_from_buffer(buffer + 1, &for_id);
-        twr_radio_node_on_state_set(&for_id, pbuffer[0], pstate);
-    }
-    else if (buffer[0] == TWR_RADIO_HEADER_NODE_STATE_GET)
+    if (decoder->decode == NULL)
     {
-        twr_radio_id_from_buffer(buffer + 1, &for_id);
-        twr_radio_node_on_state_get(&for_id, pbuffer[0]);
+        return false;
     }
-    else if (buffer[0] == TWR_RADIO_HEADER_NODE_BUFFER)
+
+    if ((decoder->length == 0) ? (length >= 1 + TWR_RADIO_ID_SIZE) : (decoder->length == length))
     {
-        twr_radio_node_on_buffer(id, pbuffer, length);
+        decoder->decode(id, buffer, length - 1 - TWR_RADIO_ID_SIZE);
     }
-    else if (buffer[0] == TWR_RADIO_HEADER_NODE_LED_STRIP_COLOR_SET)
-    {
-        uint32_t color;
 
-        twr_radio_data_from_buffer(pbuffer, &color, sizeof(color));
+    return true;
+}
 
-        twr_radio_node_on_led_strip_color_set(id, &color);
-    }
-    else if (buffer[0] == TWR_RADIO_HEADER_NODE_LED_STRIP_BRIGHTNESS_SET)
-    {
-        twr_radio_node_on_led_strip_brightness_set(id, pbuffer);
-    }
-    else if (buffer[0] == TWR_RADIO_HEADER_NODE_LED_STRIP_COMPOUND_SET)
-    {
-        twr_radio_node_on_led_strip_compound_set(id, pbuffer, length);
-    }
-    else if (buffer[0] == TWR_RADIO_HEADER_NODE_LED_STRIP_EFFECT_SET)
-    {
-        twr_radio_node_led_strip_effect_t type = (twr_radio_node_led_strip_effect_t) *pbuffer++;
+static void _twr_radio_node_decode_state_set(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    (void) id;
+    (void) length;
 
-        uint16_t wait = (uint16_t) *pbuffer++;
-        wait |= (uint16_t) *pbuffer++ >> 8;
+    uint64_t for_id;
+    uint8_t *pbuffer = buffer + 1 + TWR_RADIO_ID_SIZE;
+    bool state;
+    bool *pstate;
 
-        uint32_t color;
+    twr_radio_bool_from_buffer(pbuffer + 1, &state, &pstate);
+    twr_radio_id_from_buffer(buffer + 1, &for_id);
+    twr_radio_node_on_state_set(&for_id, pbuffer[0], pstate);
+}
 
-        twr_radio_data_from_buffer(pbuffer, &color, sizeof(color));
+static void _twr_radio_node_decode_state_get(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    (void) id;
+    (void) length;
 
-        twr_radio_node_on_led_strip_effect_set(id, type, wait, &color);
-    }
-    else if (buffer[0] == TWR_RADIO_HEADER_NODE_LED_STRIP_THERMOMETER_SET)
-    {
-        float temperature;
-        float *ptemperature;
-        float set_point = 0;
-        float *pset_point = NULL;
-        uint32_t color = 0;
+    uint64_t for_id;
+    uint8_t *pbuffer = buffer + 1 + TWR_RADIO_ID_SIZE;
 
-        pbuffer = twr_radio_float_from_buffer(pbuffer, &temperature, &ptemperature);
-        int8_t *min = (int8_t *) pbuffer;
-        int8_t *max = (int8_t *) pbuffer + 1;
-        uint8_t *white_dots = (uint8_t *) pbuffer + 2;
+    twr_radio_id_from_buffer(buffer + 1, &for_id);
+    twr_radio_node_on_state_get(&for_id, pbuffer[0]);
+}
+
+static void _twr_radio_node_decode_buffer(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    twr_radio_node_on_buffer(id, buffer + 1 + TWR_RADIO_ID_SIZE, length);
+}
+
+static void _twr_radio_node_decode_led_strip_color_set(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    (void) length;
+
+    uint32_t color;
 
-        if (length == sizeof(float) + sizeof(int8_t) + sizeof(int8_t) + sizeof(uint8_t) + sizeof(float) + sizeof(uint32_t))
-        {
-            pbuffer = twr_radio_float_from_buffer(pbuffer + 3, &set_point, &pset_point);
+    twr_radio_data_from_buffer(buffer + 1 + TWR_RADIO_ID_SIZE, &color, sizeof(color));
 
-            twr_radio_data_from_buffer(pbuffer, &color, sizeof(color));
-        }
+    twr_radio_node_on_led_strip_color_set(id, &color);
+}
+
+static void _twr_radio_node_decode_led_strip_brightness_set(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    (void) length;
+
+    twr_radio_node_on_led_strip_brightness_set(id, buffer + 1 + TWR_RADIO_ID_SIZE);
+}
+
+static void _twr_radio_node_decode_led_strip_compound_set(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    twr_radio_node_on_led_strip_compound_set(id, buffer + 1 + TWR_RADIO_ID_SIZE, length);
+}
+
+static void _twr_radio_node_decode_led_strip_effect_set(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    (void) length;
+
+    uint8_t *pbuffer = buffer + 1 + TWR_RADIO_ID_SIZE;
 
-        twr_radio_node_on_led_strip_thermometer_set(id, ptemperature, min, max, white_dots, pset_point, &color);
+    twr_radio_node_led_strip_effect_t type = (twr_radio_node_led_strip_effect_t) *pbuffer++;
+
+    uint16_t wait = (uint16_t) *pbuffer++;
+    wait |= (uint16_t) *pbuffer++ << 8;
+
+    uint32_t color;
+
+    twr_radio_data_from_buffer(pbuffer, &color, sizeof(color));
+
+    twr_radio_node_on_led_strip_effect_set(id, type, wait, &color);
+}
+
+static void _twr_radio_node_decode_led_strip_thermometer_set(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    uint8_t *pbuffer = buffer + 1 + TWR_RADIO_ID_SIZE;
+    float temperature;
+    float *ptemperature;
+    float set_point = 0;
+    float *pset_point = NULL;
+    uint32_t color = 0;
+
+    if (length < sizeof(float) + sizeof(int8_t) + sizeof(int8_t) + sizeof(uint8_t))
+    {
+        return;
     }
+
+    pbuffer = twr_radio_float_from_buffer(pbuffer, &temperature, &ptemperature);
+    int8_t *min = (int8_t *) pbuffer;
+    int8_t *max = (int8_t *) pbuffer + 1;
+    uint8_t *white_dots = (uint8_t *) pbuffer + 2;
+
+    if (length == sizeof(float) + sizeof(int8_t) + sizeof(int8_t) + sizeof(uint8_t) + sizeof(float) + sizeof(uint32_t))
+    {
+        pbuffer = twr_radio_float_from_buffer(pbuffer + 3, &set_point, &pset_point);
+
+        twr_radio_data_from_buffer(pbuffer, &color, sizeof(color));
+    }
+
+    twr_radio_node_on_led_strip_thermometer_set(id, ptemperature, min, max, white_dots, pset_point, &color);
 }
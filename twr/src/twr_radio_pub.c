@@ -1,6 +1,115 @@
 #include <twr_radio_pub.h>
 
 #define _TWR_RADIO_PUB_BUFFER_SIZE_ACCELERATION (1 + sizeof(float) + sizeof(float) + sizeof(float))
+#define _TWR_RADIO_PUB_BUFFER_SIZE_LINK (1 + 3 + 6 * sizeof(uint16_t))
+
+// Flag in subtopic id byte of TWR_RADIO_HEADER_PUB_TOPIC_ID, float value follows as half-float
+#define _TWR_RADIO_PUB_TOPIC_ID_HALF 0x80
+
+#if TWR_RADIO_PUB_TOPIC_LENGTH > 128
+#error "TWR_RADIO_PUB_TOPIC_LENGTH is limited to 128"
+#endif
+
+#if TWR_RADIO_PUB_TOPIC_LENGTH
+
+// Subtopics registered with gateway, position is subtopic id, name is kept only as hash
+static struct
+{
+    uint32_t hash[TWR_RADIO_PUB_TOPIC_LENGTH];
+    uint8_t type[TWR_RADIO_PUB_TOPIC_LENGTH];
+    int length;
+
+} _twr_radio_pub_topic;
+
+static int _twr_radio_pub_topic_get(const char *subtopic, uint8_t type);
+static uint32_t _twr_radio_pub_topic_hash(const char *subtopic);
+static uint8_t *_twr_radio_pub_varint_to_buffer(uint32_t value, uint8_t *buffer);
+static bool _twr_radio_pub_half_from_float(float value, uint16_t *half);
+
+#endif
+
+#if TWR_RADIO_PUB_TOPIC_GATEWAY_LENGTH
+
+typedef struct
+{
+    uint64_t id;
+    uint8_t topic_id;
+    uint8_t type;
+    char subtopic[TWR_RADIO_MAX_TOPIC_LEN + 1];
+
+} _twr_radio_pub_topic_entry_t;
+
+// Subtopics registered by all nodes, the oldest entry is replaced when there is no free one
+static struct
+{
+    _twr_radio_pub_topic_entry_t entry[TWR_RADIO_PUB_TOPIC_GATEWAY_LENGTH];
+    int head;
+
+} _twr_radio_pub_topic_gateway;
+
+static void _twr_radio_pub_topic_reg_decode(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_topic_id_decode(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_topic_request(uint64_t id);
+static uint8_t *_twr_radio_pub_varint_from_buffer(uint8_t *buffer, uint8_t *end, uint32_t *value);
+static float _twr_radio_pub_half_to_float(uint16_t half);
+
+#endif
+
+static void _twr_radio_pub_decode_push_button(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_decode_event_count(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_decode_temperature(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_decode_humidity(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_decode_lux_meter(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_decode_barometer(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_decode_co2(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_decode_battery(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_decode_acceleration(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_decode_buffer(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_decode_state(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_decode_topic_bool(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_decode_topic_int(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_decode_topic_uint32(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_decode_topic_float(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_decode_topic_string(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_decode_value_int(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_decode_batch(uint64_t *id, uint8_t *buffer, size_t length);
+static void _twr_radio_pub_decode_link(uint64_t *id, uint8_t *buffer, size_t length);
+
+typedef struct
+{
+    // Length of message including header, 0 when decoder checks it on its own
+    uint8_t length;
+    void (*decode)(uint64_t *id, uint8_t *buffer, size_t length);
+
+} _twr_radio_pub_decoder_t;
+
+// Indexed by header, headers without decoder are left zeroed
+static const _twr_radio_pub_decoder_t _twr_radio_pub_decoder[] =
+{
+    [TWR_RADIO_HEADER_PUB_PUSH_BUTTON]  = { 1 + sizeof(uint16_t), _twr_radio_pub_decode_push_button },
+    [TWR_RADIO_HEADER_PUB_EVENT_COUNT]  = { 1 + sizeof(uint8_t) + sizeof(uint16_t), _twr_radio_pub_decode_event_count },
+    [TWR_RADIO_HEADER_PUB_TEMPERATURE]  = { 1 + sizeof(uint8_t) + sizeof(float), _twr_radio_pub_decode_temperature },
+    [TWR_RADIO_HEADER_PUB_HUMIDITY]     = { 1 + sizeof(uint8_t) + sizeof(float), _twr_radio_pub_decode_humidity },
+    [TWR_RADIO_HEADER_PUB_LUX_METER]    = { 1 + sizeof(uint8_t) + sizeof(float), _twr_radio_pub_decode_lux_meter },
+    [TWR_RADIO_HEADER_PUB_BAROMETER]    = { 1 + sizeof(uint8_t) + sizeof(float) + sizeof(float), _twr_radio_pub_decode_barometer },
+    [TWR_RADIO_HEADER_PUB_CO2]          = { 1 + sizeof(float), _twr_radio_pub_decode_co2 },
+    [TWR_RADIO_HEADER_PUB_BATTERY]      = { 0, _twr_radio_pub_decode_battery },
+    [TWR_RADIO_HEADER_PUB_ACCELERATION] = { _TWR_RADIO_PUB_BUFFER_SIZE_ACCELERATION, _twr_radio_pub_decode_acceleration },
+    [TWR_RADIO_HEADER_PUB_BUFFER]       = { 0, _twr_radio_pub_decode_buffer },
+    [TWR_RADIO_HEADER_PUB_STATE]        = { 1 + sizeof(uint8_t) + sizeof(bool), _twr_radio_pub_decode_state },
+    [TWR_RADIO_HEADER_PUB_TOPIC_BOOL]   = { 0, _twr_radio_pub_decode_topic_bool },
+    [TWR_RADIO_HEADER_PUB_TOPIC_INT]    = { 0, _twr_radio_pub_decode_topic_int },
+    [TWR_RADIO_HEADER_PUB_TOPIC_UINT32] = { 0, _twr_radio_pub_decode_topic_uint32 },
+    [TWR_RADIO_HEADER_PUB_TOPIC_FLOAT]  = { 0, _twr_radio_pub_decode_topic_float },
+    [TWR_RADIO_HEADER_PUB_TOPIC_STRING] = { 0, _twr_radio_pub_decode_topic_string },
+    [TWR_RADIO_HEADER_PUB_VALUE_INT]    = { 1 + sizeof(uint8_t) + sizeof(int), _twr_radio_pub_decode_value_int },
+    [TWR_RADIO_HEADER_PUB_BATCH]        = { 0, _twr_radio_pub_decode_batch },
+    [TWR_RADIO_HEADER_PUB_LINK]         = { _TWR_RADIO_PUB_BUFFER_SIZE_LINK, _twr_radio_pub_decode_link },
+#if TWR_RADIO_PUB_TOPIC_GATEWAY_LENGTH
+    [TWR_RADIO_HEADER_PUB_TOPIC_REG]    = { 0, _twr_radio_pub_topic_reg_decode },
+    [TWR_RADIO_HEADER_PUB_TOPIC_ID]     = { 0, _twr_radio_pub_topic_id_decode },
+#endif
+};
 
 __attribute__((weak)) void twr_radio_pub_on_event_count(uint64_t *id, uint8_t event_id, uint16_t *event_count) { (void) id; (void) event_id; (void) event_count; }
 __attribute__((weak)) void twr_radio_pub_on_push_button(uint64_t *id, uint16_t *event_count) { (void) id; (void) event_count; }
@@ -19,6 +128,7 @@ __attribute__((weak)) void twr_radio_pub_on_uint32(uint64_t *id, char *subtopic,
 __attribute__((weak)) void twr_radio_pub_on_float(uint64_t *id, char *subtopic, float *value) { (void) id; (void) subtopic; (void) value; }
 __attribute__((weak)) void twr_radio_pub_on_string(uint64_t *id, char *subtopic, char *value) { (void) id; (void) subtopic; (void) value; }
 __attribute__((weak)) void twr_radio_pub_on_value_int(uint64_t *id, uint8_t value_id, int *value) { (void) id; (void) value_id; (void) value; }
+__attribute__((weak)) void twr_radio_pub_on_link(uint64_t *id, twr_radio_pub_link_t *link) { (void) id; (void) link; }
 
 
 bool twr_radio_pub_event_count(uint8_t event_id, uint16_t *event_count)
@@ -175,6 +285,20 @@ bool twr_radio_pub_bool(const char *subtopic, bool *value)
 
     uint8_t buffer[TWR_RADIO_MAX_BUFFER_SIZE];
 
+#if TWR_RADIO_PUB_TOPIC_LENGTH
+    int topic_id = _twr_radio_pub_topic_get(subtopic, TWR_RADIO_HEADER_PUB_TOPIC_BOOL);
+
+    if (topic_id >= 0)
+    {
+        buffer[0] = TWR_RADIO_HEADER_PUB_TOPIC_ID;
+        buffer[1] = topic_id;
+
+        twr_radio_bool_to_buffer(value, buffer + 2);
+
+        return twr_radio_pub_queue_put(buffer, 3);
+    }
+#endif
+
     buffer[0] = TWR_RADIO_HEADER_PUB_TOPIC_BOOL;
 
     twr_radio_bool_to_buffer(value, buffer + 1);
@@ -195,6 +319,23 @@ bool twr_radio_pub_int(const char *subtopic, int *value)
 
     uint8_t buffer[TWR_RADIO_MAX_BUFFER_SIZE];
 
+#if TWR_RADIO_PUB_TOPIC_LENGTH
+    int topic_id = _twr_radio_pub_topic_get(subtopic, TWR_RADIO_HEADER_PUB_TOPIC_INT);
+
+    if (topic_id >= 0)
+    {
+        buffer[0] = TWR_RADIO_HEADER_PUB_TOPIC_ID;
+        buffer[1] = topic_id;
+
+        int v = value != NULL ? *value : TWR_RADIO_NULL_INT;
+
+        // Zigzag encoding keeps small negative numbers short too
+        uint8_t *end = _twr_radio_pub_varint_to_buffer(((uint32_t) v << 1) ^ (uint32_t) (v >> 31), buffer + 2);
+
+        return twr_radio_pub_queue_put(buffer, end - buffer);
+    }
+#endif
+
     buffer[0] = TWR_RADIO_HEADER_PUB_TOPIC_INT;
 
     twr_radio_int_to_buffer(value, buffer + 1);
@@ -215,6 +356,20 @@ bool twr_radio_pub_uint32(const char *subtopic, uint32_t *value)
 
     uint8_t buffer[TWR_RADIO_MAX_BUFFER_SIZE];
 
+#if TWR_RADIO_PUB_TOPIC_LENGTH
+    int topic_id = _twr_radio_pub_topic_get(subtopic, TWR_RADIO_HEADER_PUB_TOPIC_UINT32);
+
+    if (topic_id >= 0)
+    {
+        buffer[0] = TWR_RADIO_HEADER_PUB_TOPIC_ID;
+        buffer[1] = topic_id;
+
+        uint8_t *end = _twr_radio_pub_varint_to_buffer(value != NULL ? *value : TWR_RADIO_NULL_UINT32, buffer + 2);
+
+        return twr_radio_pub_queue_put(buffer, end - buffer);
+    }
+#endif
+
     buffer[0] = TWR_RADIO_HEADER_PUB_TOPIC_UINT32;
 
     twr_radio_uint32_to_buffer(value, buffer + 1);
@@ -235,6 +390,32 @@ bool twr_radio_pub_float(const char *subtopic, float *value)
 
     uint8_t buffer[TWR_RADIO_MAX_BUFFER_SIZE];
 
+#if TWR_RADIO_PUB_TOPIC_LENGTH
+    int topic_id = _twr_radio_pub_topic_get(subtopic, TWR_RADIO_HEADER_PUB_TOPIC_FLOAT);
+
+    if (topic_id >= 0)
+    {
+        buffer[0] = TWR_RADIO_HEADER_PUB_TOPIC_ID;
+        buffer[1] = topic_id;
+
+        uint16_t half;
+
+        // Half-float is used only when it holds the value exactly
+        if (_twr_radio_pub_half_from_float(value != NULL ? *value : TWR_RADIO_NULL_FLOAT, &half))
+        {
+            buffer[1] |= _TWR_RADIO_PUB_TOPIC_ID_HALF;
+
+            twr_radio_uint16_to_buffer(&half, buffer + 2);
+
+            return twr_radio_pub_queue_put(buffer, 2 + sizeof(half));
+        }
+
+        twr_radio_float_to_buffer(value, buffer + 2);
+
+        return twr_radio_pub_queue_put(buffer, 2 + sizeof(float));
+    }
+#endif
+
     buffer[0] = TWR_RADIO_HEADER_PUB_TOPIC_FLOAT;
 
     twr_radio_float_to_buffer(value, buffer + 1);
@@ -248,14 +429,30 @@ bool twr_radio_pub_string(const char *subtopic, const char *value)
 {
     size_t len = strlen(subtopic);
     size_t len_value = strlen(value);
+    uint8_t buffer[TWR_RADIO_MAX_BUFFER_SIZE];
+
+#if TWR_RADIO_PUB_TOPIC_LENGTH
+    if ((len <= TWR_RADIO_MAX_TOPIC_LEN) && (len_value <= (TWR_RADIO_MAX_BUFFER_SIZE - 3)))
+    {
+        int topic_id = _twr_radio_pub_topic_get(subtopic, TWR_RADIO_HEADER_PUB_TOPIC_STRING);
+
+        if (topic_id >= 0)
+        {
+            buffer[0] = TWR_RADIO_HEADER_PUB_TOPIC_ID;
+            buffer[1] = topic_id;
+
+            strcpy((char *) buffer + 2, value);
+
+            return twr_radio_pub_queue_put(buffer, len_value + 3);
+        }
+    }
+#endif
 
     if (len + len_value > (TWR_RADIO_MAX_BUFFER_SIZE - 3))
     {
         return false;
     }
 
-    uint8_t buffer[TWR_RADIO_MAX_BUFFER_SIZE];
-
     buffer[0] = TWR_RADIO_HEADER_PUB_TOPIC_STRING;
 
     strcpy((char *)buffer + 1, subtopic);
@@ -264,238 +461,699 @@ bool twr_radio_pub_string(const char *subtopic, const char *value)
     return twr_radio_pub_queue_put(buffer, len + len_value + 3);
 }
 
-void twr_radio_pub_decode(uint64_t *id, uint8_t *buffer, size_t length)
+bool twr_radio_pub_link(void)
+{
+    uint64_t id;
+
+    twr_radio_get_peer_id(&id, 1);
+
+    twr_radio_peer_t *peer = twr_radio_get_peer_device(id);
+
+    if (peer == NULL)
+    {
+        return false;
+    }
+
+    uint8_t buffer[_TWR_RADIO_PUB_BUFFER_SIZE_LINK];
+
+    buffer[0] = TWR_RADIO_HEADER_PUB_LINK;
+#if TWR_RADIO_LINK_STATS
+    buffer[1] = peer->rssi_min;
+    buffer[2] = peer->rssi_max;
+    buffer[3] = peer->rssi_avg;
+#else
+    buffer[1] = peer->rssi;
+    buffer[2] = peer->rssi;
+    buffer[3] = peer->rssi;
+#endif
+
+    uint8_t *pointer = twr_radio_uint16_to_buffer(&peer->tx_count, buffer + 4);
+    pointer = twr_radio_uint16_to_buffer(&peer->tx_retry, pointer);
+    pointer = twr_radio_uint16_to_buffer(&peer->tx_busy, pointer);
+    pointer = twr_radio_uint16_to_buffer(&peer->tx_success, pointer);
+    pointer = twr_radio_uint16_to_buffer(&peer->tx_error, pointer);
+
+    uint16_t pub_queue_overflow = twr_radio_get_pub_queue_overflow();
+
+    twr_radio_uint16_to_buffer(&pub_queue_overflow, pointer);
+
+    return twr_radio_pub_queue_put(buffer, sizeof(buffer));
+}
+
+bool twr_radio_pub_decode(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    if (buffer[0] >= sizeof(_twr_radio_pub_decoder) / sizeof(_twr_radio_pub_decoder[0]))
+    {
+        return false;
+    }
+
+    const _twr_radio_pub_decoder_t *decoder = &_twr_radio_pub_decoder[buffer[0]];
+
+    if (decoder->decode == NULL)
+    {
+        return false;
+    }
+
+    if ((decoder->length == 0) || (decoder->length == length))
+    {
+        decoder->decode(id, buffer, length);
+    }
+
+    return true;
+}
+
+void twr_radio_pub_topic_reset(void)
+{
+#if TWR_RADIO_PUB_TOPIC_LENGTH
+    // Subtopic ids are assigned again from zero and each subtopic is registered with its next publish
+    _twr_radio_pub_topic.length = 0;
+#endif
+}
+
+static void _twr_radio_pub_decode_push_button(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    (void) length;
+
+    uint16_t event_count;
+    uint16_t *pevent_count;
+
+    twr_radio_uint16_from_buffer(buffer + 1, &event_count, &pevent_count);
+
+    twr_radio_pub_on_push_button(id, &event_count);
+
+    twr_radio_pub_on_event_count(id, TWR_RADIO_PUB_EVENT_PUSH_BUTTON, pevent_count);
+}
+
+static void _twr_radio_pub_decode_event_count(uint64_t *id, uint8_t *buffer, size_t length)
 {
+    (void) length;
 
-    if (buffer[0] == TWR_RADIO_HEADER_PUB_PUSH_BUTTON)
+    uint16_t event_count;
+    uint16_t *pevent_count;
+
+    twr_radio_uint16_from_buffer(buffer + 2, &event_count, &pevent_count);
+
+    if (buffer[1] == TWR_RADIO_PUB_EVENT_PUSH_BUTTON)
     {
-        uint16_t event_count;
-        uint16_t *pevent_count;
+        twr_radio_pub_on_push_button(id, pevent_count);
+    }
+
+    twr_radio_pub_on_event_count(id, buffer[1], pevent_count);
+}
+
+static void _twr_radio_pub_decode_temperature(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    (void) length;
+
+    float celsius;
+    float *pcelsius;
 
-        twr_radio_uint16_from_buffer(buffer + 1, &event_count, &pevent_count);
+    twr_radio_float_from_buffer(buffer + 2, &celsius, &pcelsius);
 
-        twr_radio_pub_on_push_button(id, &event_count);
+    twr_radio_pub_on_temperature(id, buffer[1], pcelsius);
+}
+
+static void _twr_radio_pub_decode_humidity(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    (void) length;
+
+    float percentage;
+    float *ppercentage;
+
+    twr_radio_float_from_buffer(buffer + 2, &percentage, &ppercentage);
+
+    twr_radio_pub_on_humidity(id, buffer[1], ppercentage);
+}
+
+static void _twr_radio_pub_decode_lux_meter(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    (void) length;
+
+    float lux;
+    float *plux;
+
+    twr_radio_float_from_buffer(buffer + 2, &lux, &plux);
+
+    twr_radio_pub_on_lux_meter(id, buffer[1], plux);
+}
+
+static void _twr_radio_pub_decode_barometer(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    (void) length;
+
+    float pascal;
+    float *ppascal;
+    float meter;
+    float *pmeter;
+
+    uint8_t *pointer = twr_radio_float_from_buffer(buffer + 2, &pascal, &ppascal);
+
+    twr_radio_float_from_buffer(pointer, &meter, &pmeter);
+
+    twr_radio_pub_on_barometer(id, buffer[1], ppascal, pmeter);
+}
+
+static void _twr_radio_pub_decode_co2(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    (void) length;
 
-        twr_radio_pub_on_event_count(id, TWR_RADIO_PUB_EVENT_PUSH_BUTTON, pevent_count);
+    float concentration;
+    float *pconcentration;
+
+    twr_radio_float_from_buffer(buffer + 1, &concentration, &pconcentration);
+
+    twr_radio_pub_on_co2(id, pconcentration);
+}
+
+static void _twr_radio_pub_decode_battery(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    float voltage;
+    float *pvoltage;
+
+    if (length == (1 + sizeof(float)))
+    {
+        twr_radio_float_from_buffer(buffer + 1, &voltage, &pvoltage);
+    }
+    else if (length == (1 + 1 + sizeof(float)))
+    {
+        // Old format
+        twr_radio_float_from_buffer(buffer + 2, &voltage, &pvoltage);
     }
-    else if (buffer[0] == TWR_RADIO_HEADER_PUB_EVENT_COUNT)
+    else
     {
-        uint16_t event_count;
-        uint16_t *pevent_count;
+        return;
+    }
+
+    twr_radio_pub_on_battery(id, pvoltage);
+}
+
+static void _twr_radio_pub_decode_acceleration(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    (void) length;
+
+    float x_axis;
+    float *px_axis;
+    float y_axis;
+    float *py_axis;
+    float z_axis;
+    float *pz_axis;
+
+    buffer = twr_radio_float_from_buffer(buffer + 1, &x_axis, &px_axis);
+
+    buffer = twr_radio_float_from_buffer(buffer, &y_axis, &py_axis);
+
+    twr_radio_float_from_buffer(buffer, &z_axis, &pz_axis);
+
+    twr_radio_pub_on_acceleration(id, px_axis, py_axis, pz_axis);
+}
+
+static void _twr_radio_pub_decode_buffer(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    twr_radio_pub_on_buffer(id, buffer + 1, length - 1);
+}
+
+static void _twr_radio_pub_decode_state(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    (void) length;
+
+    bool state;
+    bool *pstate = NULL;
+
+    twr_radio_bool_from_buffer(buffer + 2, &state, &pstate);
+
+    twr_radio_pub_on_state(id, buffer[1], pstate);
+}
+
+static void _twr_radio_pub_decode_topic_bool(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    bool value;
+    bool *pvalue;
+
+    buffer[length - 1] = 0;
+
+    char *subtopic = (char *) twr_radio_bool_from_buffer(buffer + 1, &value, &pvalue);
+
+    twr_radio_pub_on_bool(id, subtopic, pvalue);
+}
+
+static void _twr_radio_pub_decode_topic_int(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    int value;
+    int *pvalue;
+
+    buffer[length - 1] = 0;
+
+    char *subtopic = (char *) twr_radio_int_from_buffer(buffer + 1, &value, &pvalue);
+
+    twr_radio_pub_on_int(id, subtopic, pvalue);
+}
+
+static void _twr_radio_pub_decode_topic_uint32(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    uint32_t value;
+    uint32_t *pvalue;
 
-        if (length != (1 + sizeof(uint8_t) + sizeof(uint16_t)))
+    buffer[length - 1] = 0;
+
+    char *subtopic = (char *) twr_radio_uint32_from_buffer(buffer + 1, &value, &pvalue);
+
+    twr_radio_pub_on_uint32(id, subtopic, pvalue);
+}
+
+static void _twr_radio_pub_decode_topic_float(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    float value;
+    float *pvalue;
+
+    buffer[length - 1] = 0;
+
+    char *subtopic = (char *) twr_radio_float_from_buffer(buffer + 1, &value, &pvalue);
+
+    twr_radio_pub_on_float(id, subtopic, pvalue);
+}
+
+static void _twr_radio_pub_decode_topic_string(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    buffer[length - 1] = 0;
+
+    size_t len = strlen((char *) buffer + 1);
+
+    twr_radio_pub_on_string(id, (char *) buffer + 1, (char *) buffer + 2 + len);
+}
+
+static void _twr_radio_pub_decode_value_int(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    (void) length;
+
+    int value;
+    int *pvalue;
+
+    twr_radio_int_from_buffer(buffer + 2, &value, &pvalue);
+
+    twr_radio_pub_on_value_int(id, buffer[1], pvalue);
+}
+
+static void _twr_radio_pub_decode_batch(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    size_t offset = 1;
+
+    // Each record is prefixed by its length and decoded as if it came in a message of its own
+    while (offset < length)
+    {
+        size_t record_length = buffer[offset++];
+
+        if ((record_length == 0) || (offset + record_length > length))
         {
             return;
         }
 
-        twr_radio_uint16_from_buffer(buffer + 2, &event_count, &pevent_count);
-
-        if (buffer[1] == TWR_RADIO_PUB_EVENT_PUSH_BUTTON)
+        if (buffer[offset] != TWR_RADIO_HEADER_PUB_BATCH)
         {
-            twr_radio_pub_on_push_button(id, pevent_count);
+            twr_radio_pub_decode(id, buffer + offset, record_length);
         }
 
-        twr_radio_pub_on_event_count(id, buffer[1], pevent_count);
+        offset += record_length;
     }
-    else if (buffer[0] == TWR_RADIO_HEADER_PUB_TEMPERATURE)
-    {
-        float celsius;
-        float *pcelsius;
+}
+
+static void _twr_radio_pub_decode_link(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    (void) length;
+
+    twr_radio_pub_link_t link;
+
+    link.rssi_min = (int8_t) buffer[1];
+    link.rssi_max = (int8_t) buffer[2];
+    link.rssi_avg = (int8_t) buffer[3];
+
+    uint8_t *pointer = twr_radio_data_from_buffer(buffer + 4, &link.tx_count, sizeof(uint16_t));
+    pointer = twr_radio_data_from_buffer(pointer, &link.tx_retry, sizeof(uint16_t));
+    pointer = twr_radio_data_from_buffer(pointer, &link.tx_busy, sizeof(uint16_t));
+    pointer = twr_radio_data_from_buffer(pointer, &link.tx_success, sizeof(uint16_t));
+    pointer = twr_radio_data_from_buffer(pointer, &link.tx_error, sizeof(uint16_t));
+    twr_radio_data_from_buffer(pointer, &link.pub_queue_overflow, sizeof(uint16_t));
 
-        if (length != (1 + sizeof(uint8_t) + sizeof(float)))
+    twr_radio_pub_on_link(id, &link);
+}
+
+#if TWR_RADIO_PUB_TOPIC_LENGTH
+
+static int _twr_radio_pub_topic_get(const char *subtopic, uint8_t type)
+{
+    uint32_t hash = _twr_radio_pub_topic_hash(subtopic);
+
+    for (int i = 0; i < _twr_radio_pub_topic.length; i++)
+    {
+        if ((_twr_radio_pub_topic.hash[i] == hash) && (_twr_radio_pub_topic.type[i] == type))
         {
-            return;
+            return i;
         }
+    }
 
-        twr_radio_float_from_buffer(buffer + 2, &celsius, &pcelsius);
+    if (_twr_radio_pub_topic.length == TWR_RADIO_PUB_TOPIC_LENGTH)
+    {
+        return -1;
+    }
 
-        twr_radio_pub_on_temperature(id, buffer[1], pcelsius);
+    uint8_t buffer[TWR_RADIO_MAX_BUFFER_SIZE];
+
+    buffer[0] = TWR_RADIO_HEADER_PUB_TOPIC_REG;
+    buffer[1] = _twr_radio_pub_topic.length;
+    buffer[2] = type;
+
+    strcpy((char *) buffer + 3, subtopic);
+
+    // Registration is queued in front of the value, so both usually share one frame
+    if (!twr_radio_pub_queue_put(buffer, strlen(subtopic) + 4))
+    {
+        return -1;
     }
-    else if (buffer[0] == TWR_RADIO_HEADER_PUB_HUMIDITY)
+
+    _twr_radio_pub_topic.hash[_twr_radio_pub_topic.length] = hash;
+    _twr_radio_pub_topic.type[_twr_radio_pub_topic.length] = type;
+
+    return _twr_radio_pub_topic.length++;
+}
+
+static uint32_t _twr_radio_pub_topic_hash(const char *subtopic)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261;
+
+    while (*subtopic != 0)
     {
-        float percentage;
-        float *ppercentage;
+        hash ^= (uint8_t) *subtopic++;
+        hash *= 16777619;
+    }
 
-        if (length != (1 + sizeof(uint8_t) + sizeof(float)))
-        {
-            return;
-        }
+    return hash;
+}
 
-        twr_radio_float_from_buffer(buffer + 2, &percentage, &ppercentage);
+static uint8_t *_twr_radio_pub_varint_to_buffer(uint32_t value, uint8_t *buffer)
+{
+    while (value >= 0x80)
+    {
+        *buffer++ = (value & 0x7f) | 0x80;
 
-        twr_radio_pub_on_humidity(id, buffer[1], ppercentage);
+        value >>= 7;
     }
-    else if (buffer[0] == TWR_RADIO_HEADER_PUB_LUX_METER)
+
+    *buffer++ = value;
+
+    return buffer;
+}
+
+static bool _twr_radio_pub_half_from_float(float value, uint16_t *half)
+{
+    uint32_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint16_t sign = (bits >> 16) & 0x8000;
+    int exponent = (int) ((bits >> 23) & 0xff);
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if (exponent == 0xff)
     {
-        float lux;
-        float *plux;
+        // Infinity or NaN, which is also the null value
+        *half = sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
 
-        if (length != (1 + sizeof(uint8_t) + sizeof(float)))
-        {
-            return;
-        }
+        return true;
+    }
 
-        twr_radio_float_from_buffer(buffer + 2, &lux, &plux);
+    if ((exponent == 0) && (mantissa == 0))
+    {
+        *half = sign;
 
-        twr_radio_pub_on_lux_meter(id, buffer[1], plux);
+        return true;
     }
-    else if (buffer[0] == TWR_RADIO_HEADER_PUB_BAROMETER)
+
+    exponent -= 127 - 15;
+
+    if (exponent >= 0x1f)
     {
-        float pascal;
-        float *ppascal;
-        float meter;
-        float *pmeter;
+        return false;
+    }
 
-        if (length != (1 + sizeof(uint8_t) + sizeof(float) + sizeof(float)))
+    if (exponent <= 0)
+    {
+        // Subnormal half-float
+        if (exponent < -10)
         {
-            return;
+            return false;
         }
 
-        uint8_t *pointer = twr_radio_float_from_buffer(buffer + 2, &pascal, &ppascal);
+        mantissa |= 0x800000;
+
+        uint32_t shift = 14 - exponent;
+
+        if ((mantissa & ((1UL << shift) - 1)) != 0)
+        {
+            return false;
+        }
 
-        twr_radio_float_from_buffer(pointer, &meter, &pmeter);
+        *half = sign | (mantissa >> shift);
 
-        twr_radio_pub_on_barometer(id, buffer[1], ppascal, pmeter);
+        return true;
     }
-    else if (buffer[0] == TWR_RADIO_HEADER_PUB_CO2)
+
+    if ((mantissa & 0x1fff) != 0)
     {
-        float concentration;
-        float *pconcentration;
+        return false;
+    }
 
-        if (length != (1 + sizeof(float)))
-        {
-            return;
-        }
+    *half = sign | (exponent << 10) | (mantissa >> 13);
+
+    return true;
+}
+
+#endif
 
-        twr_radio_float_from_buffer(buffer + 1, &concentration, &pconcentration);
+#if TWR_RADIO_PUB_TOPIC_GATEWAY_LENGTH
 
-        twr_radio_pub_on_co2(id, pconcentration);
+static void _twr_radio_pub_topic_reg_decode(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    if ((length < 5) || (length > 3 + TWR_RADIO_MAX_TOPIC_LEN + 1))
+    {
+        return;
     }
-    else if (buffer[0] == TWR_RADIO_HEADER_PUB_BATTERY)
+
+    uint8_t topic_id = buffer[1] & ~_TWR_RADIO_PUB_TOPIC_ID_HALF;
+    _twr_radio_pub_topic_entry_t *entry = NULL;
+
+    for (int i = 0; i < TWR_RADIO_PUB_TOPIC_GATEWAY_LENGTH; i++)
     {
-        float voltage;
-        float *pvoltage;
+        _twr_radio_pub_topic_entry_t *e = &_twr_radio_pub_topic_gateway.entry[i];
 
-        if (length == (1 + sizeof(float)))
-        {
-            twr_radio_float_from_buffer(buffer + 1, &voltage, &pvoltage);
-        }
-        else if (length == (1 + 1 + sizeof(float)))
+        if ((e->id == *id) && (e->topic_id == topic_id))
         {
-            // Old format
-            twr_radio_float_from_buffer(buffer + 2, &voltage, &pvoltage);
+            entry = e;
+
+            break;
         }
-        else
+
+        if ((entry == NULL) && (e->id == 0))
         {
-            return;
+            entry = e;
         }
-
-        twr_radio_pub_on_battery(id, pvoltage);
     }
-    else if (buffer[0] == TWR_RADIO_HEADER_PUB_ACCELERATION)
+
+    if (entry == NULL)
     {
-        if (length != _TWR_RADIO_PUB_BUFFER_SIZE_ACCELERATION)
+        entry = &_twr_radio_pub_topic_gateway.entry[_twr_radio_pub_topic_gateway.head];
+
+        if (++_twr_radio_pub_topic_gateway.head == TWR_RADIO_PUB_TOPIC_GATEWAY_LENGTH)
         {
-            return;
+            _twr_radio_pub_topic_gateway.head = 0;
         }
 
-        float x_axis;
-        float *px_axis;
-        float y_axis;
-        float *py_axis;
-        float z_axis;
-        float *pz_axis;
+        _twr_radio_pub_topic_request(entry->id);
+    }
 
-        buffer = twr_radio_float_from_buffer(buffer + 1, &x_axis, &px_axis);
+    buffer[length - 1] = 0;
 
-        buffer = twr_radio_float_from_buffer(buffer, &y_axis, &py_axis);
+    entry->id = *id;
+    entry->topic_id = topic_id;
+    entry->type = buffer[2];
 
-        twr_radio_float_from_buffer(buffer, &z_axis, &pz_axis);
+    strcpy(entry->subtopic, (char *) buffer + 3);
+}
 
-        twr_radio_pub_on_acceleration(id, px_axis, py_axis, pz_axis);
-    }
-    else if (buffer[0] == TWR_RADIO_HEADER_PUB_BUFFER)
+static void _twr_radio_pub_topic_id_decode(uint64_t *id, uint8_t *buffer, size_t length)
+{
+    if (length < 3)
     {
-        twr_radio_pub_on_buffer(id, buffer + 1, length - 1);
+        return;
     }
-    else if (buffer[0] == TWR_RADIO_HEADER_PUB_STATE)
-    {
-        bool state;
-        bool *pstate = NULL;
 
-        if (length != (1 + sizeof(uint8_t) + sizeof(bool)))
+    uint8_t topic_id = buffer[1] & ~_TWR_RADIO_PUB_TOPIC_ID_HALF;
+    _twr_radio_pub_topic_entry_t *entry = NULL;
+
+    for (int i = 0; i < TWR_RADIO_PUB_TOPIC_GATEWAY_LENGTH; i++)
+    {
+        if ((_twr_radio_pub_topic_gateway.entry[i].id == *id) && (_twr_radio_pub_topic_gateway.entry[i].topic_id == topic_id))
         {
-            return;
+            entry = &_twr_radio_pub_topic_gateway.entry[i];
+
+            break;
         }
+    }
 
-        twr_radio_bool_from_buffer(buffer + 2, &state, &pstate);
+    if (entry == NULL)
+    {
+        _twr_radio_pub_topic_request(*id);
 
-        twr_radio_pub_on_state(id, buffer[1], pstate);
+        return;
     }
-    else if (buffer[0] == TWR_RADIO_HEADER_PUB_TOPIC_BOOL)
+
+    uint8_t *end = buffer + length;
+
+    if (entry->type == TWR_RADIO_HEADER_PUB_TOPIC_BOOL)
     {
         bool value;
         bool *pvalue;
 
-        buffer = twr_radio_bool_from_buffer(buffer + 1, &value, &pvalue);
+        if (length != 2 + sizeof(bool))
+        {
+            return;
+        }
 
-        buffer[length - 1] = 0;
+        twr_radio_bool_from_buffer(buffer + 2, &value, &pvalue);
 
-        twr_radio_pub_on_bool(id, (char *) buffer, pvalue);
+        twr_radio_pub_on_bool(id, entry->subtopic, pvalue);
     }
-    else if (buffer[0] == TWR_RADIO_HEADER_PUB_TOPIC_INT)
+    else if (entry->type == TWR_RADIO_HEADER_PUB_TOPIC_INT)
     {
-        int value;
-        int *pvalue;
+        uint32_t zigzag;
 
-        buffer = twr_radio_int_from_buffer(buffer + 1, &value, &pvalue);
+        if (_twr_radio_pub_varint_from_buffer(buffer + 2, end, &zigzag) != end)
+        {
+            return;
+        }
 
-        buffer[length - 1] = 0;
+        int value = (int) ((zigzag >> 1) ^ (~(zigzag & 1) + 1));
 
-        twr_radio_pub_on_int(id, (char *) buffer, pvalue);
+        twr_radio_pub_on_int(id, entry->subtopic, value == TWR_RADIO_NULL_INT ? NULL : &value);
     }
-    else if (buffer[0] == TWR_RADIO_HEADER_PUB_TOPIC_UINT32)
+    else if (entry->type == TWR_RADIO_HEADER_PUB_TOPIC_UINT32)
     {
         uint32_t value;
-        uint32_t *pvalue;
 
-        buffer = twr_radio_uint32_from_buffer(buffer + 1, &value, &pvalue);
-
-        buffer[length - 1] = 0;
+        if (_twr_radio_pub_varint_from_buffer(buffer + 2, end, &value) != end)
+        {
+            return;
+        }
 
-        twr_radio_pub_on_uint32(id, (char *) buffer, pvalue);
+        twr_radio_pub_on_uint32(id, entry->subtopic, value == TWR_RADIO_NULL_UINT32 ? NULL : &value);
     }
-    else if (buffer[0] == TWR_RADIO_HEADER_PUB_TOPIC_FLOAT)
+    else if (entry->type == TWR_RADIO_HEADER_PUB_TOPIC_FLOAT)
     {
         float value;
         float *pvalue;
 
-        buffer = twr_radio_float_from_buffer(buffer + 1, &value, &pvalue);
+        if ((buffer[1] & _TWR_RADIO_PUB_TOPIC_ID_HALF) != 0)
+        {
+            uint16_t half;
 
-        buffer[length - 1] = 0;
+            if (length != 2 + sizeof(half))
+            {
+                return;
+            }
+
+            memcpy(&half, buffer + 2, sizeof(half));
+
+            value = _twr_radio_pub_half_to_float(half);
+
+            pvalue = isnan(value) ? NULL : &value;
+        }
+        else
+        {
+            if (length != 2 + sizeof(float))
+            {
+                return;
+            }
 
-        twr_radio_pub_on_float(id, (char *) buffer, pvalue);
+            twr_radio_float_from_buffer(buffer + 2, &value, &pvalue);
+        }
+
+        twr_radio_pub_on_float(id, entry->subtopic, pvalue);
     }
-    else if (buffer[0] == TWR_RADIO_HEADER_PUB_TOPIC_STRING)
+    else if (entry->type == TWR_RADIO_HEADER_PUB_TOPIC_STRING)
     {
         buffer[length - 1] = 0;
 
-        size_t len = strlen((char *) buffer + 1);
+        twr_radio_pub_on_string(id, entry->subtopic, (char *) buffer + 2);
+    }
+}
+
+static void _twr_radio_pub_topic_request(uint64_t id)
+{
+    twr_radio_peer_t *peer = twr_radio_get_peer_device(id);
 
-        twr_radio_pub_on_string(id, (char *) buffer + 1, (char *) buffer + 2 + len);
+    // Next message of the node is acknowledged with request to register its subscriptions and subtopics again
+    if (peer != NULL)
+    {
+        peer->message_id_synced = false;
     }
-    else if (buffer[0] == TWR_RADIO_HEADER_PUB_VALUE_INT)
+}
+
+static uint8_t *_twr_radio_pub_varint_from_buffer(uint8_t *buffer, uint8_t *end, uint32_t *value)
+{
+    *value = 0;
+
+    for (int shift = 0; (buffer < end) && (shift < 35); shift += 7)
     {
-        int value;
-        int *pvalue;
+        uint8_t byte = *buffer++;
 
-        if (length != (1 + sizeof(uint8_t) + sizeof(int)))
+        *value |= (uint32_t) (byte & 0x7f) << shift;
+
+        if ((byte & 0x80) == 0)
         {
-            return;
+            return buffer;
         }
+    }
 
-        twr_radio_int_from_buffer(buffer + 2, &value, &pvalue);
+    return NULL;
+}
+
+static float _twr_radio_pub_half_to_float(uint16_t half)
+{
+    uint32_t sign = (uint32_t) (half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+    uint32_t bits;
+    float value;
 
-        twr_radio_pub_on_value_int(id, buffer[1], pvalue);
+    if (exponent == 0x1f)
+    {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else if (exponent != 0)
+    {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    else if (mantissa == 0)
+    {
+        bits = sign;
     }
+    else
+    {
+        // Subnormal half-float is normal float
+        exponent = 127 - 15 + 1;
+
+        while ((mantissa & 0x400) == 0)
+        {
+            mantissa <<= 1;
+
+            exponent--;
+        }
+
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+
+    memcpy(&value, &bits, sizeof(value));
+
+    return value;
 }
+
+#endif
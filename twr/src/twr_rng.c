@@ -0,0 +1,65 @@
+#include <twr_rng.h>
+#include <twr_tick.h>
+#include <stm32l0xx.h>
+
+#define _TWR_RNG_TIMEOUT 10
+
+bool twr_rng_read(uint32_t *random)
+{
+    // HSI48 is shared with USB, it is stopped again only if it was not running before
+    bool hsi48 = (RCC->CRRCR & RCC_CRRCR_HSI48ON) != 0;
+
+    if (!hsi48)
+    {
+        RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+        SYSCFG->CFGR3 |= SYSCFG_CFGR3_ENREF_HSI48;
+        RCC->CRRCR |= RCC_CRRCR_HSI48ON;
+
+        while ((RCC->CRRCR & RCC_CRRCR_HSI48RDY) == 0)
+        {
+            continue;
+        }
+    }
+
+    RCC->CCIPR |= RCC_CCIPR_HSI48SEL;
+
+    RCC->AHBENR |= RCC_AHBENR_RNGEN;
+    // Errata workaround
+    RCC->AHBENR;
+
+    RNG->CR |= RNG_CR_RNGEN;
+
+    bool result = false;
+
+    twr_tick_t timeout = twr_tick_get() + _TWR_RNG_TIMEOUT;
+
+    while (twr_tick_get() < timeout)
+    {
+        // Clock or seed error, number would not be random
+        if ((RNG->SR & (RNG_SR_CECS | RNG_SR_SECS)) != 0)
+        {
+            break;
+        }
+
+        if ((RNG->SR & RNG_SR_DRDY) != 0)
+        {
+            *random = RNG->DR;
+
+            result = true;
+
+            break;
+        }
+    }
+
+    RNG->CR &= ~RNG_CR_RNGEN;
+
+    RCC->AHBENR &= ~RCC_AHBENR_RNGEN;
+
+    if (!hsi48)
+    {
+        RCC->CRRCR &= ~RCC_CRRCR_HSI48ON;
+        SYSCFG->CFGR3 &= ~SYSCFG_CFGR3_ENREF_HSI48;
+    }
+
+    return result;
+}
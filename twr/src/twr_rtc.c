@@ -1,5 +1,6 @@
 #include <twr_rtc.h>
 #include <twr_irq.h>
+#include <twr_tick.h>
 #include <stm32l0xx.h>
 
 #define _TWR_RTC_LEAP_YEAR(year) ((((year) % 4 == 0) && ((year) % 100 != 0)) || ((year) % 400 == 0))
@@ -315,6 +316,9 @@ int twr_rtc_set_datetime(struct tm *tm, int ms)
         .YT  = year / 10,
     };
 
+    twr_irq_disable();
+    // Account for the time elapsed before the calendar change
+    twr_tick_rtc_sync_irq();
     twr_rtc_enable_write();
     twr_rtc_set_init(true);
     RTC->SSR = ssr.i;
@@ -322,6 +326,8 @@ int twr_rtc_set_datetime(struct tm *tm, int ms)
     RTC->DR = dr.i;
     twr_rtc_set_init(false);
     twr_rtc_disable_write();
+    twr_tick_rtc_reset_irq();
+    twr_irq_enable();
     return 0;
 }
 
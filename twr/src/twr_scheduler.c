@@ -1,6 +1,10 @@
 #include <twr_scheduler.h>
 #include <twr_system.h>
 #include <twr_error.h>
+#include <twr_irq.h>
+#include <stm32l0xx.h>
+
+#define _TWR_SCHEDULER_PRIORITY_COUNT (TWR_SCHEDULER_PRIORITY_HIGH + 1)
 
 static struct
 {
@@ -9,18 +13,71 @@ static struct
         twr_tick_t tick_execution;
         void (*task)(void *);
         void *param;
+        twr_scheduler_priority_t priority;
+
+        // Number of spin in which task has been taken for execution
+        uint32_t spin;
+
+#if TWR_SCHEDULER_HEAP
+        // Position in heap counted from 1, 0 if task is not planned
+        size_t heap_position;
+
+        // Task is held out of heap until end of spin
+        bool deferred;
+#endif
 
     } pool[TWR_SCHEDULER_MAX_TASKS];
 
     twr_tick_t tick_spin;
+    uint32_t spin;
     twr_scheduler_task_id_t current_task_id;
     twr_scheduler_task_id_t max_task_id;
+    size_t priority_count[_TWR_SCHEDULER_PRIORITY_COUNT];
+
+#if TWR_SCHEDULER_HEAP
+    twr_scheduler_task_id_t heap[TWR_SCHEDULER_MAX_TASKS];
+    size_t heap_size;
+
+    // Tasks taken in current spin ordered by priority, dispatched from head
+    twr_scheduler_task_id_t ready[TWR_SCHEDULER_MAX_TASKS];
+    twr_tick_t ready_tick[TWR_SCHEDULER_MAX_TASKS];
+    size_t ready_head;
+    size_t ready_count;
+
+    twr_scheduler_task_id_t deferred[TWR_SCHEDULER_MAX_TASKS];
+    size_t deferred_count;
+#endif
+
+#if TWR_SCHEDULER_STATS
+    struct
+    {
+        uint32_t run_count;
+        uint64_t time_total;
+        uint32_t time_max;
+        twr_tick_t lateness_max;
+
+    } stats[TWR_SCHEDULER_MAX_TASKS];
+#endif
 
 } _twr_scheduler;
 
 void application_idle();
 void application_error(twr_error_t code);
 
+static void _twr_scheduler_spin(void);
+
+static void _twr_scheduler_plan(twr_scheduler_task_id_t task_id, twr_tick_t tick);
+
+static void _twr_scheduler_dispatch(twr_scheduler_task_id_t task_id, twr_tick_t tick_execution);
+
+#if TWR_SCHEDULER_HEAP
+
+static void _twr_scheduler_heap_insert(twr_scheduler_task_id_t task_id);
+
+static void _twr_scheduler_heap_remove(twr_scheduler_task_id_t task_id);
+
+#endif
+
 void twr_scheduler_init(void)
 {
     memset(&_twr_scheduler, 0, sizeof(_twr_scheduler));
@@ -28,37 +85,40 @@ void twr_scheduler_init(void)
 
 void twr_scheduler_run(void)
 {
-    static twr_scheduler_task_id_t *task_id = &_twr_scheduler.current_task_id;
-
     while (true)
     {
         _twr_scheduler.tick_spin = twr_tick_get();
 
-        for (*task_id = 0; *task_id <= _twr_scheduler.max_task_id; (*task_id)++)
-        {
-            if (_twr_scheduler.pool[*task_id].task != NULL)
-            {
-                if (_twr_scheduler.tick_spin >= _twr_scheduler.pool[*task_id].tick_execution)
-                {
-                    _twr_scheduler.pool[*task_id].tick_execution = TWR_TICK_INFINITY;
+        _twr_scheduler.spin++;
+
+        _twr_scheduler_spin();
 
-                    _twr_scheduler.pool[*task_id].task(_twr_scheduler.pool[*task_id].param);
-                }
-            }
-        }
         application_idle();
     }
 }
 
 twr_scheduler_task_id_t twr_scheduler_register(void (*task)(void *), void *param, twr_tick_t tick)
+{
+    return twr_scheduler_register_ex(task, param, tick, TWR_SCHEDULER_PRIORITY_NORMAL);
+}
+
+twr_scheduler_task_id_t twr_scheduler_register_ex(void (*task)(void *), void *param, twr_tick_t tick, twr_scheduler_priority_t priority)
 {
     for (twr_scheduler_task_id_t i = 0; i < TWR_SCHEDULER_MAX_TASKS; i++)
     {
         if (_twr_scheduler.pool[i].task == NULL)
         {
-            _twr_scheduler.pool[i].tick_execution = tick;
             _twr_scheduler.pool[i].task = task;
             _twr_scheduler.pool[i].param = param;
+            _twr_scheduler.pool[i].priority = priority;
+
+            _twr_scheduler.priority_count[priority]++;
+
+#if TWR_SCHEDULER_STATS
+            memset(&_twr_scheduler.stats[i], 0, sizeof(_twr_scheduler.stats[i]));
+#endif
+
+            _twr_scheduler_plan(i, tick);
 
             if (_twr_scheduler.max_task_id < i)
             {
@@ -76,6 +136,13 @@ twr_scheduler_task_id_t twr_scheduler_register(void (*task)(void *), void *param
 
 void twr_scheduler_unregister(twr_scheduler_task_id_t task_id)
 {
+    if (_twr_scheduler.pool[task_id].task != NULL)
+    {
+        _twr_scheduler.priority_count[_twr_scheduler.pool[task_id].priority]--;
+    }
+
+    _twr_scheduler_plan(task_id, TWR_TICK_INFINITY);
+
     _twr_scheduler.pool[task_id].task = NULL;
 
     if (_twr_scheduler.max_task_id == task_id)
@@ -103,42 +170,480 @@ twr_tick_t twr_scheduler_get_spin_tick(void)
     return _twr_scheduler.tick_spin;
 }
 
+twr_tick_t twr_scheduler_get_next_tick(void)
+{
+#if TWR_SCHEDULER_HEAP
+
+    twr_tick_t tick_next = TWR_TICK_INFINITY;
+
+    twr_irq_disable();
+
+    if (_twr_scheduler.heap_size != 0)
+    {
+        tick_next = _twr_scheduler.pool[_twr_scheduler.heap[0]].tick_execution;
+    }
+
+    twr_irq_enable();
+
+    return tick_next;
+
+#else
+
+    twr_tick_t tick_next = TWR_TICK_INFINITY;
+
+    for (twr_scheduler_task_id_t i = 0; i <= _twr_scheduler.max_task_id; i++)
+    {
+        if (_twr_scheduler.pool[i].task != NULL)
+        {
+            if (_twr_scheduler.pool[i].tick_execution < tick_next)
+            {
+                tick_next = _twr_scheduler.pool[i].tick_execution;
+            }
+        }
+    }
+
+    return tick_next;
+
+#endif
+}
+
+#if TWR_SCHEDULER_STATS
+
+bool twr_scheduler_get_stats(twr_scheduler_task_id_t task_id, twr_scheduler_stats_t *stats)
+{
+    if (task_id >= TWR_SCHEDULER_MAX_TASKS || _twr_scheduler.pool[task_id].task == NULL)
+    {
+        return false;
+    }
+
+    stats->task = _twr_scheduler.pool[task_id].task;
+    stats->run_count = _twr_scheduler.stats[task_id].run_count;
+    stats->time_total = _twr_scheduler.stats[task_id].time_total;
+    stats->time_max = _twr_scheduler.stats[task_id].time_max;
+    stats->lateness_max = _twr_scheduler.stats[task_id].lateness_max;
+
+    return true;
+}
+
+void twr_scheduler_reset_stats(void)
+{
+    memset(_twr_scheduler.stats, 0, sizeof(_twr_scheduler.stats));
+}
+
+#endif
+
 void twr_scheduler_plan_now(twr_scheduler_task_id_t task_id)
 {
-    _twr_scheduler.pool[task_id].tick_execution = 0;
+    _twr_scheduler_plan(task_id, 0);
 }
 
 void twr_scheduler_plan_absolute(twr_scheduler_task_id_t task_id, twr_tick_t tick)
 {
-    _twr_scheduler.pool[task_id].tick_execution = tick;
+    _twr_scheduler_plan(task_id, tick);
 }
 
 void twr_scheduler_plan_relative(twr_scheduler_task_id_t task_id, twr_tick_t tick)
 {
-    _twr_scheduler.pool[task_id].tick_execution = _twr_scheduler.tick_spin + tick;
+    _twr_scheduler_plan(task_id, _twr_scheduler.tick_spin + tick);
 }
 
 void twr_scheduler_plan_from_now(twr_scheduler_task_id_t task_id, twr_tick_t tick)
 {
-    _twr_scheduler.pool[task_id].tick_execution = twr_tick_get() + tick;
+    _twr_scheduler_plan(task_id, twr_tick_get() + tick);
 }
 
 void twr_scheduler_plan_current_now(void)
 {
-    _twr_scheduler.pool[_twr_scheduler.current_task_id].tick_execution = 0;
+    _twr_scheduler_plan(_twr_scheduler.current_task_id, 0);
 }
 
 void twr_scheduler_plan_current_absolute(twr_tick_t tick)
 {
-    _twr_scheduler.pool[_twr_scheduler.current_task_id].tick_execution = tick;
+    _twr_scheduler_plan(_twr_scheduler.current_task_id, tick);
 }
 
 void twr_scheduler_plan_current_relative(twr_tick_t tick)
 {
-    _twr_scheduler.pool[_twr_scheduler.current_task_id].tick_execution = _twr_scheduler.tick_spin + tick;
+    _twr_scheduler_plan(_twr_scheduler.current_task_id, _twr_scheduler.tick_spin + tick);
 }
 
 void twr_scheduler_plan_current_from_now(twr_tick_t tick)
 {
-    _twr_scheduler.pool[_twr_scheduler.current_task_id].tick_execution = twr_tick_get() + tick;
+    _twr_scheduler_plan(_twr_scheduler.current_task_id, twr_tick_get() + tick);
+}
+
+#if TWR_SCHEDULER_STATS
+
+static uint32_t _twr_scheduler_get_microseconds(void)
+{
+    uint32_t ms;
+    uint32_t val;
+
+    // SysTick reloads every millisecond at any system clock, repeat if it has just reloaded
+    do
+    {
+        ms = HAL_GetTick();
+
+        val = SysTick->VAL;
+
+    } while (ms != HAL_GetTick());
+
+    uint32_t load = SysTick->LOAD;
+
+    return ms * 1000 + (load - val) * 1000 / (load + 1);
+}
+
+static void _twr_scheduler_dispatch(twr_scheduler_task_id_t task_id, twr_tick_t tick_execution)
+{
+    twr_tick_t lateness = _twr_scheduler.tick_spin - tick_execution;
+
+    // Tasks planned for immediate execution are never late
+    if (tick_execution != 0 && lateness > _twr_scheduler.stats[task_id].lateness_max)
+    {
+        _twr_scheduler.stats[task_id].lateness_max = lateness;
+    }
+
+    uint32_t start = _twr_scheduler_get_microseconds();
+
+    _twr_scheduler.pool[task_id].task(_twr_scheduler.pool[task_id].param);
+
+    uint32_t time = _twr_scheduler_get_microseconds() - start;
+
+    _twr_scheduler.stats[task_id].run_count++;
+
+    _twr_scheduler.stats[task_id].time_total += time;
+
+    if (time > _twr_scheduler.stats[task_id].time_max)
+    {
+        _twr_scheduler.stats[task_id].time_max = time;
+    }
+}
+
+#else
+
+static void _twr_scheduler_dispatch(twr_scheduler_task_id_t task_id, twr_tick_t tick_execution)
+{
+    (void) tick_execution;
+
+    _twr_scheduler.pool[task_id].task(_twr_scheduler.pool[task_id].param);
+}
+
+#endif
+
+#if TWR_SCHEDULER_HEAP
+
+static void _twr_scheduler_collect(void)
+{
+    twr_irq_disable();
+
+    while (_twr_scheduler.heap_size != 0)
+    {
+        twr_scheduler_task_id_t top = _twr_scheduler.heap[0];
+
+        if (_twr_scheduler.pool[top].tick_execution > _twr_scheduler.tick_spin)
+        {
+            break;
+        }
+
+        _twr_scheduler_heap_remove(top);
+
+        // Each task is run at most once per spin, task planned again is put back to heap after spin
+        if (_twr_scheduler.pool[top].spin == _twr_scheduler.spin)
+        {
+            _twr_scheduler.pool[top].deferred = true;
+
+            _twr_scheduler.deferred[_twr_scheduler.deferred_count++] = top;
+
+            continue;
+        }
+
+        _twr_scheduler.pool[top].spin = _twr_scheduler.spin;
+
+        // Keep ready tasks ordered by priority, tasks with equal priority in order of deadline
+        size_t i = _twr_scheduler.ready_count++;
+
+        while (i > _twr_scheduler.ready_head && _twr_scheduler.pool[_twr_scheduler.ready[i - 1]].priority < _twr_scheduler.pool[top].priority)
+        {
+            _twr_scheduler.ready[i] = _twr_scheduler.ready[i - 1];
+            _twr_scheduler.ready_tick[i] = _twr_scheduler.ready_tick[i - 1];
+
+            i--;
+        }
+
+        _twr_scheduler.ready[i] = top;
+        _twr_scheduler.ready_tick[i] = _twr_scheduler.pool[top].tick_execution;
+
+        _twr_scheduler.pool[top].tick_execution = TWR_TICK_INFINITY;
+    }
+
+    twr_irq_enable();
 }
+
+static void _twr_scheduler_spin(void)
+{
+    static twr_scheduler_task_id_t *task_id = &_twr_scheduler.current_task_id;
+
+    _twr_scheduler.ready_head = 0;
+    _twr_scheduler.ready_count = 0;
+    _twr_scheduler.deferred_count = 0;
+
+    _twr_scheduler_collect();
+
+    while (_twr_scheduler.ready_head < _twr_scheduler.ready_count)
+    {
+        size_t i = _twr_scheduler.ready_head++;
+
+        *task_id = _twr_scheduler.ready[i];
+
+        if (_twr_scheduler.pool[*task_id].task == NULL)
+        {
+            continue;
+        }
+
+        // Task has been planned again by one of the preceding tasks
+        if (_twr_scheduler.pool[*task_id].tick_execution != TWR_TICK_INFINITY)
+        {
+            if (_twr_scheduler.tick_spin < _twr_scheduler.pool[*task_id].tick_execution)
+            {
+                continue;
+            }
+
+            _twr_scheduler_plan(*task_id, TWR_TICK_INFINITY);
+        }
+
+        _twr_scheduler_dispatch(*task_id, _twr_scheduler.ready_tick[i]);
+
+        // Tasks which became due meanwhile are dispatched before remaining tasks of lower priority
+        _twr_scheduler_collect();
+    }
+
+    twr_irq_disable();
+
+    for (size_t i = 0; i < _twr_scheduler.deferred_count; i++)
+    {
+        twr_scheduler_task_id_t deferred = _twr_scheduler.deferred[i];
+
+        _twr_scheduler.pool[deferred].deferred = false;
+
+        if (_twr_scheduler.pool[deferred].heap_position == 0 && _twr_scheduler.pool[deferred].tick_execution != TWR_TICK_INFINITY && _twr_scheduler.pool[deferred].task != NULL)
+        {
+            _twr_scheduler_heap_insert(deferred);
+        }
+    }
+
+    twr_irq_enable();
+}
+
+static bool _twr_scheduler_heap_less(size_t i, size_t j)
+{
+    twr_scheduler_task_id_t a = _twr_scheduler.heap[i];
+    twr_scheduler_task_id_t b = _twr_scheduler.heap[j];
+
+    if (_twr_scheduler.pool[a].tick_execution != _twr_scheduler.pool[b].tick_execution)
+    {
+        return _twr_scheduler.pool[a].tick_execution < _twr_scheduler.pool[b].tick_execution;
+    }
+
+    // Tasks with equal deadline are run in order of their IDs
+    return a < b;
+}
+
+static void _twr_scheduler_heap_swap(size_t i, size_t j)
+{
+    twr_scheduler_task_id_t a = _twr_scheduler.heap[i];
+    twr_scheduler_task_id_t b = _twr_scheduler.heap[j];
+
+    _twr_scheduler.heap[i] = b;
+    _twr_scheduler.heap[j] = a;
+
+    _twr_scheduler.pool[a].heap_position = j + 1;
+    _twr_scheduler.pool[b].heap_position = i + 1;
+}
+
+static void _twr_scheduler_heap_sift_up(size_t i)
+{
+    while (i > 0)
+    {
+        size_t parent = (i - 1) / 2;
+
+        if (!_twr_scheduler_heap_less(i, parent))
+        {
+            break;
+        }
+
+        _twr_scheduler_heap_swap(i, parent);
+
+        i = parent;
+    }
+}
+
+static void _twr_scheduler_heap_sift_down(size_t i)
+{
+    while (true)
+    {
+        size_t smallest = i;
+        size_t left = 2 * i + 1;
+        size_t right = 2 * i + 2;
+
+        if (left < _twr_scheduler.heap_size && _twr_scheduler_heap_less(left, smallest))
+        {
+            smallest = left;
+        }
+
+        if (right < _twr_scheduler.heap_size && _twr_scheduler_heap_less(right, smallest))
+        {
+            smallest = right;
+        }
+
+        if (smallest == i)
+        {
+            break;
+        }
+
+        _twr_scheduler_heap_swap(i, smallest);
+
+        i = smallest;
+    }
+}
+
+static void _twr_scheduler_heap_insert(twr_scheduler_task_id_t task_id)
+{
+    size_t i = _twr_scheduler.heap_size++;
+
+    _twr_scheduler.heap[i] = task_id;
+    _twr_scheduler.pool[task_id].heap_position = i + 1;
+
+    _twr_scheduler_heap_sift_up(i);
+}
+
+static void _twr_scheduler_heap_remove(twr_scheduler_task_id_t task_id)
+{
+    size_t i = _twr_scheduler.pool[task_id].heap_position - 1;
+    size_t last = --_twr_scheduler.heap_size;
+
+    _twr_scheduler.pool[task_id].heap_position = 0;
+
+    if (i == last)
+    {
+        return;
+    }
+
+    twr_scheduler_task_id_t moved = _twr_scheduler.heap[last];
+
+    _twr_scheduler.heap[i] = moved;
+    _twr_scheduler.pool[moved].heap_position = i + 1;
+
+    _twr_scheduler_heap_sift_up(i);
+    _twr_scheduler_heap_sift_down(_twr_scheduler.pool[moved].heap_position - 1);
+}
+
+static void _twr_scheduler_plan(twr_scheduler_task_id_t task_id, twr_tick_t tick)
+{
+    // Heap may be modified from interrupt context
+    twr_irq_disable();
+
+    twr_tick_t tick_previous = _twr_scheduler.pool[task_id].tick_execution;
+
+    _twr_scheduler.pool[task_id].tick_execution = tick;
+
+    if (_twr_scheduler.pool[task_id].heap_position != 0)
+    {
+        if (tick == TWR_TICK_INFINITY || _twr_scheduler.pool[task_id].task == NULL)
+        {
+            _twr_scheduler_heap_remove(task_id);
+        }
+        else if (tick < tick_previous)
+        {
+            _twr_scheduler_heap_sift_up(_twr_scheduler.pool[task_id].heap_position - 1);
+        }
+        else
+        {
+            _twr_scheduler_heap_sift_down(_twr_scheduler.pool[task_id].heap_position - 1);
+        }
+    }
+    else if (tick != TWR_TICK_INFINITY && _twr_scheduler.pool[task_id].task != NULL && !_twr_scheduler.pool[task_id].deferred)
+    {
+        _twr_scheduler_heap_insert(task_id);
+    }
+
+    twr_irq_enable();
+}
+
+#else
+
+static bool _twr_scheduler_is_ready_above(twr_scheduler_priority_t priority)
+{
+    size_t count = 0;
+
+    for (int i = priority + 1; i < _TWR_SCHEDULER_PRIORITY_COUNT; i++)
+    {
+        count += _twr_scheduler.priority_count[i];
+    }
+
+    if (count == 0)
+    {
+        return false;
+    }
+
+    for (twr_scheduler_task_id_t i = 0; i <= _twr_scheduler.max_task_id; i++)
+    {
+        if (_twr_scheduler.pool[i].task != NULL && _twr_scheduler.pool[i].priority > priority && _twr_scheduler.pool[i].spin != _twr_scheduler.spin)
+        {
+            if (_twr_scheduler.tick_spin >= _twr_scheduler.pool[i].tick_execution)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static void _twr_scheduler_spin(void)
+{
+    static twr_scheduler_task_id_t *task_id = &_twr_scheduler.current_task_id;
+
+    int priority = TWR_SCHEDULER_PRIORITY_HIGH;
+
+    while (priority >= TWR_SCHEDULER_PRIORITY_LOW)
+    {
+        bool restart = false;
+
+        if (_twr_scheduler.priority_count[priority] != 0)
+        {
+            for (*task_id = 0; *task_id <= _twr_scheduler.max_task_id; (*task_id)++)
+            {
+                // Each task is run at most once per spin
+                if (_twr_scheduler.pool[*task_id].task != NULL && (int) _twr_scheduler.pool[*task_id].priority == priority && _twr_scheduler.pool[*task_id].spin != _twr_scheduler.spin)
+                {
+                    twr_tick_t tick_execution = _twr_scheduler.pool[*task_id].tick_execution;
+
+                    if (_twr_scheduler.tick_spin >= tick_execution)
+                    {
+                        _twr_scheduler.pool[*task_id].tick_execution = TWR_TICK_INFINITY;
+                        _twr_scheduler.pool[*task_id].spin = _twr_scheduler.spin;
+
+                        _twr_scheduler_dispatch(*task_id, tick_execution);
+
+                        // Tasks of higher priority which became due meanwhile are dispatched first
+                        if (_twr_scheduler_is_ready_above(priority))
+                        {
+                            restart = true;
+
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        priority = restart ? TWR_SCHEDULER_PRIORITY_HIGH : priority - 1;
+    }
+}
+
+static void _twr_scheduler_plan(twr_scheduler_task_id_t task_id, twr_tick_t tick)
+{
+    _twr_scheduler.pool[task_id].tick_execution = tick;
+}
+
+#endif
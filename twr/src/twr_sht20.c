@@ -11,6 +11,8 @@ static void _twr_sht20_task_measure(void *param);
 
 static bool _twr_sht20_write(twr_sht20_t *self, const uint8_t data);
 
+static bool _twr_sht20_read(twr_sht20_t *self, uint16_t *reg);
+
 // TODO SHT20 has only one fixed address so it is no necessary to pass it as parameter
 
 void twr_sht20_init(twr_sht20_t *self, twr_i2c_channel_t i2c_channel, uint8_t i2c_address)
@@ -178,148 +180,55 @@ static void _twr_sht20_task_measure(void *param)
 {
     twr_sht20_t *self = param;
 
-start:
-
-    switch (self->_state)
-    {
-        case TWR_SHT20_STATE_ERROR:
-        {
-            self->_humidity_valid = false;
-            self->_temperature_valid = false;
-
-            self->_measurement_active = false;
-
-            if (self->_event_handler != NULL)
-            {
-                self->_event_handler(self, TWR_SHT20_EVENT_ERROR, self->_event_param);
-            }
-
-            self->_state = TWR_SHT20_STATE_INITIALIZE;
+    TWR_COROUTINE_BEGIN(&self->_coroutine);
 
-            return;
-        }
-        case TWR_SHT20_STATE_INITIALIZE:
-        {
-            self->_state = TWR_SHT20_STATE_ERROR;
-
-            if (!_twr_sht20_write(self, 0xfe))
-            {
-                goto start;
-            }
-
-            self->_state = TWR_SHT20_STATE_MEASURE_RH;
+    TWR_COROUTINE_TRY_I2C(&self->_coroutine, _twr_sht20_write(self, 0xfe));
 
-            self->_tick_ready = twr_tick_get() + _TWR_SHT20_DELAY_INITIALIZATION;
+    self->_tick_ready = twr_tick_get() + _TWR_SHT20_DELAY_INITIALIZATION;
 
-            if (self->_measurement_active)
-            {
-                twr_scheduler_plan_current_absolute(self->_tick_ready);
-            }
-
-            return;
-        }
-        case TWR_SHT20_STATE_MEASURE_RH:
-        {
-            self->_state = TWR_SHT20_STATE_ERROR;
-
-            if (!_twr_sht20_write(self, 0xf5))
-            {
-                goto start;
-            }
-
-            self->_state = TWR_SHT20_STATE_READ_RH;
-
-            twr_scheduler_plan_current_from_now(_TWR_SHT20_DELAY_MEASUREMENT_RH);
-
-            return;
-        }
-        case TWR_SHT20_STATE_READ_RH:
-        {
-            self->_state = TWR_SHT20_STATE_ERROR;
-
-            uint8_t buffer[2];
+    while (true)
+    {
+        TWR_AWAIT_EVENT(&self->_coroutine, self->_measurement_active);
 
-            twr_i2c_transfer_t transfer;
+        TWR_AWAIT_TICK(&self->_coroutine, self->_tick_ready);
 
-            transfer.device_address = self->_i2c_address;
-            transfer.buffer = buffer;
-            transfer.length = sizeof(buffer);
+        TWR_COROUTINE_TRY_I2C(&self->_coroutine, _twr_sht20_write(self, 0xf5));
 
-            if (!twr_i2c_read(self->_i2c_channel, &transfer))
-            {
-                goto start;
-            }
+        TWR_AWAIT_MS(&self->_coroutine, _TWR_SHT20_DELAY_MEASUREMENT_RH);
 
-            self->_reg_humidity = buffer[0] << 8 | buffer[1];
-            self->_reg_humidity &= ~0x3;
+        TWR_COROUTINE_TRY_I2C(&self->_coroutine, _twr_sht20_read(self, &self->_reg_humidity));
 
-            self->_humidity_valid = true;
+        self->_humidity_valid = true;
 
-            self->_state = TWR_SHT20_STATE_MEASURE_T;
+        TWR_COROUTINE_TRY_I2C(&self->_coroutine, _twr_sht20_write(self, 0xf3));
 
-            goto start;
-        }
-        case TWR_SHT20_STATE_MEASURE_T:
-        {
-            self->_state = TWR_SHT20_STATE_ERROR;
+        TWR_AWAIT_MS(&self->_coroutine, _TWR_SHT20_DELAY_MEASUREMENT_T);
 
-            if (!_twr_sht20_write(self, 0xf3))
-            {
-                goto start;
-            }
+        TWR_COROUTINE_TRY_I2C(&self->_coroutine, _twr_sht20_read(self, &self->_reg_temperature));
 
-            self->_state = TWR_SHT20_STATE_READ_T;
+        self->_temperature_valid = true;
 
-            twr_scheduler_plan_current_from_now(_TWR_SHT20_DELAY_MEASUREMENT_T);
+        self->_measurement_active = false;
 
-            return;
-        }
-        case TWR_SHT20_STATE_READ_T:
+        if (self->_event_handler != NULL)
         {
-            self->_state = TWR_SHT20_STATE_ERROR;
-
-            uint8_t buffer[2];
-
-            twr_i2c_transfer_t transfer;
-
-            transfer.device_address = self->_i2c_address;
-            transfer.buffer = buffer;
-            transfer.length = sizeof(buffer);
-
-            if (!twr_i2c_read(self->_i2c_channel, &transfer))
-            {
-                goto start;
-            }
-
-            self->_reg_temperature = buffer[0] << 8 | buffer[1];
-            self->_reg_temperature &= ~0x3;
-
-            self->_temperature_valid = true;
-
-            self->_state = TWR_SHT20_STATE_UPDATE;
-
-            goto start;
+            self->_event_handler(self, TWR_SHT20_EVENT_UPDATE, self->_event_param);
         }
-        case TWR_SHT20_STATE_UPDATE:
-        {
-            self->_measurement_active = false;
+    }
 
-            if (self->_event_handler != NULL)
-            {
-                self->_event_handler(self, TWR_SHT20_EVENT_UPDATE, self->_event_param);
-            }
+    TWR_COROUTINE_CATCH(&self->_coroutine);
 
-            self->_state = TWR_SHT20_STATE_MEASURE_RH;
+    self->_humidity_valid = false;
+    self->_temperature_valid = false;
 
-            return;
-        }
-        default:
-        {
-            self->_state = TWR_SHT20_STATE_ERROR;
+    self->_measurement_active = false;
 
-            goto start;
-        }
+    if (self->_event_handler != NULL)
+    {
+        self->_event_handler(self, TWR_SHT20_EVENT_ERROR, self->_event_param);
     }
+
+    TWR_COROUTINE_END(&self->_coroutine);
 }
 
 static bool _twr_sht20_write(twr_sht20_t *self, const uint8_t data)
@@ -332,3 +241,24 @@ static bool _twr_sht20_write(twr_sht20_t *self, const uint8_t data)
 
     return twr_i2c_write(self->_i2c_channel, &transfer);
 }
+
+static bool _twr_sht20_read(twr_sht20_t *self, uint16_t *reg)
+{
+    uint8_t buffer[2];
+
+    twr_i2c_transfer_t transfer;
+
+    transfer.device_address = self->_i2c_address;
+    transfer.buffer = buffer;
+    transfer.length = sizeof(buffer);
+
+    if (!twr_i2c_read(self->_i2c_channel, &transfer))
+    {
+        return false;
+    }
+
+    *reg = buffer[0] << 8 | buffer[1];
+    *reg &= ~0x3;
+
+    return true;
+}
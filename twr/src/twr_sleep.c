@@ -5,6 +5,16 @@ twr_sleep_manager_t sleep_manager = {
     .disable_sleep = 0
 };
 
+static struct
+{
+    bool standby_allowed;
+    twr_sleep_stats_t stats;
+    twr_tick_t tick_reset;
+
+} _twr_sleep;
+
+static void _twr_sleep_wait(void);
+
 void twr_sleep_disable(void)
 {
     sleep_manager.disable_sleep++;
@@ -14,3 +24,93 @@ void twr_sleep_enable(void)
 {
     sleep_manager.disable_sleep--;
 }
+
+void twr_sleep(void)
+{
+    if (sleep_manager.disable_sleep != 0)
+    {
+        return;
+    }
+
+    twr_sleep_mode_t mode = twr_sleep_get_mode();
+
+    twr_tick_t tick_start = twr_tick_get();
+
+    if (mode == TWR_SLEEP_MODE_STANDBY)
+    {
+        // This call never returns
+        twr_system_enter_standby_mode();
+    }
+    else if (mode == TWR_SLEEP_MODE_STOP)
+    {
+        _twr_sleep_wait();
+
+        _twr_sleep.stats.stop_count++;
+        _twr_sleep.stats.stop_time += twr_tick_get() - tick_start;
+    }
+    else
+    {
+        // Core wakes up sooner than regulator and MSI would recover from Stop mode
+        twr_system_deep_sleep_disable();
+
+        _twr_sleep_wait();
+
+        twr_system_deep_sleep_enable();
+
+        _twr_sleep.stats.sleep_count++;
+        _twr_sleep.stats.sleep_time += twr_tick_get() - tick_start;
+    }
+}
+
+void twr_sleep_allow_standby(bool allow)
+{
+    _twr_sleep.standby_allowed = allow;
+}
+
+twr_sleep_mode_t twr_sleep_get_mode(void)
+{
+    // Deep sleep is disabled by drivers whose peripherals have to keep running
+    if (!twr_system_get_deep_sleep())
+    {
+        return TWR_SLEEP_MODE_SLEEP;
+    }
+
+    twr_tick_t tick_next = twr_scheduler_get_next_tick();
+
+    if (tick_next == TWR_TICK_INFINITY && _twr_sleep.standby_allowed)
+    {
+        return TWR_SLEEP_MODE_STANDBY;
+    }
+
+    twr_tick_t tick_now = twr_tick_get();
+
+    if (tick_next < tick_now + TWR_SLEEP_STOP_MIN_RESIDENCY_MS)
+    {
+        return TWR_SLEEP_MODE_SLEEP;
+    }
+
+    return TWR_SLEEP_MODE_STOP;
+}
+
+void twr_sleep_get_stats(twr_sleep_stats_t *stats)
+{
+    *stats = _twr_sleep.stats;
+
+    stats->run_time = twr_tick_get() - _twr_sleep.tick_reset - stats->sleep_time - stats->stop_time;
+}
+
+void twr_sleep_reset_stats(void)
+{
+    memset(&_twr_sleep.stats, 0, sizeof(_twr_sleep.stats));
+
+    _twr_sleep.tick_reset = twr_tick_get();
+}
+
+static void _twr_sleep_wait(void)
+{
+#if TWR_SCHEDULER_TICKLESS
+    twr_system_sleep_tickless();
+#else
+    twr_system_sleep();
+#endif
+}
@@ -27,11 +27,13 @@ typedef struct
     twr_spirit1_state_t current_state;
     uint8_t tx_buffer[TWR_SPIRIT1_MAX_PACKET_SIZE];
     size_t tx_length;
+    bool tx_cca;
     uint8_t  rx_buffer[TWR_SPIRIT1_MAX_PACKET_SIZE];
     size_t rx_length;
     int rx_rssi;
     twr_tick_t rx_timeout;
     twr_tick_t rx_tick_timeout;
+    twr_tick_t rx_sniff;
 
 } twr_spirit1_t;
 
@@ -72,6 +74,16 @@ PktBasicAddressesInit xAddressInit={
   BROADCAST_ADDRESS
 };
 
+// Channel is assessed once for 64 bit periods (3.3 ms at 19200 bps), back-off is left to caller
+CsmaInit xCsmaInit={
+  S_DISABLE,
+  TBIT_TIME_64,
+  TCCA_TIME_1,
+  0,
+  0xfa21,
+  1
+};
+
 SGpioInit xGpioIRQ={
   SPIRIT_GPIO_0,
   SPIRIT_GPIO_MODE_DIGITAL_OUTPUT_LP,
@@ -138,9 +150,14 @@ bool twr_spirit1_init(void)
 
     SpiritPktBasicAddressesInit(&xAddressInit);
 
+    /* Spirit CSMA config, engine is enabled only for twr_spirit1_tx_cca */
+    SpiritCsmaInit(&xCsmaInit);
+
+    SpiritQiSetRssiThresholddBm(TWR_SPIRIT1_CCA_RSSI_THRESHOLD);
+
     _twr_spirit1.desired_state = TWR_SPIRIT1_STATE_SLEEP;
 
-    _twr_spirit1.task_id = twr_scheduler_register(_twr_spirit1_task, NULL, 0);
+    _twr_spirit1.task_id = twr_scheduler_register_ex(_twr_spirit1_task, NULL, 0, TWR_SCHEDULER_PRIORITY_HIGH);
 
     _twr_spirit1.initialized_semaphore++;
 
@@ -229,6 +246,20 @@ void twr_spirit1_tx(void)
 {
     _twr_spirit1.desired_state = TWR_SPIRIT1_STATE_TX;
 
+    _twr_spirit1.tx_cca = false;
+
+    if (_twr_spirit1.initialized_semaphore > 0)
+    {
+        twr_scheduler_plan_now(_twr_spirit1.task_id);
+    }
+}
+
+void twr_spirit1_tx_cca(void)
+{
+    _twr_spirit1.desired_state = TWR_SPIRIT1_STATE_TX;
+
+    _twr_spirit1.tx_cca = true;
+
     if (_twr_spirit1.initialized_semaphore > 0)
     {
         twr_scheduler_plan_now(_twr_spirit1.task_id);
@@ -239,6 +270,20 @@ void twr_spirit1_rx(void)
 {
     _twr_spirit1.desired_state = TWR_SPIRIT1_STATE_RX;
 
+    _twr_spirit1.rx_sniff = 0;
+
+    if (_twr_spirit1.initialized_semaphore > 0)
+    {
+        twr_scheduler_plan_now(_twr_spirit1.task_id);
+    }
+}
+
+void twr_spirit1_rx_sniff(twr_tick_t timeout)
+{
+    _twr_spirit1.desired_state = TWR_SPIRIT1_STATE_RX;
+
+    _twr_spirit1.rx_sniff = timeout;
+
     if (_twr_spirit1.initialized_semaphore > 0)
     {
         twr_scheduler_plan_now(_twr_spirit1.task_id);
@@ -319,6 +364,13 @@ static void _twr_spirit1_enter_state_tx(void)
     SpiritIrqClearStatus();
     SpiritIrq(TX_DATA_SENT, S_ENABLE);
 
+    if (_twr_spirit1.tx_cca)
+    {
+        SpiritIrq(MAX_BO_CCA_REACH, S_ENABLE);
+    }
+
+    SpiritCsma(_twr_spirit1.tx_cca ? S_ENABLE : S_DISABLE);
+
     SpiritPktBasicSetPayloadLength(_twr_spirit1.tx_length);
 
     // TODO Why needed?
@@ -326,7 +378,7 @@ static void _twr_spirit1_enter_state_tx(void)
 
     SpiritSpiWriteLinearFifo(_twr_spirit1.tx_length, _twr_spirit1.tx_buffer);
 
-    twr_exti_register(TWR_EXTI_LINE_PA7, TWR_EXTI_EDGE_FALLING, _twr_spirit1_interrupt, NULL);
+    twr_exti_register_deferred(TWR_EXTI_LINE_PA7, TWR_EXTI_EDGE_FALLING, _twr_spirit1_interrupt, NULL);
 
     SpiritCmdStrobeTx();
 }
@@ -337,15 +389,18 @@ static void _twr_spirit1_check_state_tx(void)
 
     SpiritIrqGetStatus(&xIrqStatus);
 
-    if (xIrqStatus.IRQ_TX_DATA_SENT)
+    if (xIrqStatus.IRQ_TX_DATA_SENT || xIrqStatus.IRQ_MAX_BO_CCA_REACH)
     {
         SpiritIrqClearStatus();
 
+        // CSMA engine gives up on busy channel without sending packet
+        twr_spirit1_event_t event = xIrqStatus.IRQ_TX_DATA_SENT ? TWR_SPIRIT1_EVENT_TX_DONE : TWR_SPIRIT1_EVENT_TX_BUSY;
+
         _twr_spirit1.desired_state = TWR_SPIRIT1_STATE_SLEEP;
 
         if (_twr_spirit1.event_handler != NULL)
         {
-            _twr_spirit1.event_handler(TWR_SPIRIT1_EVENT_TX_DONE, _twr_spirit1.event_param);
+            _twr_spirit1.event_handler(event, _twr_spirit1.event_param);
         }
 
         if (_twr_spirit1.desired_state == TWR_SPIRIT1_STATE_RX)
@@ -394,13 +449,23 @@ static void _twr_spirit1_enter_state_rx(void)
     SpiritQiSqiCheck(S_ENABLE);
 
     /* RX timeout config */
-    SpiritTimerSetRxTimeoutMs(1000.0);
-    SpiritTimerSetRxTimeoutStopCondition(SQI_ABOVE_THRESHOLD);
+    if (_twr_spirit1.rx_sniff != 0)
+    {
+        // Timer of radio stops once RSSI gets above threshold, otherwise it ends RX state
+        SpiritIrq(RX_TIMEOUT, S_ENABLE);
+        SpiritTimerSetRxTimeoutMs(_twr_spirit1.rx_sniff);
+        SpiritTimerSetRxTimeoutStopCondition(RSSI_ABOVE_THRESHOLD);
+    }
+    else
+    {
+        SpiritTimerSetRxTimeoutMs(1000.0);
+        SpiritTimerSetRxTimeoutStopCondition(SQI_ABOVE_THRESHOLD);
+    }
 
     /* IRQ registers blanking */
     SpiritIrqClearStatus();
 
-    twr_exti_register(TWR_EXTI_LINE_PA7, TWR_EXTI_EDGE_FALLING, _twr_spirit1_interrupt, NULL);
+    twr_exti_register_deferred(TWR_EXTI_LINE_PA7, TWR_EXTI_EDGE_FALLING, _twr_spirit1_interrupt, NULL);
 
     /* RX command */
     SpiritCmdStrobeRx();
@@ -413,6 +478,34 @@ static void _twr_spirit1_check_state_rx(void)
     /* Get the IRQ status */
     SpiritIrqGetStatus(&xIrqStatus);
 
+    if (xIrqStatus.IRQ_RX_TIMEOUT && (_twr_spirit1.rx_sniff != 0))
+    {
+        // Channel was idle for the whole sniff
+        _twr_spirit1.rx_sniff = 0;
+
+        _twr_spirit1.desired_state = TWR_SPIRIT1_STATE_SLEEP;
+
+        if (_twr_spirit1.event_handler != NULL)
+        {
+            _twr_spirit1.event_handler(TWR_SPIRIT1_EVENT_RX_TIMEOUT, _twr_spirit1.event_param);
+        }
+
+        if (_twr_spirit1.desired_state == TWR_SPIRIT1_STATE_RX)
+        {
+            _twr_spirit1_enter_state_rx();
+        }
+        else if (_twr_spirit1.desired_state == TWR_SPIRIT1_STATE_SLEEP)
+        {
+            _twr_spirit1_enter_state_sleep();
+        }
+        else if (_twr_spirit1.desired_state == TWR_SPIRIT1_STATE_TX)
+        {
+            _twr_spirit1_enter_state_tx();
+        }
+
+        return;
+    }
+
     /* Check the SPIRIT RX_DATA_DISC IRQ flag */
     if (xIrqStatus.IRQ_RX_DATA_DISC)
     {
@@ -439,6 +532,16 @@ static void _twr_spirit1_check_state_rx(void)
 
             _twr_spirit1.rx_rssi = ((int) rssi_level) / 2 - 130;
 
+            if (_twr_spirit1.rx_sniff != 0)
+            {
+                // Carrier was sensed, further receptions are not limited by sniff
+                _twr_spirit1.rx_sniff = 0;
+
+                SpiritIrq(RX_TIMEOUT, S_DISABLE);
+                SpiritTimerSetRxTimeoutMs(1000.0);
+                SpiritTimerSetRxTimeoutStopCondition(SQI_ABOVE_THRESHOLD);
+            }
+
             if (_twr_spirit1.rx_timeout == TWR_TICK_INFINITY)
             {
                 _twr_spirit1.rx_tick_timeout = TWR_TICK_INFINITY;
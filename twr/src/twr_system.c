@@ -10,6 +10,9 @@
 
 #define _TWR_SYSTEM_DEBUG_ENABLE 0
 
+// Wake-up timer auto-reload register is 16-bit wide
+#define _TWR_SYSTEM_WAKEUP_TIMER_MAX_MS 30000
+
 static const uint32_t twr_system_clock_table[3] =
 {
     RCC_CFGR_SW_MSI,
@@ -39,6 +42,8 @@ static void _twr_system_init_shutdown_tmp112(void);
 
 static void _twr_system_switch_clock(twr_system_clock_t clock);
 
+static void _twr_system_set_wakeup_timer(uint32_t interval);
+
 void twr_system_init(void)
 {
     _twr_system_init_flash();
@@ -230,28 +235,13 @@ static void _twr_system_init_rtc(void)
         twr_rtc_set_init(false);
     }
 
-    // Disable timer
-    RTC->CR &= ~RTC_CR_WUTE;
-
-    // Wait until timer configuration update is allowed...
-    while ((RTC->ISR & RTC_ISR_WUTWF) == 0)
-    {
-        continue;
-    }
-
-    // Set wake-up auto-reload value based on the configured scheduler interval.
-    RTC->WUTR = LSE_VALUE / 16 * TWR_SCHEDULER_INTERVAL_MS / 1000;
-
-    // Clear timer flag
-    RTC->ISR &= ~RTC_ISR_WUTF;
+    twr_rtc_disable_write();
 
-    // Enable timer interrupts
-    RTC->CR |= RTC_CR_WUTIE;
+    // Set wake-up timer based on the configured scheduler interval
+    _twr_system_set_wakeup_timer(TWR_SCHEDULER_INTERVAL_MS);
 
-    // Enable timer
-    RTC->CR |= RTC_CR_WUTE;
-
-    twr_rtc_disable_write();
+    // Start counting ticks from current RTC time
+    twr_tick_rtc_reset_irq();
 
     // RTC IRQ needs to be configured through EXTI
     EXTI->IMR |= EXTI_IMR_IM20;
@@ -292,6 +282,56 @@ void twr_system_deep_sleep_disable(void)
     _twr_system_deep_sleep_disable_semaphore++;
 }
 
+bool twr_system_get_deep_sleep(void)
+{
+    return _twr_system_deep_sleep_disable_semaphore == 0;
+}
+
+void twr_system_sleep_tickless(void)
+{
+    // Pending interrupt still wakes up the core, but it is not serviced until the tick counter is synchronized
+    twr_irq_disable();
+
+    twr_tick_t tick_now = twr_tick_get();
+
+    twr_tick_t tick_next = twr_scheduler_get_next_tick();
+
+    // Periodic wake-up is good enough if the deadline is near
+    if (tick_next <= tick_now + TWR_SCHEDULER_INTERVAL_MS)
+    {
+        twr_system_sleep();
+
+        twr_irq_enable();
+
+        return;
+    }
+
+    twr_tick_t interval = tick_next - tick_now;
+
+    if (interval > _TWR_SYSTEM_WAKEUP_TIMER_MAX_MS)
+    {
+        interval = _TWR_SYSTEM_WAKEUP_TIMER_MAX_MS;
+    }
+
+    twr_tick_rtc_sync_irq();
+
+    _twr_system_set_wakeup_timer(interval);
+
+    twr_system_sleep();
+
+    // Time spent in sleep is taken from RTC regardless of the wake-up source
+    twr_tick_rtc_sync_irq();
+
+    _twr_system_set_wakeup_timer(TWR_SCHEDULER_INTERVAL_MS);
+
+    // Wake-up timer event has already been accounted for
+    EXTI->PR = EXTI_IMR_IM20;
+
+    NVIC_ClearPendingIRQ(RTC_IRQn);
+
+    twr_irq_enable();
+}
+
 void twr_system_enter_standby_mode(void)
 {
     twr_i2c_init(TWR_I2C_I2C0, TWR_I2C_SPEED_100_KHZ);
@@ -510,7 +550,11 @@ void RTC_IRQHandler(void)
         // Clear wake-up timer flag
         RTC->ISR &= ~RTC_ISR_WUTF;
 
+#if TWR_SCHEDULER_TICKLESS
+        twr_tick_rtc_sync_irq();
+#else
         twr_tick_increment_irq(TWR_SCHEDULER_INTERVAL_MS);
+#endif
     }
 
     // Clear EXTI interrupt flag
@@ -531,3 +575,31 @@ static void _twr_system_switch_clock(twr_system_clock_t clock)
 
     twr_irq_enable();
 }
+
+static void _twr_system_set_wakeup_timer(uint32_t interval)
+{
+    twr_rtc_enable_write();
+
+    // Disable timer
+    RTC->CR &= ~RTC_CR_WUTE;
+
+    // Wait until timer configuration update is allowed...
+    while ((RTC->ISR & RTC_ISR_WUTWF) == 0)
+    {
+        continue;
+    }
+
+    // Set wake-up auto-reload value, timer is clocked from RTCCLK / 16
+    RTC->WUTR = LSE_VALUE / 16 * interval / 1000;
+
+    // Clear timer flag
+    RTC->ISR &= ~RTC_ISR_WUTF;
+
+    // Enable timer interrupts
+    RTC->CR |= RTC_CR_WUTIE;
+
+    // Enable timer
+    RTC->CR |= RTC_CR_WUTE;
+
+    twr_rtc_disable_write();
+}
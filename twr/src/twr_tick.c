@@ -1,23 +1,146 @@
 #include <twr_tick.h>
 #include <twr_irq.h>
+#include <twr_scheduler.h>
+#include <twr_rtc.h>
 #include <stm32l0xx.h>
 
+#define _TWR_TICK_RTC_DAY (86400UL * TWR_RTC_PREDIV_S)
+
+#define _TWR_TICK_LSE_HZ 32768
+
+// Periods of LSE in one step of RTC sub-second counter
+#define _TWR_TICK_LSE_PER_RTC (_TWR_TICK_LSE_HZ / TWR_RTC_PREDIV_S)
+
 static volatile twr_tick_t _twr_tick_counter = 0;
 
+// Incremented on every update of tick counter, readers repeat the read if it has changed meanwhile
+static volatile uint32_t _twr_tick_sequence = 0;
+
+// RTC time of day and tick counter at reference point of twr_tick_get_us (and of tick counter in tickless mode)
+static uint32_t _twr_tick_rtc_reference;
+static twr_tick_t _twr_tick_reference;
+
+// Fraction of millisecond elapsed on RTC but not yet added to reference
+static uint32_t _twr_tick_rtc_remainder;
+
+#if TWR_TICK_LPTIM
+
+// LPTIM1 counter at reference point
+static uint16_t _twr_tick_lptim_reference;
+
+static void _twr_tick_lptim_init(void);
+
+static uint16_t _twr_tick_lptim_read(void);
+
+#endif
+
+#if !TWR_SCHEDULER_TICKLESS
+
+// Reference is not taken on every tick, twr_tick_get_us moves it on once it gets this old,
+// long before time of day counter could wrap around past it
+#define _TWR_TICK_REFERENCE_MAX_MS 3600000UL
+
+// Older reference cannot be told from one a day younger
+#define _TWR_TICK_RTC_DAY_MS 86400000UL
+
+#endif
+
+static void _twr_tick_set_reference(uint32_t now);
+
+static twr_tick_t _twr_tick_advance_reference(uint32_t now);
+
+static uint32_t _twr_tick_rtc_read(void);
+
+static uint32_t _twr_tick_rtc_elapsed(uint32_t now);
+
 twr_tick_t twr_tick_get(void)
 {
     twr_tick_t tick;
+    uint32_t sequence;
+
+    // Writer updates counter with interrupts disabled, so any change of sequence means the read may be torn
+    do
+    {
+        sequence = _twr_tick_sequence;
+
+        tick = _twr_tick_counter;
+
+    } while (sequence != _twr_tick_sequence);
 
-    // Disable interrupts
+    return tick;
+}
+
+uint64_t twr_tick_get_us(void)
+{
+    // RTC registers must not be read concurrently from interrupt, shadow registers stay locked until RTC_DR is read
     twr_irq_disable();
 
-    // Get current tick counter
-    tick = _twr_tick_counter;
+    uint32_t now = _twr_tick_rtc_read();
+
+#if !TWR_SCHEDULER_TICKLESS
+
+    twr_tick_t tick = _twr_tick_counter;
+
+    if (tick - _twr_tick_reference >= _TWR_TICK_RTC_DAY_MS)
+    {
+        // Time of day counter may have wrapped around past reference, start again from tick counter
+        _twr_tick_set_reference(now);
+
+        _twr_tick_reference = tick;
+
+        _twr_tick_rtc_remainder = 0;
+    }
+    else if (tick - _twr_tick_reference >= _TWR_TICK_REFERENCE_MAX_MS)
+    {
+        _twr_tick_advance_reference(now);
+    }
+
+#endif
+
+    twr_tick_t reference = _twr_tick_reference;
+
+    uint32_t rtc_elapsed = _twr_tick_rtc_elapsed(now);
+
+    uint32_t remainder = _twr_tick_rtc_remainder;
+
+#if TWR_TICK_LPTIM
+
+    uint16_t lptim_elapsed = _twr_tick_lptim_read() - _twr_tick_lptim_reference;
 
-    // Enable interrupts
     twr_irq_enable();
 
-    return tick;
+    // RTC tells how many times LPTIM1 has wrapped around, LPTIM1 adds the fraction of RTC step
+    uint32_t lse_estimate = rtc_elapsed * _TWR_TICK_LSE_PER_RTC;
+
+    uint64_t lse = lse_estimate + (int16_t) (uint16_t) (lptim_elapsed - (uint16_t) lse_estimate);
+
+    uint64_t elapsed = (lse * 1000000 + (uint64_t) remainder * 1000 * _TWR_TICK_LSE_PER_RTC) / _TWR_TICK_LSE_HZ;
+
+#else
+
+    twr_irq_enable();
+
+    uint64_t elapsed = ((uint64_t) rtc_elapsed * 1000000 + (uint64_t) remainder * 1000) / TWR_RTC_PREDIV_S;
+
+#endif
+
+    uint64_t us = reference * 1000 + elapsed;
+
+#if !TWR_SCHEDULER_TICKLESS
+
+    // Tick counter advances in steps of wake-up timer, do not let time leave the current step
+    if (us < tick * 1000)
+    {
+        us = tick * 1000;
+    }
+    else if (us >= (tick + TWR_SCHEDULER_INTERVAL_MS) * 1000)
+    {
+        us = (tick + TWR_SCHEDULER_INTERVAL_MS) * 1000 - 1;
+    }
+
+#endif
+
+    return us;
 }
 
 void twr_tick_wait(twr_tick_t delay)
@@ -32,5 +155,151 @@ void twr_tick_wait(twr_tick_t delay)
 
 void twr_tick_increment_irq(twr_tick_t delta)
 {
+    twr_irq_disable();
+
+    _twr_tick_sequence++;
+
     _twr_tick_counter += delta;
+
+    twr_irq_enable();
 }
+
+void twr_tick_rtc_reset_irq(void)
+{
+    twr_irq_disable();
+
+#if TWR_TICK_LPTIM
+
+    if ((LPTIM1->CR & LPTIM_CR_ENABLE) == 0)
+    {
+        _twr_tick_lptim_init();
+    }
+
+#endif
+
+    _twr_tick_set_reference(_twr_tick_rtc_read());
+
+    _twr_tick_reference = _twr_tick_counter;
+
+    twr_irq_enable();
+}
+
+#if TWR_SCHEDULER_TICKLESS
+
+void twr_tick_rtc_sync_irq(void)
+{
+    twr_irq_disable();
+
+    twr_tick_t delta = _twr_tick_advance_reference(_twr_tick_rtc_read());
+
+    _twr_tick_sequence++;
+
+    _twr_tick_counter += delta;
+
+    twr_irq_enable();
+}
+
+#else
+
+void twr_tick_rtc_sync_irq(void)
+{
+}
+
+#endif
+
+static void _twr_tick_set_reference(uint32_t now)
+{
+    _twr_tick_rtc_reference = now;
+
+#if TWR_TICK_LPTIM
+
+    _twr_tick_lptim_reference = _twr_tick_lptim_read();
+
+#endif
+}
+
+static twr_tick_t _twr_tick_advance_reference(uint32_t now)
+{
+    // Keep the fraction of millisecond so that no time is lost between moves of reference
+    uint64_t elapsed = (uint64_t) _twr_tick_rtc_elapsed(now) * 1000 + _twr_tick_rtc_remainder;
+
+    _twr_tick_set_reference(now);
+
+    _twr_tick_rtc_remainder = elapsed % TWR_RTC_PREDIV_S;
+
+    _twr_tick_reference += elapsed / TWR_RTC_PREDIV_S;
+
+    return elapsed / TWR_RTC_PREDIV_S;
+}
+
+static uint32_t _twr_tick_rtc_elapsed(uint32_t now)
+{
+    // Time of day counter wraps around at midnight
+    if (now >= _twr_tick_rtc_reference)
+    {
+        return now - _twr_tick_rtc_reference;
+    }
+
+    return now + _TWR_TICK_RTC_DAY - _twr_tick_rtc_reference;
+}
+
+static uint32_t _twr_tick_rtc_read(void)
+{
+    // Shadow registers are not updated in deep sleep modes, twr_system_sleep clears RSF after wake-up
+    twr_rtc_wait();
+
+    uint32_t ssr = RTC->SSR & RTC_SSR_SS;
+
+    uint32_t tr = RTC->TR;
+
+    // Reading of RTC_DR unlocks the shadow registers
+    RTC->DR;
+
+    uint32_t seconds = ((tr & RTC_TR_HT_Msk) >> RTC_TR_HT_Pos) * 36000;
+    seconds += ((tr & RTC_TR_HU_Msk) >> RTC_TR_HU_Pos) * 3600;
+    seconds += ((tr & RTC_TR_MNT_Msk) >> RTC_TR_MNT_Pos) * 600;
+    seconds += ((tr & RTC_TR_MNU_Msk) >> RTC_TR_MNU_Pos) * 60;
+    seconds += ((tr & RTC_TR_ST_Msk) >> RTC_TR_ST_Pos) * 10;
+    seconds += (tr & RTC_TR_SU_Msk) >> RTC_TR_SU_Pos;
+
+    // Sub-second register counts down from prescaler value
+    return seconds * TWR_RTC_PREDIV_S + (TWR_RTC_PREDIV_S - 1 - ssr);
+}
+
+#if TWR_TICK_LPTIM
+
+static void _twr_tick_lptim_init(void)
+{
+    // Clock LPTIM1 from LSE, so that it keeps counting in Stop mode
+    RCC->CCIPR |= RCC_CCIPR_LPTIM1SEL;
+
+    // Enable LPTIM1 clock
+    RCC->APB1ENR |= RCC_APB1ENR_LPTIM1EN;
+
+    // Errata workaround
+    RCC->APB1ENR;
+
+    LPTIM1->CR = LPTIM_CR_ENABLE;
+
+    // Auto-reload register can only be written while LPTIM1 is enabled
+    LPTIM1->ARR = 0xffff;
+
+    // Count continuously over whole 16-bit range
+    LPTIM1->CR |= LPTIM_CR_CNTSTRT;
+}
+
+static uint16_t _twr_tick_lptim_read(void)
+{
+    uint16_t cnt;
+
+    // Counter runs asynchronously to bus clock, its value is only reliable if two consecutive reads match
+    do
+    {
+        cnt = LPTIM1->CNT;
+
+    } while (cnt != LPTIM1->CNT);
+
+    return cnt;
+}
+
+#endif
@@ -5,6 +5,13 @@
 #include <stm32l0xx.h>
 #include <twr_dma.h>
 #include <twr_gpio.h>
+#include <twr_defer.h>
+
+// Interrupt handler moves data only, events it raises are processed by deferred handler
+#define _TWR_UART_DEFER_SIZE 8
+#define _TWR_UART_DEFER_RX 0
+#define _TWR_UART_DEFER_IDLE 1
+#define _TWR_UART_DEFER_TC 2
 
 typedef struct
 {
@@ -19,6 +26,22 @@ typedef struct
     bool async_read_in_progress;
     twr_tick_t async_timeout;
     USART_TypeDef *usart;
+    bool dma_read;
+    twr_dma_channel_t dma_read_channel;
+    bool dma_write;
+    bool dma_write_busy;
+    bool dma_write_fifo;
+    twr_dma_channel_t dma_write_channel;
+    size_t dma_write_length;
+    twr_uart_segment_t writev_segment[TWR_UART_WRITEV_SEGMENTS];
+    size_t writev_count;
+    size_t writev_index;
+    size_t writev_offset;
+    void (*writev_done_handler)(twr_uart_channel_t, void *);
+    void *writev_done_param;
+    volatile bool defer_rx_pending;
+    volatile bool defer_idle_pending;
+    volatile bool defer_tc_pending;
 
 } twr_uart_t;
 
@@ -29,12 +52,14 @@ static twr_uart_t _twr_uart[3] =
     [TWR_UART_UART2] = { .initialized = false }
 };
 
+// Deferred event sources are kept apart from state of channels, which is cleared by init
 static struct
 {
-    twr_scheduler_task_id_t read_task_id;
-    size_t length;
+    bool initialized;
+    twr_defer_t defer;
+    uint8_t buffer[_TWR_UART_DEFER_SIZE];
 
-} _twr_uart_2_dma;
+} _twr_uart_defer[3];
 
 static uint32_t _twr_uart_brr_t[] =
 {
@@ -46,15 +71,35 @@ static uint32_t _twr_uart_brr_t[] =
     [TWR_UART_BAUDRATE_921600] = 0x22
 };
 
+static void _twr_uart_async_write_start(twr_uart_channel_t channel);
+static void _twr_uart_async_write_finish(twr_uart_channel_t channel);
+static void _twr_uart_dma_write_done(twr_uart_t *uart);
 static void _twr_uart_async_write_task(void *param);
+static bool _twr_uart_writev_read(twr_uart_t *uart, uint8_t *character);
+static bool _twr_uart_dma_write_start(twr_uart_channel_t channel);
+static void _twr_uart_dma_write_next(twr_uart_channel_t channel);
+static void _twr_uart_dma_write_event_handler(twr_dma_channel_t dma_channel, twr_dma_event_t event, void *event_param);
+static void _twr_uart_dma_write_release_handler(twr_dma_channel_t dma_channel, void *param);
 static void _twr_uart_async_read_task(void *param);
-static void _twr_uart_2_dma_read_task(void *param);
+static bool _twr_uart_dma_read_start(twr_uart_channel_t channel);
+static void _twr_uart_dma_read_update(twr_uart_channel_t channel);
+static void _twr_uart_dma_read_event_handler(twr_dma_channel_t dma_channel, twr_dma_event_t event, void *event_param);
+static void _twr_uart_defer_handler(const void *item, void *param);
 static void _twr_uart_irq_handler(twr_uart_channel_t channel);
 
 void twr_uart_init(twr_uart_channel_t channel, twr_uart_baudrate_t baudrate, twr_uart_setting_t setting)
 {
+    _twr_uart_async_write_finish(channel);
+
     memset(&_twr_uart[channel], 0, sizeof(_twr_uart[channel]));
 
+    if (!_twr_uart_defer[channel].initialized)
+    {
+        twr_defer_init(&_twr_uart_defer[channel].defer, _twr_uart_defer[channel].buffer, 1, _TWR_UART_DEFER_SIZE, _twr_uart_defer_handler, (void *) channel);
+
+        _twr_uart_defer[channel].initialized = true;
+    }
+
     switch(channel)
     {
         case TWR_UART_UART0:
@@ -232,6 +277,8 @@ void twr_uart_init(twr_uart_channel_t channel, twr_uart_baudrate_t baudrate, twr
 
 void twr_uart_deinit(twr_uart_channel_t channel)
 {
+    _twr_uart_async_write_finish(channel);
+
     twr_uart_async_read_cancel(channel);
 
     // Disable UART
@@ -305,11 +352,14 @@ void twr_uart_deinit(twr_uart_channel_t channel)
 
 size_t twr_uart_write(twr_uart_channel_t channel, const void *buffer, size_t length)
 {
-    if (!_twr_uart[channel].initialized || _twr_uart[channel].async_write_in_progress)
+    if (!_twr_uart[channel].initialized)
     {
         return 0;
     }
 
+    // Data of async write go out first
+    twr_uart_flush(channel);
+
     USART_TypeDef *usart = _twr_uart[channel].usart;
 
     size_t bytes_written = 0;
@@ -408,44 +458,101 @@ size_t twr_uart_async_write(twr_uart_channel_t channel, const void *buffer, size
         return 0;
     }
 
-    size_t bytes_written = 0;
+    size_t bytes_written = twr_fifo_write(_twr_uart[channel].write_fifo, buffer, length);
 
-    for (size_t i = 0; i < length; i += 16)
+    if (bytes_written != 0)
     {
-        bytes_written += twr_fifo_write(_twr_uart[channel].write_fifo, (uint8_t *)buffer + i, length - i  > 16 ? 16 : length - i);
+        _twr_uart_async_write_start(channel);
     }
 
-    if (bytes_written != 0)
+    return bytes_written;
+}
+
+bool twr_uart_async_writev(twr_uart_channel_t channel, const twr_uart_segment_t *segment, size_t count, void (*done_handler)(twr_uart_channel_t, void *), void *done_param)
+{
+    twr_uart_t *uart = &_twr_uart[channel];
+
+    if (!uart->initialized || uart->async_write_in_progress || count > TWR_UART_WRITEV_SEGMENTS)
     {
-        if (!_twr_uart[channel].async_write_in_progress)
-        {
-            _twr_uart[channel].async_write_task_id = twr_scheduler_register(_twr_uart_async_write_task, (void *) channel, TWR_TICK_INFINITY);
+        return false;
+    }
 
-            if (_twr_uart[channel].usart == LPUART1)
-            {
-                twr_system_deep_sleep_disable();
-            }
-            else
+    memcpy(uart->writev_segment, segment, count * sizeof(twr_uart_segment_t));
+
+    uart->writev_count = count;
+    uart->writev_index = 0;
+    uart->writev_offset = 0;
+    uart->writev_done_handler = done_handler;
+    uart->writev_done_param = done_param;
+
+    _twr_uart_async_write_start(channel);
+
+    return true;
+}
+
+void twr_uart_flush(twr_uart_channel_t channel)
+{
+    twr_uart_t *uart = &_twr_uart[channel];
+
+    if (!uart->initialized || !uart->async_write_in_progress)
+    {
+        return;
+    }
+
+    USART_TypeDef *usart = uart->usart;
+
+    if (uart->dma_write)
+    {
+        if (uart->dma_write_busy)
+        {
+            // DMA keeps transferring on its own, event it reports later is ignored
+            while (twr_dma_channel_get_length(uart->dma_write_channel) != 0)
             {
-                twr_system_pll_enable();
+                continue;
             }
-        }
-        else
-        {
-            twr_scheduler_plan_absolute(_twr_uart[channel].async_write_task_id, TWR_TICK_INFINITY);
-        }
 
+            twr_dma_channel_stop(uart->dma_write_channel);
+
+            _twr_uart_dma_write_done(uart);
+        }
+    }
+    else
+    {
         twr_irq_disable();
 
-        // Enable transmit interrupt
-        _twr_uart[channel].usart->CR1 |= USART_CR1_TXEIE;
+        // Disable transmit interrupt
+        usart->CR1 &= ~USART_CR1_TXEIE_Msk;
 
         twr_irq_enable();
+    }
+
+    uint8_t character;
+
+    // Rest of segments and FIFO is written out by polling
+    while (_twr_uart_writev_read(uart, &character) || (uart->write_fifo != NULL && twr_fifo_read(uart->write_fifo, &character, 1) != 0))
+    {
+        // Until transmit data register is not empty...
+        while ((usart->ISR & USART_ISR_TXE) == 0)
+        {
+            continue;
+        }
 
-        _twr_uart[channel].async_write_in_progress = true;
+        // Load transmit data register
+        usart->TDR = character;
     }
 
-    return bytes_written;
+    // Until transmission is not complete...
+    while ((usart->ISR & USART_ISR_TC) == 0)
+    {
+        continue;
+    }
+
+    twr_irq_disable();
+
+    // Enable transmission complete interrupt, so that task reports async write as done
+    usart->CR1 |= USART_CR1_TCIE;
+
+    twr_irq_enable();
 }
 
 bool twr_uart_async_read_start(twr_uart_channel_t channel, twr_tick_t timeout)
@@ -459,34 +566,7 @@ bool twr_uart_async_read_start(twr_uart_channel_t channel, twr_tick_t timeout)
 
     _twr_uart[channel].async_read_task_id = twr_scheduler_register(_twr_uart_async_read_task, (void *) channel, _twr_uart[channel].async_timeout);
 
-    if (channel == TWR_UART_UART2)
-    {
-        twr_dma_channel_config_t config = {
-                .request = TWR_DMA_REQUEST_3,
-                .direction = TWR_DMA_DIRECTION_TO_RAM,
-                .data_size_memory = TWR_DMA_SIZE_1,
-                .data_size_peripheral = TWR_DMA_SIZE_1,
-                .length = _twr_uart[channel].read_fifo->size,
-                .mode = TWR_DMA_MODE_CIRCULAR,
-                .address_memory = _twr_uart[channel].read_fifo->buffer,
-                .address_peripheral = (void *) &_twr_uart[channel].usart->RDR,
-                .priority = TWR_DMA_PRIORITY_HIGH
-        };
-
-        twr_dma_init();
-
-        twr_dma_channel_config(TWR_DMA_CHANNEL_3, &config);
-
-        _twr_uart_2_dma.read_task_id = twr_scheduler_register(_twr_uart_2_dma_read_task, (void *) channel, 0);
-
-        twr_irq_disable();
-        // Enable receive DMA interrupt
-        _twr_uart[channel].usart->CR3 |=  USART_CR3_DMAR;
-        twr_irq_enable();
-
-        twr_dma_channel_run(TWR_DMA_CHANNEL_3);
-    }
-    else
+    if (!_twr_uart_dma_read_start(channel))
     {
         twr_irq_disable();
         // Enable receive interrupt
@@ -513,16 +593,19 @@ bool twr_uart_async_read_cancel(twr_uart_channel_t channel)
 
     _twr_uart[channel].async_read_in_progress = false;
 
-    if (channel == TWR_UART_UART2)
+    if (_twr_uart[channel].dma_read)
     {
-        twr_dma_channel_stop(TWR_DMA_CHANNEL_3);
-
-        twr_scheduler_unregister(_twr_uart_2_dma.read_task_id);
+        twr_dma_channel_stop(_twr_uart[channel].dma_read_channel);
 
         twr_irq_disable();
-        // Disable receive DMA interrupt
+
+        // Disable receive DMA and idle line interrupt
         _twr_uart[channel].usart->CR3 &= ~USART_CR3_DMAR_Msk;
+        _twr_uart[channel].usart->CR1 &= ~USART_CR1_IDLEIE_Msk;
+
         twr_irq_enable();
+
+        _twr_uart[channel].dma_read = false;
     }
     else
     {
@@ -556,6 +639,82 @@ size_t twr_uart_async_read(twr_uart_channel_t channel, void *buffer, size_t leng
     return bytes_read;
 }
 
+static void _twr_uart_async_write_start(twr_uart_channel_t channel)
+{
+    twr_uart_t *uart = &_twr_uart[channel];
+
+    twr_irq_disable();
+
+    // Disable transmission complete interrupt, more data are coming
+    uart->usart->CR1 &= ~USART_CR1_TCIE_Msk;
+
+    // Transmission complete which has not been processed yet is outdated
+    uart->defer_tc_pending = false;
+
+    twr_irq_enable();
+
+    if (!uart->async_write_in_progress)
+    {
+        uart->async_write_task_id = twr_scheduler_register(_twr_uart_async_write_task, (void *) channel, TWR_TICK_INFINITY);
+
+        if (uart->usart == LPUART1)
+        {
+            twr_system_deep_sleep_disable();
+        }
+        else
+        {
+            twr_system_pll_enable();
+        }
+
+        uart->dma_write = _twr_uart_dma_write_start(channel);
+
+        uart->async_write_in_progress = true;
+    }
+    else
+    {
+        twr_scheduler_plan_absolute(uart->async_write_task_id, TWR_TICK_INFINITY);
+    }
+
+    if (uart->dma_write)
+    {
+        if (!uart->dma_write_busy)
+        {
+            _twr_uart_dma_write_next(channel);
+        }
+    }
+    else
+    {
+        twr_irq_disable();
+
+        // Enable transmit interrupt
+        uart->usart->CR1 |= USART_CR1_TXEIE;
+
+        twr_irq_enable();
+    }
+}
+
+static void _twr_uart_async_write_finish(twr_uart_channel_t channel)
+{
+    twr_uart_t *uart = &_twr_uart[channel];
+
+    // Write in progress is completed and reported, done handler may start another one
+    while (uart->initialized && uart->async_write_in_progress)
+    {
+        twr_uart_flush(channel);
+
+        twr_irq_disable();
+
+        // Disable transmission complete interrupt, task is run right away
+        uart->usart->CR1 &= ~USART_CR1_TCIE_Msk;
+
+        uart->defer_tc_pending = false;
+
+        twr_irq_enable();
+
+        _twr_uart_async_write_task((void *) channel);
+    }
+}
+
 static void _twr_uart_async_write_task(void *param)
 {
     twr_uart_channel_t channel = (twr_uart_channel_t) param;
@@ -565,6 +724,20 @@ static void _twr_uart_async_write_task(void *param)
 
     twr_scheduler_unregister(uart->async_write_task_id);
 
+    if (uart->dma_write)
+    {
+        twr_irq_disable();
+
+        // Disable transmit DMA
+        uart->usart->CR3 &= ~USART_CR3_DMAT_Msk;
+
+        twr_irq_enable();
+
+        uart->dma_write = false;
+
+        twr_dma_channel_return(uart->dma_write_channel);
+    }
+
     if (uart->usart == LPUART1)
     {
         twr_system_deep_sleep_enable();
@@ -574,6 +747,16 @@ static void _twr_uart_async_write_task(void *param)
         twr_system_pll_disable();
     }
 
+    if (uart->writev_count != 0)
+    {
+        uart->writev_count = 0;
+
+        if (uart->writev_done_handler != NULL)
+        {
+            uart->writev_done_handler(channel, uart->writev_done_param);
+        }
+    }
+
     if (uart->event_handler != NULL)
     {
         uart->event_handler(channel, TWR_UART_EVENT_ASYNC_WRITE_DONE, uart->event_param);
@@ -600,29 +783,371 @@ static void _twr_uart_async_read_task(void *param)
     }
 }
 
-static void _twr_uart_2_dma_read_task(void *param)
+static bool _twr_uart_dma_read_start(twr_uart_channel_t channel)
 {
-    (void) param;
+    twr_uart_t *uart = &_twr_uart[channel];
+    twr_dma_channel_t dma_channel;
+    twr_dma_request_t request;
+
+    // LPUART receives in Stop mode, where DMA does not run, so it wakes MCU up by interrupt on every byte instead
+    if (uart->usart == USART1)
+    {
+        dma_channel = TWR_DMA_CHANNEL_3;
+        request = TWR_DMA_REQUEST_3;
+    }
+    else if (uart->usart == USART2)
+    {
+        dma_channel = TWR_DMA_CHANNEL_6;
+        request = TWR_DMA_REQUEST_4;
+    }
+    else if (uart->usart == USART4)
+    {
+        dma_channel = TWR_DMA_CHANNEL_6;
+        request = TWR_DMA_REQUEST_12;
+    }
+    else
+    {
+        return false;
+    }
+
+    // UART0 and UART1 share DMA channel, the one which starts reading later is served by interrupt
+    for (int i = 0; i < 3; i++)
+    {
+        if (_twr_uart[i].dma_read && (_twr_uart[i].dma_read_channel == dma_channel))
+        {
+            return false;
+        }
+    }
 
-    size_t length = twr_dma_channel_get_length(TWR_DMA_CHANNEL_3);
+    twr_dma_channel_config_t config = {
+            .request = request,
+            .direction = TWR_DMA_DIRECTION_TO_RAM,
+            .data_size_memory = TWR_DMA_SIZE_1,
+            .data_size_peripheral = TWR_DMA_SIZE_1,
+            .length = uart->read_fifo->size,
+            .mode = TWR_DMA_MODE_CIRCULAR,
+            .address_memory = uart->read_fifo->buffer,
+            .address_peripheral = (void *) &uart->usart->RDR,
+            .priority = TWR_DMA_PRIORITY_HIGH
+    };
 
-    twr_uart_t *uart = &_twr_uart[TWR_UART_UART2];
+    // DMA fills FIFO from start of buffer on
+    twr_fifo_purge(uart->read_fifo);
+
+    twr_dma_init();
+
+    twr_dma_channel_config(dma_channel, &config);
+
+    twr_dma_set_event_handler(dma_channel, _twr_uart_dma_read_event_handler, (void *) channel);
+
+    uart->dma_read = true;
+    uart->dma_read_channel = dma_channel;
+
+    twr_irq_disable();
+
+    // Enable receive DMA and idle line interrupt
+    uart->usart->ICR = USART_ICR_IDLECF;
+    uart->usart->CR3 |= USART_CR3_DMAR;
+    uart->usart->CR1 |= USART_CR1_IDLEIE;
+
+    twr_irq_enable();
+
+    twr_dma_channel_run(dma_channel);
+
+    return true;
+}
 
-    if (_twr_uart_2_dma.length != length)
+static void _twr_uart_dma_read_update(twr_uart_channel_t channel)
+{
+    twr_uart_t *uart = &_twr_uart[channel];
+
+    // DMA counts down remaining transfers and reloads at the end of buffer
+    size_t head = uart->read_fifo->size - twr_dma_channel_get_length(uart->dma_read_channel);
+
+    if (head == uart->read_fifo->size)
     {
-        uart->read_fifo->head = uart->read_fifo->size - length;
+        head = 0;
+    }
 
-        _twr_uart_2_dma.length = length;
+    if (head != uart->read_fifo->head)
+    {
+        uart->read_fifo->head = head;
 
         twr_scheduler_plan_now(uart->async_read_task_id);
     }
+}
+
+static void _twr_uart_dma_read_event_handler(twr_dma_channel_t dma_channel, twr_dma_event_t event, void *event_param)
+{
+    (void) dma_channel;
+    (void) event;
+
+    twr_uart_channel_t channel = (twr_uart_channel_t) event_param;
+
+    // Half and full transfer hand data over while line is still busy, interrupt may update head if deferred ring is full
+    twr_irq_disable();
+
+    if (_twr_uart[channel].dma_read)
+    {
+        _twr_uart_dma_read_update(channel);
+    }
+
+    twr_irq_enable();
+}
+
+static bool _twr_uart_writev_read(twr_uart_t *uart, uint8_t *character)
+{
+    while (uart->writev_index < uart->writev_count)
+    {
+        const twr_uart_segment_t *segment = &uart->writev_segment[uart->writev_index];
+
+        if (uart->writev_offset < segment->length)
+        {
+            *character = ((const uint8_t *) segment->buffer)[uart->writev_offset++];
+
+            return true;
+        }
+
+        uart->writev_index++;
+        uart->writev_offset = 0;
+    }
+
+    return false;
+}
+
+static bool _twr_uart_dma_write_start(twr_uart_channel_t channel)
+{
+    twr_uart_t *uart = &_twr_uart[channel];
+    twr_dma_channel_t dma_channel;
+
+    // Channel 2 is left to LED strip and DAC, UART2 can only use channel 4 which it shares with DAC
+    if (uart->usart == USART1)
+    {
+        dma_channel = TWR_DMA_CHANNEL_4;
+    }
+    else
+    {
+        dma_channel = TWR_DMA_CHANNEL_7;
+    }
+
+    twr_dma_init();
+
+    // Channel is borrowed for single async write, UART which finds it used by DAC or by the other UART is served by interrupt
+    if (!twr_dma_channel_borrow(dma_channel, _twr_uart_dma_write_event_handler, _twr_uart_dma_write_release_handler, (void *) channel))
+    {
+        return false;
+    }
+
+    uart->dma_write_channel = dma_channel;
+    uart->dma_write_busy = false;
+
+    twr_irq_disable();
+
+    // Enable transmit DMA
+    uart->usart->CR3 |= USART_CR3_DMAT;
+
+    twr_irq_enable();
+
+    return true;
+}
+
+static void _twr_uart_dma_write_next(twr_uart_channel_t channel)
+{
+    twr_uart_t *uart = &_twr_uart[channel];
+    void *buffer = NULL;
+    size_t length = 0;
+
+    // Segments go first, then whatever has been added to FIFO, each transferred from where it is
+    while (uart->writev_index < uart->writev_count)
+    {
+        const twr_uart_segment_t *segment = &uart->writev_segment[uart->writev_index];
+
+        if (uart->writev_offset < segment->length)
+        {
+            buffer = (uint8_t *) segment->buffer + uart->writev_offset;
+            length = segment->length - uart->writev_offset;
+
+            break;
+        }
+
+        uart->writev_index++;
+        uart->writev_offset = 0;
+    }
+
+    uart->dma_write_fifo = length == 0;
+
+    if (uart->dma_write_fifo && uart->write_fifo != NULL)
+    {
+        length = twr_fifo_get_read_span(uart->write_fifo, &buffer);
+    }
+
+    if (length == 0)
+    {
+        uart->dma_write_busy = false;
+
+        twr_irq_disable();
+
+        // Enable transmission complete interrupt
+        uart->usart->CR1 |= USART_CR1_TCIE;
+
+        twr_irq_enable();
+
+        return;
+    }
+
+    // Transfer counter has 16 bits
+    if (length > 0xffff)
+    {
+        length = 0xffff;
+    }
 
-    twr_scheduler_plan_current_now();
+    twr_dma_channel_config_t config = {
+            .request = TWR_DMA_REQUEST_3,
+            .direction = TWR_DMA_DIRECTION_TO_PERIPHERAL,
+            .data_size_memory = TWR_DMA_SIZE_1,
+            .data_size_peripheral = TWR_DMA_SIZE_1,
+            .length = length,
+            .mode = TWR_DMA_MODE_STANDARD,
+            .address_memory = buffer,
+            .address_peripheral = (void *) &uart->usart->TDR,
+            .priority = TWR_DMA_PRIORITY_MEDIUM
+    };
+
+    if (uart->usart == USART2)
+    {
+        config.request = TWR_DMA_REQUEST_4;
+    }
+    else if (uart->usart == LPUART1)
+    {
+        config.request = TWR_DMA_REQUEST_5;
+    }
+    else if (uart->usart == USART4)
+    {
+        config.request = TWR_DMA_REQUEST_12;
+    }
+
+    uart->dma_write_length = length;
+    uart->dma_write_busy = true;
+
+    twr_dma_channel_config(uart->dma_write_channel, &config);
+
+    // Clear transmission complete flag, it is waited for again once DMA is done
+    uart->usart->ICR = USART_ICR_TCCF;
+
+    twr_dma_channel_run(uart->dma_write_channel);
+}
+
+static void _twr_uart_dma_write_done(twr_uart_t *uart)
+{
+    if (uart->dma_write_fifo)
+    {
+        twr_fifo_commit_read(uart->write_fifo, uart->dma_write_length);
+    }
+    else
+    {
+        uart->writev_offset += uart->dma_write_length;
+    }
+
+    uart->dma_write_busy = false;
+}
+
+static void _twr_uart_dma_write_event_handler(twr_dma_channel_t dma_channel, twr_dma_event_t event, void *event_param)
+{
+    twr_uart_channel_t channel = (twr_uart_channel_t) event_param;
+    twr_uart_t *uart = &_twr_uart[channel];
+
+    // Event of transfer completed by twr_uart_flush may come while the next one is running
+    if (event != TWR_DMA_EVENT_DONE || !uart->dma_write || !uart->dma_write_busy || twr_dma_channel_get_length(dma_channel) != 0)
+    {
+        return;
+    }
+
+    _twr_uart_dma_write_done(uart);
+
+    _twr_uart_dma_write_next(channel);
+}
+
+static void _twr_uart_dma_write_release_handler(twr_dma_channel_t dma_channel, void *param)
+{
+    twr_uart_channel_t channel = (twr_uart_channel_t) param;
+    twr_uart_t *uart = &_twr_uart[channel];
+    bool busy = uart->dma_write_busy;
+
+    if (busy)
+    {
+        // Transfer in progress is completed, event it reports is ignored
+        while (twr_dma_channel_get_length(dma_channel) != 0)
+        {
+            continue;
+        }
+
+        twr_dma_channel_stop(dma_channel);
+
+        _twr_uart_dma_write_done(uart);
+    }
+
+    uart->dma_write = false;
+
+    twr_irq_disable();
+
+    // Disable transmit DMA
+    uart->usart->CR3 &= ~USART_CR3_DMAT_Msk;
+
+    // Rest of data is written by interrupt, otherwise transmission complete interrupt has been enabled already
+    if (busy)
+    {
+        uart->usart->CR1 |= USART_CR1_TXEIE;
+    }
+
+    twr_irq_enable();
+}
+
+static void _twr_uart_defer_handler(const void *item, void *param)
+{
+    twr_uart_channel_t channel = (twr_uart_channel_t) param;
+    twr_uart_t *uart = &_twr_uart[channel];
+    uint8_t event = *(const uint8_t *) item;
+
+    // Flag is cleared first, so that event raised while it is processed is deferred again
+    if (event == _TWR_UART_DEFER_RX)
+    {
+        uart->defer_rx_pending = false;
+
+        if (uart->async_read_in_progress)
+        {
+            twr_scheduler_plan_now(uart->async_read_task_id);
+        }
+    }
+    else if (event == _TWR_UART_DEFER_IDLE)
+    {
+        uart->defer_idle_pending = false;
+
+        twr_irq_disable();
+
+        if (uart->dma_read)
+        {
+            _twr_uart_dma_read_update(channel);
+        }
+
+        twr_irq_enable();
+    }
+    else if (event == _TWR_UART_DEFER_TC)
+    {
+        // Async write might have been continued or completed by flush meanwhile
+        if (uart->defer_tc_pending)
+        {
+            uart->defer_tc_pending = false;
+
+            twr_scheduler_plan_now(uart->async_write_task_id);
+        }
+    }
 }
 
 static void _twr_uart_irq_handler(twr_uart_channel_t channel)
 {
-    USART_TypeDef *usart = _twr_uart[channel].usart;
+    twr_uart_t *uart = &_twr_uart[channel];
+    twr_defer_t *defer = &_twr_uart_defer[channel].defer;
+    USART_TypeDef *usart = uart->usart;
 
     if ((usart->CR1 & USART_CR1_RXNEIE) != 0 && (usart->ISR & USART_ISR_RXNE) != 0)
     {
@@ -631,9 +1156,44 @@ static void _twr_uart_irq_handler(twr_uart_channel_t channel)
         // Read receive data register
         character = usart->RDR;
 
-        twr_fifo_irq_write(_twr_uart[channel].read_fifo, &character, 1);
+        twr_fifo_irq_write(uart->read_fifo, &character, 1);
+
+        // Burst of characters is reported once
+        if (!uart->defer_rx_pending)
+        {
+            uint8_t event = _TWR_UART_DEFER_RX;
 
-        twr_scheduler_plan_now(_twr_uart[channel].async_read_task_id);
+            uart->defer_rx_pending = true;
+
+            // Read task is planned right away if ring is full
+            if (!twr_defer_irq_push(defer, &event))
+            {
+                uart->defer_rx_pending = false;
+
+                twr_scheduler_plan_now(uart->async_read_task_id);
+            }
+        }
+    }
+
+    // If line went idle after reception by DMA...
+    if ((usart->CR1 & USART_CR1_IDLEIE) != 0 && (usart->ISR & USART_ISR_IDLE) != 0)
+    {
+        // Clear idle line flag
+        usart->ICR = USART_ICR_IDLECF;
+
+        if (!uart->defer_idle_pending)
+        {
+            uint8_t event = _TWR_UART_DEFER_IDLE;
+
+            uart->defer_idle_pending = true;
+
+            if (!twr_defer_irq_push(defer, &event))
+            {
+                uart->defer_idle_pending = false;
+
+                _twr_uart_dma_read_update(channel);
+            }
+        }
     }
 
     // If it is transmit interrupt...
@@ -641,8 +1201,9 @@ static void _twr_uart_irq_handler(twr_uart_channel_t channel)
     {
         uint8_t character;
 
-        // If there are still data in FIFO...
-        if (twr_fifo_irq_read(_twr_uart[channel].write_fifo, &character, 1) != 0)
+        // If there are still data in segments or FIFO...
+        if (_twr_uart_writev_read(uart, &character) ||
+            (uart->write_fifo != NULL && twr_fifo_irq_read(uart->write_fifo, &character, 1) != 0))
         {
             // Load transmit data register
             usart->TDR = character;
@@ -660,10 +1221,19 @@ static void _twr_uart_irq_handler(twr_uart_channel_t channel)
     // If it is transmit interrupt...
     if ((usart->CR1 & USART_CR1_TCIE) != 0 && (usart->ISR & USART_ISR_TC) != 0)
     {
+        uint8_t event = _TWR_UART_DEFER_TC;
+
         // Disable transmission complete interrupt
         usart->CR1 &= ~USART_CR1_TCIE;
 
-        twr_scheduler_plan_now(_twr_uart[channel].async_write_task_id);
+        uart->defer_tc_pending = true;
+
+        if (!twr_defer_irq_push(defer, &event))
+        {
+            uart->defer_tc_pending = false;
+
+            twr_scheduler_plan_now(uart->async_write_task_id);
+        }
     }
 }
 
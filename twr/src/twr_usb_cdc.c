@@ -1,5 +1,6 @@
 #include <twr_usb_cdc.h>
 #include <twr_scheduler.h>
+#include <twr_event_flags.h>
 #include <twr_fifo.h>
 #include <twr_system.h>
 
@@ -10,6 +11,8 @@
 
 #include <stm32l0xx.h>
 
+#define _TWR_USB_CDC_FLAG_TRANSMIT_DONE (1 << 0)
+
 static struct
 {
     twr_fifo_t receive_fifo;
@@ -17,6 +20,7 @@ static struct
     uint8_t transmit_buffer[512];
     size_t transmit_length;
     twr_scheduler_task_id_t task_id;
+    twr_event_flags_t event_flags;
 
 } _twr_usb_cdc;
 
@@ -26,10 +30,14 @@ static void _twr_usb_cdc_task_start(void *param);
 static void _twr_usb_cdc_task(void *param);
 static void _twr_usb_cdc_init_hsi48();
 
+void twr_usb_cdc_transmit_done(void);
+
 void twr_usb_cdc_init(void)
 {
     memset(&_twr_usb_cdc, 0, sizeof(_twr_usb_cdc));
 
+    twr_event_flags_init(&_twr_usb_cdc.event_flags);
+
     _twr_usb_cdc_init_hsi48();
 
     twr_fifo_init(&_twr_usb_cdc.receive_fifo, _twr_usb_cdc.receive_buffer, sizeof(_twr_usb_cdc.receive_buffer));
@@ -91,6 +99,11 @@ void twr_usb_cdc_received_data(const void *buffer, size_t length)
     twr_fifo_irq_write(&_twr_usb_cdc.receive_fifo, (uint8_t *) buffer, length);
 }
 
+void twr_usb_cdc_transmit_done(void)
+{
+    twr_event_flags_set(&_twr_usb_cdc.event_flags, _TWR_USB_CDC_FLAG_TRANSMIT_DONE);
+}
+
 static void _twr_usb_cdc_task_start(void *param)
 {
     (void) param;
@@ -111,6 +124,8 @@ static void _twr_usb_cdc_task(void *param)
         return;
     }
 
+    twr_event_flags_clear(&_twr_usb_cdc.event_flags, _TWR_USB_CDC_FLAG_TRANSMIT_DONE);
+
     HAL_NVIC_DisableIRQ(USB_IRQn);
 
     if (CDC_Transmit_FS(_twr_usb_cdc.transmit_buffer, _twr_usb_cdc.transmit_length) == USBD_OK)
@@ -120,7 +135,11 @@ static void _twr_usb_cdc_task(void *param)
 
     HAL_NVIC_EnableIRQ(USB_IRQn);
 
-    twr_scheduler_plan_current_now();
+    if (_twr_usb_cdc.transmit_length != 0)
+    {
+        // Previous transfer is still in progress, try again once it is done
+        twr_event_flags_wait(&_twr_usb_cdc.event_flags, _TWR_USB_CDC_FLAG_TRANSMIT_DONE, TWR_TICK_INFINITY);
+    }
 }
 
 static void _twr_usb_cdc_init_hsi48()
@@ -1,6 +1,7 @@
 #include "stm32l0xx.h"
 #include <twr_ws2812b.h>
 #include <twr_scheduler.h>
+#include <twr_event_flags.h>
 #include <twr_dma.h>
 #include <twr_system.h>
 #include <twr_timer.h>
@@ -14,6 +15,8 @@
 #define _TWR_WS2812_TWR_WS2812B_PORT GPIOA
 #define _TWR_WS2812_TWR_WS2812B_PIN GPIO_PIN_1
 
+#define _TWR_WS2812_FLAG_READY (1 << 0)
+
 static struct ws2812b_t
 {
     uint32_t *dma_bit_buffer;
@@ -21,6 +24,7 @@ static struct ws2812b_t
 
     bool transfer;
     twr_scheduler_task_id_t task_id;
+    twr_event_flags_t event_flags;
     void (*event_handler)(twr_ws2812b_event_t, void *);
     void *event_param;
 
@@ -123,6 +127,10 @@ bool twr_ws2812b_init(const twr_led_strip_buffer_t *led_strip)
 
     _twr_ws2812b.transfer = false;
 
+    twr_event_flags_init(&_twr_ws2812b.event_flags);
+
+    twr_event_flags_set(&_twr_ws2812b.event_flags, _TWR_WS2812_FLAG_READY);
+
     return true;
 }
 
@@ -222,6 +230,8 @@ bool twr_ws2812b_write(void)
     // transmission complete flag
     _twr_ws2812b.transfer = true;
 
+    twr_event_flags_clear(&_twr_ws2812b.event_flags, _TWR_WS2812_FLAG_READY);
+
     twr_system_pll_enable();
 
     HAL_TIM_Base_Stop(&_twr_ws2812b_timer2_handle);
@@ -262,6 +272,11 @@ bool twr_ws2812b_is_ready(void)
     return !_twr_ws2812b.transfer;
 }
 
+void twr_ws2812b_wait_ready(void)
+{
+    twr_event_flags_wait(&_twr_ws2812b.event_flags, _TWR_WS2812_FLAG_READY, TWR_TICK_INFINITY);
+}
+
 static void _twr_ws2812b_dma_event_handler(twr_dma_channel_t channel, twr_dma_event_t event, void *event_param)
 {
     (void) channel;
@@ -332,6 +347,8 @@ static void _twr_ws2812b_task(void *param)
     // set transfer_complete flag
     _twr_ws2812b.transfer = false;
 
+    twr_event_flags_set(&_twr_ws2812b.event_flags, _TWR_WS2812_FLAG_READY);
+
     if (_twr_ws2812b.event_handler != NULL)
     {
         _twr_ws2812b.event_handler(TWR_WS2812B_SEND_DONE, _twr_ws2812b.event_param);
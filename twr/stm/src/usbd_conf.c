@@ -61,6 +61,7 @@ PCD_HandleTypeDef hpcd_USB_FS;
 /* Private functions ---------------------------------------------------------*/
 /* USER CODE BEGIN 1 */
 static void SystemClockConfig_Resume(void);
+void twr_usb_cdc_transmit_done(void);
 /* USER CODE END 1 */
 void HAL_PCDEx_SetConnectionState(PCD_HandleTypeDef *hpcd, uint8_t state);
 
@@ -137,6 +138,11 @@ void HAL_PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 {
   USBD_LL_DataInStage((USBD_HandleTypeDef*)hpcd->pData, epnum, hpcd->IN_ep[epnum].xfer_buff);
+
+  if (epnum == (CDC_IN_EP & 0x7F))
+  {
+    twr_usb_cdc_transmit_done();
+  }
 }
 
 /**